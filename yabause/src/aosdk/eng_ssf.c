@@ -259,7 +259,12 @@ s32 ssf_gen(s16 *buffer, u32 samples)
 	{
 		s32 bufL=0, bufR=0;
 		s16 buf16[2];
+#if defined(ASYNC_SCSP)
+		// M68KExec() is a stub when the sound CPU runs on its own thread
+		MM68KExec((11300000/60)/735);
+#else
 		M68KExec((11300000/60)/735);
+#endif
 		scsp_update_timer(1);
 		scsp_update(&bufL, &bufR, 1);
 		scsp_update_monitor();
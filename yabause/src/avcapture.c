@@ -0,0 +1,437 @@
+/*  This file is part of Yabause.
+
+    Yabause is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Yabause is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Yabause; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+/*! \file avcapture.c
+    \brief Audio and video capture written from a background thread.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "avcapture.h"
+#include "debug.h"
+#include "threads.h"
+#include "yabause.h"
+
+#ifdef _MSC_VER
+#include <windows.h>
+#define AVCAPTURE_BARRIER() MemoryBarrier()
+#else
+#define AVCAPTURE_BARRIER() __sync_synchronize()
+#endif
+
+// Both rings have a single producer, the sound output for audio and the
+// renderer for video, and the writer thread as their single consumer.
+// head is only written by the producer, tail only by the consumer.
+
+#define AVCAPTURE_AUDIO_BLOCKS        256  // power of two
+#define AVCAPTURE_AUDIO_BLOCK_SAMPLES 2048
+#define AVCAPTURE_VIDEO_FRAMES        16   // power of two
+#define AVCAPTURE_VIDEO_MAX_WIDTH     704
+#define AVCAPTURE_VIDEO_MAX_HEIGHT    512
+
+#define AVCAPTURE_WAV_HEADER_SIZE 44
+
+typedef struct
+{
+   u32 num_samples;
+   s16 data[AVCAPTURE_AUDIO_BLOCK_SAMPLES * 2];
+} avcaptureaudio_struct;
+
+typedef struct
+{
+   int width;
+   int height;
+   pixel_t * pixels;
+} avcapturevideo_struct;
+
+volatile int AVCaptureAudioActive = 0;
+volatile int AVCaptureVideoActive = 0;
+
+static struct
+{
+   volatile int running;
+   u32 audio_dropped;          // one counter per producer
+   u32 video_dropped;
+
+   FILE * audio_fp;
+   int audio_format;
+   u32 audio_bytes;
+   avcaptureaudio_struct * audio;
+   volatile u32 audio_head;
+   volatile u32 audio_tail;
+
+   FILE * video_fp;
+   int video_width;            // from the first frame, 0 until then
+   int video_height;
+   u8 * video_planes;
+   avcapturevideo_struct video[AVCAPTURE_VIDEO_FRAMES];
+   volatile u32 video_head;
+   volatile u32 video_tail;
+} avcapture;
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void AVCapturePut16(u8 * buf, u16 val)
+{
+   buf[0] = (u8)val;
+   buf[1] = (u8)(val >> 8);
+}
+
+static void AVCapturePut32(u8 * buf, u32 val)
+{
+   buf[0] = (u8)val;
+   buf[1] = (u8)(val >> 8);
+   buf[2] = (u8)(val >> 16);
+   buf[3] = (u8)(val >> 24);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void AVCaptureWriteWavHeader(FILE * fp, u32 data_size)
+{
+   u8 header[AVCAPTURE_WAV_HEADER_SIZE];
+
+   memcpy(header, "RIFF", 4);
+   AVCapturePut32(header + 4, data_size + AVCAPTURE_WAV_HEADER_SIZE - 8);
+   memcpy(header + 8, "WAVEfmt ", 8);
+   AVCapturePut32(header + 16, 16);
+   AVCapturePut16(header + 20, 1);          // PCM
+   AVCapturePut16(header + 22, 2);          // stereo
+   AVCapturePut32(header + 24, 44100);
+   AVCapturePut32(header + 28, 44100 * 4);
+   AVCapturePut16(header + 32, 4);
+   AVCapturePut16(header + 34, 16);
+   memcpy(header + 36, "data", 4);
+   AVCapturePut32(header + 40, data_size);
+
+   fseek(fp, 0, SEEK_SET);
+   fwrite(header, 1, sizeof(header), fp);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int AVCaptureDrainAudio(void)
+{
+   u32 tail = avcapture.audio_tail;
+   int count = 0;
+
+   while (tail != avcapture.audio_head)
+   {
+      avcaptureaudio_struct * block;
+      u8 out[AVCAPTURE_AUDIO_BLOCK_SAMPLES * 4];
+      u32 i;
+
+      AVCAPTURE_BARRIER();
+      block = &avcapture.audio[tail & (AVCAPTURE_AUDIO_BLOCKS - 1)];
+
+      // samples go out little endian whatever the host is
+      for (i = 0; i < block->num_samples * 2; i++)
+         AVCapturePut16(out + i * 2, (u16)block->data[i]);
+
+      fwrite(out, 4, block->num_samples, avcapture.audio_fp);
+      avcapture.audio_bytes += block->num_samples * 4;
+
+      AVCAPTURE_BARRIER();
+      avcapture.audio_tail = ++tail;
+      count++;
+   }
+
+   return count;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void AVCaptureWriteFrame(const avcapturevideo_struct * frame)
+{
+   int width = avcapture.video_width, height = avcapture.video_height;
+   u8 * y = avcapture.video_planes;
+   u8 * u = y + width * height;
+   u8 * v = u + width * height;
+   int i, j;
+
+   if (width == 0)
+   {
+      width = avcapture.video_width = frame->width;
+      height = avcapture.video_height = frame->height;
+      fprintf(avcapture.video_fp, "YUV4MPEG2 W%d H%d F%s Ip A1:1 C444\n",
+         width, height, yabsys.IsPal ? "50:1" : "60000:1001");
+      u = y + width * height;
+      v = u + width * height;
+   }
+
+   // black outside of the captured frame
+   memset(y, 16, width * height);
+   memset(u, 128, width * height * 2);
+
+   for (j = 0; j < height && j < frame->height; j++)
+   {
+      const pixel_t * src = frame->pixels + j * frame->width;
+      int pos = j * width;
+
+      for (i = 0; i < width && i < frame->width; i++, pos++)
+      {
+         // BT.601 studio range
+         int r = src[i] & 0xFF;
+         int g = (src[i] >> 8) & 0xFF;
+         int b = (src[i] >> 16) & 0xFF;
+
+         y[pos] = (u8)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+         u[pos] = (u8)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+         v[pos] = (u8)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+      }
+   }
+
+   fputs("FRAME\n", avcapture.video_fp);
+   fwrite(avcapture.video_planes, 1, width * height * 3, avcapture.video_fp);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int AVCaptureDrainVideo(void)
+{
+   u32 tail = avcapture.video_tail;
+   int count = 0;
+
+   while (tail != avcapture.video_head)
+   {
+      AVCAPTURE_BARRIER();
+      AVCaptureWriteFrame(&avcapture.video[tail & (AVCAPTURE_VIDEO_FRAMES - 1)]);
+
+      AVCAPTURE_BARRIER();
+      avcapture.video_tail = ++tail;
+      count++;
+   }
+
+   return count;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void * AVCaptureThread(UNUSED void * arg)
+{
+   for (;;)
+   {
+      int count = 0;
+
+      if (avcapture.audio_fp != NULL)
+         count += AVCaptureDrainAudio();
+      if (avcapture.video_fp != NULL)
+         count += AVCaptureDrainVideo();
+
+      if (count == 0)
+      {
+         // everything queued before the stop is written out first
+         if (!avcapture.running)
+            break;
+         YabThreadUSleep(2000);
+      }
+   }
+
+   return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void AVCaptureFree(void)
+{
+   int i;
+
+   if (avcapture.audio_fp != NULL)
+   {
+      if (avcapture.audio_format == AVCAPTURE_AUDIO_WAV)
+         AVCaptureWriteWavHeader(avcapture.audio_fp, avcapture.audio_bytes);
+      fclose(avcapture.audio_fp);
+   }
+
+   if (avcapture.video_fp != NULL)
+      fclose(avcapture.video_fp);
+
+   free(avcapture.audio);
+   free(avcapture.video_planes);
+   for (i = 0; i < AVCAPTURE_VIDEO_FRAMES; i++)
+      free(avcapture.video[i].pixels);
+
+   memset(&avcapture, 0, sizeof(avcapture));
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Either file name may be NULL to capture only the other stream
+int AVCaptureStart(const char * audio_filename, int audio_format, const char * video_filename)
+{
+   int i;
+
+   if (avcapture.running)
+      return -1;
+
+   memset(&avcapture, 0, sizeof(avcapture));
+
+   if (audio_filename != NULL && audio_filename[0] != '\0')
+   {
+      avcapture.audio_format = audio_format;
+      avcapture.audio = (avcaptureaudio_struct *)malloc(AVCAPTURE_AUDIO_BLOCKS * sizeof(avcaptureaudio_struct));
+      if (avcapture.audio == NULL || (avcapture.audio_fp = fopen(audio_filename, "wb")) == NULL)
+         goto fail;
+
+      if (audio_format == AVCAPTURE_AUDIO_WAV)
+         AVCaptureWriteWavHeader(avcapture.audio_fp, 0);
+   }
+
+   if (video_filename != NULL && video_filename[0] != '\0')
+   {
+#ifdef USE_16BPP
+      LOG("avcapture: video capture needs 32-bit pixels");
+      goto fail;
+#endif
+      for (i = 0; i < AVCAPTURE_VIDEO_FRAMES; i++)
+      {
+         avcapture.video[i].pixels = (pixel_t *)malloc(AVCAPTURE_VIDEO_MAX_WIDTH * AVCAPTURE_VIDEO_MAX_HEIGHT * sizeof(pixel_t));
+         if (avcapture.video[i].pixels == NULL)
+            goto fail;
+      }
+
+      avcapture.video_planes = (u8 *)malloc(AVCAPTURE_VIDEO_MAX_WIDTH * AVCAPTURE_VIDEO_MAX_HEIGHT * 3);
+      if (avcapture.video_planes == NULL || (avcapture.video_fp = fopen(video_filename, "wb")) == NULL)
+         goto fail;
+   }
+
+   if (avcapture.audio_fp == NULL && avcapture.video_fp == NULL)
+      return 0;
+
+   avcapture.running = 1;
+   if (YabThreadStart(YAB_THREAD_AVCAPTURE, "avcapture", AVCaptureThread, NULL) != 0)
+      goto fail;
+
+   AVCaptureAudioActive = avcapture.audio_fp != NULL;
+   AVCaptureVideoActive = avcapture.video_fp != NULL;
+   return 0;
+
+fail:
+   AVCaptureFree();
+   return -1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Call it once the sound output and the renderer are done producing
+void AVCaptureStop(void)
+{
+   if (!avcapture.running)
+      return;
+
+   AVCaptureAudioActive = 0;
+   AVCaptureVideoActive = 0;
+
+   avcapture.running = 0;
+   YabThreadWait(YAB_THREAD_AVCAPTURE);
+
+   if (avcapture.audio_dropped || avcapture.video_dropped)
+   {
+      LOG("avcapture: dropped %u audio blocks and %u frames",
+         (unsigned)avcapture.audio_dropped, (unsigned)avcapture.video_dropped);
+   }
+
+   AVCaptureFree();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int AVCaptureIsRunning(void)
+{
+   return avcapture.running;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void AVCaptureAudio(const s32 * left, const s32 * right, u32 num_samples)
+{
+   while (AVCaptureAudioActive && num_samples > 0)
+   {
+      u32 head = avcapture.audio_head;
+      u32 count = num_samples < AVCAPTURE_AUDIO_BLOCK_SAMPLES ? num_samples : AVCAPTURE_AUDIO_BLOCK_SAMPLES;
+      avcaptureaudio_struct * block;
+      u32 i;
+
+      if (head - avcapture.audio_tail >= AVCAPTURE_AUDIO_BLOCKS)
+      {
+         avcapture.audio_dropped++;
+         return;
+      }
+
+      block = &avcapture.audio[head & (AVCAPTURE_AUDIO_BLOCKS - 1)];
+      for (i = 0; i < count; i++)
+      {
+         s32 l = left[i], r = right[i];
+
+         block->data[i * 2] = (s16)(l > 0x7FFF ? 0x7FFF : l < -0x8000 ? -0x8000 : l);
+         block->data[i * 2 + 1] = (s16)(r > 0x7FFF ? 0x7FFF : r < -0x8000 ? -0x8000 : r);
+      }
+      block->num_samples = count;
+
+      AVCAPTURE_BARRIER();
+      avcapture.audio_head = head + 1;
+
+      left += count;
+      right += count;
+      num_samples -= count;
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void AVCaptureVideo(const pixel_t * pixels, int width, int height)
+{
+   u32 head = avcapture.video_head;
+   avcapturevideo_struct * frame;
+
+   if (!AVCaptureVideoActive || width <= 0 || height <= 0)
+      return;
+
+   if (head - avcapture.video_tail >= AVCAPTURE_VIDEO_FRAMES)
+   {
+      avcapture.video_dropped++;
+      return;
+   }
+
+   frame = &avcapture.video[head & (AVCAPTURE_VIDEO_FRAMES - 1)];
+   frame->width = width < AVCAPTURE_VIDEO_MAX_WIDTH ? width : AVCAPTURE_VIDEO_MAX_WIDTH;
+   frame->height = height < AVCAPTURE_VIDEO_MAX_HEIGHT ? height : AVCAPTURE_VIDEO_MAX_HEIGHT;
+
+   if (frame->width == width)
+      memcpy(frame->pixels, pixels, frame->width * frame->height * sizeof(pixel_t));
+   else
+   {
+      int j;
+
+      for (j = 0; j < frame->height; j++)
+         memcpy(frame->pixels + j * frame->width, pixels + j * width, frame->width * sizeof(pixel_t));
+   }
+
+   AVCAPTURE_BARRIER();
+   avcapture.video_head = head + 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Audio blocks and frames that didn't fit in their ring
+u32 AVCaptureGetDropped(void)
+{
+   return avcapture.audio_dropped + avcapture.video_dropped;
+}
+
+//////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,62 @@
+/*  This file is part of Yabause.
+
+    Yabause is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Yabause is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Yabause; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+/*! \file avcapture.h
+    \brief Audio and video capture written from a background thread.
+
+    The scsp, as it generates samples, and the software renderer only copy
+    their data into fixed size ring buffers, one for audio blocks and one
+    for frames. Audio is taken before the sound core sees it, so a core that
+    falls behind doesn't leave holes in the capture. A writer thread takes
+    it from there, converts it and writes it to disk, so a slow disk never
+    holds up emulation. When a ring is full the block is dropped and counted
+    instead of waited for.
+
+    Audio is 44.1 kHz 16-bit stereo, as a WAV file or raw little endian
+    samples. Video is a YUV4MPEG2 (4:4:4) stream sized after the first
+    frame, later frames of another size are cropped or padded to it.
+*/
+
+#ifndef AVCAPTURE_H
+#define AVCAPTURE_H
+
+#include "core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AVCAPTURE_AUDIO_WAV 0
+#define AVCAPTURE_AUDIO_RAW 1
+
+extern volatile int AVCaptureAudioActive;
+extern volatile int AVCaptureVideoActive;
+
+int AVCaptureStart(const char * audio_filename, int audio_format, const char * video_filename);
+void AVCaptureStop(void);
+int AVCaptureIsRunning(void);
+
+void AVCaptureAudio(const s32 * left, const s32 * right, u32 num_samples);
+void AVCaptureVideo(const pixel_t * pixels, int width, int height);
+
+u32 AVCaptureGetDropped(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
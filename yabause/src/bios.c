@@ -45,6 +45,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
 #include "debug.h"
 #include "sh2core.h"
 #include "bios.h"
+#include "bupsync.h"
 #include "smpc.h"
 #include "yabause.h"
 #include "error.h"
@@ -1122,7 +1123,7 @@ static void FASTCALL BiosBUPWrite(SH2_struct * sh)
    //fclose(fp);
    free(blocktbl);
 
-   YabFlushBackups();
+   BupSyncNotify();
 
    sh->regs.R[0] = 0; // returns 0 if there's no error
    sh->regs.PC = sh->regs.PR;
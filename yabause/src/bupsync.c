@@ -0,0 +1,719 @@
+/*  This file is part of Yabause.
+
+    Yabause is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Yabause is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Yabause; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+/*! \file bupsync.c
+    \brief Write-behind for the backup RAM images.
+*/
+
+// Journal layout, all values little endian:
+//
+//    "YBJ" + version byte
+//    u32 number of ranges
+//    u32 offset, u32 length, data     once per range
+//    "END\0"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bupsync.h"
+#include "debug.h"
+#include "error.h"
+#include "threads.h"
+
+#if defined(_WINDOWS)
+#include <windows.h>
+#include <io.h>
+#define BUPSYNC_FSYNC(fp) _commit(_fileno(fp))
+#elif defined(NX)
+#define BUPSYNC_FSYNC(fp) 0
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#define BUPSYNC_FSYNC(fp) fsync(fileno(fp))
+#define BUPSYNC_SYNC_DIR
+#endif
+
+#define BUPSYNC_PAGE_SIZE (1 << BUPSYNC_PAGE_SHIFT)
+#define BUPSYNC_JOURNAL_VERSION 1
+
+typedef struct
+{
+   u8 * mem;
+   u32 size;
+   u32 num_pages;
+   char * filename;
+   u8 ** staged;  // copies of the pages of finished saves, not written yet
+} bupsyncimage_struct;
+
+typedef struct
+{
+   u32 offset;
+   u32 length;
+   u8 * data;
+} bupsyncrange_struct;
+
+u8 * BupSyncDirty[BUPSYNC_MAX_IMAGES];
+volatile int BupSyncPending = 0;
+
+static bupsyncimage_struct bupsync_images[BUPSYNC_MAX_IMAGES];
+static YabMutex * bupsync_mutex = NULL;     // the staged pages
+static YabMutex * bupsync_io_mutex = NULL;  // one flush at a time
+static volatile int bupsync_running = 0;
+static volatile int bupsync_staged_pending = 0;
+static u32 bupsync_interval = BUPSYNC_DEFAULT_INTERVAL;
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int BupSyncWrite32(FILE * fp, u32 val)
+{
+   u8 buf[4];
+
+   buf[0] = (u8)val;
+   buf[1] = (u8)(val >> 8);
+   buf[2] = (u8)(val >> 16);
+   buf[3] = (u8)(val >> 24);
+   return fwrite(buf, 1, 4, fp) == 4 ? 0 : -1;
+}
+
+static int BupSyncRead32(FILE * fp, u32 * val)
+{
+   u8 buf[4];
+
+   if (fread(buf, 1, 4, fp) != 4)
+      return -1;
+   *val = buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((u32)buf[3] << 24);
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static char * BupSyncJournalName(const char * filename, const char * suffix)
+{
+   char * name = (char *)malloc(strlen(filename) + strlen(suffix) + 1);
+
+   if (name != NULL)
+      sprintf(name, "%s%s", filename, suffix);
+   return name;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+#ifdef BUPSYNC_SYNC_DIR
+// A rename is only durable once the directory holding the entry is synced.
+// Some file systems can't sync a directory, so this is best effort.
+static void BupSyncDir(const char * path)
+{
+   const char * slash = strrchr(path, '/');
+   char * dir = NULL;
+   int fd;
+
+   if (slash == NULL)
+      dir = strdup(".");
+   else if (slash == path)
+      dir = strdup("/");
+   else if ((dir = (char *)malloc(slash - path + 1)) != NULL)
+   {
+      memcpy(dir, path, slash - path);
+      dir[slash - path] = '\0';
+   }
+
+   if (dir == NULL)
+      return;
+
+   if ((fd = open(dir, O_RDONLY)) >= 0)
+   {
+      fsync(fd);
+      close(fd);
+   }
+   free(dir);
+}
+#endif
+
+static int BupSyncRename(const char * from, const char * to)
+{
+#if defined(_WINDOWS)
+   return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) ? 0 : -1;
+#else
+   if (rename(from, to) != 0)
+      return -1;
+#ifdef BUPSYNC_SYNC_DIR
+   BupSyncDir(to);
+#endif
+   return 0;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static FILE * BupSyncOpenImage(const char * filename)
+{
+   FILE * fp = fopen(filename, "r+b");
+
+   if (fp == NULL)
+      fp = fopen(filename, "w+b");
+   return fp;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int BupSyncWriteJournal(const char * filename, const bupsyncrange_struct * ranges, u32 num_ranges)
+{
+   char * journal = BupSyncJournalName(filename, ".journal");
+   char * temp = BupSyncJournalName(filename, ".journal.tmp");
+   FILE * fp = NULL;
+   int ret = -1;
+   u32 i;
+
+   if (journal == NULL || temp == NULL || (fp = fopen(temp, "wb")) == NULL)
+      goto done;
+
+   if (fwrite("YBJ", 1, 3, fp) != 3 || fputc(BUPSYNC_JOURNAL_VERSION, fp) == EOF ||
+       BupSyncWrite32(fp, num_ranges) != 0)
+      goto done;
+
+   for (i = 0; i < num_ranges; i++)
+   {
+      if (BupSyncWrite32(fp, ranges[i].offset) != 0 ||
+          BupSyncWrite32(fp, ranges[i].length) != 0 ||
+          fwrite(ranges[i].data, 1, ranges[i].length, fp) != ranges[i].length)
+         goto done;
+   }
+
+   if (fwrite("END", 1, 4, fp) != 4 || fflush(fp) != 0 || BUPSYNC_FSYNC(fp) != 0)
+      goto done;
+
+   fclose(fp);
+   fp = NULL;
+
+   // the journal only counts once it's complete
+   ret = BupSyncRename(temp, journal);
+
+done:
+   if (fp != NULL)
+   {
+      fclose(fp);
+      remove(temp);
+   }
+   free(journal);
+   free(temp);
+   return ret;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int BupSyncApply(bupsyncimage_struct * img, const bupsyncrange_struct * ranges, u32 num_ranges)
+{
+   FILE * fp;
+   u32 i;
+
+   if ((fp = BupSyncOpenImage(img->filename)) == NULL)
+      return -1;
+
+   for (i = 0; i < num_ranges; i++)
+   {
+      if (fseek(fp, ranges[i].offset, SEEK_SET) != 0 ||
+          fwrite(ranges[i].data, 1, ranges[i].length, fp) != ranges[i].length)
+      {
+         fclose(fp);
+         return -1;
+      }
+   }
+
+   if (fflush(fp) != 0 || BUPSYNC_FSYNC(fp) != 0)
+   {
+      fclose(fp);
+      return -1;
+   }
+
+   fclose(fp);
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static u32 BupSyncPageLength(const bupsyncimage_struct * img, u32 page)
+{
+   u32 offset = page << BUPSYNC_PAGE_SHIFT;
+
+   return img->size - offset < BUPSYNC_PAGE_SIZE ? img->size - offset : BUPSYNC_PAGE_SIZE;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Copies the dirty pages of one image aside, they hold a consistent picture
+// of the backup RAM at this point. Call with the mutex held, from the
+// emulation thread or while it's stopped.
+static int BupSyncStageImage(bupsyncimage_struct * img, u8 * dirty)
+{
+   int ret = 0;
+   u32 i;
+
+   if (img->mem == NULL || dirty == NULL)
+      return 0;
+
+   for (i = 0; i < img->num_pages; i++)
+   {
+      if (!dirty[i])
+         continue;
+
+      if (img->staged[i] == NULL && (img->staged[i] = (u8 *)malloc(BUPSYNC_PAGE_SIZE)) == NULL)
+      {
+         ret = -1;
+         continue;
+      }
+
+      dirty[i] = 0;
+      memcpy(img->staged[i], img->mem + (i << BUPSYNC_PAGE_SHIFT), BupSyncPageLength(img, i));
+      bupsync_staged_pending = 1;
+   }
+
+   return ret;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void BupSyncStageAll(void)
+{
+   int i;
+
+   YabThreadLock(bupsync_mutex);
+   for (i = 0; i < BUPSYNC_MAX_IMAGES; i++)
+   {
+      if (BupSyncStageImage(&bupsync_images[i], BupSyncDirty[i]) != 0)
+      {
+         LOG("bupsync: out of memory staging %s", bupsync_images[i].filename);
+      }
+   }
+   YabThreadUnLock(bupsync_mutex);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Writes out the staged pages of one image, neighbouring pages go out as one
+// range. The pages are taken under the mutex, the writing is done without
+// it so that staging the next save doesn't wait for the disk. Call with the
+// io mutex held.
+static int BupSyncFlushImage(bupsyncimage_struct * img)
+{
+   bupsyncrange_struct * ranges = NULL;
+   u8 ** pages;
+   u8 * snapshot = NULL, * data;
+   char * journal;
+   u32 i, count = 0, num_ranges = 0;
+   int ret = -1;
+
+   if (img->mem == NULL)
+      return 0;
+
+   if ((pages = (u8 **)calloc(img->num_pages, sizeof(u8 *))) == NULL)
+      return -1;
+
+   YabThreadLock(bupsync_mutex);
+   for (i = 0; i < img->num_pages; i++)
+   {
+      pages[i] = img->staged[i];
+      img->staged[i] = NULL;
+      if (pages[i] != NULL)
+         count++;
+   }
+   YabThreadUnLock(bupsync_mutex);
+
+   if (count == 0)
+   {
+      free(pages);
+      return 0;
+   }
+
+   ranges = (bupsyncrange_struct *)malloc(count * sizeof(bupsyncrange_struct));
+   snapshot = (u8 *)malloc(count << BUPSYNC_PAGE_SHIFT);
+   if (ranges == NULL || snapshot == NULL)
+      goto done;
+
+   data = snapshot;
+   for (i = 0; i < img->num_pages; i++)
+   {
+      u32 length;
+
+      if (pages[i] == NULL)
+         continue;
+
+      length = BupSyncPageLength(img, i);
+      memcpy(data, pages[i], length);
+
+      if (i > 0 && pages[i - 1] != NULL)
+         ranges[num_ranges - 1].length += length;
+      else
+      {
+         ranges[num_ranges].offset = i << BUPSYNC_PAGE_SHIFT;
+         ranges[num_ranges].length = length;
+         ranges[num_ranges].data = data;
+         num_ranges++;
+      }
+
+      data += length;
+   }
+
+   if (BupSyncWriteJournal(img->filename, ranges, num_ranges) != 0 ||
+       BupSyncApply(img, ranges, num_ranges) != 0)
+      goto done;
+
+   if ((journal = BupSyncJournalName(img->filename, ".journal")) != NULL)
+   {
+      remove(journal);
+      free(journal);
+   }
+
+   ret = 0;
+
+done:
+   // try again next time, unless a newer save staged the page meanwhile
+   YabThreadLock(bupsync_mutex);
+   for (i = 0; i < img->num_pages; i++)
+   {
+      if (pages[i] == NULL)
+         continue;
+
+      if (ret != 0 && img->staged[i] == NULL)
+      {
+         img->staged[i] = pages[i];
+         bupsync_staged_pending = 1;
+      }
+      else
+         free(pages[i]);
+   }
+   YabThreadUnLock(bupsync_mutex);
+
+   free(pages);
+   free(ranges);
+   free(snapshot);
+   return ret;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int BupSyncFlushAll(void)
+{
+   int i, ret = 0;
+
+   YabThreadLock(bupsync_io_mutex);
+
+   bupsync_staged_pending = 0;
+
+   for (i = 0; i < BUPSYNC_MAX_IMAGES; i++)
+   {
+      if (BupSyncFlushImage(&bupsync_images[i]) != 0)
+      {
+         LOG("bupsync: couldn't flush %s", bupsync_images[i].filename);
+         ret = i + 1;
+      }
+   }
+
+   YabThreadUnLock(bupsync_io_mutex);
+
+   return ret;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Applies a journal a crash left behind. Call it before the image is loaded
+// or mapped.
+int BupSyncRecover(const char * filename)
+{
+   char * journal, * temp;
+   FILE * fp, * image = NULL;
+   u8 header[4], trailer[4], buf[BUPSYNC_PAGE_SIZE];
+   u32 num_ranges, offset, length, i;
+   long start;
+   int ret = 0;
+
+   if (filename == NULL)
+      return 0;
+
+   journal = BupSyncJournalName(filename, ".journal");
+   temp = BupSyncJournalName(filename, ".journal.tmp");
+   if (journal == NULL || temp == NULL)
+   {
+      free(journal);
+      free(temp);
+      return -1;
+   }
+
+   // never renamed, so the image wasn't touched
+   remove(temp);
+   free(temp);
+
+   if ((fp = fopen(journal, "rb")) == NULL)
+   {
+      free(journal);
+      return 0;
+   }
+
+   if (fread(header, 1, 4, fp) != 4 || memcmp(header, "YBJ", 3) != 0 ||
+       header[3] != BUPSYNC_JOURNAL_VERSION || BupSyncRead32(fp, &num_ranges) != 0)
+      goto done;
+
+   // check the whole journal is there before touching the image
+   start = ftell(fp);
+   for (i = 0; i < num_ranges; i++)
+   {
+      if (BupSyncRead32(fp, &offset) != 0 || BupSyncRead32(fp, &length) != 0 ||
+          fseek(fp, length, SEEK_CUR) != 0)
+         goto done;
+   }
+
+   if (fread(trailer, 1, 4, fp) != 4 || memcmp(trailer, "END", 4) != 0)
+      goto done;
+
+   if ((image = BupSyncOpenImage(filename)) == NULL)
+   {
+      ret = -1;
+      goto done;
+   }
+
+   fseek(fp, start, SEEK_SET);
+   for (i = 0; i < num_ranges && ret == 0; i++)
+   {
+      BupSyncRead32(fp, &offset);
+      BupSyncRead32(fp, &length);
+      fseek(image, offset, SEEK_SET);
+
+      while (length > 0)
+      {
+         u32 part = length < sizeof(buf) ? length : sizeof(buf);
+
+         if (fread(buf, 1, part, fp) != part || fwrite(buf, 1, part, image) != part)
+         {
+            ret = -1;
+            break;
+         }
+         length -= part;
+      }
+   }
+
+   if (fflush(image) != 0 || BUPSYNC_FSYNC(image) != 0)
+      ret = -1;
+
+   fclose(image);
+
+done:
+   fclose(fp);
+   if (ret == 0)
+      remove(journal);
+   else
+      YabSetError(YAB_ERR_FILEWRITE, (void *)filename);
+   free(journal);
+   return ret;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int BupSyncAdd(int image, u8 * mem, u32 size, const char * filename)
+{
+   bupsyncimage_struct * img = &bupsync_images[image];
+   u32 num_pages = (size + BUPSYNC_PAGE_SIZE - 1) >> BUPSYNC_PAGE_SHIFT;
+   u8 * dirty;
+   FILE * fp;
+   long filesize = 0;
+
+   BupSyncRemove(image);
+
+   if (mem == NULL || filename == NULL || filename[0] == '\0')
+      return 0;
+
+   if (bupsync_mutex == NULL)
+      bupsync_mutex = YabThreadCreateMutex();
+   if (bupsync_io_mutex == NULL)
+      bupsync_io_mutex = YabThreadCreateMutex();
+
+   if ((dirty = (u8 *)calloc(num_pages, 1)) == NULL)
+      return -1;
+
+   if ((img->staged = (u8 **)calloc(num_pages, sizeof(u8 *))) == NULL ||
+       (img->filename = strdup(filename)) == NULL)
+   {
+      free(img->staged);
+      img->staged = NULL;
+      free(dirty);
+      return -1;
+   }
+
+   img->mem = mem;
+   img->size = size;
+   img->num_pages = num_pages;
+
+   // a new or short file gets the whole image on the first flush
+   if ((fp = fopen(filename, "rb")) != NULL)
+   {
+      fseek(fp, 0, SEEK_END);
+      filesize = ftell(fp);
+      fclose(fp);
+   }
+
+   if (filesize < (long)size)
+   {
+      memset(dirty, 1, num_pages);
+      BupSyncPending = 1;
+   }
+
+   BupSyncDirty[image] = dirty;
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Writes out everything that's dirty and lets go of the image, call it while
+// the emulation is stopped
+void BupSyncRemove(int image)
+{
+   bupsyncimage_struct * img = &bupsync_images[image];
+   u8 * dirty = BupSyncDirty[image];
+   u32 i;
+
+   if (img->mem == NULL)
+      return;
+
+   YabThreadLock(bupsync_io_mutex);
+
+   YabThreadLock(bupsync_mutex);
+   BupSyncStageImage(img, dirty);
+   YabThreadUnLock(bupsync_mutex);
+
+   if (BupSyncFlushImage(img) != 0)
+      YabSetError(YAB_ERR_FILEWRITE, (void *)img->filename);
+
+   YabThreadLock(bupsync_mutex);
+   BupSyncDirty[image] = NULL;
+   free(dirty);
+   for (i = 0; i < img->num_pages; i++)
+      free(img->staged[i]);
+   free(img->staged);
+   free(img->filename);
+   memset(img, 0, sizeof(*img));
+   YabThreadUnLock(bupsync_mutex);
+
+   YabThreadUnLock(bupsync_io_mutex);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Only writes what BupSyncNotify staged, pages the game is still writing
+// stay in memory until the next finished save, a pause or the exit
+static void * BupSyncThread(UNUSED void * arg)
+{
+   u32 waited = 0;
+
+   while (bupsync_running)
+   {
+      YabThreadUSleep(10000);
+      waited += 10;
+
+      if (waited < bupsync_interval)
+         continue;
+
+      waited = 0;
+      if (bupsync_staged_pending)
+         BupSyncFlushAll();
+   }
+
+   return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Without the thread, BupSyncNotify flushes right away
+int BupSyncStart(u32 interval, int usethread)
+{
+   bupsync_interval = interval ? interval : BUPSYNC_DEFAULT_INTERVAL;
+
+   if (!usethread || bupsync_running)
+      return 0;
+
+   bupsync_running = 1;
+   if (YabThreadStart(YAB_THREAD_BUPSYNC, "bupsync", BupSyncThread, NULL) != 0)
+   {
+      bupsync_running = 0;
+      return -1;
+   }
+
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Flushes and lets go of every image
+void BupSyncStop(void)
+{
+   int i;
+
+   if (bupsync_running)
+   {
+      bupsync_running = 0;
+      YabThreadWait(YAB_THREAD_BUPSYNC);
+   }
+
+   for (i = 0; i < BUPSYNC_MAX_IMAGES; i++)
+      BupSyncRemove(i);
+
+   if (bupsync_mutex != NULL)
+      YabThreadFreeMutex(bupsync_mutex);
+   if (bupsync_io_mutex != NULL)
+      YabThreadFreeMutex(bupsync_io_mutex);
+   bupsync_mutex = NULL;
+   bupsync_io_mutex = NULL;
+   BupSyncPending = 0;
+   bupsync_staged_pending = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// The BIOS finished writing a save, called on the emulation thread. The
+// pages written so far are copied aside for the thread to write out.
+void BupSyncNotify(void)
+{
+   if (bupsync_mutex == NULL)
+      return;
+
+   BupSyncPending = 0;
+   BupSyncStageAll();
+
+   if (!bupsync_running)
+      BupSyncFlushAll();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Writes out everything that's dirty now, for pausing and exiting
+int BupSyncFlush(void)
+{
+   int ret;
+
+   if (bupsync_mutex == NULL)
+      return 0;
+
+   BupSyncPending = 0;
+   BupSyncStageAll();
+
+   if ((ret = BupSyncFlushAll()) != 0)
+   {
+      YabSetError(YAB_ERR_FILEWRITE, (void *)bupsync_images[ret - 1].filename);
+      return -1;
+   }
+
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,81 @@
+/*  This file is part of Yabause.
+
+    Yabause is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Yabause is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Yabause; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+/*! \file bupsync.h
+    \brief Write-behind for the backup RAM images.
+
+    Writes to backup RAM only mark the page they touch as dirty. When the
+    BIOS reports a finished save, BupSyncNotify copies the dirty pages
+    aside, and a background thread writes those copies out on a timer.
+    Pages written after that stay in memory until the next finished save,
+    or until BupSyncFlush writes everything when pausing or exiting, so the
+    file only ever holds saves that were complete.
+
+    Each flush first copies the pages into a journal next to the image,
+    which is written to a temporary name and renamed into place. Only then
+    is the image itself updated, and the journal removed after. A journal
+    left behind by a crash is applied by BupSyncRecover before the image is
+    loaded again, so the file never ends up with half of a flush.
+
+    The image is always updated with file writes. A memory mapped image
+    must be mapped copy-on-write, or the system would write pages back on
+    its own, outside of the journal.
+*/
+
+#ifndef BUPSYNC_H
+#define BUPSYNC_H
+
+#include "core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BUPSYNC_INTERNAL 0
+#define BUPSYNC_CART     1
+#define BUPSYNC_MAX_IMAGES 2
+
+#define BUPSYNC_PAGE_SHIFT 12
+#define BUPSYNC_DEFAULT_INTERVAL 1000 // milliseconds
+
+// One byte per page rather than one bit, so the emulation thread marking a
+// page never does a read-modify-write on something the flusher clears
+extern u8 * BupSyncDirty[BUPSYNC_MAX_IMAGES];
+extern volatile int BupSyncPending;
+
+#define BupSyncMarkDirty(image, addr) \
+   do { \
+      if (BupSyncDirty[image] != NULL) { \
+         BupSyncDirty[image][(addr) >> BUPSYNC_PAGE_SHIFT] = 1; \
+         BupSyncPending = 1; \
+      } \
+   } while (0)
+
+int BupSyncRecover(const char * filename);
+int BupSyncAdd(int image, u8 * mem, u32 size, const char * filename);
+void BupSyncRemove(int image);
+
+int BupSyncStart(u32 interval, int usethread);
+void BupSyncStop(void);
+void BupSyncNotify(void);
+int BupSyncFlush(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -44,6 +44,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
 
 #include <stdlib.h>
 #include "cs0.h"
+#include "bupsync.h"
 #include "error.h"
 #include "japmodem.h"
 #include "netlink.h"
@@ -847,6 +848,7 @@ static u32 FASTCALL BUP4MBITCs1ReadLong(u32 addr)
 static void FASTCALL BUP4MBITCs1WriteByte(u32 addr, u8 val)
 {
    T1WriteByte(CartridgeArea->bupram, addr & 0xFFFFF, val);
+   BupSyncMarkDirty(BUPSYNC_CART, addr & 0xFFFFF);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -854,6 +856,7 @@ static void FASTCALL BUP4MBITCs1WriteByte(u32 addr, u8 val)
 static void FASTCALL BUP4MBITCs1WriteWord(u32 addr, u16 val)
 {
    T1WriteWord(CartridgeArea->bupram, addr & 0xFFFFF, val);
+   BupSyncMarkDirty(BUPSYNC_CART, addr & 0xFFFFF);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -861,6 +864,7 @@ static void FASTCALL BUP4MBITCs1WriteWord(u32 addr, u16 val)
 static void FASTCALL BUP4MBITCs1WriteLong(u32 addr, u32 val)
 {
    T1WriteLong(CartridgeArea->bupram, addr & 0xFFFFF, val);
+   BupSyncMarkDirty(BUPSYNC_CART, addr & 0xFFFFF);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -891,6 +895,7 @@ static u32 FASTCALL BUP8MBITCs1ReadLong(u32 addr)
 static void FASTCALL BUP8MBITCs1WriteByte(u32 addr, u8 val)
 {
    T1WriteByte(CartridgeArea->bupram, addr & 0x1FFFFF, val);
+   BupSyncMarkDirty(BUPSYNC_CART, addr & 0x1FFFFF);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -898,6 +903,7 @@ static void FASTCALL BUP8MBITCs1WriteByte(u32 addr, u8 val)
 static void FASTCALL BUP8MBITCs1WriteWord(u32 addr, u16 val)
 {
    T1WriteWord(CartridgeArea->bupram, addr & 0x1FFFFF, val);
+   BupSyncMarkDirty(BUPSYNC_CART, addr & 0x1FFFFF);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -905,6 +911,7 @@ static void FASTCALL BUP8MBITCs1WriteWord(u32 addr, u16 val)
 static void FASTCALL BUP8MBITCs1WriteLong(u32 addr, u32 val)
 {
    T1WriteLong(CartridgeArea->bupram, addr & 0x1FFFFF, val);
+   BupSyncMarkDirty(BUPSYNC_CART, addr & 0x1FFFFF);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -935,6 +942,7 @@ static u32 FASTCALL BUP16MBITCs1ReadLong(u32 addr)
 static void FASTCALL BUP16MBITCs1WriteByte(u32 addr, u8 val)
 {
    T1WriteByte(CartridgeArea->bupram, addr & 0x3FFFFF, val);
+   BupSyncMarkDirty(BUPSYNC_CART, addr & 0x3FFFFF);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -942,6 +950,7 @@ static void FASTCALL BUP16MBITCs1WriteByte(u32 addr, u8 val)
 static void FASTCALL BUP16MBITCs1WriteWord(u32 addr, u16 val)
 {
    T1WriteWord(CartridgeArea->bupram, addr & 0x3FFFFF, val);
+   BupSyncMarkDirty(BUPSYNC_CART, addr & 0x3FFFFF);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -949,6 +958,7 @@ static void FASTCALL BUP16MBITCs1WriteWord(u32 addr, u16 val)
 static void FASTCALL BUP16MBITCs1WriteLong(u32 addr, u32 val)
 {
    T1WriteLong(CartridgeArea->bupram, addr & 0x3FFFFF, val);
+   BupSyncMarkDirty(BUPSYNC_CART, addr & 0x3FFFFF);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -979,6 +989,7 @@ static u32 FASTCALL BUP32MBITCs1ReadLong(u32 addr)
 static void FASTCALL BUP32MBITCs1WriteByte(u32 addr, u8 val)
 {
    T1WriteByte(CartridgeArea->bupram, addr & 0x7FFFFF, val);
+   BupSyncMarkDirty(BUPSYNC_CART, addr & 0x7FFFFF);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -986,6 +997,7 @@ static void FASTCALL BUP32MBITCs1WriteByte(u32 addr, u8 val)
 static void FASTCALL BUP32MBITCs1WriteWord(u32 addr, u16 val)
 {
    T1WriteWord(CartridgeArea->bupram, addr & 0x7FFFFF, val);
+   BupSyncMarkDirty(BUPSYNC_CART, addr & 0x7FFFFF);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -993,6 +1005,7 @@ static void FASTCALL BUP32MBITCs1WriteWord(u32 addr, u16 val)
 static void FASTCALL BUP32MBITCs1WriteLong(u32 addr, u32 val)
 {
    T1WriteLong(CartridgeArea->bupram, addr & 0x7FFFFF, val);
+   BupSyncMarkDirty(BUPSYNC_CART, addr & 0x7FFFFF);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -1112,9 +1125,13 @@ int CartInit(const char * filename, int type)
          CartridgeArea->cartid = 0x21;
 
          // Load Backup Ram data from file
+         BupSyncRecover(filename);
          if (T123Load(CartridgeArea->bupram, 0x100000, 1, filename) != 0)
             FormatBackupRam(CartridgeArea->bupram, 0x100000);
 
+         if (BupSyncAdd(BUPSYNC_CART, CartridgeArea->bupram, 0x100000, filename) != 0)
+            return -1;
+
          // Setup Functions
          CartridgeArea->Cs1ReadByte = &BUP4MBITCs1ReadByte;
          CartridgeArea->Cs1ReadWord = &BUP4MBITCs1ReadWord;
@@ -1132,9 +1149,13 @@ int CartInit(const char * filename, int type)
          CartridgeArea->cartid = 0x22;
 
          // Load Backup Ram data from file
+         BupSyncRecover(filename);
          if (T123Load(CartridgeArea->bupram, 0x200000, 1, filename) != 0)
             FormatBackupRam(CartridgeArea->bupram, 0x200000);
 
+         if (BupSyncAdd(BUPSYNC_CART, CartridgeArea->bupram, 0x200000, filename) != 0)
+            return -1;
+
          // Setup Functions
          CartridgeArea->Cs1ReadByte = &BUP8MBITCs1ReadByte;
          CartridgeArea->Cs1ReadWord = &BUP8MBITCs1ReadWord;
@@ -1152,9 +1173,13 @@ int CartInit(const char * filename, int type)
          CartridgeArea->cartid = 0x23;
 
          // Load Backup Ram data from file
+         BupSyncRecover(filename);
          if (T123Load(CartridgeArea->bupram, 0x400000, 1, filename) != 0)
             FormatBackupRam(CartridgeArea->bupram, 0x400000);
 
+         if (BupSyncAdd(BUPSYNC_CART, CartridgeArea->bupram, 0x400000, filename) != 0)
+            return -1;
+
          // Setup Functions
          CartridgeArea->Cs1ReadByte = &BUP16MBITCs1ReadByte;
          CartridgeArea->Cs1ReadWord = &BUP16MBITCs1ReadWord;
@@ -1172,9 +1197,13 @@ int CartInit(const char * filename, int type)
          CartridgeArea->cartid = 0x24;
 
          // Load Backup Ram data from file
+         BupSyncRecover(filename);
          if (T123Load(CartridgeArea->bupram, 0x800000, 1, filename) != 0)
             FormatBackupRam(CartridgeArea->bupram, 0x800000);
 
+         if (BupSyncAdd(BUPSYNC_CART, CartridgeArea->bupram, 0x800000, filename) != 0)
+            return -1;
+
          // Setup Functions
          CartridgeArea->Cs1ReadByte = &BUP32MBITCs1ReadByte;
          CartridgeArea->Cs1ReadWord = &BUP32MBITCs1ReadWord;
@@ -1225,14 +1254,18 @@ int CartInit(const char * filename, int type)
       }
       case CART_ROM16MBIT: // 16 Mbit Rom Cart
       {
-         if ((CartridgeArea->rom = T1MemoryInit(0x200000)) == NULL)
-            return -1;
-
          CartridgeArea->cartid = 0xFF; // I have no idea what the real id is
 
-         // Load Rom to memory
-         if (T123Load(CartridgeArea->rom, 0x200000, 1, filename) != 0)
-            return -1;
+         // Map the image if we can, the rom is never written back
+         if ((CartridgeArea->rom = YabRomMap(filename, 0x200000, 1)) == NULL)
+         {
+            if ((CartridgeArea->rom = T1MemoryInit(0x200000)) == NULL)
+               return -1;
+
+            // Load Rom to memory
+            if (T123Load(CartridgeArea->rom, 0x200000, 1, filename) != 0)
+               return -1;
+         }
 
          // Setup Functions
          CartridgeArea->Cs0ReadByte = &ROM16MBITCs0ReadByte;
@@ -1317,41 +1350,6 @@ void CartFlush(void){
                YabSetError(YAB_ERR_FILEWRITE, (void *)CartridgeArea->filename);
          }
       }
-
-      if (CartridgeArea->bupram)
-      {
-         u32 size = 0;
-
-         switch (CartridgeArea->carttype)
-         {
-            case CART_BACKUPRAM4MBIT: // 4 Mbit Backup Ram
-            {
-               size = 0x100000;
-               break;
-            }
-            case CART_BACKUPRAM8MBIT: // 8 Mbit Backup Ram
-            {
-               size = 0x200000;
-               break;
-            }
-            case CART_BACKUPRAM16MBIT: // 16 Mbit Backup Ram
-            {
-               size = 0x400000;
-               break;
-            }
-            case CART_BACKUPRAM32MBIT: // 32 Mbit Backup Ram
-            {
-               size = 0x800000;
-               break;
-            }
-         }
-
-         if (size != 0)
-         {
-            if (T123Save(CartridgeArea->bupram, size, 1, CartridgeArea->filename) != 0)
-               YabSetError(YAB_ERR_FILEWRITE, (void *)CartridgeArea->filename);
-         }
-      }
    }
 }
 
@@ -1372,45 +1370,14 @@ void CartDeInit(void)
       }
       else
       {
-         if (CartridgeArea->rom)
+         if (CartridgeArea->rom && YabRomUnmap(CartridgeArea->rom) != 0)
             T1MemoryDeInit(CartridgeArea->rom);
       }
 
       if (CartridgeArea->bupram)
       {
-         u32 size=0;
-
-         switch (CartridgeArea->carttype)
-         {
-            case CART_BACKUPRAM4MBIT: // 4 Mbit Backup Ram
-            {
-               size = 0x100000;
-               break;
-            }
-            case CART_BACKUPRAM8MBIT: // 8 Mbit Backup Ram
-            {
-               size = 0x200000;
-               break;
-            }
-            case CART_BACKUPRAM16MBIT: // 16 Mbit Backup Ram
-            {
-               size = 0x400000;
-               break;
-            }
-            case CART_BACKUPRAM32MBIT: // 32 Mbit Backup Ram
-            {
-               size = 0x800000;
-               break;
-            }
-         }
-
-         if (size != 0)
-         {
-            if (T123Save(CartridgeArea->bupram, size, 1, CartridgeArea->filename) != 0)
-               YabSetError(YAB_ERR_FILEWRITE, (void *)CartridgeArea->filename);
-
-            T1MemoryDeInit(CartridgeArea->bupram);
-         }
+         BupSyncRemove(BUPSYNC_CART);
+         T1MemoryDeInit(CartridgeArea->bupram);
       }
 
       if (CartridgeArea->dram)
@@ -43,6 +43,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
 
 #include <stdlib.h>
 #include <ctype.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 #include "cs2.h"
 #include "debug.h"
 #include "error.h"
@@ -99,15 +102,41 @@ enum CDB_DATATRANSTYPE
 
 #define SEEK_TIME (60000*5)
 
+// Drive clock multiplier used while seeking or reading data with the
+// accelerated timing mode
+#define CS2_FAST_DRIVE_RATE 8
+
+// IRQs that mark the end of an operation, their order is what the CD event
+// log checks. CMOK/DRDY/CSCT/SCDQ/BFUL follow the drive clock and are left out.
+#define CS2_EVENT_IRQ_MASK (CDB_HIRQ_PEND | CDB_HIRQ_DCHG | CDB_HIRQ_ESEL | CDB_HIRQ_EHST | CDB_HIRQ_ECPY | CDB_HIRQ_EFLS)
+
 Cs2 * Cs2Area = NULL;
 ip_struct *cdip = NULL;
 
+static int cs2_timing_mode = CS2_TIMING_ACCURATE;
+static char * cs2_timing_profile = NULL;
+static FILE * cs2_event_log = NULL;
+static int cs2_event_verify = 0;
+static u32 cs2_event_count = 0;
+static u32 cs2_event_last = 0xFFFFFFFF;
+
+static void Cs2LogEvent(u32 event);
+
 extern CDInterface *CDCoreList[];
 
 //////////////////////////////////////////////////////////////////////////////
 
 static INLINE void doCDReport(u8 status)
 {
+   if (cs2_event_log)
+   {
+      // drive state changes, except the seek/play flips that follow the
+      // buffer filling up
+      u8 state = status & 0xF;
+      if (status != CDB_STAT_REJECT && state != CDB_STAT_SEEK && state != CDB_STAT_PLAY)
+         Cs2LogEvent(0x10000 | state);
+   }
+
    Cs2Area->reg.CR1 = (status << 8) | ((Cs2Area->options & 0xF) << 4) | (Cs2Area->repcnt & 0xF);
    Cs2Area->reg.CR2 = (Cs2Area->ctrladdr << 8) | Cs2Area->track;
    Cs2Area->reg.CR3 = (u16)((Cs2Area->index << 8) | ((Cs2Area->FAD >> 16) & 0xFF));
@@ -127,6 +156,8 @@ static INLINE void doMPEGReport(u8 status)
 //////////////////////////////////////////////////////////////////////////////
 
 static INLINE void Cs2SetIRQ(u32 irq){
+  if (cs2_event_log && (irq & CS2_EVENT_IRQ_MASK))
+    Cs2LogEvent(irq & CS2_EVENT_IRQ_MASK);
   Cs2Area->reg.HIRQ |= irq;
   if (Cs2Area->reg.HIRQ & Cs2Area->reg.HIRQMASK){
     ScuSendExternalInterrupt00();
@@ -416,17 +447,12 @@ u32 FASTCALL Cs2ReadLong(u32 addr) {
 
                            // free blocks
                            for (i = Cs2Area->datatranssectpos; i < (Cs2Area->datatranssectpos+Cs2Area->datasectstotrans); i++)
-                           {
                               Cs2FreeBlock(Cs2Area->datatranspartition->block[i]);
-                              Cs2Area->datatranspartition->block[i] = NULL;
-                              Cs2Area->datatranspartition->blocknum[i] = 0xFF;
-                           }
 
-                           // sort remaining blocks
-                           Cs2SortBlocks(Cs2Area->datatranspartition);
+                           // close the gap left in the partition
+                           Cs2RemoveBlocks(Cs2Area->datatranspartition, Cs2Area->datatranssectpos, Cs2Area->datasectstotrans);
 
                            Cs2Area->datatranspartition->size -= Cs2Area->cdwnum;
-                           Cs2Area->datatranspartition->numblocks -= Cs2Area->datasectstotrans;
 
                            CDLOG("cs2\t: datatranspartition->size = %x\n", Cs2Area->datatranspartition->size);
                         }
@@ -503,6 +529,32 @@ void FASTCALL Cs2WriteLong(UNUSED u32 addr, UNUSED u32 val) {
 
 //////////////////////////////////////////////////////////////////////////////
 
+/* Number of 32-bit words that can still be read from 0x25818000 before the
+ * current transfer runs out of sectors */
+
+u32 FASTCALL Cs2DataWordsPending(void)
+{
+   u32 bytes = 0;
+   u32 i;
+
+   if (Cs2Area->datatranstype == CDB_DATATRANSTYPE_INVALID)
+      return 0;
+
+   for (i = Cs2Area->datanumsecttrans; i < Cs2Area->datasectstotrans; i++)
+   {
+      const block_struct *block = Cs2Area->datatranspartition->block[Cs2Area->datatranssectpos + i];
+      if (block == NULL)
+         break;
+      bytes += block->size;
+      if (i == Cs2Area->datanumsecttrans)
+         bytes -= Cs2Area->datatransoffset;
+   }
+
+   return bytes / 4;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 /* Copy "count" 32-bit words from the CD buffer to type-1 memory "dest" (a
  * native pointer), as though 0x25818000 had been read that many times */
 
@@ -516,8 +568,9 @@ void FASTCALL Cs2RapidCopyT1(void *dest, u32 count)
 
       while (count > 0 && Cs2Area->datanumsecttrans < Cs2Area->datasectstotrans)
       {
-         const u8 *src = &Cs2Area->datatranspartition->block[Cs2Area->datanumsecttrans]->data[Cs2Area->datatransoffset];
-         const u32 size = Cs2Area->datatranspartition->block[Cs2Area->datanumsecttrans]->size;
+         const block_struct *block = Cs2Area->datatranspartition->block[Cs2Area->datatranssectpos + Cs2Area->datanumsecttrans];
+         const u8 *src = &block->data[Cs2Area->datatransoffset];
+         const u32 size = block->size;
          const u32 max = size - Cs2Area->datatransoffset;
          const u32 copy = (max < count*4) ? max : count*4;
          memcpy(dest8, src, copy);
@@ -544,16 +597,12 @@ void FASTCALL Cs2RapidCopyT1(void *dest, u32 count)
          Cs2Area->datatranstype = CDB_DATATRANSTYPE_INVALID;
 
          for (i = Cs2Area->datatranssectpos; i < (Cs2Area->datatranssectpos+Cs2Area->datasectstotrans); i++)
-         {
             Cs2FreeBlock(Cs2Area->datatranspartition->block[i]);
-            Cs2Area->datatranspartition->block[i] = NULL;
-            Cs2Area->datatranspartition->blocknum[i] = 0xFF;
-         }
 
-         Cs2SortBlocks(Cs2Area->datatranspartition);
+         // close the gap left in the partition
+         Cs2RemoveBlocks(Cs2Area->datatranspartition, Cs2Area->datatranssectpos, Cs2Area->datasectstotrans);
 
          Cs2Area->datatranspartition->size -= Cs2Area->cdwnum;
-         Cs2Area->datatranspartition->numblocks -= Cs2Area->datasectstotrans;
 
          CDLOG("cs2\t: datatranspartition->size = %x\n", Cs2Area->datatranspartition->size);
       }
@@ -583,8 +632,9 @@ void FASTCALL Cs2RapidCopyT2(void *dest, u32 count)
 
       while (count > 0 && Cs2Area->datanumsecttrans < Cs2Area->datasectstotrans)
       {
-         const u8 *src = &Cs2Area->datatranspartition->block[Cs2Area->datanumsecttrans]->data[Cs2Area->datatransoffset];
-         const u32 size = Cs2Area->datatranspartition->block[Cs2Area->datanumsecttrans]->size;
+         const block_struct *block = Cs2Area->datatranspartition->block[Cs2Area->datatranssectpos + Cs2Area->datanumsecttrans];
+         const u8 *src = &block->data[Cs2Area->datatransoffset];
+         const u32 size = block->size;
          const u32 max = size - Cs2Area->datatransoffset;
          const u32 copy = (max < count*4) ? max : count*4;
          u32 i = 0;
@@ -636,16 +686,12 @@ void FASTCALL Cs2RapidCopyT2(void *dest, u32 count)
          Cs2Area->datatranstype = CDB_DATATRANSTYPE_INVALID;
 
          for (i = Cs2Area->datatranssectpos; i < (Cs2Area->datatranssectpos+Cs2Area->datasectstotrans); i++)
-         {
             Cs2FreeBlock(Cs2Area->datatranspartition->block[i]);
-            Cs2Area->datatranspartition->block[i] = NULL;
-            Cs2Area->datatranspartition->blocknum[i] = 0xFF;
-         }
 
-         Cs2SortBlocks(Cs2Area->datatranspartition);
+         // close the gap left in the partition
+         Cs2RemoveBlocks(Cs2Area->datatranspartition, Cs2Area->datatranssectpos, Cs2Area->datasectstotrans);
 
          Cs2Area->datatranspartition->size -= Cs2Area->cdwnum;
-         Cs2Area->datatranspartition->numblocks -= Cs2Area->datasectstotrans;
 
          CDLOG("cs2\t: datatranspartition->size = %x\n", Cs2Area->datatranspartition->size);
       }
@@ -759,6 +805,14 @@ void Cs2DeInit(void) {
    }
    Cs2Area = NULL;
 
+   if (cs2_event_log)
+      fclose(cs2_event_log);
+   cs2_event_log = NULL;
+
+   if (cs2_timing_profile)
+      free(cs2_timing_profile);
+   cs2_timing_profile = NULL;
+
    if (cdip)
       free(cdip);
    cdip = NULL;
@@ -766,6 +820,108 @@ void Cs2DeInit(void) {
 
 //////////////////////////////////////////////////////////////////////////////
 
+void Cs2SetTimingMode(int mode, const char * profile, const char * eventlog) {
+  cs2_timing_mode = mode;
+
+  if (cs2_timing_profile)
+     free(cs2_timing_profile);
+  cs2_timing_profile = (profile && profile[0]) ? strdup(profile) : NULL;
+
+  if (cs2_event_log)
+     fclose(cs2_event_log);
+  cs2_event_log = NULL;
+  cs2_event_verify = 0;
+  cs2_event_count = 0;
+  cs2_event_last = 0xFFFFFFFF;
+
+  if (eventlog && eventlog[0])
+  {
+     // an existing log is the reference run, otherwise record one
+     if ((cs2_event_log = fopen(eventlog, "r")) != NULL)
+        cs2_event_verify = 1;
+     else
+        cs2_event_log = fopen(eventlog, "w");
+  }
+
+  Cs2ApplyTimingProfile();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+/* The profile is a text file with one "<product code> <0|1>" per line, 1
+ * allowing and 0 denying the accelerated timing for that game. Games not
+ * listed use the global mode. */
+void Cs2ApplyTimingProfile(void) {
+  int fast = (cs2_timing_mode == CS2_TIMING_FAST);
+  FILE * fp;
+  char line[64];
+
+  if (Cs2Area == NULL)
+     return;
+
+  if (cs2_timing_profile && cdip && cdip->itemnum[0] &&
+      (fp = fopen(cs2_timing_profile, "r")) != NULL)
+  {
+     while (fgets(line, sizeof(line), fp) != NULL)
+     {
+        char code[16];
+        int allow;
+
+        if (line[0] == '#')
+           continue;
+        if (sscanf(line, "%15s %d", code, &allow) == 2 && strcmp(code, cdip->itemnum) == 0)
+        {
+           fast = allow ? 1 : 0;
+           break;
+        }
+     }
+     fclose(fp);
+  }
+
+  if (Cs2Area->fastdrive != fast)
+  {
+     LOG("cs2\t: %s CD timing for %s\n", fast ? "accelerated" : "accurate", cdip ? cdip->itemnum : "");
+  }
+  Cs2Area->fastdrive = fast;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void Cs2LogEvent(u32 event) {
+  u32 expected;
+
+  // repeats carry no ordering information
+  if (event == cs2_event_last)
+     return;
+  cs2_event_last = event;
+  cs2_event_count++;
+
+  if (!cs2_event_verify)
+  {
+     fprintf(cs2_event_log, "%05X\n", event);
+     return;
+  }
+
+  if (fscanf(cs2_event_log, "%X", &expected) != 1)
+  {
+     // past the end of the reference run
+     fclose(cs2_event_log);
+     cs2_event_log = NULL;
+     return;
+  }
+
+  if (expected != event)
+  {
+     static char msg[128];
+     sprintf(msg, "CD event %u: expected %05X got %05X", cs2_event_count, expected, event);
+     YabSetError(YAB_ERR_OTHER, (void *)msg);
+     fclose(cs2_event_log);
+     cs2_event_log = NULL;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 void Cs2Reset(void) {
   u32 i, i2;
 
@@ -866,7 +1022,7 @@ void Cs2Reset(void) {
      memset(Cs2Area->block[i].data, 0, 2352);
   }
 
-  Cs2Area->blockfreespace = MAX_BLOCKS;
+  Cs2ResetBlockPool();
 
   // initialize TOC
   memset(Cs2Area->TOC, 0xFF, sizeof(Cs2Area->TOC));
@@ -939,7 +1095,7 @@ int Cs2ForceCloseTray( int coreid, const char * cdpath ){
 
 void Cs2Exec(u32 timing) {
    Cs2Area->_statuscycles += timing * 3;
-   Cs2Area->_periodiccycles += timing * 3;
+   Cs2Area->_periodiccycles += timing * 3 * Cs2GetDriveRate();
 
    // Command is not acceptable while other command is executing
    if( Cs2Area->_command_execlock > 0  ){
@@ -1159,7 +1315,8 @@ int Cs2GetTimeToNextSector(void) {
       return 0;
    } else {
       // Round up, since the caller wants to know when it'll be safe to check
-      int time = (Cs2Area->_periodictiming - Cs2Area->_periodiccycles + 2) / 3;
+      int rate = Cs2GetDriveRate() * 3;
+      int time = (Cs2Area->_periodictiming - Cs2Area->_periodiccycles + rate - 1) / rate;
       return time<0 ? 0 : time;
    }
 }
@@ -1172,6 +1329,24 @@ void Cs2Command(void) {
 
 //////////////////////////////////////////////////////////////////////////////
 
+/* Returns how many times faster than real time the drive clock runs. Only
+ * seeks and data reads are sped up, so CDDA keeps its pitch and every
+ * interrupt and status change still happens in the same order. */
+u32 Cs2GetDriveRate(void) {
+  u8 state;
+
+  if (!Cs2Area->fastdrive)
+     return 1;
+
+  state = Cs2Area->status & 0xF;
+  if (state == CDB_STAT_SEEK || (state == CDB_STAT_PLAY && !Cs2Area->isaudio))
+     return CS2_FAST_DRIVE_RATE;
+
+  return 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 void Cs2SetTiming(int mode) {
 
   // Playing
@@ -1642,7 +1817,7 @@ void Cs2InitializeCDSystem(void) {
       memset(Cs2Area->block[i].data, 0, 2352);
     }
 
-    Cs2Area->blockfreespace = MAX_BLOCKS;
+    Cs2ResetBlockPool();
 
     // initialize TOC
    // memset(Cs2Area->TOC, 0xFF, sizeof(Cs2Area->TOC));
@@ -1739,18 +1914,13 @@ void Cs2EndDataTransfer(void) {
         Cs2Area->datatranstype = CDB_DATATRANSTYPE_INVALID;
 
         // free blocks
-        for (i = Cs2Area->datatranssectpos; i < (Cs2Area->datatranssectpos + Cs2Area->datasectstotrans); i++)
-        {
+        for (i = Cs2Area->datatranssectpos; i < (Cs2Area->datatranssectpos+Cs2Area->datasectstotrans); i++)
            Cs2FreeBlock(Cs2Area->datatranspartition->block[i]);
-           Cs2Area->datatranspartition->block[i] = NULL;
-           Cs2Area->datatranspartition->blocknum[i] = 0xFF;
-        }
 
-        // sort remaining blocks
-        Cs2SortBlocks(Cs2Area->datatranspartition);
+        // close the gap left in the partition
+        Cs2RemoveBlocks(Cs2Area->datatranspartition, Cs2Area->datatranssectpos, Cs2Area->datasectstotrans);
 
         Cs2Area->datatranspartition->size -= Cs2Area->cdwnum;
-        Cs2Area->datatranspartition->numblocks -= Cs2Area->datasectstotrans;
 
         if (Cs2Area->blockfreespace == MAX_BLOCKS) Cs2Area->isonesectorstored = 0;
 
@@ -2340,7 +2510,7 @@ void Cs2ResetSelector(void) {
         memset(Cs2Area->block[i].data, 0, 2352);
      }
 
-     Cs2Area->blockfreespace = 200;
+     Cs2ResetBlockPool();
      Cs2Area->isbufferfull = 0;
      Cs2Area->isonesectorstored = 0;
      Cs2Area->datatranstype = CDB_DATATRANSTYPE_INVALID;
@@ -2616,14 +2786,10 @@ void Cs2DeleteSectorData(void)
    {
       Cs2Area->partition[dsdbufno].size -= Cs2Area->partition[dsdbufno].block[i]->size;
       Cs2FreeBlock(Cs2Area->partition[dsdbufno].block[i]);
-      Cs2Area->partition[dsdbufno].block[i] = NULL;
-      Cs2Area->partition[dsdbufno].blocknum[i] = 0xFF;
    }
 
-   // sort remaining blocks
-   Cs2SortBlocks(&Cs2Area->partition[dsdbufno]);
-
-   Cs2Area->partition[dsdbufno].numblocks -= (u8)dsdsectnum;
+   // close the gap left in the partition
+   Cs2RemoveBlocks(&Cs2Area->partition[dsdbufno], dsdsectoffset, dsdsectnum);
 
    if (Cs2Area->blockfreespace == MAX_BLOCKS)
       Cs2Area->isonesectorstored = 0;
@@ -2798,14 +2964,13 @@ void Cs2MoveSectorData(void) {
 
   for (int i = 0; i < count; i++) {
     putpartition->block[putpartition->numblocks] = srcpartition->block[offset + i];
-    srcpartition->numblocks--;
+    putpartition->blocknum[putpartition->numblocks] = srcpartition->blocknum[offset + i];
     srcpartition->size -= 2352;
-    srcpartition->block[offset + i] = NULL;
     putpartition->numblocks++;
     putpartition->size += 2352;
   }
 
-  Cs2SortBlocks(&Cs2Area->partition[source]);
+  Cs2RemoveBlocks(srcpartition, offset, count);
   doCDReport(Cs2Area->status);
   Cs2SetIRQ(CDB_HIRQ_CMOK | CDB_HIRQ_ECPY);
 }
@@ -3412,61 +3577,105 @@ void Cs2SetupDefaultPlayStats(u8 track_number, int writeFAD) {
 
 //////////////////////////////////////////////////////////////////////////////
 
+static INLINE u32 Cs2LowestBit(u32 word) {
+#ifdef _MSC_VER
+  unsigned long i;
+  _BitScanForward(&i, word);
+  return (u32)i;
+#else
+  return (u32)__builtin_ctz(word);
+#endif
+}
+
 block_struct * Cs2AllocateBlock(u8 * blocknum, s32 sectsize) {
-  u32 i;
-  // find a free block
-  for(i = 0; i < MAX_BLOCKS; i++)
-  {
-     if (Cs2Area->block[i].size == -1)
-     {
-        Cs2Area->blockfreespace--;
+  u32 w, i;
 
-		if (Cs2Area->blockfreespace <= 0) {
-			Cs2Area->isbufferfull = 1;
-      Cs2SetIRQ(CDB_HIRQ_BFUL);
-		}
+  for (w = 0; w < (MAX_BLOCKS + 31) / 32; w++)
+  {
+     if (Cs2Area->freeblockmap[w] != 0)
+        break;
+  }
 
-        Cs2Area->block[i].size = sectsize;
+  if (Cs2Area->blockfreespace == 0 || w == (MAX_BLOCKS + 31) / 32)
+  {
+     Cs2Area->isbufferfull = 1;
+     Cs2SetIRQ(CDB_HIRQ_BFUL);
+     return NULL;
+  }
 
-        *blocknum = (u8)i;
-        return (Cs2Area->block + i);
-     }
+  // take the lowest free block, like the old linear scan, so the choice
+  // depends only on which blocks are in use and not on the order they
+  // were freed in
+  i = Cs2LowestBit(Cs2Area->freeblockmap[w]);
+  Cs2Area->freeblockmap[w] &= ~(1u << i);
+  i += w * 32;
+  Cs2Area->blockfreespace--;
+
+  if (Cs2Area->blockfreespace <= 0) {
+     Cs2Area->isbufferfull = 1;
+     Cs2SetIRQ(CDB_HIRQ_BFUL);
   }
 
-  Cs2Area->isbufferfull = 1;
-  Cs2SetIRQ(CDB_HIRQ_BFUL);
-  return NULL;
+  Cs2Area->block[i].size = sectsize;
+
+  *blocknum = (u8)i;
+  return (Cs2Area->block + i);
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
 void Cs2FreeBlock(block_struct * blk) {
-  if (blk == NULL) return;
+  u32 i;
+  if (blk == NULL || blk->size == -1) return;
   blk->size = -1;
+  i = (u32)(blk - Cs2Area->block);
+  Cs2Area->freeblockmap[i / 32] |= 1u << (i % 32);
   Cs2Area->blockfreespace++;
   Cs2Area->isbufferfull = 0;
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-void Cs2SortBlocks(partition_struct * part) {
-  unsigned int from, to;
+void Cs2ResetBlockPool(void) {
+  u32 i;
 
-  for (from = to = 0; from < MAX_BLOCKS; from++)
+  // rebuild the free map from the block sizes
+  memset(Cs2Area->freeblockmap, 0, sizeof(Cs2Area->freeblockmap));
+  Cs2Area->blockfreespace = 0;
+
+  for (i = 0; i < MAX_BLOCKS; i++)
   {
-     if (part->block[from] != NULL)
+     if (Cs2Area->block[i].size == -1)
      {
-        if (to != from)
-        {
-           part->block[to] = part->block[from];
-        }
-        to++;
+        Cs2Area->freeblockmap[i / 32] |= 1u << (i % 32);
+        Cs2Area->blockfreespace++;
      }
   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Cs2RemoveBlocks(partition_struct * part, u32 pos, u32 count) {
+  u32 tail, i;
+
+  if (pos >= part->numblocks)
+     return;
+  if (count > part->numblocks - pos)
+     count = part->numblocks - pos;
 
-  for (; to < MAX_BLOCKS; to++) {
-      part->block[to] = NULL;
+  // shift the blocks behind the removed range down, nothing past
+  // numblocks needs to be looked at
+  tail = part->numblocks - pos - count;
+  memmove(&part->block[pos], &part->block[pos + count], tail * sizeof(block_struct *));
+  memmove(&part->blocknum[pos], &part->blocknum[pos + count], tail);
+
+  for (i = pos + tail; i < part->numblocks; i++)
+  {
+     part->block[i] = NULL;
+     part->blocknum[i] = 0xFF;
   }
+
+  part->numblocks -= (u8)count;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -3764,8 +3973,6 @@ int Cs2ReadFileSystem(filter_struct * curfilter, u32 fid, int isoffset)
          rfspartition->block[rfspartition->numblocks - 1] = NULL;
          rfspartition->blocknum[rfspartition->numblocks - 1] = 0xFF;
 
-         // Sort remaining blocks
-         Cs2SortBlocks(rfspartition);
          rfspartition->numblocks -= 1;
 
          curdirlba = Cs2Area->curdirsect = dirrec.lba;
@@ -3831,8 +4038,6 @@ int Cs2ReadFileSystem(filter_struct * curfilter, u32 fid, int isoffset)
                rfspartition->block[rfspartition->numblocks - 1] = NULL;
                rfspartition->blocknum[rfspartition->numblocks - 1] = 0xFF;
        
-               // Sort remaining blocks
-               Cs2SortBlocks(rfspartition);
                rfspartition->numblocks -= 1;
    
                // Read in next sector of directory record
@@ -3870,8 +4075,6 @@ int Cs2ReadFileSystem(filter_struct * curfilter, u32 fid, int isoffset)
             rfspartition->block[rfspartition->numblocks - 1] = NULL;
             rfspartition->blocknum[rfspartition->numblocks - 1] = 0xFF;
        
-            // Sort remaining blocks
-            Cs2SortBlocks(rfspartition);
             rfspartition->numblocks -= 1;
    
             // Read in next sector of directory record
@@ -3896,8 +4099,6 @@ int Cs2ReadFileSystem(filter_struct * curfilter, u32 fid, int isoffset)
    rfspartition->block[rfspartition->numblocks - 1] = NULL;
    rfspartition->blocknum[rfspartition->numblocks - 1] = 0xFF;
 
-   // Sort remaining blocks
-   Cs2SortBlocks(rfspartition);
    rfspartition->numblocks -= 1;
 
 //#if CDDEBUG
@@ -4127,6 +4328,7 @@ u8 Cs2GetIP(int autoregion) {
          memcpy(tmp, buf+0x20, 0x0A);
          tmp[10]='\0';
          sscanf(tmp, "%s", cdip->itemnum);
+         Cs2ApplyTimingProfile();
 		 
 		 // make gameid as u64
 		 cdip->gameid = 0;
@@ -4221,8 +4423,6 @@ u8 Cs2GetIP(int autoregion) {
       gripartition->block[gripartition->numblocks - 1] = NULL;
       gripartition->blocknum[gripartition->numblocks - 1] = 0xFF;
 
-      // Sort remaining blocks
-      Cs2SortBlocks(gripartition);
       gripartition->numblocks -= 1;
    }
 
@@ -4451,6 +4651,7 @@ int Cs2LoadState(FILE * fp, int version, int size) {
 
    // Read CD buffer
    yread(&check, (void *)Cs2Area->block, sizeof(block_struct), MAX_BLOCKS, fp);
+   Cs2ResetBlockPool();
 
    // Read partition data
    for (i = 0; i < MAX_SELECTORS; i++)
@@ -52,6 +52,9 @@ extern "C" {
 #define MAX_SELECTORS   24
 #define MAX_FILES       256
 
+#define CS2_TIMING_ACCURATE 0
+#define CS2_TIMING_FAST     1
+
   typedef struct
   {
     s32 size;
@@ -192,6 +195,7 @@ extern "C" {
     int isbufferfull;
     int speed1x;
     int isaudio;
+    int fastdrive;
     u8 transfileinfo[12];
     u8 lastbuffer;
     u8 transscodeq[5 * 2];
@@ -220,6 +224,7 @@ extern "C" {
 
     u32 blockfreespace;
     block_struct block[MAX_BLOCKS];
+    u32 freeblockmap[(MAX_BLOCKS + 31) / 32];   // one bit set per free block
     struct
     {
       s32 size;
@@ -294,6 +299,9 @@ extern "C" {
   int Cs2Init(int carttype, int coreid, const char *cdpath, const char *mpegpath, const char *modemip, const char *modemport);
   int Cs2ChangeCDCore(int coreid, const char *cdpath);
   void Cs2DeInit(void);
+  void Cs2SetTimingMode(int mode, const char * profile, const char * eventlog);
+  void Cs2ApplyTimingProfile(void);
+  u32 Cs2GetDriveRate(void);
 
   u8 FASTCALL 	Cs2ReadByte(u32);
   u16 FASTCALL 	Cs2ReadWord(u32);
@@ -302,6 +310,7 @@ extern "C" {
   void FASTCALL 	Cs2WriteWord(u32, u16);
   void FASTCALL 	Cs2WriteLong(u32, u32);
 
+  u32 FASTCALL    Cs2DataWordsPending(void);
   void FASTCALL   Cs2RapidCopyT1(void *dest, u32 count);
   void FASTCALL   Cs2RapidCopyT2(void *dest, u32 count);
 
@@ -397,7 +406,8 @@ extern "C" {
   void Cs2SetupDefaultPlayStats(u8 track_number, int writeFAD);
   block_struct * Cs2AllocateBlock(u8 * blocknum, s32 sectsize);
   void Cs2FreeBlock(block_struct * blk);
-  void Cs2SortBlocks(partition_struct * part);
+  void Cs2ResetBlockPool(void);
+  void Cs2RemoveBlocks(partition_struct * part, u32 pos, u32 count);
   partition_struct * Cs2GetPartition(filter_struct * curfilter);
   partition_struct * Cs2FilterData(filter_struct * curfilter, int isaudio);
   int Cs2CopyDirRecord(u8 * buffer, dirrec_struct * dirrec);
@@ -0,0 +1,691 @@
+/*  This file is part of Yabause.
+
+    Yabause is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Yabause is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Yabause; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+/*! \file inputlog.c
+    \brief Binary input log with keyframes.
+*/
+
+// File layout, all values little endian:
+//
+// header (64 bytes)
+//    "YIL" + version byte
+//    u32 keyframe interval
+//    u32 number of frames
+//    u32 number of keyframes
+//    u64 offset of the index, 0 if the recording wasn't stopped cleanly
+//    char[16] product number of the game
+//
+// chunks, in frame order
+//    'I' u32 frame, ports                   port data changed this frame
+//    'K' u32 frame, ports, u32 size, state  keyframe, a full save state
+//    'E'                                    end of the chunks
+//
+//    ports is u8 size + data for port 1, then the same for port 2
+//
+// index
+//    u32 frame, u64 offset of the 'K' chunk, once per keyframe
+//
+// Keyframes are full save states, a long recording goes past 2 GB quickly,
+// so file offsets are 64-bit everywhere.
+
+#if !defined(_MSC_VER) && !defined(_FILE_OFFSET_BITS)
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <stdlib.h>
+#include <string.h>
+#include "inputlog.h"
+#include "cs2.h"
+#include "error.h"
+#include "memory.h"
+#include "peripheral.h"
+#include "yabause.h"
+
+#define INPUTLOG_VERSION     2
+#define INPUTLOG_HEADER_SIZE 64
+
+#ifdef _MSC_VER
+typedef __int64 inputlogoff_t;
+#define InputLogTell(fp) _ftelli64(fp)
+#define InputLogSeekTo(fp, offset, whence) _fseeki64(fp, offset, whence)
+#else
+typedef off_t inputlogoff_t;
+#define InputLogTell(fp) ftello(fp)
+#define InputLogSeekTo(fp, offset, whence) fseeko(fp, offset, whence)
+#endif
+
+#define INPUTLOG_CHUNK_INPUT    'I'
+#define INPUTLOG_CHUNK_KEYFRAME 'K'
+#define INPUTLOG_CHUNK_END      'E'
+
+typedef struct
+{
+   u8 size;
+   u8 data[255];
+} inputlogport_struct;
+
+typedef struct
+{
+   int type;
+   u32 frame;
+   inputlogport_struct port[2];
+   u32 statesize;
+} inputlogchunk_struct;
+
+static struct
+{
+   int status;
+   FILE * fp;
+   u32 interval;
+   u32 frame;               // frame about to run, counted from the start
+   u32 num_frames;
+   u32 num_keyframes;
+   u32 max_keyframes;
+   u32 * keyframe_frames;
+   u64 * keyframe_offsets;
+   inputlogport_struct port[2]; // last recorded, or currently played back
+   int port_valid;
+   inputlogchunk_struct next;   // playback: next chunk, not applied yet
+} inputlog;
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void InputLogPut32(u8 * buf, u32 val)
+{
+   buf[0] = (u8)val;
+   buf[1] = (u8)(val >> 8);
+   buf[2] = (u8)(val >> 16);
+   buf[3] = (u8)(val >> 24);
+}
+
+static u32 InputLogGet32(const u8 * buf)
+{
+   return buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((u32)buf[3] << 24);
+}
+
+static void InputLogPut64(u8 * buf, u64 val)
+{
+   InputLogPut32(buf, (u32)val);
+   InputLogPut32(buf + 4, (u32)(val >> 32));
+}
+
+static u64 InputLogGet64(const u8 * buf)
+{
+   return InputLogGet32(buf) | ((u64)InputLogGet32(buf + 4) << 32);
+}
+
+static int InputLogWrite32(FILE * fp, u32 val)
+{
+   u8 buf[4];
+
+   InputLogPut32(buf, val);
+   return fwrite(buf, 1, 4, fp) == 4 ? 0 : -1;
+}
+
+static int InputLogRead32(FILE * fp, u32 * val)
+{
+   u8 buf[4];
+
+   if (fread(buf, 1, 4, fp) != 4)
+      return -1;
+   *val = InputLogGet32(buf);
+   return 0;
+}
+
+static int InputLogWrite64(FILE * fp, u64 val)
+{
+   u8 buf[8];
+
+   InputLogPut64(buf, val);
+   return fwrite(buf, 1, 8, fp) == 8 ? 0 : -1;
+}
+
+static int InputLogRead64(FILE * fp, u64 * val)
+{
+   u8 buf[8];
+
+   if (fread(buf, 1, 8, fp) != 8)
+      return -1;
+   *val = InputLogGet64(buf);
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void InputLogGetPorts(inputlogport_struct * port)
+{
+   PortData_struct * data[2] = { &PORTDATA1, &PORTDATA2 };
+   int i, size;
+
+   for (i = 0; i < 2; i++)
+   {
+      size = data[i]->size;
+      if (size < 0)
+         size = 0;
+      if (size > 255)
+         size = 255;
+
+      memset(&port[i], 0, sizeof(port[i]));
+      port[i].size = (u8)size;
+      memcpy(port[i].data, data[i]->data, size);
+   }
+}
+
+static void InputLogSetPorts(const inputlogport_struct * port)
+{
+   PortData_struct * data[2] = { &PORTDATA1, &PORTDATA2 };
+   int i;
+
+   for (i = 0; i < 2; i++)
+   {
+      memset(data[i]->data, 0, 8);
+      memcpy(data[i]->data, port[i].data, port[i].size);
+      data[i]->size = port[i].size;
+   }
+}
+
+static int InputLogWritePorts(FILE * fp, const inputlogport_struct * port)
+{
+   int i;
+
+   for (i = 0; i < 2; i++)
+   {
+      if (fwrite(&port[i].size, 1, 1, fp) != 1 ||
+          fwrite(port[i].data, 1, port[i].size, fp) != port[i].size)
+         return -1;
+   }
+
+   return 0;
+}
+
+static int InputLogReadPorts(FILE * fp, inputlogport_struct * port)
+{
+   int i;
+
+   for (i = 0; i < 2; i++)
+   {
+      memset(&port[i], 0, sizeof(port[i]));
+      if (fread(&port[i].size, 1, 1, fp) != 1 ||
+          fread(port[i].data, 1, port[i].size, fp) != port[i].size)
+         return -1;
+   }
+
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void InputLogGameId(char * id)
+{
+   memset(id, 0, 16);
+   if (cdip != NULL)
+      memcpy(id, cdip->itemnum, sizeof(cdip->itemnum) < 16 ? sizeof(cdip->itemnum) : 16);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int InputLogWriteHeader(FILE * fp, u64 index_offset)
+{
+   u8 header[INPUTLOG_HEADER_SIZE];
+
+   memset(header, 0, sizeof(header));
+   memcpy(header, "YIL", 3);
+   header[3] = INPUTLOG_VERSION;
+   InputLogPut32(header + 4, inputlog.interval);
+   InputLogPut32(header + 8, inputlog.num_frames);
+   InputLogPut32(header + 12, inputlog.num_keyframes);
+   InputLogPut64(header + 16, index_offset);
+   InputLogGameId((char *)header + 24);
+
+   InputLogSeekTo(fp, 0, SEEK_SET);
+   return fwrite(header, 1, sizeof(header), fp) == sizeof(header) ? 0 : -1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int InputLogAddKeyframe(u32 frame, u64 offset)
+{
+   if (inputlog.num_keyframes == inputlog.max_keyframes)
+   {
+      u32 max = inputlog.max_keyframes ? inputlog.max_keyframes * 2 : 64;
+      u32 * frames = (u32 *)realloc(inputlog.keyframe_frames, max * sizeof(u32));
+      u64 * offsets;
+
+      if (frames == NULL)
+         return -1;
+      inputlog.keyframe_frames = frames;
+
+      if ((offsets = (u64 *)realloc(inputlog.keyframe_offsets, max * sizeof(u64))) == NULL)
+         return -1;
+      inputlog.keyframe_offsets = offsets;
+      inputlog.max_keyframes = max;
+   }
+
+   inputlog.keyframe_frames[inputlog.num_keyframes] = frame;
+   inputlog.keyframe_offsets[inputlog.num_keyframes] = offset;
+   inputlog.num_keyframes++;
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void InputLogReset(void)
+{
+   if (inputlog.fp != NULL)
+      fclose(inputlog.fp);
+   free(inputlog.keyframe_frames);
+   free(inputlog.keyframe_offsets);
+   memset(&inputlog, 0, sizeof(inputlog));
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int InputLogRecord(const char * filename, u32 keyframe_interval)
+{
+   InputLogStop();
+
+   if ((inputlog.fp = fopen(filename, "w+b")) == NULL)
+   {
+      YabSetError(YAB_ERR_FILEWRITE, (void *)filename);
+      return -1;
+   }
+
+   inputlog.interval = keyframe_interval ? keyframe_interval : INPUTLOG_DEFAULT_INTERVAL;
+
+   if (InputLogWriteHeader(inputlog.fp, 0) != 0)
+   {
+      YabSetError(YAB_ERR_FILEWRITE, (void *)filename);
+      InputLogReset();
+      return -1;
+   }
+
+   inputlog.status = INPUTLOG_RECORDING;
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int InputLogWriteKeyframe(void)
+{
+   FILE * fp = inputlog.fp;
+   void * state;
+   size_t size;
+   inputlogoff_t offset = InputLogTell(fp);
+
+   if (offset < 0)
+      return -1;
+
+   if (YabSaveStateBuffer(&state, &size) != 0 || state == NULL)
+      return -1;
+
+   if (fputc(INPUTLOG_CHUNK_KEYFRAME, fp) == EOF ||
+       InputLogWrite32(fp, inputlog.frame) != 0 ||
+       InputLogWritePorts(fp, inputlog.port) != 0 ||
+       InputLogWrite32(fp, (u32)size) != 0 ||
+       fwrite(state, 1, size, fp) != size)
+   {
+      free(state);
+      return -1;
+   }
+
+   free(state);
+   return InputLogAddKeyframe(inputlog.frame, (u64)offset);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void InputLogRecordFrame(void)
+{
+   inputlogport_struct port[2];
+   int changed;
+
+   InputLogGetPorts(port);
+   changed = !inputlog.port_valid || memcmp(port, inputlog.port, sizeof(port)) != 0;
+   memcpy(inputlog.port, port, sizeof(port));
+   inputlog.port_valid = 1;
+
+   // a keyframe carries the port data too, so no separate entry is needed
+   if (inputlog.frame % inputlog.interval == 0)
+   {
+      if (InputLogWriteKeyframe() != 0)
+      {
+         YabSetError(YAB_ERR_FILEWRITE, "input log keyframe");
+         InputLogStop();
+         return;
+      }
+   }
+   else if (changed)
+   {
+      fputc(INPUTLOG_CHUNK_INPUT, inputlog.fp);
+      InputLogWrite32(inputlog.fp, inputlog.frame);
+      InputLogWritePorts(inputlog.fp, port);
+   }
+
+   inputlog.frame++;
+   inputlog.num_frames = inputlog.frame;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Reads the next chunk header, leaving the file at the save state of a
+// keyframe. Returns -1 at the end or on a damaged file.
+static int InputLogReadChunk(FILE * fp, inputlogchunk_struct * chunk)
+{
+   int type = fgetc(fp);
+
+   memset(chunk, 0, sizeof(*chunk));
+   chunk->type = type;
+
+   switch (type)
+   {
+      case INPUTLOG_CHUNK_INPUT:
+         if (InputLogRead32(fp, &chunk->frame) != 0 ||
+             InputLogReadPorts(fp, chunk->port) != 0)
+            return -1;
+         return 0;
+      case INPUTLOG_CHUNK_KEYFRAME:
+         if (InputLogRead32(fp, &chunk->frame) != 0 ||
+             InputLogReadPorts(fp, chunk->port) != 0 ||
+             InputLogRead32(fp, &chunk->statesize) != 0)
+            return -1;
+         return 0;
+      default:
+         chunk->type = INPUTLOG_CHUNK_END;
+         return -1;
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void InputLogNextChunk(void)
+{
+   if (inputlog.next.type == INPUTLOG_CHUNK_KEYFRAME)
+      InputLogSeekTo(inputlog.fp, inputlog.next.statesize, SEEK_CUR);
+
+   if (InputLogReadChunk(inputlog.fp, &inputlog.next) != 0)
+      inputlog.next.type = INPUTLOG_CHUNK_END;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// A recording that was never stopped has no index and no frame count in the
+// header, walk the chunks to rebuild them
+static int InputLogScan(void)
+{
+   FILE * fp = inputlog.fp;
+   inputlogchunk_struct chunk;
+   inputlogoff_t offset, filesize;
+
+   inputlog.num_keyframes = 0;
+   inputlog.num_frames = 0;
+   InputLogSeekTo(fp, 0, SEEK_END);
+   filesize = InputLogTell(fp);
+   InputLogSeekTo(fp, INPUTLOG_HEADER_SIZE, SEEK_SET);
+
+   for (;;)
+   {
+      offset = InputLogTell(fp);
+      if (InputLogReadChunk(fp, &chunk) != 0)
+         break;
+
+      if (chunk.type == INPUTLOG_CHUNK_KEYFRAME)
+      {
+         // the last keyframe may have been cut short
+         if ((inputlogoff_t)chunk.statesize > filesize - InputLogTell(fp))
+            break;
+         InputLogSeekTo(fp, chunk.statesize, SEEK_CUR);
+         if (InputLogAddKeyframe(chunk.frame, (u64)offset) != 0)
+            return -1;
+      }
+
+      inputlog.num_frames = chunk.frame + 1;
+   }
+
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int InputLogPlay(const char * filename)
+{
+   u8 header[INPUTLOG_HEADER_SIZE];
+   char id[16];
+   u64 index_offset;
+   u32 i;
+
+   InputLogStop();
+
+   if ((inputlog.fp = fopen(filename, "rb")) == NULL)
+   {
+      YabSetError(YAB_ERR_FILENOTFOUND, (void *)filename);
+      return -1;
+   }
+
+   if (fread(header, 1, sizeof(header), inputlog.fp) != sizeof(header) ||
+       memcmp(header, "YIL", 3) != 0 || header[3] != INPUTLOG_VERSION)
+   {
+      YabSetError(YAB_ERR_OTHER, "Not a supported input log");
+      InputLogReset();
+      return -1;
+   }
+
+   InputLogGameId(id);
+   if (cdip != NULL && memcmp(id, header + 24, 16) != 0)
+   {
+      YabSetError(YAB_ERR_OTHER, "Input log was recorded with a different game");
+      InputLogReset();
+      return -1;
+   }
+
+   inputlog.interval = InputLogGet32(header + 4);
+   inputlog.num_frames = InputLogGet32(header + 8);
+   index_offset = InputLogGet64(header + 16);
+
+   if (index_offset != 0)
+   {
+      u32 num = InputLogGet32(header + 12);
+
+      InputLogSeekTo(inputlog.fp, (inputlogoff_t)index_offset, SEEK_SET);
+      for (i = 0; i < num; i++)
+      {
+         u32 frame;
+         u64 offset;
+
+         if (InputLogRead32(inputlog.fp, &frame) != 0 ||
+             InputLogRead64(inputlog.fp, &offset) != 0 ||
+             InputLogAddKeyframe(frame, offset) != 0)
+            break;
+      }
+
+      if (i != num)
+         index_offset = 0;
+   }
+
+   if (index_offset == 0 && InputLogScan() != 0)
+   {
+      YabSetError(YAB_ERR_MEMORYALLOC, NULL);
+      InputLogReset();
+      return -1;
+   }
+
+   InputLogSeekTo(inputlog.fp, INPUTLOG_HEADER_SIZE, SEEK_SET);
+   InputLogNextChunk();
+
+   inputlog.frame = 0;
+   inputlog.status = INPUTLOG_PLAYING;
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void InputLogPlayFrame(void)
+{
+   if (inputlog.frame >= inputlog.num_frames)
+   {
+      InputLogStop();
+      return;
+   }
+
+   while (inputlog.next.type != INPUTLOG_CHUNK_END && inputlog.next.frame <= inputlog.frame)
+   {
+      memcpy(inputlog.port, inputlog.next.port, sizeof(inputlog.port));
+      inputlog.port_valid = 1;
+      InputLogNextChunk();
+   }
+
+   // set every frame, so input from the port doesn't leak in
+   if (inputlog.port_valid)
+      InputLogSetPorts(inputlog.port);
+
+   inputlog.frame++;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void InputLogFrame(void)
+{
+   if (inputlog.status == INPUTLOG_RECORDING)
+      InputLogRecordFrame();
+   else if (inputlog.status == INPUTLOG_PLAYING)
+      InputLogPlayFrame();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Loads the last keyframe at or before the frame and runs the emulation up
+// to it. Call it between frames while playing back.
+int InputLogSeek(u32 frame)
+{
+   inputlogchunk_struct chunk;
+   void * state;
+   u32 lo, hi;
+   int status;
+
+   if (inputlog.status != INPUTLOG_PLAYING || inputlog.num_keyframes == 0 ||
+       frame > inputlog.num_frames)
+      return -1;
+
+   // last keyframe with a frame number not above the one asked for
+   lo = 0;
+   hi = inputlog.num_keyframes;
+   while (hi - lo > 1)
+   {
+      u32 mid = (lo + hi) / 2;
+
+      if (inputlog.keyframe_frames[mid] <= frame)
+         lo = mid;
+      else
+         hi = mid;
+   }
+
+   InputLogSeekTo(inputlog.fp, (inputlogoff_t)inputlog.keyframe_offsets[lo], SEEK_SET);
+   if (InputLogReadChunk(inputlog.fp, &chunk) != 0 || chunk.type != INPUTLOG_CHUNK_KEYFRAME)
+   {
+      YabSetError(YAB_ERR_FILEREAD, "input log keyframe");
+      return -1;
+   }
+
+   if ((state = malloc(chunk.statesize)) == NULL)
+   {
+      YabSetError(YAB_ERR_MEMORYALLOC, NULL);
+      return -1;
+   }
+
+   if (fread(state, 1, chunk.statesize, inputlog.fp) != chunk.statesize)
+   {
+      free(state);
+      YabSetError(YAB_ERR_FILEREAD, "input log keyframe");
+      return -1;
+   }
+
+   status = YabLoadStateBuffer(state, chunk.statesize);
+   free(state);
+   if (status != 0)
+      return -1;
+
+   memcpy(inputlog.port, chunk.port, sizeof(inputlog.port));
+   inputlog.port_valid = 1;
+   inputlog.frame = chunk.frame;
+   inputlog.next.type = INPUTLOG_CHUNK_INPUT;
+   InputLogNextChunk();
+
+   while (inputlog.status == INPUTLOG_PLAYING && inputlog.frame < frame)
+      YabauseEmulate();
+
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void InputLogStop(void)
+{
+   if (inputlog.status == INPUTLOG_RECORDING)
+   {
+      FILE * fp = inputlog.fp;
+      inputlogoff_t index_offset;
+      u32 i;
+
+      fputc(INPUTLOG_CHUNK_END, fp);
+      index_offset = InputLogTell(fp);
+
+      for (i = 0; i < inputlog.num_keyframes; i++)
+      {
+         InputLogWrite32(fp, inputlog.keyframe_frames[i]);
+         InputLogWrite64(fp, inputlog.keyframe_offsets[i]);
+      }
+
+      InputLogWriteHeader(fp, index_offset > 0 ? (u64)index_offset : 0);
+   }
+
+   InputLogReset();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int InputLogGetStatus(void)
+{
+   return inputlog.status;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+u32 InputLogGetFrame(void)
+{
+   return inputlog.frame;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+u32 InputLogGetNumFrames(void)
+{
+   return inputlog.num_frames;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Frame numbers of the keyframes in increasing order, a replay can be split
+// into pieces that each start with InputLogSeek to one of them
+u32 InputLogGetKeyframes(const u32 ** frames)
+{
+   if (frames != NULL)
+      *frames = inputlog.keyframe_frames;
+   return inputlog.num_keyframes;
+}
+
+//////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,63 @@
+/*  This file is part of Yabause.
+
+    Yabause is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Yabause is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Yabause; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+/*! \file inputlog.h
+    \brief Binary input log with keyframes.
+
+    Records the peripheral port data frame by frame, one entry each time it
+    changes, plus a full save state every keyframe interval. An index of the
+    keyframes is written at the end of the file, so a replay can jump to any
+    frame by loading the keyframe before it and running at most one interval
+    of frames. A long replay can also be split up, each worker seeking to a
+    different keyframe.
+
+    Frames are counted from the start of the recording, the first keyframe
+    is always frame 0. The log is fed from YabauseEmulate, before the frame
+    runs.
+*/
+
+#ifndef INPUTLOG_H
+#define INPUTLOG_H
+
+#include "core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define INPUTLOG_STOPPED   0
+#define INPUTLOG_RECORDING 1
+#define INPUTLOG_PLAYING   2
+
+#define INPUTLOG_DEFAULT_INTERVAL 600
+
+int InputLogRecord(const char * filename, u32 keyframe_interval);
+int InputLogPlay(const char * filename);
+void InputLogStop(void);
+int InputLogSeek(u32 frame);
+void InputLogFrame(void);
+
+int InputLogGetStatus(void);
+u32 InputLogGetFrame(void);
+u32 InputLogGetNumFrames(void);
+u32 InputLogGetKeyframes(const u32 ** frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -452,6 +452,9 @@ M68K_struct *M68KCoreList[] = {
     &M68KMusashi,
 #else
     &M68KC68K,
+#endif
+#ifdef HAVE_Q68
+    &M68KQ68,
 #endif
     NULL
 };
@@ -840,43 +843,38 @@ void retro_set_controller_port_device(unsigned port, unsigned device)
    }
 }
 
-size_t retro_serialize_size(void)
+// The size is fixed by the cart chosen at load; frontends expect it to stay
+// constant, so it is only computed once per game
+static size_t serialize_size = 0;
+
+static int use_fast_savestates(void)
 {
-   // Disabling savestates until they are safe
+   int result = 0;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_AUDIO_VIDEO_ENABLE, &result))
+      return (result & 4) != 0;
    return 0;
-   void *buffer;
-   size_t size;
-
-   ScspMuteAudio(SCSP_MUTE_SYSTEM);
-   YabSaveStateBuffer (&buffer, &size);
-   ScspUnMuteAudio(SCSP_MUTE_SYSTEM);
+}
 
-   free(buffer);
+size_t retro_serialize_size(void)
+{
+   if (serialize_size == 0)
+      serialize_size = YabSaveStateMemSize();
 
-   return size;
+   return serialize_size;
 }
 
 bool retro_serialize(void *data, size_t size)
 {
-   // Disabling savestates until they are safe
-   return true;
-   void *buffer;
-   size_t out_size;
-
-   int error = YabSaveStateBuffer (&buffer, &out_size);
-
-   memcpy(data, buffer, size);
-
-   free(buffer);
-   return !error;
+   return YabSaveStateMem(data, size, NULL) == 0;
 }
 
 bool retro_unserialize(const void *data, size_t size)
 {
-   // Disabling savestates until they are safe
-   return true;
-   int error = YabLoadStateBuffer(data, size);
-   retro_set_resolution();
+   int fast = use_fast_savestates();
+   int error = YabLoadStateMem(data, size, fast);
+
+   if (!fast)
+      retro_set_resolution();
 
    return !error;
 }
@@ -1266,6 +1264,7 @@ bool retro_load_game_special(unsigned game_type, const struct retro_game_info *i
 
 void retro_unload_game(void)
 {
+   serialize_size = 0;
    if (!renderer_running)
       VIDCore->Init();
    YabauseDeInit();
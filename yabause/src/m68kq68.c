@@ -23,6 +23,17 @@
 
 #include "q68/q68.h"
 
+#if defined(Q68_USE_JIT) && !defined(PSP)
+# ifdef _WIN32
+#  include <windows.h>
+# else
+#  include <sys/mman.h>
+# endif
+#endif
+#ifdef _MSC_VER
+# include <windows.h>  // Interlocked*() for the pending page bitmap
+#endif
+
 /*************************************************************************/
 
 /**
@@ -34,6 +45,16 @@
 # define NEED_TRAMPOLINE
 #endif
 
+/**
+ * EXEC_ALLOC:  Defined when translated code has to be placed in memory
+ * explicitly mapped executable.  The x86-64 translator copies its code
+ * fragments into blocks from the state's malloc function, and the C heap
+ * is not executable on modern x86-64 systems.
+ */
+#if defined(Q68_USE_JIT) && !defined(PSP)
+# define EXEC_ALLOC
+#endif
+
 /**
  * PROFILE_68K: Perform simple profiling of the 68000 emulation, reporting
  * the average time per 68000 clock cycle.  (Realtime execution would be
@@ -84,6 +105,12 @@ static void m68kq68_set_writew(M68K_WRITE *func);
 static uint32_t dummy_read(uint32_t address);
 static void dummy_write(uint32_t address, uint32_t data);
 
+#ifdef EXEC_ALLOC
+static void *exec_malloc(size_t size);
+static void *exec_realloc(void *ptr, size_t size);
+static void exec_free(void *ptr);
+#endif
+
 #ifdef NEED_TRAMPOLINE
 static uint32_t readb_trampoline(uint32_t address);
 static uint32_t readw_trampoline(uint32_t address);
@@ -94,6 +121,8 @@ static void writew_trampoline(uint32_t address, uint32_t data);
 static void m68kq68_save_state(FILE * fp);
 static void m68kq68_load_state(FILE * fp);
 
+static void apply_pending_pages(void);
+
 /*-----------------------------------------------------------------------*/
 
 /* Module interface definition */
@@ -141,6 +170,31 @@ M68K_struct M68KQ68 = {
 
 static Q68State *state;
 
+/**
+ * PENDING_PAGE_BITS:  Size (as a power of 2) of the pages recorded by
+ * m68kq68_write_notify().  Matches Q68_JIT_PAGE_BITS so that one pending
+ * bit covers exactly one translation page.
+ */
+#define PENDING_PAGE_BITS  8
+#define PENDING_PAGE_COUNT (0x100000 >> PENDING_PAGE_BITS)
+
+/* Pages written by someone other than the 68000 (the SH-2 writing sound
+ * RAM, SCSP DMA, state loads) whose translations still have to be
+ * cleared.  The SH-2 side can run while the sound thread is inside
+ * q68_run(), so the translations are only cleared by the sound thread
+ * between two Exec() slices, see apply_pending_pages(). */
+static volatile uint32_t pending_pages[PENDING_PAGE_COUNT / 32];
+static volatile int pending_any;
+
+#ifdef _MSC_VER
+# define PENDING_SET(word,mask)  InterlockedOr((volatile LONG *)&(word), (mask))
+# define PENDING_TAKE(word)      (uint32_t)InterlockedExchange((volatile LONG *)&(word), 0)
+# define PENDING_BARRIER()       MemoryBarrier()
+#else
+# define PENDING_SET(word,mask)  __sync_fetch_and_or(&(word), (mask))
+# define PENDING_TAKE(word)      __sync_fetch_and_and(&(word), 0)
+# define PENDING_BARRIER()       __sync_synchronize()
+#endif
 
 #ifdef NEED_TRAMPOLINE
 
@@ -165,9 +219,15 @@ static M68K_WRITE *real_writeb, *real_writew;
  */
 static int m68kq68_init(void)
 {
+#ifdef EXEC_ALLOC
+    if (!(state = q68_create_ex(exec_malloc, exec_realloc, exec_free))) {
+        return -1;
+    }
+#else
     if (!(state = q68_create())) {
         return -1;
     }
+#endif
     q68_set_irq(state, 0);
     q68_set_readb_func(state, dummy_read);
     q68_set_readw_func(state, dummy_read);
@@ -224,6 +284,7 @@ static FASTCALL s32 m68kq68_exec(s32 cycles)
     static uint32_t tot_cycles = 0, tot_usec = 0, tot_ticks = 0;
     static uint32_t last_report = 0;
     uint32_t start, end;
+    apply_pending_pages();
     start = (uint32_t) YabauseGetTicks();
     int retval = q68_run(state, cycles);
     end = (uint32_t) YabauseGetTicks();
@@ -257,6 +318,7 @@ static FASTCALL s32 m68kq68_exec(s32 cycles)
     }
     return retval;
 #else  // !PROFILE_68K
+    apply_pending_pages();
     return q68_run(state, cycles);
 #endif
 }
@@ -380,7 +442,8 @@ static FASTCALL void m68kq68_set_irq(s32 level)
 
 /**
  * m68kq68_write_notify:  Inform the 68k emulator that the given address
- * range has been modified.
+ * range has been modified.  May be called from any thread; the pages are
+ * only marked here and cleared by the next m68kq68_exec().
  *
  * [Parameters]
  *     address: 68000 address of modified data
@@ -390,7 +453,25 @@ static FASTCALL void m68kq68_set_irq(s32 level)
  */
 static FASTCALL void m68kq68_write_notify(u32 address, u32 size)
 {
-    q68_touch_memory(state, address, size);
+    uint32_t page, last;
+
+    if (size == 0) {
+        return;
+    }
+    address &= 0xFFFFF;
+    page = address >> PENDING_PAGE_BITS;
+    if (size > 0x100000 - address) {
+        last = PENDING_PAGE_COUNT - 1;
+    } else {
+        last = (address + size - 1) >> PENDING_PAGE_BITS;
+    }
+    for (; page <= last; page++) {
+        PENDING_SET(pending_pages[page / 32], 1u << (page % 32));
+    }
+    /* The bits must be visible before the flag that sends the sound
+     * thread looking for them */
+    PENDING_BARRIER();
+    pending_any = 1;
 }
 
 /*************************************************************************/
@@ -464,6 +545,79 @@ static void m68kq68_set_writew(M68K_WRITE *func)
 
 /*************************************************************************/
 
+#ifdef EXEC_ALLOC
+
+/**
+ * exec_malloc, exec_realloc, exec_free:  Memory allocation functions
+ * returning readable, writable and executable memory.  Each block is its
+ * own mapping, with the mapping size stored in the first EXEC_HEADER
+ * bytes.  Q68 only allocates when a block is translated or grows, so the
+ * per-block system call is not a concern.
+ */
+
+#define EXEC_HEADER  16
+
+static void *exec_malloc(size_t size)
+{
+    const size_t total = size + EXEC_HEADER;
+    uint8_t *base;
+
+#ifdef _WIN32
+    base = VirtualAlloc(NULL, total, MEM_COMMIT | MEM_RESERVE,
+                        PAGE_EXECUTE_READWRITE);
+    if (!base) {
+        return NULL;
+    }
+#else
+    base = mmap(NULL, total, PROT_READ | PROT_WRITE | PROT_EXEC,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        return NULL;
+    }
+#endif
+    *(size_t *)base = total;
+    return base + EXEC_HEADER;
+}
+
+static void exec_free(void *ptr)
+{
+    uint8_t *base;
+
+    if (!ptr) {
+        return;
+    }
+    base = (uint8_t *)ptr - EXEC_HEADER;
+#ifdef _WIN32
+    VirtualFree(base, 0, MEM_RELEASE);
+#else
+    munmap(base, *(size_t *)base);
+#endif
+}
+
+static void *exec_realloc(void *ptr, size_t size)
+{
+    size_t oldsize;
+    void *newptr;
+
+    if (!ptr) {
+        return exec_malloc(size);
+    }
+    oldsize = *(size_t *)((uint8_t *)ptr - EXEC_HEADER) - EXEC_HEADER;
+    if (size <= oldsize) {
+        return ptr;
+    }
+    if (!(newptr = exec_malloc(size))) {
+        return NULL;
+    }
+    memcpy(newptr, ptr, oldsize);
+    exec_free(ptr);
+    return newptr;
+}
+
+#endif  // EXEC_ALLOC
+
+/*-----------------------------------------------------------------------*/
+
 /**
  * dummy_read:  Default read function, always returning 0 for any address.
  *
@@ -525,6 +679,47 @@ static void writew_trampoline(uint32_t address, uint32_t data) {
 
 #endif  // NEED_TRAMPOLINE
 
+/*************************************************************************/
+
+/**
+ * apply_pending_pages:  Clear the translations of all pages marked by
+ * m68kq68_write_notify().  Must be called on the thread that runs the
+ * 68000, outside q68_run().
+ *
+ * [Parameters]
+ *     None
+ * [Return value]
+ *     None
+ */
+static void apply_pending_pages(void)
+{
+    uint32_t i;
+
+    if (!pending_any) {
+        return;
+    }
+    /* Clear the flag before the scan, so a page marked during the scan
+     * raises it again and is picked up by the next call */
+    pending_any = 0;
+    PENDING_BARRIER();
+
+    for (i = 0; i < PENDING_PAGE_COUNT / 32; i++) {
+        uint32_t bits, bit;
+        if (!pending_pages[i]) {
+            continue;
+        }
+        bits = PENDING_TAKE(pending_pages[i]);
+        for (bit = 0; bits != 0; bit++, bits >>= 1) {
+            if (bits & 1) {
+                q68_touch_memory(state, (i*32 + bit) << PENDING_PAGE_BITS,
+                                 1 << PENDING_PAGE_BITS);
+            }
+        }
+    }
+}
+
+/*************************************************************************/
+
 static void m68kq68_save_state(FILE * fp)
 {
    int i = 0;
@@ -539,20 +734,20 @@ static void m68kq68_save_state(FILE * fp)
 
    for (i = 0; i < 8; i++)
    {
-      val = q68_get_areg(state, i, val);
+      val = q68_get_areg(state, i);
       ywrite(&check, (void *)&val, sizeof(u32), 1, fp);
    }
 
-   val = q68_get_pc(state, val);
+   val = q68_get_pc(state);
    ywrite(&check, (void *)&val, sizeof(u32), 1, fp);
    
-   val = q68_get_sr(state, val);
+   val = q68_get_sr(state);
    ywrite(&check, (void *)&val, sizeof(u32), 1, fp);
    
-   val = q68_get_usp(state, val);
+   val = q68_get_usp(state);
    ywrite(&check, (void *)&val, sizeof(u32), 1, fp);
    
-   val = q68_get_ssp(state, val);
+   val = q68_get_ssp(state);
    ywrite(&check, (void *)&val, sizeof(u32), 1, fp);
 }
 
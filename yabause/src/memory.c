@@ -48,8 +48,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
 #include <stdlib.h>
 #include <sys/stat.h>
 #include <ctype.h>
+#include <string.h>
 
 #include "memory.h"
+#include "bupsync.h"
 #include "coffelf.h"
 #include "cs0.h"
 #include "cs1.h"
@@ -154,7 +156,8 @@ void * YabMemMap(char * filename, u32 size ) {
   //  return NULL;
   //}
 
-  p = mmap(0, sb.st_size, PROT_READ| PROT_WRITE, MAP_SHARED, fd, 0);
+  // copy-on-write, the file is only updated through the bupsync journal
+  p = mmap(0, sb.st_size, PROT_READ| PROT_WRITE, MAP_PRIVATE, fd, 0);
   if (p == MAP_FAILED) {
     LOG("YabMemMap: mmap failed");
     return NULL;
@@ -186,10 +189,12 @@ void * YabMemMap(char * filename, u32 size ) {
   char *p;
   int fd;
 
+  // copy-on-write, the file is only updated through the bupsync journal,
+  // which needs to open it for writing meanwhile
   hFile = CreateFileA(
     filename, 
-    GENERIC_READ|GENERIC_WRITE, 
-    FILE_SHARE_READ,
+    GENERIC_READ, 
+    FILE_SHARE_READ|FILE_SHARE_WRITE,
     0, 
     OPEN_EXISTING, 
     FILE_ATTRIBUTE_NORMAL,
@@ -206,14 +211,14 @@ void * YabMemMap(char * filename, u32 size ) {
   hFMWrite = CreateFileMapping(
     hFile,
     NULL,
-    PAGE_READWRITE,
+    PAGE_WRITECOPY,
     0,
     size,
     "BACKUP");
   if (hFMWrite == INVALID_HANDLE_VALUE)
     return NULL;
 
-  return MapViewOfFile(hFMWrite, FILE_MAP_ALL_ACCESS, 0, 0, size);
+  return MapViewOfFile(hFMWrite, FILE_MAP_COPY, 0, 0, size);
 }
 
 void YabFreeMap(void * p) {
@@ -229,6 +234,228 @@ void * YabMemMap(char * filename) {
 }
 #endif
 
+//////////////////////////////////////////////////////////////////////////////
+// BIOS and ROM cartridge images are mapped from disk rather than read into a
+// buffer of each process, so every process running the same image shares
+// its pages. T2 images are stored byte swapped on little endian hosts, they
+// are mapped from a swapped copy kept in the ROM cache directory, or loaded
+// as before when none is set. The mappings are private: a write only copies
+// the page it lands on.
+
+#define ROMMAP_MAX 4
+
+static struct {
+  u8 * mem;
+  u32 size;
+} rommaps[ROMMAP_MAX];
+
+static char * romcachedir = NULL;
+
+void YabRomSetCacheDir(const char * dir) {
+  free(romcachedir);
+  romcachedir = (dir != NULL && dir[0] != '\0') ? strdup(dir) : NULL;
+}
+
+#if defined(__GNUC__) && !defined(_WINDOWS) && !defined(NX)
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+static u8 * YabRomMapFile(const char * filename, u32 size) {
+  struct stat sb;
+  void * p;
+  int fd;
+
+  if ((fd = open(filename, O_RDONLY)) == -1)
+    return NULL;
+
+  // a short file would fault past its end
+  if (fstat(fd, &sb) == -1 || sb.st_size < (off_t)size) {
+    close(fd);
+    return NULL;
+  }
+
+  p = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  return p == MAP_FAILED ? NULL : (u8 *)p;
+}
+
+static const char * YabRomBaseName(const char * filename) {
+  const char * base = strrchr(filename, '/');
+  return base ? base + 1 : filename;
+}
+
+// The name carries the size and time of the original, so a changed image
+// never picks up an old copy
+static char * YabRomCacheName(const char * filename, u32 size, const struct stat * sb) {
+  char * name;
+
+  if ((name = (char *)malloc(strlen(romcachedir) + strlen(filename) + 64)) == NULL)
+    return NULL;
+
+  sprintf(name, "%s/%s.%lx.%lx.%x.t2", romcachedir, YabRomBaseName(filename),
+    (unsigned long)sb->st_size, (unsigned long)sb->st_mtime, (unsigned int)size);
+
+  return name;
+}
+
+// Is entry <base>.<hex>.<hex>.<hex>.t2, a cache of an image named base?
+static int YabRomIsCacheOf(const char * entry, const char * base) {
+  size_t len = strlen(base);
+  int i;
+
+  if (strncmp(entry, base, len) != 0)
+    return 0;
+  entry += len;
+
+  for (i = 0; i < 3; i++) {
+    size_t digits;
+    if (*entry++ != '.')
+      return 0;
+    if ((digits = strspn(entry, "0123456789abcdef")) == 0)
+      return 0;
+    entry += digits;
+  }
+
+  return strcmp(entry, ".t2") == 0;
+}
+
+// Copies made for an older version of the image would never be used again.
+// Processes that still map one keep their pages after the unlink.
+static void YabRomRemoveStaleCaches(const char * filename, const char * cachename) {
+  const char * base = YabRomBaseName(filename);
+  const char * keep = YabRomBaseName(cachename);
+  struct dirent * entry;
+  DIR * dir;
+
+  if ((dir = opendir(romcachedir)) == NULL)
+    return;
+
+  while ((entry = readdir(dir)) != NULL) {
+    char * path;
+
+    if (strcmp(entry->d_name, keep) == 0 || !YabRomIsCacheOf(entry->d_name, base))
+      continue;
+
+    if ((path = (char *)malloc(strlen(romcachedir) + strlen(entry->d_name) + 2)) != NULL) {
+      sprintf(path, "%s/%s", romcachedir, entry->d_name);
+      remove(path);
+      free(path);
+    }
+  }
+
+  closedir(dir);
+}
+
+static int YabRomBuildCache(const char * filename, const char * cachename, u32 size) {
+  char * temp;
+  u8 * image;
+  FILE * fp;
+  int ret = -1;
+
+  if ((image = (u8 *)calloc(size, 1)) == NULL)
+    return -1;
+
+  if ((temp = (char *)malloc(strlen(cachename) + 32)) == NULL) {
+    free(image);
+    return -1;
+  }
+
+  // written under a name of its own, other processes only ever see a
+  // complete cache
+  sprintf(temp, "%s.%ld.tmp", cachename, (long)getpid());
+  mkdir(romcachedir, 0755);
+
+  if (T123Load(image, size, 2, filename) == 0 && (fp = fopen(temp, "wb")) != NULL) {
+    if (fwrite(image, 1, size, fp) == size && fflush(fp) == 0 && fsync(fileno(fp)) == 0) {
+      fclose(fp);
+      ret = rename(temp, cachename);
+    }
+    else
+      fclose(fp);
+
+    if (ret != 0)
+      remove(temp);
+    else
+      YabRomRemoveStaleCaches(filename, cachename);
+  }
+
+  free(temp);
+  free(image);
+  return ret;
+}
+
+u8 * YabRomMap(const char * filename, u32 size, int type) {
+  u8 * mem = NULL;
+  int i;
+
+  if (filename == NULL || filename[0] == '\0')
+    return NULL;
+
+  for (i = 0; i < ROMMAP_MAX && rommaps[i].mem != NULL; i++) {}
+  if (i == ROMMAP_MAX)
+    return NULL;
+
+#ifndef WORDS_BIGENDIAN
+  if (type == 2) {
+    struct stat sb;
+    char * cachename;
+
+    // without a cache directory the image is loaded instead
+    if (romcachedir == NULL)
+      return NULL;
+
+    if (stat(filename, &sb) != 0 || (cachename = YabRomCacheName(filename, size, &sb)) == NULL)
+      return NULL;
+
+    if ((mem = YabRomMapFile(cachename, size)) == NULL &&
+        YabRomBuildCache(filename, cachename, size) == 0)
+      mem = YabRomMapFile(cachename, size);
+
+    free(cachename);
+  }
+  else
+#endif
+  if (type == 1 || type == 2)
+    mem = YabRomMapFile(filename, size);
+
+  if (mem != NULL) {
+    rommaps[i].mem = mem;
+    rommaps[i].size = size;
+  }
+
+  return mem;
+}
+
+int YabRomUnmap(u8 * mem) {
+  int i;
+
+  for (i = 0; i < ROMMAP_MAX; i++) {
+    if (mem != NULL && rommaps[i].mem == mem) {
+      munmap(mem, rommaps[i].size);
+      rommaps[i].mem = NULL;
+      return 0;
+    }
+  }
+
+  return -1;
+}
+
+#else
+
+u8 * YabRomMap(const char * filename, u32 size, int type) {
+  return NULL;
+}
+
+int YabRomUnmap(u8 * mem) {
+  return -1;
+}
+
+#endif
+
 
 //////////////////////////////////////////////////////////////////////////////
 
@@ -571,6 +798,7 @@ static void FASTCALL BupRamMemoryWriteByte(u32 addr, u8 val)
   }
   //printf("BupRamMemoryWriteByte %08X\n",addr);
   T1WriteByte(BupRam, addr|0x1, val);
+  BupSyncMarkDirty(BUPSYNC_INTERNAL, addr|0x1);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -680,12 +908,12 @@ void MappedMemoryInit()
                                 &SoundRamWriteByte,
                                 &SoundRamWriteWord,
                                 &SoundRamWriteLong);
-   FillMemoryArea(0x5B0, 0x5BF, &scsp_r_b,
-                                &scsp_r_w,
-                                &scsp_r_d,
-                                &scsp_w_b,
-                                &scsp_w_w,
-                                &scsp_w_d);
+   FillMemoryArea(0x5B0, 0x5BF, &ScspSh2ReadByte,
+                                &ScspSh2ReadWord,
+                                &ScspSh2ReadLong,
+                                &ScspSh2WriteByte,
+                                &ScspSh2WriteWord,
+                                &ScspSh2WriteLong);
    FillMemoryArea(0x5C0, 0x5C7, &Vdp1RamReadByte,
                                 &Vdp1RamReadWord,
                                 &Vdp1RamReadLong,
@@ -804,6 +1032,83 @@ inline u32 getMemClock(u32 addr) {
 
 #endif
 
+//////////////////////////////////////////////////////////////////////////////
+
+int MemoryGetSpan(u32 addr, MemorySpan * span) {
+   u32 mask;
+   addr &= 0x0FFFFFFF;
+   if ((addr & 0x0FF00000) == 0x00200000) {
+      span->base = LowWram;
+      mask = 0xFFFFF;
+      span->t2 = 1;
+   } else if ((addr & 0x0FF00000) == 0x06000000) {
+      span->base = HighWram;
+      mask = 0xFFFFF;
+      span->t2 = 1;
+   } else if ((addr & 0x0FF80000) == 0x05C00000) {
+      span->base = Vdp1Ram;
+      mask = 0x7FFFF;
+      span->t2 = 0;
+   } else if ((addr & 0x0FF00000) == 0x05E00000) {
+      span->base = Vdp2Ram;
+      mask = 0x7FFFF;
+      span->t2 = 0;
+   } else {
+      return 0;
+   }
+   if (span->base == NULL)
+      return 0;
+   span->offset = addr & mask;
+   span->avail = mask + 1 - span->offset;
+   span->ptr = span->base + span->offset;
+   return 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Call before a block transfer reads or writes the span. In lock-step mode it
+// joins the render thread first, as Vdp1RamRead*/Vdp1RamWrite* do per access.
+void MemorySpanSync(const MemorySpan * span) {
+   if (span->base == Vdp1Ram || span->base == Vdp2Ram)
+      Vdp2LockStepSync();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void MemorySpanCopy(MemorySpan * dst, const MemorySpan * src, u32 size) {
+#ifndef WORDS_BIGENDIAN
+   if (dst->t2 != src->t2) {
+      // T1 <-> T2 swaps the bytes of every 16-bit word. Kept as a plain loop
+      // over 32-bit lanes so the compiler can vectorize it.
+      const u8 * s = src->ptr;
+      u8 * d = dst->ptr;
+      u32 i;
+      for (i = 0; i + 4 <= size; i += 4) {
+         u32 v;
+         memcpy(&v, s + i, 4);
+         v = ((v & 0x00FF00FF) << 8) | ((v >> 8) & 0x00FF00FF);
+         memcpy(d + i, &v, 4);
+      }
+      if (i < size) {
+         d[i] = s[i + 1];
+         d[i + 1] = s[i];
+      }
+      return;
+   }
+#endif
+   memcpy(dst->ptr, src->ptr, size);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void MemorySpanWritten(const MemorySpan * span, u32 size) {
+   if (span->base == Vdp1Ram)
+      Vdp1RamWriteNotify(span->offset, size);
+   else if (span->base == Vdp2Ram)
+      Vdp2RamWriteNotify(span->offset, size);
+   // Work RAM is reported to the SH-2 core by the caller
+}
+
 #if 0
 inline u32 getMemCycle(u32 addr) {
   switch (addr & 0xFFF00000) {
@@ -1399,6 +1704,16 @@ int MappedMemoryLoadExec(const char *filename, u32 pc)
 
 int LoadBios(const char *filename)
 {
+   u8 * rom = YabRomMap(filename, 0x80000, 2);
+
+   if (rom != NULL)
+   {
+      if (YabRomUnmap(BiosRom) != 0)
+         T2MemoryDeInit(BiosRom);
+      BiosRom = rom;
+      return 0;
+   }
+
    return T123Load(BiosRom, 0x80000, 2, filename);
 }
 
@@ -1492,6 +1807,217 @@ void FormatBackupRam(void *mem, u32 size)
 
 //////////////////////////////////////////////////////////////////////////////
 
+// In-memory states (YabSaveStateMem) leave out the screenshot, the movie and
+// the OSD message so that the same emulated state always gives the same
+// bytes, and so that their layout only depends on the inserted cartridge.
+static int state_mem_mode = 0;
+int StateFastLoad = 0;
+
+//////////////////////////////////////////////////////////////////////////////
+
+// A state for another cartridge would reallocate the cart RAM and change the
+// size of every following state, see YabSaveStateMemSize
+static int YabStateMemCartMatches(const u8 * p, size_t length)
+{
+   int carttype;
+
+   // The CART chunk always comes first, right after the 0x14 byte header
+   if (length < 0x24 || memcmp(p + 0x14, "CART", 4) != 0)
+      return 0;
+   memcpy(&carttype, p + 0x20, sizeof(carttype));
+   return carttype == CartridgeArea->carttype;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void StateReadPages(IOCheck_struct * check, FILE * fp, u8 * dst, u32 size, u32 shift, void (*dirty)(u32 addr, u32 size))
+{
+   u8 page[0x1000];
+   u32 page_size = 1 << shift;
+   u32 addr;
+
+   if (!StateFastLoad || page_size > sizeof(page))
+   {
+      yread(check, (void *)dst, size, 1, fp);
+      dirty(0, size);
+      return;
+   }
+
+   for (addr = 0; addr < size; addr += page_size)
+   {
+      yread(check, (void *)page, page_size, 1, fp);
+      if (memcmp(dst + addr, page, page_size) != 0)
+      {
+         memcpy(dst + addr, page, page_size);
+         dirty(addr, page_size);
+      }
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+#if !defined(_WIN32)
+static void YabStateQuiesce(void)
+{
+   ScspLockThread();
+   Vdp2Quiesce();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int YabSaveStateMem(void * buffer, size_t size, size_t * used)
+{
+   FILE * fp;
+   int status;
+   long end;
+
+   if (used != NULL) *used = 0;
+
+   if ((fp = fmemopen(buffer, size, "w+b")) == NULL)
+      return -1;
+
+   YabStateQuiesce();
+   state_mem_mode = 1;
+   status = YabSaveStateStream(fp);
+   state_mem_mode = 0;
+   ScspUnLockThread();
+
+   fflush(fp);
+   fseek(fp, 0, SEEK_END);
+   end = ftell(fp);
+   fclose(fp);
+
+   if (status != 0)
+      return status;
+
+   // A full buffer means the state was truncated
+   if (end < 0 || (size_t)end >= size)
+      return -2;
+
+   memset((u8 *)buffer + end, 0, size - end);
+   if (used != NULL) *used = end;
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int YabLoadStateMem(const void * buffer, size_t size, int fast)
+{
+   const u8 * p = (const u8 *)buffer;
+   FILE * fp;
+   int status;
+   int version, chunks;
+   size_t length;
+
+   // Trailing padding is not part of the state, take the length from the
+   // header (signature, endianness, version, size, frame, movie position)
+   if (size < 0x14 || memcmp(p, "YSS", 3) != 0)
+      return -2;
+   memcpy(&version, p + 4, sizeof(version));
+   memcpy(&chunks, p + 8, sizeof(chunks));
+   length = (size_t)chunks + (version > 1 ? 0x14 : 0xC);
+   if (chunks < 0 || length > size)
+      return -2;
+   if (!YabStateMemCartMatches(p, length))
+      return -3;
+
+   if ((fp = fmemopen((void *)buffer, length, "rb")) == NULL)
+      return -1;
+
+   YabStateQuiesce();
+   state_mem_mode = 1;
+   StateFastLoad = fast;
+   status = YabLoadStateStream(fp);
+   StateFastLoad = 0;
+   state_mem_mode = 0;
+   ScspUnLockThread();
+
+   fclose(fp);
+   return status;
+}
+#else
+// No fmemopen on Windows, go through the buffer functions
+int YabSaveStateMem(void * buffer, size_t size, size_t * used)
+{
+   void * state;
+   size_t state_size;
+   int status;
+
+   if (used != NULL) *used = 0;
+
+   Vdp2Quiesce();
+   state_mem_mode = 1;
+   status = YabSaveStateBuffer(&state, &state_size);
+   state_mem_mode = 0;
+   if (status != 0)
+      return status;
+
+   if (state_size >= size)
+   {
+      free(state);
+      return -2;
+   }
+
+   memcpy(buffer, state, state_size);
+   memset((u8 *)buffer + state_size, 0, size - state_size);
+   free(state);
+   if (used != NULL) *used = state_size;
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int YabLoadStateMem(const void * buffer, size_t size, int fast)
+{
+   const u8 * p = (const u8 *)buffer;
+   int status;
+   int version, chunks;
+   size_t length;
+
+   if (size < 0x14 || memcmp(p, "YSS", 3) != 0)
+      return -2;
+   memcpy(&version, p + 4, sizeof(version));
+   memcpy(&chunks, p + 8, sizeof(chunks));
+   length = (size_t)chunks + (version > 1 ? 0x14 : 0xC);
+   if (chunks < 0 || length > size)
+      return -2;
+   if (!YabStateMemCartMatches(p, length))
+      return -3;
+
+   Vdp2Quiesce();
+   state_mem_mode = 1;
+   StateFastLoad = fast;
+   status = YabLoadStateBuffer(buffer, length);
+   StateFastLoad = 0;
+   state_mem_mode = 0;
+   return status;
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+
+size_t YabSaveStateMemSize(void)
+{
+   size_t state_size = 0;
+   int status;
+
+   // Every chunk of an in-memory state has a fixed layout once the cartridge
+   // is chosen, and YabLoadStateMem refuses states for another cartridge, so
+   // the size of one state is the size of all of them for the session
+   Vdp2Quiesce();
+   state_mem_mode = 1;
+   status = YabSaveStateBuffer(NULL, &state_size);
+   state_mem_mode = 0;
+
+   if (status != 0 || state_size == 0)
+      return 0;
+
+   // A completely full buffer reads as a truncated state
+   return state_size + 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 int YabSaveStateBuffer(void ** buffer, size_t * size)
 {
    FILE * fp;
@@ -1555,7 +2081,6 @@ int YabSaveState(const char *filename)
 // FIXME: Here's a (possibly incomplete) list of data that should be added
 // to the next version of the save state file:
 //    yabsys.DecilineStop (new format)
-//    yabsys.SH2CycleFrac (new field)
 //    yabsys.DecilineUSed (new field)
 //    yabsys.UsecFrac (new field)
 //    [scsp2.c] It would be nice to redo the format entirely because so
@@ -1616,7 +2141,7 @@ int YabSaveStateStream(FILE *fp)
    i += Vdp1SaveState(fp);
    i += Vdp2SaveState(fp);
 
-   offset = StateWriteHeader(fp, "OTHR", 1);
+   offset = StateWriteHeader(fp, "OTHR", 2);
 
    // Other data
    ywrite(&check, (void *)BupRam, 0x10000, 1, fp); // do we really want to save this?
@@ -1635,21 +2160,31 @@ int YabSaveStateStream(FILE *fp)
    ywrite(&check, (void *)&temp32, sizeof(u32), 1, fp);
    ywrite(&check, (void *)&yabsys.CurSH2FreqType, sizeof(int), 1, fp);
    ywrite(&check, (void *)&yabsys.IsPal, sizeof(int), 1, fp);
+   ywrite(&check, (void *)&yabsys.SH2CycleFrac, sizeof(u32), 1, fp);
 
-   VIDCore->GetGlSize(&outputwidth, &outputheight);
+   if (state_mem_mode)
+   {
+      outputwidth = 0;
+      outputheight = 0;
+   }
+   else
+      VIDCore->GetGlSize(&outputwidth, &outputheight);
 
    totalsize=outputwidth * outputheight * sizeof(u32);
 
-   if ((buf = (u8 *)malloc(totalsize)) == NULL)
+   if ((buf = (u8 *)malloc(totalsize ? totalsize : 1)) == NULL)
    {
       return -2;
    }
 
    //YuiSwapBuffers();
    #ifdef USE_OPENGL
-   glPixelZoom(1,1);
-   glReadBuffer(GL_BACK);
-   glReadPixels(0, 0, outputwidth, outputheight, GL_RGBA, GL_UNSIGNED_BYTE, buf);
+   if (totalsize > 0)
+   {
+      glPixelZoom(1,1);
+      glReadBuffer(GL_BACK);
+      glReadPixels(0, 0, outputwidth, outputheight, GL_RGBA, GL_UNSIGNED_BYTE, buf);
+   }
    #else
    //memcpy(buf, dispbuffer, totalsize);
    #endif
@@ -1658,11 +2193,13 @@ int YabSaveStateStream(FILE *fp)
    ywrite(&check, (void *)&outputwidth, sizeof(outputwidth), 1, fp);
    ywrite(&check, (void *)&outputheight, sizeof(outputheight), 1, fp);
 
-   ywrite(&check, (void *)buf, totalsize, 1, fp);
+   if (totalsize > 0)
+      ywrite(&check, (void *)buf, totalsize, 1, fp);
 
    movieposition=ftell(fp);
    //write the movie to the end of the savestate
-   SaveMovieInState(fp, check);
+   if (!state_mem_mode)
+      SaveMovieInState(fp, check);
 
    i += StateFinishHeader(fp, offset);
 
@@ -1674,7 +2211,8 @@ int YabSaveStateStream(FILE *fp)
 
    free(buf);
 
-   OSDPushMessage(OSDMSG_STATUS, 150, "STATE SAVED");
+   if (!state_mem_mode)
+      OSDPushMessage(OSDMSG_STATUS, 150, "STATE SAVED");
    return 0;
 }
 
@@ -1739,6 +2277,7 @@ int YabLoadStateStream(FILE *fp)
    int movieposition;
    int temp;
    u32 temp32;
+   int decilinecount, linecount;
 	int test_endian;
 
   yabsys.frame_count = 0;
@@ -1886,8 +2425,18 @@ int YabLoadStateStream(FILE *fp)
    yread(&check, (void *)&temp32, sizeof(u32), 1, fp);
    yread(&check, (void *)&yabsys.CurSH2FreqType, sizeof(int), 1, fp);
    yread(&check, (void *)&yabsys.IsPal, sizeof(int), 1, fp);
+   decilinecount = yabsys.DecilineCount;
+   linecount = yabsys.LineCount;
    YabauseChangeTiming(yabsys.CurSH2FreqType);
-   yabsys.UsecFrac = (temp32 << YABSYS_TIMING_BITS) * temp / 10;
+   yabsys.DecilineCount = decilinecount;
+   yabsys.LineCount = linecount;
+   // without it a state loaded mid-run drifts a few cycles from the
+   // machine that saved it
+   if (version > 1)
+      yread(&check, (void *)&yabsys.SH2CycleFrac, sizeof(u32), 1, fp);
+   // Undo the scaling done by YabSaveStateStream, rounding up so that saving
+   // again writes back the same value
+   yabsys.UsecFrac = ((temp32 << YABSYS_TIMING_BITS) * 10 + temp - 1) / temp;
 
    if (headerversion > 1) {
 
@@ -1896,6 +2445,8 @@ int YabLoadStateStream(FILE *fp)
 
    totalsize=outputwidth * outputheight * sizeof(u32);
 
+   if (totalsize > 0) {
+
    if ((buf = (u8 *)malloc(totalsize)) == NULL)
    {
       return -2;
@@ -1920,13 +2471,19 @@ int YabLoadStateStream(FILE *fp)
    //YuiSwapBuffers();
    free(buf);
 
-   fseek(fp, movieposition, SEEK_SET);
-   MovieReadState(fp);
+   }
+
+   if (!state_mem_mode)
+   {
+      fseek(fp, movieposition, SEEK_SET);
+      MovieReadState(fp);
+   }
    }
 
    ScspUnMuteAudio(SCSP_MUTE_SYSTEM);
 
-   OSDPushMessage(OSDMSG_STATUS, 150, "STATE LOADED");
+   if (!state_mem_mode)
+      OSDPushMessage(OSDMSG_STATUS, 150, "STATE LOADED");
 
    return 0;
 }
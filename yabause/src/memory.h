@@ -422,6 +422,24 @@ extern "C" {
     const char *searchstr,
     result_struct *prevresults, u32 *maxresults);
 
+  /* Host view of a RAM-backed bus address, for block transfers (DMA) that
+   * bypass the per-access handlers. Sound RAM, color RAM and the CD block are
+   * never returned: they mirror depending on mode registers or have side
+   * effects on every access. */
+  typedef struct {
+    u8 * base;
+    u8 * ptr;
+    u32 offset;  // offset inside the region
+    u32 avail;   // bytes before the region ends or mirrors
+    int t2;      // 1 = T2 (16-bit native words), 0 = T1 (byte order as-is)
+  } MemorySpan;
+
+  int MemoryGetSpan(u32 addr, MemorySpan * span);
+  void MemorySpanSync(const MemorySpan * span);
+  void MemorySpanCopy(MemorySpan * dst, const MemorySpan * src, u32 size);
+  void MemorySpanWritten(const MemorySpan * span, u32 size);
+  u32 getMemClock(u32 addr);
+
   int MappedMemoryLoad(const char *filename, u32 addr);
   int MappedMemorySave(const char *filename, u32 addr, u32 size);
   int MappedMemoryLoadExec(const char *filename, u32 pc);
@@ -439,12 +457,29 @@ extern "C" {
   int YabSaveStateBuffer(void **buffer, size_t *size);
   int YabLoadStateBuffer(const void *buffer, size_t size);
 
+  /* Fixed-size, deterministic states for rewind, netplay and run-ahead.
+   * YabSaveStateMem zero-fills the unused tail of the buffer;
+   * YabSaveStateMemSize returns the exact buffer size for the current game;
+   * YabLoadStateMem returns -3 for a state made with another cartridge.
+   * With fast set, YabLoadStateMem only invalidates the video caches for the
+   * VDP1/VDP2 RAM pages and color RAM entries that actually changed. */
+  int YabSaveStateMem(void *buffer, size_t size, size_t *used);
+  int YabLoadStateMem(const void *buffer, size_t size, int fast);
+  size_t YabSaveStateMemSize(void);
+
+  /* Set while loading a fast state, see StateReadPages */
+  extern int StateFastLoad;
+  void StateReadPages(IOCheck_struct *check, FILE *fp, u8 *dst, u32 size, u32 shift, void (*dirty)(u32 addr, u32 size));
+
   int YabLoadCompressedState(const char *filename);
   int YabSaveCompressedState(const char *filename);
 
 // Mapped mewmory
 void * YabMemMap(char * filename, u32 size );
 void YabFreeMap(void * p);
+void YabRomSetCacheDir(const char * dir);
+u8 * YabRomMap(const char * filename, u32 size, int type);
+int YabRomUnmap(u8 * mem);
 int ExtendBackupFile(FILE *fp, u32 size );
 void FormatBackupRamFile(FILE *fp, u32 size);
 void FormatBackupRam(void *mem, u32 size);
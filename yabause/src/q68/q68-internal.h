@@ -56,15 +56,23 @@
  * This allows the translated code to execute more quickly, but will
  * slightly alter the timing of responses to external events such as
  * interrupts.
+ *
+ * Q68_EXACT_TIMING may be defined on the compiler command line to disable
+ * both this and Q68_OPTIMIZE_IDLE, e.g. for cycle-exact comparisons
+ * against another 68000 core.
  */
-#define Q68_JIT_LOOSE_TIMING
+#ifndef Q68_EXACT_TIMING
+# define Q68_JIT_LOOSE_TIMING
+#endif
 
 /**
  * Q68_OPTIMIZE_IDLE:  When defined, optimizes certain idle loops to
  * improve performance in JIT mode.  Enabling this option slightly alters
  * execution timing.
  */
-#define Q68_OPTIMIZE_IDLE
+#ifndef Q68_EXACT_TIMING
+# define Q68_OPTIMIZE_IDLE
+#endif
 
 /**
  * Q68_JIT_VERBOSE:  When defined, outputs some status messages considered
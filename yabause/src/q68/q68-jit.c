@@ -1009,7 +1009,7 @@ static int translate_insn(Q68State *state, Q68JitEntry *entry)
 
     /* Emit a cycle count check if appropriate */
 #ifdef Q68_JIT_LOOSE_TIMING
-    if ((opcode & 0xFF00) == 0x6100  // Bcc
+    if ((opcode & 0xF000) == 0x6000  // Bcc/BRA/BSR
      || (opcode & 0xF0F8) == 0x50C8  // DBcc
      || (opcode & 0xFFF0) == 0x4E40  // TRAP
      || (opcode & 0xFF80) == 0x4E80  // JSR/JMP
@@ -1092,6 +1092,12 @@ static void clear_entry(Q68State *state, Q68JitEntry *entry)
         state->jit_hashchain[JIT_HASH(entry->m68k_start)] = entry->next;
     }
 
+    /* A block stopped at the cycle limit is resumed through jit_running;
+     * make the next q68_run() look the PC up again instead */
+    if (state->jit_running == entry) {
+        state->jit_running = NULL;
+    }
+
     /* Mark the entry as free */
     entry->m68k_start = 0;
 }
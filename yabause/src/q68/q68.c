@@ -265,6 +265,10 @@ void q68_set_areg(Q68State *state, int num, uint32_t value)
 void q68_set_pc(Q68State *state, uint32_t value)
 {
     state->PC = value;
+#ifdef Q68_USE_JIT
+    /* Don't resume a translated block stopped at the old PC */
+    state->jit_running = NULL;
+#endif
 }
 
 void q68_set_sr(Q68State *state, uint16_t value)
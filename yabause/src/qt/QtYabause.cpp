@@ -50,6 +50,9 @@ M68K_struct * M68KCoreList[] = {
 #ifdef HAVE_MUSASHI
 &M68KMusashi,
 #endif
+#ifdef HAVE_Q68
+&M68KQ68,
+#endif
 NULL
 };
 
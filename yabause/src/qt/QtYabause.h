@@ -58,6 +58,7 @@ extern "C"
 
 	#include "../cheat.h"
 	#include "../memory.h"
+	#include "../inputlog.h"
 	#include "../bios.h"
 
 	#include "../m68kd.h"
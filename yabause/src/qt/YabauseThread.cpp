@@ -596,6 +596,26 @@ void YabauseThread::reloadSettings()
 
   mYabauseConf.use_sh2_cache = vs->value("General/UseSh2Cache", true).toBool()?1:0 ;
 
+#ifdef YAB_ASYNC_RENDERING
+  mYabauseConf.frame_pipeline = vs->value("Video/FramePipeline", false).toBool()?1:0 ;
+#else
+  mYabauseConf.frame_pipeline = 0; // drawn on the emulation thread, nothing to overlap with
+#endif
+
+  mYabauseConf.deterministic = vs->value("General/Deterministic", false).toBool()?1:0 ;
+  QString determinismLog = vs->value("General/DeterminismLog", QString()).toString();
+  mYabauseConf.determinism_log = determinismLog.isEmpty() ? NULL : strdup(determinismLog.toLatin1().constData());
+
+  mYabauseConf.cd_timing = vs->value("General/CdTiming", 0).toInt();
+  QString cdTimingProfile = vs->value("General/CdTimingProfile", QString()).toString();
+  mYabauseConf.cd_timing_profile = cdTimingProfile.isEmpty() ? NULL : strdup(cdTimingProfile.toLatin1().constData());
+  QString cdEventLog = vs->value("General/CdEventLog", QString()).toString();
+  mYabauseConf.cd_event_log = cdEventLog.isEmpty() ? NULL : strdup(cdEventLog.toLatin1().constData());
+
+  mYabauseConf.sound_idle_skip = vs->value("Sound/IdleSkip", mYabauseConf.sound_idle_skip).toBool()?1:0 ;
+  QString tracePath = vs->value("General/TracePath", QString()).toString();
+  mYabauseConf.trace_path = tracePath.isEmpty() ? NULL : strdup(tracePath.toLatin1().constData());
+
 	reloadClock();
 	reloadControllers();
 }
@@ -658,7 +678,15 @@ void YabauseThread::resetYabauseConf()
   mYabauseConf.scsp_main_mode = 1;
   mYabauseConf.use_new_scsp = 1;
   mYabauseConf.buppath = strdup(getDataDirPath().append("/bkram.bin").toLatin1().constData());
+  mYabauseConf.rom_cache_dir = strdup(getDataDirPath().append("/romcache").toLatin1().constData());
   mYabauseConf.playRecordPath = NULL;
+  mYabauseConf.deterministic = 0;
+  mYabauseConf.determinism_log = NULL;
+  mYabauseConf.cd_timing = 0;
+  mYabauseConf.cd_timing_profile = NULL;
+  mYabauseConf.cd_event_log = NULL;
+  mYabauseConf.sound_idle_skip = 1;
+  mYabauseConf.trace_path = NULL;
 }
 
 void YabauseThread::timerEvent( QTimerEvent* )
@@ -879,12 +879,14 @@ void UIYabause::on_aFileSettings_triggered()
 			{
 				int num = newhash["General/NumThreads"].toInt() < 1 ? 1 : newhash["General/NumThreads"].toInt();
 				VIDSoftSetVdp1ThreadEnable(num == 1 ? 0 : 1);
+				VIDSoftSetNumVdp1BandThreads(num);
 				VIDSoftSetNumLayerThreads(num);
 				VIDSoftSetNumPriorityThreads(num);
 			}
 			else
 			{
 				VIDSoftSetVdp1ThreadEnable(0);
+				VIDSoftSetNumVdp1BandThreads(0);
 				VIDSoftSetNumLayerThreads(1);
 				VIDSoftSetNumPriorityThreads(1);
 			}
@@ -1206,6 +1208,41 @@ void UIYabause::on_actionPlay_triggered() {
     
 }
 
+void UIYabause::on_aEmulationInputLogRecord_triggered()
+{
+	YabauseLocker locker( mYabauseThread );
+	if ( InputLogGetStatus() != INPUTLOG_STOPPED )
+	{
+		InputLogStop();
+		aEmulationInputLogRecord->setText( QtYabause::translate( "Record &Input Log..." ) );
+		return;
+	}
+	const QString fn = CommonDialogs::getSaveFileName( QtYabause::volatileSettings()->value( "General/SaveStates", getDataDirPath() ).toString(), QtYabause::translate( "Choose a file to record the input to" ), QtYabause::translate( "Yabause Input Log (*.yil)" ) );
+	if ( fn.isNull() )
+		return;
+	if ( InputLogRecord( fn.toLocal8Bit().constData(), INPUTLOG_DEFAULT_INTERVAL ) != 0 )
+		CommonDialogs::information( QtYabause::translate( "Couldn't create input log file" ) );
+	else
+		aEmulationInputLogRecord->setText( QtYabause::translate( "Stop Input Log" ) );
+}
+
+void UIYabause::on_aEmulationInputLogPlay_triggered()
+{
+	YabauseLocker locker( mYabauseThread );
+	const QString fn = CommonDialogs::getOpenFileName( QtYabause::volatileSettings()->value( "General/SaveStates", getDataDirPath() ).toString(), QtYabause::translate( "Select an input log to play back" ), QtYabause::translate( "Yabause Input Log (*.yil)" ) );
+	if ( fn.isNull() )
+		return;
+	// start from the state the log was recorded from
+	if ( InputLogPlay( fn.toLocal8Bit().constData() ) != 0 || InputLogSeek( 0 ) != 0 )
+	{
+		InputLogStop();
+		CommonDialogs::information( QtYabause::translate( "Couldn't play back input log file" ) );
+		return;
+	}
+	aEmulationInputLogRecord->setText( QtYabause::translate( "Stop Input Log" ) );
+	aEmulationRun->trigger();
+}
+
 void UIYabause::on_aEmulationPause_triggered()
 {
 	if ( !mYabauseThread->emulationPaused() )
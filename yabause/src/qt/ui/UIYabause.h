@@ -193,6 +193,8 @@ protected slots:
 	void on_aEmulationFrameSkipLimiter_toggled( bool toggled );
   void on_actionRecord_triggered();
   void on_actionPlay_triggered();
+	void on_aEmulationInputLogRecord_triggered();
+	void on_aEmulationInputLogPlay_triggered();
 	// tools
   void on_actionOpen_web_interface_triggered();
 	void on_aToolsBackupManager_triggered();
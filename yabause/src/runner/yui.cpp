@@ -19,6 +19,7 @@
 */
 
 #include <stdio.h>
+#include <inttypes.h>
 extern "C"
 {
 #include "../yui.h"
@@ -29,6 +30,11 @@ extern "C"
 #include "../vidsoft.h"
 #include "../vdp2.h"
 #include "../titan/titan.h"
+#include "../memory.h"
+#include "../vdp1.h"
+#include "../scsp.h"
+#include "../inputlog.h"
+#include "../osdcore.h"
 #ifdef _MSC_VER
 #include <Windows.h>
 #endif
@@ -44,6 +50,12 @@ extern u8 *vdp1backframebuffer;
 #include <vector>
 #include <sstream>
 #include <fstream>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
 
 #define AUTO_TEST_SELECT_ADDRESS 0x7F000
 #define AUTO_TEST_STATUS_ADDRESS 0x7F004
@@ -53,6 +65,43 @@ extern u8 *vdp1backframebuffer;
 
 #define VDP2_VRAM 0x25E00000
 
+#define SNDCORE_FRAMEHASH 2
+
+static int SNDFrameHashInit(void);
+static void SNDFrameHashDeInit(void);
+static int SNDFrameHashReset(void);
+static int SNDFrameHashChangeVideoFormat(int vertfreq);
+static void SNDFrameHashUpdateAudio(u32 *leftchanbuffer, u32 *rightchanbuffer, u32 num_samples);
+static u32 SNDFrameHashGetAudioSpace(void);
+static void SNDFrameHashMuteAudio(void);
+static void SNDFrameHashUnMuteAudio(void);
+static void SNDFrameHashSetVolume(int volume);
+#ifdef USE_SCSPMIDI
+static int SNDFrameHashMidiChangePorts(int inport, int outport);
+static u8 SNDFrameHashMidiIn(int *isdata);
+static int SNDFrameHashMidiOut(u8 data);
+#endif
+
+//hashes the samples the scsp mixed, instead of playing them
+SoundInterface_struct SNDFrameHash = {
+   SNDCORE_FRAMEHASH,
+   "Frame Hash Sound Interface",
+   SNDFrameHashInit,
+   SNDFrameHashDeInit,
+   SNDFrameHashReset,
+   SNDFrameHashChangeVideoFormat,
+   SNDFrameHashUpdateAudio,
+   SNDFrameHashGetAudioSpace,
+   SNDFrameHashMuteAudio,
+   SNDFrameHashUnMuteAudio,
+   SNDFrameHashSetVolume,
+#ifdef USE_SCSPMIDI
+   SNDFrameHashMidiChangePorts,
+   SNDFrameHashMidiIn,
+   SNDFrameHashMidiOut
+#endif
+};
+
 extern "C"
 {
    SH2Interface_struct *SH2CoreList[] = {
@@ -73,6 +122,7 @@ extern "C"
 
    SoundInterface_struct *SNDCoreList[] = {
       &SNDDummy,
+      &SNDFrameHash,
       NULL
    };
 
@@ -92,6 +142,13 @@ extern "C"
    #endif
       NULL
    };
+
+#ifdef YAB_PORT_OSD
+   OSD_struct *OSDCoreList[] = {
+      &OSDDummy,
+      NULL
+   };
+#endif
 }
 
 struct ConsoleColor
@@ -128,6 +185,48 @@ void YuiSwapBuffers(void)
 
 }
 
+int YuiUseOGLOnThisThread(void)
+{
+   return 0;
+}
+
+int YuiRevokeOGLOnThisThread(void)
+{
+   return 0;
+}
+
+//the runner always boots the test binary directly, without a bios or a
+//backup ram file
+int YabauseThread_IsUseBios()
+{
+   return 0;
+}
+
+const char * YabauseThread_getBackupPath()
+{
+   return "";
+}
+
+void YabauseThread_setUseBios(int use)
+{
+
+}
+
+void YabauseThread_setBackupPath(const char * buf)
+{
+
+}
+
+void YabauseThread_coldBoot()
+{
+
+}
+
+void YabauseThread_resetPlaymode()
+{
+
+}
+
 //add tests that currently don't work in yabause here
 const char* tests_expected_to_fail[] =
 {
@@ -321,21 +420,6 @@ bool handle_framebuffer(char * stored_test_name, std::string framebuffer_path)
    return true;
 }
 
-int go_to_next_test(int &current_test, std::string filename, yabauseinit_struct yinit)
-{
-   current_test++;
-
-   YabauseDeInit();
-
-   if (YabauseInit(&yinit) != 0)
-      return -1;
-
-   MappedMemoryLoadExec(filename.c_str(), 0);
-   MappedMemoryWriteByte(VDP2_VRAM + AUTO_TEST_SELECT_ADDRESS, current_test);
-
-   return 1;
-}
-
 struct Stats
 {
    int regressions;
@@ -779,14 +863,28 @@ namespace game_testing
 
 namespace yabauseut
 {
-   int start(std::string yabause_ut_filename, std::string screenshot_path, std::string framebuffer_path, bool check)
+   struct TestResult
    {
-      struct Stats stats = { 0 };
-      yabauseinit_struct yinit = { 0 };
-      int current_test = 0;
-      char stored_test_name[256] = { 0 };
+      int group;
+      std::string section;
+      std::string name;
+      std::string status;//"pass", "fail" or "expected_fail"
+   };
 
-      printf("Running tests...\n\n");
+   struct Runner
+   {
+      yabauseinit_struct yinit;
+      std::string filename;
+      std::string screenshot_path;
+      std::string framebuffer_path;
+      //state right after the test binary was loaded, NULL for a cold boot per group
+      void * boot_state;
+      size_t boot_state_size;
+   };
+
+   void setup_runner(Runner & runner, std::string yabause_ut_filename, std::string screenshot_path, std::string framebuffer_path)
+   {
+      yabauseinit_struct yinit = { 0 };
 
       yinit.percoretype = PERCORE_DUMMY;
       yinit.sh2coretype = SH2CORE_INTERPRETER;
@@ -807,11 +905,55 @@ namespace yabauseut
       yinit.basetime = 0;
       yinit.skip_load = 1;
 
-      if (YabauseInit(&yinit) != 0)
-         return -1;
+      runner.yinit = yinit;
+      runner.filename = yabause_ut_filename;
+      runner.screenshot_path = screenshot_path;
+      runner.framebuffer_path = framebuffer_path;
+      runner.boot_state = NULL;
+      runner.boot_state_size = 0;
+   }
 
-      MappedMemoryLoadExec(yabause_ut_filename.c_str(), 0);
-      MappedMemoryWriteByte(VDP2_VRAM + AUTO_TEST_SELECT_ADDRESS, current_test);
+   //every test group starts from a freshly reset system
+   int select_group(Runner & runner, int group)
+   {
+      if (runner.boot_state == NULL ||
+         YabLoadStateBuffer(runner.boot_state, runner.boot_state_size) != 0)
+      {
+         YabauseDeInit();
+
+         if (YabauseInit(&runner.yinit) != 0)
+            return -1;
+
+         MappedMemoryLoadExec(runner.filename.c_str(), 0);
+      }
+
+      MappedMemoryWriteByte(VDP2_VRAM + AUTO_TEST_SELECT_ADDRESS, group, NULL);
+
+      return 1;
+   }
+
+   void add_result(std::vector<TestResult> & results, int group, const std::string & section, const std::string & name, const char * status)
+   {
+      TestResult result;
+      result.group = group;
+      result.section = section;
+      result.name = name;
+      result.status = status;
+      results.push_back(result);
+   }
+
+   const char * fail_status(char * test_name)
+   {
+      return find_test_expected_to_fail(test_name) ? "expected_fail" : "fail";
+   }
+
+   //runs test groups first_group, first_group + group_step, ... until the
+   //test binary reports that there are no more groups
+   int run_groups(Runner & runner, int first_group, int group_step, struct Stats & stats, std::vector<TestResult> & results)
+   {
+      int current_test = first_group;
+      char stored_test_name[256] = { 0 };
+      std::string section = "";
 
       bool write_images = false;
 
@@ -829,7 +971,7 @@ namespace yabauseut
          //emulate a frame
          PERCore->HandleEvents();
 
-         status = MappedMemoryReadByteNoCache(VDP2_VRAM + AUTO_TEST_STATUS_ADDRESS);
+         status = MappedMemoryReadByteNocache(VDP2_VRAM + AUTO_TEST_STATUS_ADDRESS, NULL);
 
          if (status == AUTO_TEST_MESSAGE_SENT)
          {
@@ -844,9 +986,11 @@ namespace yabauseut
             }
             else if (!strcmp(message, "SCREENSHOT"))
             {
+               std::string preset_name = std::string(stored_test_name) + " preset " + int_to_string(screenshot_preset);
+
                stats.screenshot.total++;
 
-               if (handle_screenshot(write_images, stored_test_name, screenshot_path, screenshot_preset, runner_dispbuffer))
+               if (handle_screenshot(write_images, stored_test_name, runner.screenshot_path, screenshot_preset, runner_dispbuffer))
                {
                   //screenshot matches
                   if (!write_images)
@@ -854,6 +998,7 @@ namespace yabauseut
                      printf("Preset %-25d ", screenshot_preset);
                      do_test_pass(stats, "Match");
                      stats.screenshot.matches++;
+                     add_result(results, current_test, section, preset_name, "pass");
                   }
                }
                else
@@ -862,6 +1007,7 @@ namespace yabauseut
                   if (!write_images)
                   {
                      stats.screenshot.diffs++;
+                     add_result(results, current_test, section, preset_name, "fail");
                   }
                }
 
@@ -870,10 +1016,15 @@ namespace yabauseut
             else if (std::string(message) == "FRAMEBUFFER")
             {
 
-               bool result = handle_framebuffer(stored_test_name, framebuffer_path);
+               bool result = handle_framebuffer(stored_test_name, runner.framebuffer_path);
 
                if (!result)
+               {
                   do_test_fail(stats, stored_test_name);
+                  add_result(results, current_test, section, stored_test_name, fail_status(stored_test_name));
+               }
+               else
+                  add_result(results, current_test, section, stored_test_name, "pass");
 
                stats.total_tests++;
             }
@@ -881,6 +1032,7 @@ namespace yabauseut
             {
                //print the name of the test section
                print_basic(message);
+               section = message;
 
                if (std::string(message) == "Vdp2 screenshot tests")
                {
@@ -892,17 +1044,16 @@ namespace yabauseut
                //all sub-tests finished, proceed to next main test
                printf("\n");
 
-               YabauseDeInit();
+               current_test += group_step;
 
-               if (YabauseInit(&yinit) != 0)
+               if (select_group(runner, current_test) != 1)
+               {
+                  free(runner_dispbuffer);
                   return -1;
-
-               MappedMemoryLoadExec(yabause_ut_filename.c_str() , 0);
-               MappedMemoryWriteByte(VDP2_VRAM + AUTO_TEST_SELECT_ADDRESS, current_test);
-
-               go_to_next_test(current_test, yabause_ut_filename, yinit);
+               }
 
                is_screenshot = false;
+               continue;
             }
             else if (!strcmp(message, "SUB_TEST_START"))
             {
@@ -928,7 +1079,7 @@ namespace yabauseut
 
                if (is_screenshot)
                {
-                  screenshot_filename = make_screenshot_filename(stored_test_name, screenshot_path, screenshot_preset);
+                  screenshot_filename = make_screenshot_filename(stored_test_name, runner.screenshot_path, screenshot_preset);
                }
             }
             else if (!strcmp(message, "RESULT"))
@@ -943,10 +1094,12 @@ namespace yabauseut
                {
                   do_test_pass(stats, "PASS");
                   stats.tests_passed++;
+                  add_result(results, current_test, section, stored_test_name, "pass");
                }
                else if (!strcmp(result_prefix, "FAIL"))
                {
                   do_test_fail(stats, stored_test_name);
+                  add_result(results, current_test, section, stored_test_name, fail_status(stored_test_name));
                }
                else
                {
@@ -957,16 +1110,6 @@ namespace yabauseut
             }
             else if (!strcmp(message, "ALL_FINISHED"))
             {
-               //print stats and exit
-
-               do_regression_color(stats.regressions);
-               printf("%d of %d tests passed. %d regressions. %d failures that are not regressions. \n", stats.tests_passed, stats.total_tests, stats.regressions, stats.expected_failures);
-
-               do_regression_color(stats.screenshot.diffs);
-               printf("%d of %d screenshots matched. %d did not match. \n", stats.screenshot.matches, stats.screenshot.total, stats.screenshot.diffs);
-
-               set_color(text_white);
-
                break;
             }
             else
@@ -974,19 +1117,598 @@ namespace yabauseut
                printf("Unrecognized message type: %s\n", message);
             }
 
-            MappedMemoryWriteByte(VDP2_VRAM + AUTO_TEST_STATUS_ADDRESS, AUTO_TEST_MESSAGE_RECEIVED);
+            MappedMemoryWriteByte(VDP2_VRAM + AUTO_TEST_STATUS_ADDRESS, AUTO_TEST_MESSAGE_RECEIVED, NULL);
          }
       }
+
+      free(runner_dispbuffer);
+      return 0;
+   }
+
+   void print_stats(const struct Stats & stats)
+   {
+      do_regression_color(stats.regressions);
+      printf("%d of %d tests passed. %d regressions. %d failures that are not regressions. \n", stats.tests_passed, stats.total_tests, stats.regressions, stats.expected_failures);
+
+      do_regression_color(stats.screenshot.diffs);
+      printf("%d of %d screenshots matched. %d did not match. \n", stats.screenshot.matches, stats.screenshot.total, stats.screenshot.diffs);
+
+      set_color(text_white);
+   }
+
+   int start(std::string yabause_ut_filename, std::string screenshot_path, std::string framebuffer_path, bool check)
+   {
+      struct Stats stats = { 0 };
+      std::vector<TestResult> results;
+      Runner runner;
+
+      printf("Running tests...\n\n");
+
+      setup_runner(runner, yabause_ut_filename, screenshot_path, framebuffer_path);
+
+      if (YabauseInit(&runner.yinit) != 0)
+         return -1;
+
+      MappedMemoryLoadExec(yabause_ut_filename.c_str(), 0);
+      MappedMemoryWriteByte(VDP2_VRAM + AUTO_TEST_SELECT_ADDRESS, 0, NULL);
+
+      if (run_groups(runner, 0, 1, stats, results) != 0)
+         return -1;
+
+      //print stats and exit
+      print_stats(stats);
+
       return stats.regressions || stats.screenshot.diffs;
    }
+
+   //////////////////////////////////////////////////////////////////////////////
+   //sharded mode
+   //
+   //the test groups are dealt round robin to a number of worker processes.
+   //each worker boots the test binary once, keeps a save state of that and
+   //starts every one of its groups from the save state instead of a cold
+   //boot. the workers write their results to a file each, which are merged
+   //into a JUnit XML and a JSON report.
+
+   std::string shard_filename(const std::string & report, int shard, const char * extension)
+   {
+      return report + ".shard" + int_to_string(shard) + extension;
+   }
+
+   int run_shard(Runner runner, int shard, int jobs, std::string results_filename)
+   {
+      struct Stats stats = { 0 };
+      std::vector<TestResult> results;
+      int ret;
+
+      if (YabauseInit(&runner.yinit) != 0)
+         return -1;
+
+      MappedMemoryLoadExec(runner.filename.c_str(), 0);
+
+      if (YabSaveStateBuffer(&runner.boot_state, &runner.boot_state_size) != 0)
+      {
+         printf("Couldn't save the boot state, cold booting every group.\n");
+         runner.boot_state = NULL;
+      }
+
+      MappedMemoryWriteByte(VDP2_VRAM + AUTO_TEST_SELECT_ADDRESS, shard, NULL);
+
+      ret = run_groups(runner, shard, jobs, stats, results);
+
+      print_stats(stats);
+
+      free(runner.boot_state);
+
+      FILE * fp = fopen(results_filename.c_str(), "w");
+
+      if (fp == NULL)
+         return -1;
+
+      for (size_t i = 0; i < results.size(); i++)
+      {
+         fprintf(fp, "%d\t%s\t%s\t%s\n", results[i].group, results[i].status.c_str(),
+            results[i].section.c_str(), results[i].name.c_str());
+      }
+
+      fclose(fp);
+
+      return ret;
+   }
+
+   bool read_shard_results(std::string results_filename, std::vector<TestResult> & results)
+   {
+      std::ifstream file(results_filename.c_str());
+      std::string line;
+
+      if (!file.is_open())
+         return false;
+
+      while (std::getline(file, line))
+      {
+         std::vector<std::string> fields;
+         std::stringstream s(line);
+         std::string field;
+
+         while (std::getline(s, field, '\t'))
+            fields.push_back(field);
+
+         if (fields.size() < 4)
+            continue;
+
+         TestResult result;
+         result.group = string_to_int(fields[0]);
+         result.status = fields[1];
+         result.section = fields[2];
+         result.name = fields[3];
+         results.push_back(result);
+      }
+
+      return true;
+   }
+
+   bool compare_group(const TestResult & a, const TestResult & b)
+   {
+      return a.group < b.group;
+   }
+
+   std::string escape_xml(const std::string & input)
+   {
+      std::string output;
+
+      for (size_t i = 0; i < input.size(); i++)
+      {
+         switch (input[i])
+         {
+         case '&': output += "&amp;"; break;
+         case '<': output += "&lt;"; break;
+         case '>': output += "&gt;"; break;
+         case '"': output += "&quot;"; break;
+         default: output += input[i]; break;
+         }
+      }
+
+      return output;
+   }
+
+   std::string escape_json(const std::string & input)
+   {
+      std::string output;
+
+      for (size_t i = 0; i < input.size(); i++)
+      {
+         if (input[i] == '"' || input[i] == '\\')
+            output += '\\';
+         if ((unsigned char)input[i] < 0x20)
+            continue;
+         output += input[i];
+      }
+
+      return output;
+   }
+
+   bool write_junit(std::string filename, const std::vector<TestResult> & results)
+   {
+      std::ofstream file(filename.c_str());
+      int failures = 0;
+      size_t i = 0;
+
+      if (!file.is_open())
+         return false;
+
+      for (size_t j = 0; j < results.size(); j++)
+      {
+         if (results[j].status == "fail")
+            failures++;
+      }
+
+      file << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>" << std::endl;
+      file << "<testsuites name=\"yabauseut\" tests=\"" << results.size() << "\" failures=\"" << failures << "\">" << std::endl;
+
+      //one test suite per group
+      while (i < results.size())
+      {
+         size_t end = i;
+         int suite_failures = 0;
+
+         while (end < results.size() && results[end].group == results[i].group)
+         {
+            if (results[end].status == "fail")
+               suite_failures++;
+            end++;
+         }
+
+         file << "  <testsuite name=\"" << escape_xml(results[i].section) << "\" tests=\"" << (end - i) << "\" failures=\"" << suite_failures << "\">" << std::endl;
+
+         for (; i < end; i++)
+         {
+            file << "    <testcase classname=\"" << escape_xml(results[i].section) << "\" name=\"" << escape_xml(results[i].name) << "\"";
+
+            if (results[i].status == "fail")
+               file << "><failure message=\"FAIL\"/></testcase>" << std::endl;
+            else if (results[i].status == "expected_fail")
+               file << "><skipped message=\"expected to fail\"/></testcase>" << std::endl;
+            else
+               file << "/>" << std::endl;
+         }
+
+         file << "  </testsuite>" << std::endl;
+      }
+
+      file << "</testsuites>" << std::endl;
+
+      return true;
+   }
+
+   bool write_json(std::string filename, const std::vector<TestResult> & results)
+   {
+      std::ofstream file(filename.c_str());
+
+      if (!file.is_open())
+         return false;
+
+      file << "[" << std::endl;
+
+      for (size_t i = 0; i < results.size(); i++)
+      {
+         file << "  {\"group\": " << results[i].group
+            << ", \"section\": \"" << escape_json(results[i].section)
+            << "\", \"name\": \"" << escape_json(results[i].name)
+            << "\", \"status\": \"" << results[i].status << "\"}"
+            << (i + 1 < results.size() ? "," : "") << std::endl;
+      }
+
+      file << "]" << std::endl;
+
+      return true;
+   }
+
+   int start_sharded(std::string yabause_ut_filename, std::string screenshot_path, std::string framebuffer_path, int jobs, std::string report)
+   {
+      std::vector<TestResult> results;
+      Runner runner;
+      int failed_shards = 0;
+      int regressions = 0;
+      int expected_failures = 0;
+      int passed = 0;
+      int i;
+
+      if (jobs < 1)
+         jobs = 1;
+
+      printf("Running tests in %d shards...\n\n", jobs);
+
+      setup_runner(runner, yabause_ut_filename, screenshot_path, framebuffer_path);
+
+      fflush(stdout);
+
+#ifndef _WIN32
+      std::vector<pid_t> workers;
+
+      for (i = 0; i < jobs; i++)
+      {
+         pid_t pid = fork();
+
+         if (pid == 0)
+         {
+            //worker output goes to a log per shard
+            freopen(shard_filename(report, i, ".log").c_str(), "w", stdout);
+            int ret = run_shard(runner, i, jobs, shard_filename(report, i, ".txt"));
+            //_exit doesn't flush stdio, the log would be cut short
+            fflush(stdout);
+            _exit(ret == 0 ? 0 : 2);
+         }
+         else if (pid < 0)
+         {
+            printf("Couldn't start worker %d.\n", i);
+            failed_shards++;
+         }
+
+         workers.push_back(pid);
+      }
+
+      for (i = 0; i < jobs; i++)
+      {
+         int status = 0;
+
+         if (workers[i] <= 0)
+            continue;
+
+         if (waitpid(workers[i], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+         {
+            printf("Shard %d failed, see %s\n", i, shard_filename(report, i, ".log").c_str());
+            failed_shards++;
+         }
+      }
+#else
+      //no fork, run the shards one after the other
+      for (i = 0; i < jobs; i++)
+      {
+         if (run_shard(runner, i, jobs, shard_filename(report, i, ".txt")) != 0)
+            failed_shards++;
+
+         //the next shard initializes the emulator again
+         YabauseDeInit();
+      }
+#endif
+
+      for (i = 0; i < jobs; i++)
+      {
+         std::string results_filename = shard_filename(report, i, ".txt");
+
+         if (!read_shard_results(results_filename, results))
+         {
+            printf("Missing results for shard %d.\n", i);
+            failed_shards++;
+         }
+
+         remove(results_filename.c_str());
+      }
+
+      std::stable_sort(results.begin(), results.end(), compare_group);
+
+      for (size_t j = 0; j < results.size(); j++)
+      {
+         if (results[j].status == "pass")
+            passed++;
+         else if (results[j].status == "expected_fail")
+            expected_failures++;
+         else
+         {
+            regressions++;
+            set_color(text_red);
+            printf("FAIL %s: %s\n", results[j].section.c_str(), results[j].name.c_str());
+            set_color(text_white);
+         }
+      }
+
+      write_junit(report + ".xml", results);
+      write_json(report + ".json", results);
+
+      do_regression_color(regressions + failed_shards);
+      printf("%d of %d tests passed. %d regressions. %d failures that are not regressions. %d shards failed.\n",
+         passed, (int)results.size(), regressions, expected_failures, failed_shards);
+      set_color(text_white);
+
+      return regressions || failed_shards;
+   }
 }
 
 //usage
 //no spaces in paths allowed, include final / on directories
+static u64 frame_hash_audio = 0;
+
+static int SNDFrameHashInit(void)
+{
+   frame_hash_audio = 0;
+   return 0;
+}
+
+static void SNDFrameHashDeInit(void)
+{
+}
+
+static int SNDFrameHashReset(void)
+{
+   frame_hash_audio = 0;
+   return 0;
+}
+
+static int SNDFrameHashChangeVideoFormat(int vertfreq)
+{
+   return 0;
+}
+
+static void SNDFrameHashUpdateAudio(u32 *leftchanbuffer, u32 *rightchanbuffer, u32 num_samples)
+{
+   frame_hash_audio = (frame_hash_audio ^ YabauseHashBytes(leftchanbuffer, num_samples * sizeof(u32))) * 0x100000001B3ULL;
+   frame_hash_audio = (frame_hash_audio ^ YabauseHashBytes(rightchanbuffer, num_samples * sizeof(u32))) * 0x100000001B3ULL;
+}
+
+static u32 SNDFrameHashGetAudioSpace(void)
+{
+   //take everything, so each frame's samples are hashed with that frame
+   return 0x10000;
+}
+
+static void SNDFrameHashMuteAudio(void)
+{
+}
+
+static void SNDFrameHashUnMuteAudio(void)
+{
+}
+
+static void SNDFrameHashSetVolume(int volume)
+{
+}
+
+#ifdef USE_SCSPMIDI
+static int SNDFrameHashMidiChangePorts(int inport, int outport)
+{
+   return 0;
+}
+
+static u8 SNDFrameHashMidiIn(int *isdata)
+{
+   *isdata = 0;
+   return 0;
+}
+
+static int SNDFrameHashMidiOut(u8 data)
+{
+   return 1;
+}
+#endif
+
+namespace frame_hash
+{
+   const char * subsystems[] = {
+      "Framebuffer",
+      "Vdp1BackFramebuffer",
+      "Audio",
+      "HighWram",
+      "LowWram",
+      "SoundRam",
+      "Vdp1Ram",
+      "Vdp2Ram",
+      "Vdp2ColorRam",
+   };
+
+   const int num_subsystems = sizeof(subsystems) / sizeof(subsystems[0]);
+
+   int init_game(std::string cd_path)
+   {
+      yabauseinit_struct yinit = { 0 };
+
+      yinit.percoretype = PERCORE_DUMMY;
+      yinit.sh2coretype = SH2CORE_INTERPRETER;
+      yinit.vidcoretype = VIDCORE_SOFT;
+      yinit.m68kcoretype = M68KCORE_C68K;
+      yinit.sndcoretype = SNDCORE_FRAMEHASH;
+      yinit.cdcoretype = CDCORE_ISO;
+      yinit.carttype = CART_NONE;
+      yinit.regionid = REGION_AUTODETECT;
+      yinit.biospath = emulate_bios ? NULL : bios;
+      yinit.cdpath = cd_path.c_str();
+      yinit.buppath = NULL;
+      yinit.mpegpath = NULL;
+      yinit.cartpath = NULL;
+      yinit.frameskip = 0;
+      yinit.videoformattype = VIDEOFORMATTYPE_NTSC;
+      yinit.clocksync = 0;
+      yinit.basetime = 0;
+      yinit.skip_load = 0;
+      yinit.numthreads = 0;
+      yinit.usethreads = 0;
+      //scsp and video in lock-step, so a frame's audio and pictures are done when it ends
+      yinit.deterministic = 1;
+
+      YabauseDeInit();
+
+      if (YabauseInit(&yinit) != 0)
+         return -1;
+
+      return 0;
+   }
+
+   void hash_frame(u64 * hash, pixel_t * runner_dispbuffer)
+   {
+      int width = 0, height = 0;
+
+      //no png encode, the picture is only hashed
+      TitanGetResolution(&width, &height);
+      TitanRender(runner_dispbuffer);
+
+      hash[0] = YabauseHashBytes(runner_dispbuffer, sizeof(pixel_t) * width * height) ^ ((u64)width << 32 | height);
+      hash[1] = YabauseHashBytes(vdp1backframebuffer, 0x40000);
+      hash[2] = frame_hash_audio;
+      hash[3] = YabauseHashBytes(HighWram, 0x100000);
+      hash[4] = YabauseHashBytes(LowWram, 0x100000);
+      hash[5] = YabauseHashBytes(SoundRam, 0x80000);
+      hash[6] = YabauseHashBytes(Vdp1Ram, 0x80000);
+      hash[7] = YabauseHashBytes(Vdp2Ram, 0x80000);
+      hash[8] = YabauseHashBytes(Vdp2ColorRam, 0x1000);
+
+      frame_hash_audio = 0;
+   }
+
+   //golden file: one line per frame, the frame number then one hash per subsystem
+   int start(std::string cd_path, int frames, std::string golden_filename, std::string input_log, bool check)
+   {
+      FILE * golden = fopen(golden_filename.c_str(), check ? "r" : "w");
+      u64 hash[num_subsystems];
+      int ret = 0;
+
+      if (golden == NULL)
+      {
+         std::cout << "Couldn't open " << golden_filename << std::endl;
+         return 1;
+      }
+
+      if (init_game(cd_path) != 0)
+      {
+         std::cout << "Couldn't init game" << std::endl;
+         fclose(golden);
+         return 1;
+      }
+
+      //the log's first keyframe is the state it was recorded from
+      if (input_log != "" && (InputLogPlay(input_log.c_str()) != 0 || InputLogSeek(0) != 0))
+      {
+         std::cout << "Couldn't play back " << input_log << std::endl;
+         InputLogStop();
+         fclose(golden);
+         return 1;
+      }
+
+      pixel_t * runner_dispbuffer = (pixel_t*)calloc(1, sizeof(pixel_t) * 704 * 512);
+
+      for (int frame = 0; frame < frames; frame++)
+      {
+         PERCore->HandleEvents();
+         hash_frame(hash, runner_dispbuffer);
+
+         if (!check)
+         {
+            fprintf(golden, "%d", frame);
+            for (int i = 0; i < num_subsystems; i++)
+               fprintf(golden, " %016" PRIx64, hash[i]);
+            fprintf(golden, "\n");
+            continue;
+         }
+
+         int golden_frame;
+
+         if (fscanf(golden, "%d", &golden_frame) != 1 || golden_frame != frame)
+         {
+            std::cout << "Golden file ends before frame " << frame << std::endl;
+            ret = 1;
+            break;
+         }
+
+         for (int i = 0; i < num_subsystems; i++)
+         {
+            u64 expected;
+
+            if (fscanf(golden, " %" SCNx64, &expected) != 1)
+               expected = ~hash[i];
+
+            if (expected != hash[i])
+            {
+               set_color(text_red);
+               printf("Frame %d: %s diverged\n", frame, subsystems[i]);
+               set_color(text_white);
+               ret = 1;
+               break;
+            }
+         }
+
+         if (ret)
+            break;
+      }
+
+      if (!ret)
+      {
+         set_color(text_green);
+         printf("%d frames %s.\n", frames, check ? "matched" : "written");
+         set_color(text_white);
+      }
+
+      InputLogStop();
+      free(runner_dispbuffer);
+      fclose(golden);
+      return ret;
+   }
+}
+
 //yabause game check game_data_file path_file screenshot_path fail_path
 //yabause game dump game_data_file path_file output_path
 //yabause yabauseut check yabause_ut_binary_path screenshot_path framebuffer_path
 //yabause yabauseut dump yabause_ut_binary_path output_path
+//yabause yabauseut shard yabause_ut_binary_path screenshot_path framebuffer_path jobs report_prefix
+//yabause hash record cd_image frames golden_file [input_log]
+//yabause hash check cd_image frames golden_file [input_log]
 int main(int argc, char *argv[])
 {
    int i = 0;
@@ -1004,7 +1726,7 @@ int main(int argc, char *argv[])
       return false;
    }
 
-   if (args.size() > 7)
+   if (args.size() > 8)
    {
       std::cout << "Too many command line arguments." << std::endl;
       std::cout << "Paths cannot have spaces." << std::endl;
@@ -1098,12 +1820,59 @@ int main(int argc, char *argv[])
 
          return yabauseut::start(yabause_ut_filename, output_path, dummy, true);
       }
+      else if (args.at(2) == "shard")
+      {
+         //verify images, test groups split across worker processes
+         if (args.size() < 8)
+         {
+            std::cout << "Not enough arguments for yabauseut sharded mode." << std::endl;
+            return false;
+         }
+
+         std::string yabause_ut_filename = args.at(3);
+         std::string screenshot_path = args.at(4);
+         std::string framebuffer_path = args.at(5);
+         int jobs = string_to_int(args.at(6));
+         std::string report = args.at(7);
+
+         return yabauseut::start_sharded(yabause_ut_filename, screenshot_path, framebuffer_path, jobs, report);
+      }
       else
       {
-         std::cout << "Unknown check/dump argment." << std::endl;
+         std::cout << "Unknown check/dump/shard argment." << std::endl;
          return false;
       }
    }
+   else if (args.at(1) == "hash")
+   {
+      //headless frame hashes against a golden file
+      if (args.size() < 6)
+      {
+         std::cout << "Not enough arguments for hash mode." << std::endl;
+         return 1;
+      }
+
+      std::string cd_path = args.at(3);
+      int frames = string_to_int(args.at(4));
+      std::string golden_filename = args.at(5);
+      std::string input_log = args.size() > 6 ? args.at(6) : "";
+
+      if (frames <= 0)
+      {
+         std::cout << "Frame count must be positive." << std::endl;
+         return 1;
+      }
+
+      if (args.at(2) == "check")
+         return frame_hash::start(cd_path, frames, golden_filename, input_log, true);
+      else if (args.at(2) == "record")
+         return frame_hash::start(cd_path, frames, golden_filename, input_log, false);
+      else
+      {
+         std::cout << "Unknown check/record argment." << std::endl;
+         return 1;
+      }
+   }
    else
    {
       std::cout << "Unknown mode argument." << std::endl;
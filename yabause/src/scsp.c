@@ -107,7 +107,11 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
 #include <stdarg.h>
 #include <math.h>
 #include <limits.h>
+#ifdef _MSC_VER
+#include <windows.h>
+#endif
 
+#include "avcapture.h"
 #include "c68k/c68k.h"
 #include "cs2.h"
 #include "debug.h"
@@ -119,6 +123,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
 #include "scsp.h"
 #include "scspdsp.h"
 #include "threads.h"
+#include "trace.h"
 
 #ifndef max
 #define max(a,b) (((a) > (b)) ? (a) : (b))
@@ -161,6 +166,7 @@ s32 new_scsp_outbuf_l[900] = { 0 };
 s32 new_scsp_outbuf_r[900] = { 0 };
 int new_scsp_cycles = 0;
 int g_scsp_lock = 0;
+static volatile int scsp_thread_parked = 0;
 YabMutex * g_scsp_mtx = NULL;
 static int g_scsp_sync_count_per_frame = 1;
 static int g_scsp_main_mode = 0;
@@ -1824,6 +1830,16 @@ static int scsp_volume = 100;
 static int thread_running = 0;
 static int scsp_sample_count = 0;
 static int scsp_checktime = 0;
+
+// Bumped by anything that can change what a 68K polling loop reads: writes
+// to sound RAM or SCSP registers from either CPU, and new interrupts. Both
+// the SH2 and the sound thread bump it, so the increment must be atomic.
+static volatile u32 scsp_idle_events = 0;
+#ifdef _MSC_VER
+#define M68K_IDLE_WAKE() InterlockedIncrement((volatile LONG *)&scsp_idle_events)
+#else
+#define M68K_IDLE_WAKE() __sync_fetch_and_add(&scsp_idle_events, 1)
+#endif
 ////////////////////////////////////////////////////////////////
 // Misc
 
@@ -1940,6 +1956,8 @@ void scsp_sound_interrupt (u32 id)
 
 //  SCSPLOG ("scsp sound interrupt %.4X\n", id);
 
+  if (!(scsp.scipd & id))
+    M68K_IDLE_WAKE();
   scsp.scipd |= id;
   WRITE_THROUGH (scsp.scipd);
 
@@ -1970,7 +1988,8 @@ scsp_dma (void)
         from += 2;
         to += 2;
       }
-
+      if (scsp.dmlen)
+        M68KWriteNotify (scsp.drga & 0x7FFFF, scsp.dmlen);
     }
   else
     {
@@ -4132,6 +4151,7 @@ scsp_midi_out_read (void)
 void FASTCALL
 scsp_w_b (u32 a, u8 d)
 {
+  M68K_IDLE_WAKE();
   a &= 0xFFF;
 
   if (a < 0x400)
@@ -4241,6 +4261,8 @@ scsp_w_b (u32 a, u8 d)
 void FASTCALL
 scsp_w_w (u32 a, u16 d)
 {
+  M68K_IDLE_WAKE();
+
   if (a & 1)
     {
       SCSPLOG ("ERROR: scsp w_w misaligned : %.8X\n", a);
@@ -4325,6 +4347,8 @@ scsp_w_w (u32 a, u16 d)
 void FASTCALL
 scsp_w_d (u32 a, u32 d)
 {
+  M68K_IDLE_WAKE();
+
   if (a & 3)
     {
       SCSPLOG ("ERROR: scsp w_d misaligned : %.8X\n", a);
@@ -4776,6 +4800,96 @@ static u8 IsM68KRunning;
 static s32 FASTCALL (*m68kexecptr)(s32 cycles);  // M68K->Exec or M68KExecBP
 static s32 savedcycles;  // Cycles left over from the last M68KExec() call
 
+//////////////////////////////////////////////////////////////////////////////
+// 68K idle-loop skipping
+//
+// Sound drivers spend most of their time polling sound RAM or SCSP
+// registers for a command from the SH2 or for a timer interrupt.  After
+// each exec slice the 68K registers are compared with the last few slices.
+// If they repeat while nothing the loop could read has changed, the 68K is
+// in a loop with no way out, and further slices are skipped until the next
+// write, interrupt or SCSP register update.
+
+#define M68K_IDLE_HISTORY 32
+
+typedef struct
+{
+  u32 pc;
+  u32 sr;
+  u32 dreg[8];
+  u32 areg[8];
+  s32 savedcycles;
+} m68kidlestate_struct;
+
+static int m68k_idle_skip = 0;       // Set by ScspSetIdleSkip()
+static int m68k_idle = 0;            // Skipping slices until the next event
+static int m68k_idle_volatile_read;  // 68K read a register the SCSP updates itself
+static u32 m68k_idle_events_seen;    // scsp_idle_events when history was started
+static m68kidlestate_struct m68k_idle_history[M68K_IDLE_HISTORY];
+static int m68k_idle_count;
+static int m68k_idle_pos;
+
+// MIDI input/output, slot monitor, sound stack and DSP outputs change
+// without a write from either CPU
+static INLINE int
+scsp_reg_is_volatile (u32 adr)
+{
+  u32 a = adr & 0xFFE;
+  return (a >= 0x404 && a <= 0x408) || (a >= 0x600 && a < 0x700) || a >= 0xE80;
+}
+
+static void
+M68KIdleReset (void)
+{
+  m68k_idle = 0;
+  m68k_idle_count = 0;
+  m68k_idle_pos = 0;
+  m68k_idle_volatile_read = 0;
+  m68k_idle_events_seen = scsp_idle_events;
+}
+
+static void
+M68KIdleCheck (void)
+{
+  m68kidlestate_struct cur;
+  int i;
+
+  if (m68k_idle_volatile_read || m68k_idle_events_seen != scsp_idle_events)
+    M68KIdleReset ();
+
+  memset (&cur, 0, sizeof(cur));
+  cur.pc = M68K->GetPC ();
+  cur.sr = M68K->GetSR ();
+  for (i = 0; i < 8; i++)
+    {
+      cur.dreg[i] = M68K->GetDReg (i);
+      cur.areg[i] = M68K->GetAReg (i);
+    }
+  cur.savedcycles = savedcycles;
+
+  for (i = 0; i < m68k_idle_count; i++)
+    {
+      if (m68k_idle_history[i].pc == cur.pc &&
+          memcmp (&m68k_idle_history[i], &cur, sizeof(cur)) == 0)
+        {
+          m68k_idle = 1;
+          return;
+        }
+    }
+
+  m68k_idle_history[m68k_idle_pos] = cur;
+  m68k_idle_pos = (m68k_idle_pos + 1) % M68K_IDLE_HISTORY;
+  if (m68k_idle_count < M68K_IDLE_HISTORY)
+    m68k_idle_count++;
+}
+
+void
+ScspSetIdleSkip (int enable)
+{
+  m68k_idle_skip = enable;
+  M68KIdleReset ();
+}
+
 //////////////////////////////////////////////////////////////////////////////
 
 static u32 FASTCALL
@@ -4787,8 +4901,11 @@ c68k_byte_read (const u32 adr)
       rtn = T2ReadByte(SoundRam, adr & 0x7FFFF);
     }
   }
-  else
+  else {
+    if (scsp_reg_is_volatile(adr))
+      m68k_idle_volatile_read = 1;
     rtn = scsp_r_b(adr);
+  }
   return rtn;
 }
 
@@ -4803,6 +4920,7 @@ c68k_byte_write (const u32 adr, u32 data)
     //}
     if (adr < 0x80000) {
       T2WriteByte(SoundRam, adr & 0x7FFFF, data);
+      M68K_IDLE_WAKE();
     }
   }
   else{
@@ -4822,8 +4940,11 @@ c68k_word_read (const u32 adr)
       rtn = T2ReadWord(SoundRam, adr);
     }
   }
-  else
+  else {
+    if (scsp_reg_is_volatile(adr))
+      m68k_idle_volatile_read = 1;
     rtn = scsp_r_w(adr);
+  }
   return rtn;
 }
 
@@ -4838,6 +4959,7 @@ c68k_word_write (const u32 adr, u32 data)
 //    }
     if (adr < 0x80000) {
       T2WriteWord(SoundRam, adr, data);
+      M68K_IDLE_WAKE();
     }
   }
   else{
@@ -4850,19 +4972,242 @@ c68k_word_write (const u32 adr, u32 data)
 static void
 c68k_interrupt_handler (u32 level)
 {
+  static u32 lastlevel = 0;
+
+  if (level != lastlevel)
+    {
+      lastlevel = level;
+      M68K_IDLE_WAKE();
+    }
   // send interrupt to 68k
   M68K->SetIRQ ((s32)level);
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
+static volatile int scsp_scu_request_pending = 0;
+
 static void
 scu_interrupt_handler (void)
 {
+  // In lock-step mode the request is raised at the next deciline boundary,
+  // not whenever the sound thread happens to get there
+  if (yabsys.deterministic) {
+    scsp_scu_request_pending = 1;
+    return;
+  }
   // send interrupt to scu
   ScuSendSoundRequest ();
 }
 
+//////////////////////////////////////////////////////////////////////////////
+// Lock-step mode: the sound thread still runs in parallel with the SH2s, but
+// the SH2 side only observes it at points where it has caught up with the
+// published 68K cycle counter.
+
+static void ScspWriteQueueFlush(void);
+
+void ScspLockStepSync(void)
+{
+  if (yabsys.deterministic && IsM68KRunning) {
+    syncM68K();
+    ScspWriteQueueFlush();
+  }
+}
+
+// Called by the emulation thread before publishing the next deciline
+void ScspLockStepBoundary(void)
+{
+  ScspLockStepSync();
+  if (scsp_scu_request_pending) {
+    scsp_scu_request_pending = 0;
+    ScuSendSoundRequest ();
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// SH2 -> SCSP register write queue
+//
+// Register writes from the SH2 side are queued with the 68K cycle count the
+// emulation thread had published when they were made, and the sound thread
+// applies them before the sample that covers that position.  The SH2 only
+// waits for the sound thread when it reads a register whose value the SCSP
+// updates by itself (status, monitor, timers, DSP output), or when it reads
+// a register one of its own queued writes has not reached yet.
+//
+// Only the lock-step main mode (0) queues. With the free-running sound
+// thread (scsp_main_mode 1, the default of the Qt and libretro ports) there
+// is no sample position to apply a write at, so writes go straight to the
+// registers as before.
+
+#define SCSP_WRITE_QUEUE_SIZE 1024  // must be a power of 2
+
+#if defined(__GNUC__)
+#define SCSP_WRITE_QUEUE_BARRIER() __sync_synchronize()
+#else
+#define SCSP_WRITE_QUEUE_BARRIER()
+#endif
+
+typedef struct
+{
+  u32 timestamp;  // 68K cycles into the frame
+  u16 addr;
+  u8 size;        // 1, 2 or 4
+  u32 data;
+} scspwrite_struct;
+
+static scspwrite_struct scsp_write_queue[SCSP_WRITE_QUEUE_SIZE];
+static volatile u32 scsp_write_queue_head = 0;  // next entry to apply
+static volatile u32 scsp_write_queue_tail = 0;  // next free entry
+
+static void
+ScspWriteQueueApply (const scspwrite_struct *w)
+{
+  switch (w->size)
+    {
+    case 1:
+      scsp_w_b (w->addr, (u8)w->data);
+      break;
+    case 2:
+      scsp_w_w (w->addr, (u16)w->data);
+      break;
+    default:
+      scsp_w_d (w->addr, w->data);
+      break;
+    }
+}
+
+// Sound thread: apply every queued write made before 68K cycle 'limit'
+static void
+ScspWriteQueueDrain (u32 limit)
+{
+  u32 head = scsp_write_queue_head;
+
+  while (head != scsp_write_queue_tail)
+    {
+      const scspwrite_struct *w = &scsp_write_queue[head & (SCSP_WRITE_QUEUE_SIZE - 1)];
+      if (w->timestamp >= limit)
+        break;
+      SCSP_WRITE_QUEUE_BARRIER();
+      ScspWriteQueueApply (w);
+      head++;
+      SCSP_WRITE_QUEUE_BARRIER();
+      scsp_write_queue_head = head;
+    }
+}
+
+static int
+ScspWriteQueueOwned (void)
+{
+  // With the sound thread stopped or parked the SH2 side owns the SCSP
+  return !thread_running || scsp_thread_parked;
+}
+
+// SH2 side: is a write to any byte of [a, a + size) still queued? Entries
+// between head and tail are only read by the sound thread, so they can be
+// looked at while it drains.
+static int
+ScspWriteQueueHas (u32 a, u32 size)
+{
+  u32 tail = scsp_write_queue_tail;
+  u32 head = scsp_write_queue_head;
+
+  a &= 0xFFF;
+  for (; head != tail; head++)
+    {
+      const scspwrite_struct *w = &scsp_write_queue[head & (SCSP_WRITE_QUEUE_SIZE - 1)];
+      if (w->addr < a + size && a < (u32)w->addr + w->size)
+        return 1;
+    }
+  return 0;
+}
+
+// SH2 side: wait until the sound thread has applied everything queued
+static void
+ScspWriteQueueFlush (void)
+{
+  while (scsp_write_queue_head != scsp_write_queue_tail)
+    {
+      if (ScspWriteQueueOwned ())
+        {
+          ScspWriteQueueDrain (0xFFFFFFFF);
+          break;
+        }
+      YabThreadYield ();
+    }
+}
+
+static void
+ScspWriteQueuePush (u32 a, u32 d, u8 size)
+{
+  scspwrite_struct *w;
+  u32 tail = scsp_write_queue_tail;
+
+  // The free-running sound thread has no sample position to apply them at
+  if (g_scsp_main_mode != 0 ||
+      (ScspWriteQueueOwned () && scsp_write_queue_head == tail))
+    {
+      scspwrite_struct direct;
+      direct.addr = a & 0xFFF;
+      direct.size = size;
+      direct.data = d;
+      ScspWriteQueueApply (&direct);
+      return;
+    }
+
+  while (tail - scsp_write_queue_head >= SCSP_WRITE_QUEUE_SIZE)
+    {
+      if (ScspWriteQueueOwned ())
+        ScspWriteQueueFlush ();
+      else
+        YabThreadYield ();
+    }
+
+  w = &scsp_write_queue[tail & (SCSP_WRITE_QUEUE_SIZE - 1)];
+  w->timestamp = (u32)(getM68KCounter () >> SCSP_FRACTIONAL_BITS);
+  w->addr = a & 0xFFF;
+  w->size = size;
+  w->data = d;
+  SCSP_WRITE_QUEUE_BARRIER();
+  scsp_write_queue_tail = tail + 1;
+}
+
+// Common control registers (MIDI, monitor, timers, interrupts) and DSP
+// outputs change without a write from the SH2
+static INLINE int
+scsp_reg_needs_catchup (u32 a)
+{
+  a &= 0xFFF;
+  return (a >= 0x400 && a < 0x440) || a >= 0xE80;
+}
+
+static void
+ScspSh2ReadSync (u32 a, u32 size)
+{
+  if (yabsys.deterministic)
+    {
+      ScspLockStepSync ();
+      return;
+    }
+  if (scsp_reg_needs_catchup (a))
+    {
+      // Any queued write (a timer or interrupt reset) can change these
+      if (g_scsp_main_mode == 0 && thread_running && !g_scsp_lock)
+        syncM68K ();
+      ScspWriteQueueFlush ();
+    }
+  else if (scsp_write_queue_head != scsp_write_queue_tail &&
+           ScspWriteQueueHas (a, size))
+    ScspWriteQueueFlush ();
+}
+
+u8 FASTCALL ScspSh2ReadByte(u32 a) { ScspSh2ReadSync(a, 1); return scsp_r_b(a); }
+u16 FASTCALL ScspSh2ReadWord(u32 a) { ScspSh2ReadSync(a, 2); return scsp_r_w(a); }
+u32 FASTCALL ScspSh2ReadLong(u32 a) { ScspSh2ReadSync(a, 4); return scsp_r_d(a); }
+void FASTCALL ScspSh2WriteByte(u32 a, u8 d) { ScspWriteQueuePush(a, d, 1); }
+void FASTCALL ScspSh2WriteWord(u32 a, u16 d) { ScspWriteQueuePush(a, d, 2); }
+void FASTCALL ScspSh2WriteLong(u32 a, u32 d) { ScspWriteQueuePush(a, d, 4); }
+
 //////////////////////////////////////////////////////////////////////////////
 
 u8 FASTCALL
@@ -4877,6 +5222,7 @@ SoundRamReadByte (u32 addr)
   else if (addr > 0x7FFFF)
     val = 0xFF;
 
+  ScspLockStepSync();
   val = T2ReadByte(SoundRam, addr);
   //SCSPLOG("SoundRamReadByte %08X:%02X",addr,val);
   return val;
@@ -4896,8 +5242,10 @@ SoundRamWriteByte (u32 addr, u8 val)
     return;
 
   //SCSPLOG("SoundRamWriteByte %08X:%02X", addr, val);
+  ScspLockStepSync();
   T2WriteByte (SoundRam, addr, val);
   M68K->WriteNotify (addr, 1);
+  M68K_IDLE_WAKE();
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -4906,6 +5254,10 @@ SoundRamWriteByte (u32 addr, u8 val)
 int sh2_read_req = 0;
 static int mem_access_counter = 0;
 void SyncSh2And68k(){
+  if (yabsys.deterministic) {
+    ScspLockStepSync();
+    return;
+  }
   if (IsM68KRunning) {
     /*
     #if defined(ARCH_IS_LINUX)
@@ -4969,8 +5321,10 @@ SoundRamWriteWord (u32 addr, u16 val)
   else if (addr > 0x7FFFF)
     return;
   //LOG("SoundRamWriteWord %08X:%04X", addr, val);
+  ScspLockStepSync();
   T2WriteWord (SoundRam, addr, val);
   M68K->WriteNotify (addr, 2);
+  M68K_IDLE_WAKE();
   //SyncSh2And68k();
 }
 
@@ -5043,8 +5397,10 @@ SoundRamWriteLong (u32 addr, u32 val)
     return;
 
   //LOG("SoundRamWriteLong %08X:%08X", addr, val);
+  ScspLockStepSync();
   T2WriteLong (SoundRam, addr, val);
   M68K->WriteNotify (addr, 4);
+  M68K_IDLE_WAKE();
   //SyncSh2And68k();
 
 }
@@ -5209,6 +5565,7 @@ M68KStart (void)
   M68K->Reset ();
   //ScspReset();
   savedcycles = 0;
+  M68KIdleReset ();
   IsM68KRunning = 1;
 }
 
@@ -5229,6 +5586,7 @@ ScspReset (void)
 {
   g_scsp_lock = 1;
   YabThreadUSleep(100000);
+  scsp_write_queue_head = scsp_write_queue_tail;
   scsp_reset();
   g_scsp_lock = 0;
 }
@@ -5269,12 +5627,21 @@ void M68KExec(s32 cycles)
   s32 newcycles = savedcycles - cycles;
   if (LIKELY(IsM68KRunning))
     {
+      if (m68k_idle)
+        {
+          // Still spinning: the loop can't exit before something changes
+          if (m68k_idle_events_seen == scsp_idle_events)
+            return;
+          M68KIdleReset ();
+        }
       if (LIKELY(newcycles < 0))
         {
           s32 cyclestoexec = -newcycles;
           newcycles += (*m68kexecptr)(cyclestoexec);
         }
       savedcycles = newcycles;
+      if (m68k_idle_skip && m68kexecptr == M68K->Exec)
+        M68KIdleCheck ();
     }
 }
 
@@ -5464,9 +5831,22 @@ void new_scsp_update_samples(s32 *bufL, s32 *bufR, int scspsoundlen)
    new_scsp_outbuf_pos = 0;
 }
 
+// Called by the sound thread at points where it holds no SCSP/68K state
+static void ScspThreadPark(void) {
+  if (!g_scsp_lock) return;
+  scsp_thread_parked = 1;
+  while (g_scsp_lock) { YabThreadUSleep(1000); }
+  scsp_thread_parked = 0;
+}
+
 void ScspLockThread() {
+  int wait;
   g_scsp_lock = 1;
-  YabThreadUSleep(16666*2);
+  // Wait for the sound thread to park instead of sleeping for two frames.
+  // The timeout only matters if the thread is blocked somewhere else.
+  for (wait = 0; thread_running && !scsp_thread_parked && wait < 100; wait++) {
+    YabThreadUSleep(1000);
+  }
 }
 
 void ScspUnLockThread() {
@@ -5514,6 +5894,7 @@ void ScspAsynMainCpuTime( void * p ){
   if( yabsys.use_cpu_affinity ){
     YabThreadSetCurrentThreadAffinityMask( YabThreadGetFastestCpuIndex() );
   }
+  TraceThreadName("scsp sync");
   before = YabauseGetTicks() * 1000000000 / yabsys.tickfreq;
   u32 wait_clock = 0;
   u64 pre_m68k_cycle = 0;
@@ -5525,14 +5906,16 @@ void ScspAsynMainCpuTime( void * p ){
   now = 0;
   before = 0;
   while (thread_running){
-    while (g_scsp_lock) { YabThreadUSleep(1000); }
+    ScspThreadPark();
     u64 m68k_done_counter = 0;
     u64 m68k_integer_part = 0;
     u64 m68k_cycle = 0;
     do {
+      // Writes made before the end of the sample we're waiting to run
+      ScspWriteQueueDrain((u32)(pre_m68k_cycle - m68k_inc) + samplecnt);
       m68k_integer_part = getM68KCounter() >> SCSP_FRACTIONAL_BITS;
       m68k_cycle = m68k_integer_part - pre_m68k_cycle;
-      if (thread_running == 0) break;
+      if (thread_running == 0 || g_scsp_lock) break;
     } while (m68k_cycle == 0);
 
     m68k_inc += m68k_cycle;
@@ -5540,9 +5923,12 @@ void ScspAsynMainCpuTime( void * p ){
 
     // Sync 44100KHz
     while (m68k_inc >= samplecnt) {
+      ScspWriteQueueDrain((u32)(pre_m68k_cycle - m68k_inc) + samplecnt);
       m68k_inc = m68k_inc - samplecnt;
       //LOG("[SCSP] MM68KExec %d", samplecnt);
+      TRACE_BEGIN(TRACE_M68K_EXEC);
       MM68KExec(samplecnt);
+      TRACE_END(TRACE_M68K_EXEC);
       if (use_new_scsp) {
         new_scsp_exec((samplecnt << 1));
       }
@@ -5558,11 +5944,15 @@ void ScspAsynMainCpuTime( void * p ){
         ScspInternalVars->scsptiming1 = scsplines;
         ScspExecAsync();
 
+        // Nothing is written between the last deciline and the next frame
+        ScspWriteQueueDrain(0xFFFFFFFF);
         YabAddEventQueue( q_scsp_finish , 0);
         pre_m68k_cycle = 0;
         m68k_inc = 0;
         //LOG("[SCSP] WAIT SH2");
+        TRACE_BEGIN(TRACE_SCSP_FRAME_WAIT);
         YabWaitEventQueue(q_scsp_frame_start);
+        TRACE_END(TRACE_SCSP_FRAME_WAIT);
         now = YabauseGetTicks() * 1000000000 / yabsys.tickfreq;
         //LOG(" SCSPTIME = %d/16666666 %d/735", (s32)(now - before), hzcheck);
         hzcheck = 0;
@@ -5572,6 +5962,7 @@ void ScspAsynMainCpuTime( void * p ){
     }
     setM68kDoneCounter(pre_m68k_cycle);
   }
+  TraceThreadExit();
   YabThreadWake(YAB_THREAD_SCSP);
 }
 
@@ -5599,6 +5990,7 @@ void ScspAsynMainRealtime(void * p) {
   }
   setpriority( PRIO_PROCESS, 0, -10);
 #endif
+  TraceThreadName("scsp async");
 
   // Special for Thunder Force V
   char * pCurrentGame = Cs2GetCurrentGmaecode();
@@ -5620,7 +6012,7 @@ void ScspAsynMainRealtime(void * p) {
   now = 0;
   before = 0;
   while (thread_running) {
-    while (g_scsp_lock) { YabThreadUSleep(1000); }
+    ScspThreadPark();
     // Run 1 sample(44100Hz)
     for (i = 0; i < samplecnt; i += step) {
       MM68KExec(step);
@@ -5746,6 +6138,7 @@ void ScspAsynMainRealtime(void * p) {
       before = checktime;
     }
   }
+  TraceThreadExit();
   YabThreadWake(YAB_THREAD_SCSP);
 }
 
@@ -5796,6 +6189,9 @@ void ScspExecAsync() {
         new_scsp_update_samples(bufL, bufR, scspsoundlen);
      else
         scsp_update(bufL, bufR, scspsoundlen);
+     // every generated sample, whatever the sound core takes below
+     if (AVCaptureAudioActive)
+        AVCaptureAudio(bufL, bufR, scspsoundlen);
      scspsoundgenpos += scspsoundlen;
      scspsoundoutleft += scspsoundlen;
   }
@@ -5858,6 +6254,7 @@ void
 M68KWriteNotify (u32 address, u32 size)
 {
   M68K->WriteNotify (address, size);
+  M68K_IDLE_WAKE();
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -6048,6 +6445,9 @@ SoundSaveState (FILE *fp)
   u8 nextphase;
   IOCheck_struct check = { 0, 0 };
 
+  // Registers must include every write the SH2 has made
+  ScspWriteQueueFlush ();
+
   offset = StateWriteHeader (fp, "SCSP", 3);
 
   // Save 68k registers first
@@ -6340,6 +6740,8 @@ SoundLoadState (FILE *fp, int version, int size)
   u8 nextphase;
   IOCheck_struct check = { 0, 0 };
   
+  // Writes queued before the load belong to the old state
+  scsp_write_queue_head = scsp_write_queue_tail;
 
   // Read 68k registers first
   yread(&check, (void *)&IsM68KRunning, 1, 1, fp);
@@ -6437,6 +6839,7 @@ SoundLoadState (FILE *fp, int version, int size)
 
   // Lastly, sound ram
   yread (&check, (void *)SoundRam, 0x80000, 1, fp);
+  M68KWriteNotify (0, 0x80000);
 
   if (version > 1)
     {
@@ -127,6 +127,10 @@ void M68KStop(void);
 void ScspReset(void);
 int ScspChangeVideoFormat(int type);
 void M68KExec(s32 cycles);
+void ScspSetIdleSkip(int enable);
+#if defined(ASYNC_SCSP)
+void MM68KExec(s32 cycles);
+#endif
 void ScspExec(void);
 void ScspConvert32uto16s(s32 *srcL, s32 *srcR, s16 *dst, u32 len);
 void ScspReceiveCDDA(const u8 *sector);
@@ -188,6 +192,19 @@ void ScspLockThread();
 void ScspUnLockThread();
 void setM68kCounter(u64 counter);
 void setM68kDoneCounter(u64 counter);
+void syncM68K();
+
+// Lock-step mode (yabsys.deterministic)
+void ScspLockStepSync(void);
+void ScspLockStepBoundary(void);
+
+// SH2 side of the SCSP registers: writes are queued for the sound thread
+u8 FASTCALL ScspSh2ReadByte(u32 a);
+u16 FASTCALL ScspSh2ReadWord(u32 a);
+u32 FASTCALL ScspSh2ReadLong(u32 a);
+void FASTCALL ScspSh2WriteByte(u32 a, u8 d);
+void FASTCALL ScspSh2WriteWord(u32 a, u16 d);
+void FASTCALL ScspSh2WriteLong(u32 a, u32 d);
 
 extern int use_new_scsp;
 
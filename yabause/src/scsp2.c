@@ -22,6 +22,7 @@
 */
 
 #include "core.h"
+#include "avcapture.h"
 #include "debug.h"
 #include "error.h"
 #include "m68kcore.h"
@@ -1343,6 +1344,9 @@ static void ScspDoExec(u32 cycles)
          bufL = &scsp_buffer_L[scsp_sound_genpos];
          bufR = &scsp_buffer_R[scsp_sound_genpos];
          ScspGenerateAudio(bufL, bufR, this_count);
+         // every generated sample, whatever the sound core takes below
+         if (AVCaptureAudioActive)
+            AVCaptureAudio(bufL, bufR, this_count);
          scsp_sound_genpos += this_count;
          scsp_sound_left += this_count;
          sample_count -= this_count;
@@ -1373,7 +1377,11 @@ static void ScspDoExec(u32 cycles)
       {
          if (audio_free > SCSP_SOUND_BUFSIZE)
             audio_free = SCSP_SOUND_BUFSIZE;
+         // only as much is generated as the sound core takes, so that is
+         // also all there is to capture
          ScspGenerateAudio(scsp_buffer_L, scsp_buffer_R, audio_free);
+         if (AVCaptureAudioActive)
+            AVCaptureAudio(scsp_buffer_L, scsp_buffer_R, audio_free);
          SNDCore->UpdateAudio((u32 *)scsp_buffer_L,
                               (u32 *)scsp_buffer_R, audio_free);
 #if 0
@@ -47,13 +47,14 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
 #include "memory.h"
 #include "sh2core.h"
 #include "yabause.h"
+#include "vdp1.h"
+#include "vdp2.h"
 #include <inttypes.h>
+#include <string.h>
 
 #ifdef OPTIMIZED_DMA
 # include "cs2.h"
 # include "scsp.h"
-# include "vdp1.h"
-# include "vdp2.h"
 #endif
 
 Scu * ScuRegs;
@@ -233,6 +234,95 @@ static INLINE void *DMAMemoryPointer(u32 address) {
 
 #endif  // OPTIMIZED_DMA
 
+//////////////////////////////////////////////////////////////////////////////
+
+// Bulk transfer between RAM-backed regions. When both ends of a linear DMA
+// resolve to host memory (see MemoryGetSpan), the words are moved with one
+// block copy or fill and the dirty tracking of the destination is updated
+// once for the range.
+
+#define SCU_DMA_BULK_MIN 32
+
+// Copies the leading part of the transfer that is contiguous in host memory.
+// unit is the number of bytes moved per tick of *time and write_step how far
+// the destination advances per unit. The last unit is always left to the
+// caller so that its end-of-transfer handling runs as before.
+static void ScuDmaBulkCopy(scudmainfo_struct * dma, int * time, u32 unit, u32 write_step) {
+   MemorySpan src, dst;
+   u32 size;
+
+   if (write_step != unit || *time <= 0 || dma->TransferNumber <= (s32)unit)
+      return;
+   if (!MemoryGetSpan(dma->ReadAddress, &src) || !MemoryGetSpan(dma->WriteAddress, &dst))
+      return;
+
+   size = dma->TransferNumber - unit;
+   if (size > src.avail) size = src.avail;
+   if (size > dst.avail) size = dst.avail;
+   if (size > (u32)*time * unit) size = (u32)*time * unit;
+   size -= size % unit;
+   if (size < SCU_DMA_BULK_MIN)
+      return;
+
+   // Overlapping ranges replicate data word by word on the real bus
+   if (src.base == dst.base && src.offset < dst.offset + size && dst.offset < src.offset + size)
+      return;
+
+   MemorySpanSync(&src);
+   MemorySpanSync(&dst);
+   MemorySpanCopy(&dst, &src, size);
+   MemorySpanWritten(&dst, size);
+
+   *time -= size / unit;
+   dma->ReadAddress += size;
+   dma->WriteAddress += size;
+   dma->TransferNumber -= size;
+}
+
+// Same as ScuDmaBulkCopy for fills from a constant source. val is written as
+// two 16-bit halves (upper first), which also covers the 32-bit fill.
+// read_step only keeps the source address where the word loop would leave it.
+static void ScuDmaBulkFill(scudmainfo_struct * dma, int * time, u32 val, u32 write_step, u32 read_step) {
+   MemorySpan dst;
+   u8 pattern[4];
+   u32 size, i;
+
+   if (write_step != 4 || *time <= 0 || dma->TransferNumber <= 4)
+      return;
+   if (!MemoryGetSpan(dma->WriteAddress, &dst))
+      return;
+
+   size = dma->TransferNumber - 4;
+   if (size > dst.avail) size = dst.avail;
+   if (size > (u32)*time * 4) size = (u32)*time * 4;
+   size &= ~3;
+   if (size < SCU_DMA_BULK_MIN)
+      return;
+
+   pattern[0] = (u8)(val >> 24);
+   pattern[1] = (u8)(val >> 16);
+   pattern[2] = (u8)(val >> 8);
+   pattern[3] = (u8)val;
+#ifndef WORDS_BIGENDIAN
+   if (dst.t2) {
+      u8 tmp;
+      tmp = pattern[0]; pattern[0] = pattern[1]; pattern[1] = tmp;
+      tmp = pattern[2]; pattern[2] = pattern[3]; pattern[3] = tmp;
+   }
+#endif
+   MemorySpanSync(&dst);
+   for (i = 0; i < size; i += 4)
+      memcpy(dst.ptr + i, pattern, 4);
+   MemorySpanWritten(&dst, size);
+
+   *time -= size / 4;
+   dma->ReadAddress += (size / 4) * read_step;
+   dma->WriteAddress += size;
+   dma->TransferNumber -= size;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 static void DoDMA(u32 ReadAddress, unsigned int ReadAdd,
                   u32 WriteAddress, unsigned int WriteAdd,
                   u32 TransferSize)
@@ -1139,6 +1229,7 @@ void SucDmaExec(scudmainfo_struct * dma, int * time ) {
         }
 
         u32 start = dma->WriteAddress;
+        ScuDmaBulkFill(dma, time, val, dma->WriteAdd * 2, 0);
         while ( *time > 0 ) {
           *time -= 1;
           MappedMemoryWriteWordNocache(dma->WriteAddress, (u16)(val >> 16), &cycle);
@@ -1177,6 +1268,7 @@ void SucDmaExec(scudmainfo_struct * dma, int * time ) {
       u32 start = dma->WriteAddress;
       if (constant_source) {
         u32 val = MappedMemoryReadLongNocache((dma->ReadAddress & 0x0FFFFFFF), &cycle);
+        ScuDmaBulkFill(dma, time, val, dma->WriteAdd, dma->ReadAdd);
         while ( *time > 0) {
           *time -= 1;
           MappedMemoryWriteLongNocache(dma->WriteAddress, val, &cycle);
@@ -1216,6 +1308,7 @@ void SucDmaExec(scudmainfo_struct * dma, int * time ) {
       // Copy in 16-bit units, avoiding misaligned accesses.
       u32 counter = 0;
       u32 start = dma->WriteAddress;
+      ScuDmaBulkCopy(dma, time, 2, dma->WriteAdd);
       while (*time > 0) {
         *time -= 1;
         u16 tmp = MappedMemoryReadWordNocache((dma->ReadAddress & 0x0FFFFFFF), &cycle);
@@ -1232,6 +1325,7 @@ void SucDmaExec(scudmainfo_struct * dma, int * time ) {
     }
     else if (((dma->ReadAddress & 0x1FFFFFFF) >= 0x5A00000 && (dma->ReadAddress & 0x1FFFFFFF) < 0x5FF0000)) {
       u32 start = dma->WriteAddress;
+      ScuDmaBulkCopy(dma, time, 2, dma->WriteAdd >> 1);
       while ( *time > 0) {
         *time -= 1;
         u16 tmp = MappedMemoryReadWordNocache((dma->ReadAddress & 0x0FFFFFFF), &cycle);
@@ -1249,6 +1343,7 @@ void SucDmaExec(scudmainfo_struct * dma, int * time ) {
     else {
       u32 counter = 0;
       u32 start = dma->WriteAddress;
+      ScuDmaBulkCopy(dma, time, 4, dma->WriteAdd);
       while (*time > 0) {
         *time -= 1;
         u32 val = MappedMemoryReadLongNocache((dma->ReadAddress & 0x0FFFFFFF), &cycle);
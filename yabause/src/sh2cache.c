@@ -27,6 +27,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
 #endif
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <ctype.h>
 
@@ -37,6 +38,14 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
 
 #include "debug.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CACHE_TAG_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define CACHE_TAG_NEON
+#endif
+
 #define AREA_MASK (0xE0000000)
 #define TAG_MASK (0x1FFFFC00)
 #define ENTRY_MASK (0x000003F0)
@@ -120,6 +129,71 @@ static INLINE int select_way_to_replace(cache_enty *ca, u32 lru, u32 isInstr)
   return lru_replace[lru & ca->ccr_replace_and] | ca->ccr_replace_or[isInstr];
 }
 
+// highest matching way wins, the same order the ways used to be tested in
+static const s8 way_from_mask[16] = {-1, 0, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3};
+
+// Compares the four tags of an entry at once, returns the hit way or -1
+static INLINE int find_way(const cache_line *line, u32 tagaddr)
+{
+#if defined(CACHE_TAG_SSE2)
+  const __m128i tags = _mm_loadu_si128((const __m128i *)line->tag);
+  const __m128i eq = _mm_cmpeq_epi32(tags, _mm_set1_epi32((int)tagaddr));
+  return way_from_mask[_mm_movemask_ps(_mm_castsi128_ps(eq))];
+#elif defined(CACHE_TAG_NEON)
+  static const u32 bits[4] = {1, 2, 4, 8};
+  const uint32x4_t eq = vceqq_u32(vld1q_u32(line->tag), vdupq_n_u32(tagaddr));
+  return way_from_mask[vaddvq_u32(vandq_u32(eq, vld1q_u32(bits)))];
+#else
+  return way_from_mask[(line->tag[0] == tagaddr) |
+                       ((line->tag[1] == tagaddr) << 1) |
+                       ((line->tag[2] == tagaddr) << 2) |
+                       ((line->tag[3] == tagaddr) << 3)];
+#endif
+}
+
+// Fills a line straight from work RAM or the BIOS ROM in one copy. Returns 0
+// for anything else (I/O, cartridge, memory breakpoints installed), the
+// caller then reads the line through the memory handlers.
+static INLINE int fill_line_from_span(u8 *data, u32 addr, u32 *tmpcycle)
+{
+  MemorySpan span;
+  u32 line = addr & 0xFFFFFFF0;
+
+  if (MSH2->bp.nummemorybreakpoints || SSH2->bp.nummemorybreakpoints)
+    return 0;
+
+  if ((line & 0x0FF00000) == 0x00000000 && BiosRom != NULL)
+  {
+    span.ptr = BiosRom + (line & 0x7FFFF);
+  }
+  else if (!MemoryGetSpan(line, &span) || !span.t2)
+  {
+    return 0;
+  }
+
+#ifdef WORDS_BIGENDIAN
+  memcpy(data, span.ptr, 16);
+#else
+  {
+    // T2 memory holds native 16-bit words, the line holds bus byte order
+    u64 lo, hi;
+    memcpy(&lo, span.ptr, 8);
+    memcpy(&hi, span.ptr + 8, 8);
+    lo = ((lo & 0x00FF00FF00FF00FFULL) << 8) | ((lo >> 8) & 0x00FF00FF00FF00FFULL);
+    hi = ((hi & 0x00FF00FF00FF00FFULL) << 8) | ((hi >> 8) & 0x00FF00FF00FF00FFULL);
+    memcpy(data, &lo, 8);
+    memcpy(data + 8, &hi, 8);
+  }
+#endif
+
+#if CACHE_ENABLE
+  *tmpcycle = getMemClock(line) << 1;
+#else
+  *tmpcycle = 0;
+#endif
+  return 1;
+}
+
 #if HAVE_BUILTIN_BSWAP16
 #define SWAP16(v) (__builtin_bswap16(v))
 #else
@@ -155,23 +229,7 @@ void cache_memory_write_b(cache_enty *ca, u32 addr, u8 val, u32 *cycle)
     const u32 tagaddr = (addr & TAG_MASK) | 0x02;
     const u32 entry = (addr & ENTRY_MASK) >> ENTRY_SHIFT;
 
-    int way = -1;
-    if (ca->way[entry].tag[3] == tagaddr)
-    {
-      way = 3;
-    }
-    else if (ca->way[entry].tag[2] == tagaddr)
-    {
-      way = 2;
-    }
-    else if (ca->way[entry].tag[1] == tagaddr)
-    {
-      way = 1;
-    }
-    else if (ca->way[entry].tag[0] == tagaddr)
-    {
-      way = 0;
-    }
+    const int way = find_way(&ca->way[entry], tagaddr);
 
 #ifdef CACHE_STATICS
     ca->write_count++;
@@ -226,23 +284,7 @@ void cache_memory_write_w(cache_enty *ca, u32 addr, u16 val, u32 *cycle)
     const u32 tagaddr = (addr & TAG_MASK) | 0x02;
     const u32 entry = (addr & ENTRY_MASK) >> ENTRY_SHIFT;
 
-    int way = -1;
-    if (ca->way[entry].tag[3] == tagaddr)
-    {
-      way = 3;
-    }
-    else if (ca->way[entry].tag[2] == tagaddr)
-    {
-      way = 2;
-    }
-    else if (ca->way[entry].tag[1] == tagaddr)
-    {
-      way = 1;
-    }
-    else if (ca->way[entry].tag[0] == tagaddr)
-    {
-      way = 0;
-    }
+    const int way = find_way(&ca->way[entry], tagaddr);
 
     if (way > -1)
     {
@@ -314,24 +356,7 @@ void cache_memory_write_l(cache_enty *ca, u32 addr, u32 val, u32 *cycle)
 
     const u32 tagaddr = (addr & TAG_MASK) | 0x02;
     const u32 entry = (addr & ENTRY_MASK) >> ENTRY_SHIFT;
-    int way = -1;
-
-    if (ca->way[entry].tag[3] == tagaddr)
-    {
-      way = 3;
-    }
-    else if (ca->way[entry].tag[2] == tagaddr)
-    {
-      way = 2;
-    }
-    else if (ca->way[entry].tag[1] == tagaddr)
-    {
-      way = 1;
-    }
-    else if (ca->way[entry].tag[0] == tagaddr)
-    {
-      way = 0;
-    }
+    const int way = find_way(&ca->way[entry], tagaddr);
 
     if (way > -1)
     {
@@ -377,23 +402,7 @@ u8 cache_memory_read_b(cache_enty *ca, u32 addr, u32 *cycle)
     const u32 tagaddr = (addr & TAG_MASK) | 0x02;
     const u32 entry = (addr & ENTRY_MASK) >> ENTRY_SHIFT;
 
-    int way = -1;
-    if (ca->way[entry].tag[3] == tagaddr)
-    {
-      way = 3;
-    }
-    else if (ca->way[entry].tag[2] == tagaddr)
-    {
-      way = 2;
-    }
-    else if (ca->way[entry].tag[1] == tagaddr)
-    {
-      way = 1;
-    }
-    else if (ca->way[entry].tag[0] == tagaddr)
-    {
-      way = 0;
-    }
+    const int way = find_way(&ca->way[entry], tagaddr);
 
     if (way > -1)
     {
@@ -419,16 +428,19 @@ u8 cache_memory_read_b(cache_enty *ca, u32 addr, u32 *cycle)
       update_lru(lruway, &ca->lru[entry]);
       ca->way[entry].tag[lruway] = tagaddr;
       u32 tmpcycle = 0;
-      for (i = 0; i < 16; i += 4)
+      if (!fill_line_from_span(ca->way[entry].data[lruway], addr, &tmpcycle))
       {
-        u32 odi = (addr + 4 + i) & 0xC;
-        u32 ccycle = 0;
-        ca->way[entry].data[lruway][odi] = MappedMemoryReadByteNocache( (addr & 0xFFFFFFF0) + odi, &ccycle);
-        tmpcycle = ccycle << 1;
-        ca->way[entry].data[lruway][odi + 1] = ReadByteList[(addr >> 16) & 0xFFF]((addr & 0xFFFFFFF0) + odi + 1);
-        ca->way[entry].data[lruway][odi + 2] = ReadByteList[(addr >> 16) & 0xFFF]((addr & 0xFFFFFFF0) + odi + 2);
-        ca->way[entry].data[lruway][odi + 3] = ReadByteList[(addr >> 16) & 0xFFF]((addr & 0xFFFFFFF0) + odi + 3);
-        //CACHE_LOG("[SH2-%s] %d Cache miss read %08X %d:%d:%d", CurrentSH2->isslave ? "S" : "M", CurrentSH2->cycles, addr, entry, lruway, odi);
+        for (i = 0; i < 16; i += 4)
+        {
+          u32 odi = (addr + 4 + i) & 0xC;
+          u32 ccycle = 0;
+          ca->way[entry].data[lruway][odi] = MappedMemoryReadByteNocache( (addr & 0xFFFFFFF0) + odi, &ccycle);
+          tmpcycle = ccycle << 1;
+          ca->way[entry].data[lruway][odi + 1] = ReadByteList[(addr >> 16) & 0xFFF]((addr & 0xFFFFFFF0) + odi + 1);
+          ca->way[entry].data[lruway][odi + 2] = ReadByteList[(addr >> 16) & 0xFFF]((addr & 0xFFFFFFF0) + odi + 2);
+          ca->way[entry].data[lruway][odi + 3] = ReadByteList[(addr >> 16) & 0xFFF]((addr & 0xFFFFFFF0) + odi + 3);
+          //CACHE_LOG("[SH2-%s] %d Cache miss read %08X %d:%d:%d", CurrentSH2->isslave ? "S" : "M", CurrentSH2->cycles, addr, entry, lruway, odi);
+        }
       }
       if (cycle) { *cycle = MIN(MAX_CACHE_MISS_CYCLE, tmpcycle);}
 
@@ -481,23 +493,7 @@ u16 cache_memory_read_w(cache_enty *ca, u32 addr, u32 *cycle, u32 isInst)
     const u32 tagaddr = (addr & TAG_MASK) | 0x02;
     const u32 entry = (addr & ENTRY_MASK) >> ENTRY_SHIFT;
 
-    int way = -1;
-    if (ca->way[entry].tag[3] == tagaddr)
-    {
-      way = 3;
-    }
-    else if (ca->way[entry].tag[2] == tagaddr)
-    {
-      way = 2;
-    }
-    else if (ca->way[entry].tag[1] == tagaddr)
-    {
-      way = 1;
-    }
-    else if (ca->way[entry].tag[0] == tagaddr)
-    {
-      way = 0;
-    }
+    const int way = find_way(&ca->way[entry], tagaddr);
 
     if (way > -1)
     {
@@ -527,14 +523,17 @@ u16 cache_memory_read_w(cache_enty *ca, u32 addr, u32 *cycle, u32 isInst)
       ca->way[entry].tag[lruway] = tagaddr;
 
       u32 tmpcycle = 0;
-      for (i = 0; i < 16; i += 4)
+      if (!fill_line_from_span(ca->way[entry].data[lruway], addr, &tmpcycle))
       {
-        u32 odi = (addr + 4 + i) & 0xC;
-        u32 ccycle = 0;
-        *(u16 *)(&ca->way[entry].data[lruway][odi]) = SWAP16(MappedMemoryReadWordNocache((addr & 0xFFFFFFF0) + odi, &ccycle));
-        tmpcycle = ccycle << 1;
-        *(u16 *)(&ca->way[entry].data[lruway][odi + 2]) = SWAP16(ReadWordList[(addr >> 16) & 0xFFF]((addr & 0xFFFFFFF0) + odi + 2));
-        //CACHE_LOG("[SH2-%s] %d Cache miss read %08X %d:%d:%d", CurrentSH2->isslave ? "S" : "M", CurrentSH2->cycles, addr, entry, lruway, odi);
+        for (i = 0; i < 16; i += 4)
+        {
+          u32 odi = (addr + 4 + i) & 0xC;
+          u32 ccycle = 0;
+          *(u16 *)(&ca->way[entry].data[lruway][odi]) = SWAP16(MappedMemoryReadWordNocache((addr & 0xFFFFFFF0) + odi, &ccycle));
+          tmpcycle = ccycle << 1;
+          *(u16 *)(&ca->way[entry].data[lruway][odi + 2]) = SWAP16(ReadWordList[(addr >> 16) & 0xFFF]((addr & 0xFFFFFFF0) + odi + 2));
+          //CACHE_LOG("[SH2-%s] %d Cache miss read %08X %d:%d:%d", CurrentSH2->isslave ? "S" : "M", CurrentSH2->cycles, addr, entry, lruway, odi);
+        }
       }
       if (cycle) { *cycle = MIN(MAX_CACHE_MISS_CYCLE, tmpcycle);}
       CACHE_LOG("[SH2-%s] %d+%d Cache miss read 2 %08X\n", CurrentSH2->isslave ? "S" : "M", CurrentSH2->cycles, tmpcycle, addr);
@@ -586,23 +585,7 @@ u32 cache_memory_read_l(cache_enty *ca, u32 addr, u32 *cycle)
     const u32 tagaddr = (addr & TAG_MASK) | 0x02;
     const u32 entry = (addr & ENTRY_MASK) >> ENTRY_SHIFT;
 
-    int way = -1;
-    if (ca->way[entry].tag[3] == tagaddr)
-    {
-      way = 3;
-    }
-    else if (ca->way[entry].tag[2] == tagaddr)
-    {
-      way = 2;
-    }
-    else if (ca->way[entry].tag[1] == tagaddr)
-    {
-      way = 1;
-    }
-    else if (ca->way[entry].tag[0] == tagaddr)
-    {
-      way = 0;
-    }
+    const int way = find_way(&ca->way[entry], tagaddr);
 
     if (way > -1)
     {
@@ -636,14 +619,17 @@ u32 cache_memory_read_l(cache_enty *ca, u32 addr, u32 *cycle)
       update_lru(lruway, &ca->lru[entry]);
       ca->way[entry].tag[lruway] = tagaddr;
       u32 tmpcycle = 0;
-      for (i = 0; i < 16; i += 4)
+      if (!fill_line_from_span(ca->way[entry].data[lruway], addr, &tmpcycle))
       {
-        u32 odi = (addr + 4 + i) & 0xC;
-        u32 ccycle = 0;
-        u32 data = MappedMemoryReadLongNocache((addr & 0xFFFFFFF0) + odi, &ccycle);
-        *(u32 *)(&ca->way[entry].data[lruway][odi]) = SWAP32(data);
-        tmpcycle = ccycle << 1;
-        //CACHE_LOG("[SH2-%s] %d Cache miss read %08X %d:%d:%d %08X\n", CurrentSH2->isslave ? "S" : "M", CurrentSH2->cycles, addr, entry, lruway, odi, data);
+        for (i = 0; i < 16; i += 4)
+        {
+          u32 odi = (addr + 4 + i) & 0xC;
+          u32 ccycle = 0;
+          u32 data = MappedMemoryReadLongNocache((addr & 0xFFFFFFF0) + odi, &ccycle);
+          *(u32 *)(&ca->way[entry].data[lruway][odi]) = SWAP32(data);
+          tmpcycle = ccycle << 1;
+          //CACHE_LOG("[SH2-%s] %d Cache miss read %08X %d:%d:%d %08X\n", CurrentSH2->isslave ? "S" : "M", CurrentSH2->cycles, addr, entry, lruway, odi, data);
+        }
       }
       if (cycle) { *cycle = MIN(MAX_CACHE_MISS_CYCLE, tmpcycle);}
       CACHE_LOG("[SH2-%s] %d+%d Cache miss read 4 %08X\n", CurrentSH2->isslave ? "S" : "M", CurrentSH2->cycles, tmpcycle, addr);
@@ -46,6 +46,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
 #include "debug.h"
 #include "memory.h"
 #include "yabause.h"
+#include "cs2.h"
 
 #include "vdp2.h"
 
@@ -2329,6 +2330,73 @@ int getEatClock(u32 src, u32 dst) {
 
 }
 
+#define DMA_BLOCK_MIN 8
+
+// Moves the leading 32-bit units of a long or 16-byte transfer in one block
+// when the channel reads incrementing RAM or the fixed CD block data port and
+// writes incrementing RAM. Registers, copy_clock and penerly are advanced as
+// the unit loop would have done; the last unit is always left to that loop so
+// that the end-of-transfer interrupt and TE handling stay in one place.
+// Returns the number of units moved.
+static u32 DMATransferBlock(Dmac * dmac, int srcInc, int destInc) {
+   MemorySpan src, dst;
+   u32 sar = *dmac->SAR;
+   u32 dar = *dmac->DAR;
+   u32 units, unit_clock;
+   int cs2_source;
+
+   if (destInc != 4 || *dmac->TCR <= DMA_BLOCK_MIN)
+      return 0;
+   if ((sar >> 29) > 1 || (dar >> 29) > 1)
+      return 0;
+   if (!MemoryGetSpan(dar, &dst))
+      return 0;
+
+   cs2_source = srcInc == 0 && (sar & 0x0FF00000) == 0x05800000 && (sar & 0xFFFFF) == 0x18000;
+   if (!cs2_source) {
+      if (srcInc != 4 || !MemoryGetSpan(sar, &src))
+         return 0;
+   }
+
+   units = MIN(*dmac->TCR - 1, dst.avail / 4);
+   if (cs2_source) {
+      // Stop one word short of the end of the transfer so that the port read
+      // that frees the sectors still goes through Cs2ReadLong
+      u32 pending = Cs2DataWordsPending();
+      units = MIN(units, pending > 0 ? pending - 1 : 0);
+   } else {
+      units = MIN(units, src.avail / 4);
+      if (src.base == dst.base && src.offset < dst.offset + units * 4 && dst.offset < src.offset + units * 4)
+         return 0;
+   }
+
+   unit_clock = MAX(getMemClock(sar), getMemClock(dar));
+   if (unit_clock > 0)
+      units = MIN(units, (u32)dmac->copy_clock / unit_clock);
+   if (units < DMA_BLOCK_MIN)
+      return 0;
+
+   if (!cs2_source)
+      MemorySpanSync(&src);
+   MemorySpanSync(&dst);
+   if (cs2_source) {
+      if (dst.t2)
+         Cs2RapidCopyT2(dst.ptr, units);
+      else
+         Cs2RapidCopyT1(dst.ptr, units);
+   } else {
+      MemorySpanCopy(&dst, &src, units * 4);
+      *dmac->SAR += units * 4;
+   }
+   MemorySpanWritten(&dst, units * 4);
+
+   *dmac->DAR += units * 4;
+   *dmac->TCR -= units;
+   dmac->penerly += units * unit_clock;
+   dmac->copy_clock -= units * unit_clock;
+   return units;
+}
+
 void DMATransferCycles(Dmac * dmac, int cycles ){
 
    u32 i = 0;
@@ -2429,6 +2497,7 @@ void DMATransferCycles(Dmac * dmac, int cycles ){
          case 2:
             destInc *= 4;
             srcInc *= 4;
+            i = DMATransferBlock(dmac, srcInc, destInc);
             while (dmac->copy_clock >= 0) {
                u32 val = MappedMemoryReadLongNocache(*dmac->SAR,&cycler);
 				       MappedMemoryWriteLongNocache(*dmac->DAR,val,&cycle);
@@ -2457,6 +2526,7 @@ void DMATransferCycles(Dmac * dmac, int cycles ){
          case 3:
            destInc *= 4;
            srcInc *= 4;
+           i = DMATransferBlock(dmac, srcInc, destInc);
            while (dmac->copy_clock >= 0) {
              u32 val = MappedMemoryReadLongNocache(*dmac->SAR,&cycler);
              MappedMemoryWriteLongNocache(*dmac->DAR, val,&cycle);
@@ -20,6 +20,8 @@
 */
 
 #include "scsp.h"
+#include "avcapture.h"
+#include "yabause.h"
 
 //////////////////////////////////////////////////////////////////////////////
 // Wave File Output Sound Interface
@@ -61,71 +63,30 @@ SNDWavMidiOut
 };
 
 char *wavefilename=NULL;
-static FILE *wavefp;
-
-typedef struct {
-   char id[4];
-   u32 size;
-} chunk_struct;
-
-typedef struct {
-   chunk_struct riff;
-   char rifftype[4];
-} waveheader_struct;
-
-typedef struct {
-   chunk_struct chunk;
-   u16 compress;
-   u16 numchan;
-   u32 rate;
-   u32 bytespersec;
-   u16 blockalign;
-   u16 bitspersample;
-} fmt_struct;
+static int wavecapture = 0;
+
+// There is no device, but the scsp still wants one that plays at 44.1 kHz.
+// A tenth of a second of buffer drains with the host clock.
+#define SNDWAV_BUFFER_SAMPLES (44100 / 10)
+static u64 wavestart = 0;
+static u64 wavewritten = 0;
 
 //////////////////////////////////////////////////////////////////////////////
 
+// The file is written by the capture thread, fed straight from the scsp
 static int SNDWavInit(void)
 {
-   waveheader_struct waveheader;
-   fmt_struct fmt;
-   chunk_struct data;
-   IOCheck_struct check = { 0, 0 };
-
-   if (wavefilename)
-   {
-
-      if ((wavefp = fopen(wavefilename, "wb")) == NULL)
-         return -1;
-   }
-   else
-   {
-      if ((wavefp = fopen("scsp.wav", "wb")) == NULL)
-         return -1;
-   }
-
-   // Do wave header
-   memcpy(waveheader.riff.id, "RIFF", 4);
-   waveheader.riff.size = 0; // we'll fix this after the file is closed
-   memcpy(waveheader.rifftype, "WAVE", 4);
-   ywrite(&check, (void *)&waveheader, 1, sizeof(waveheader_struct), wavefp);
-
-   // fmt chunk
-   memcpy(fmt.chunk.id, "fmt ", 4);
-   fmt.chunk.size = 16; // we'll fix this at the end
-   fmt.compress = 1; // PCM
-   fmt.numchan = 2; // Stereo
-   fmt.rate = 44100;
-   fmt.bitspersample = 16;
-   fmt.blockalign = fmt.bitspersample / 8 * fmt.numchan;
-   fmt.bytespersec = fmt.rate * fmt.blockalign;
-   ywrite(&check, (void *)&fmt, 1, sizeof(fmt_struct), wavefp);
-
-   // data chunk
-   memcpy(data.id, "data", 4);
-   data.size = 0; // we'll fix this at the end
-   ywrite(&check, (void *)&data, 1, sizeof(chunk_struct), wavefp);
+   wavestart = YabauseGetTicks();
+   wavewritten = 0;
+
+   // a capture set up by YabauseInit already takes the audio
+   if (AVCaptureIsRunning())
+      return 0;
 
+   if (AVCaptureStart(wavefilename ? wavefilename : "scsp.wav", AVCAPTURE_AUDIO_WAV, NULL) != 0)
+      return -1;
+
+   wavecapture = 1;
    return 0;
 }
 
@@ -133,21 +94,9 @@ static int SNDWavInit(void)
 
 static void SNDWavDeInit(void)
 {
-   if (wavefp)
-   {
-      long length = ftell(wavefp);
-      IOCheck_struct check = { 0, 0 };
-
-      // Let's fix the riff chunk size and the data chunk size
-      fseek(wavefp, sizeof(waveheader_struct)-0x8, SEEK_SET);
-      length -= 0x4;
-      ywrite(&check, (void *)&length, 1, 4, wavefp);
-
-      fseek(wavefp, sizeof(waveheader_struct)+sizeof(fmt_struct)+0x4, SEEK_SET);
-      length -= sizeof(waveheader_struct)+sizeof(fmt_struct);
-      ywrite(&check, (void *)&length, 1, 4, wavefp);
-      fclose(wavefp);
-   }
+   if (wavecapture)
+      AVCaptureStop();
+   wavecapture = 0;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -166,30 +115,32 @@ static int SNDWavChangeVideoFormat(UNUSED int vertfreq)
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void SNDWavUpdateAudio(u32 *leftchanbuffer, u32 *rightchanbuffer, u32 num_samples)
+// The capture takes the samples straight from the scsp, they're only counted
+static void SNDWavUpdateAudio(UNUSED u32 *leftchanbuffer, UNUSED u32 *rightchanbuffer, u32 num_samples)
 {
-   s16 stereodata16[44100 / 50];
-   ScspConvert32uto16s((s32 *)leftchanbuffer, (s32 *)rightchanbuffer, (s16 *)stereodata16, num_samples);
-   fwrite((void *)stereodata16, sizeof(s16) * 2, num_samples, wavefp);
+   wavewritten += num_samples;
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
 static u32 SNDWavGetAudioSpace(void)
 {
-   /* A "hack" to get sound core working enough
-    * so videos are not "freezing". Values have been
-    * found by experiments... I don't have a clue why
-    * they are working ^^;
-    */
-   static int i = 0;
-   i++;
-   if (i == 55) {
-      i = 0;
-      return 85;
-   } else {
+   u64 ticks, played;
+
+   if (yabsys.tickfreq == 0)
+      return SNDWAV_BUFFER_SAMPLES;
+
+   ticks = YabauseGetTicks() - wavestart;
+   played = ticks / yabsys.tickfreq * 44100 + ticks % yabsys.tickfreq * 44100 / yabsys.tickfreq;
+
+   // an underrun, the missing samples are not made up for
+   if (wavewritten < played)
+      wavewritten = played;
+
+   if (wavewritten - played >= SNDWAV_BUFFER_SAMPLES)
       return 0;
-   }
+
+   return SNDWAV_BUFFER_SAMPLES - (u32)(wavewritten - played);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -50,6 +50,14 @@ enum {
    YAB_THREAD_VIDSOFT_PRIORITY_3,
    YAB_THREAD_VIDSOFT_PRIORITY_4,
    YAB_THREAD_VIDSOFT_LAYER_SPRITE,
+   YAB_THREAD_VIDSOFT_VDP1_BAND_0,
+   YAB_THREAD_VIDSOFT_VDP1_BAND_1,
+   YAB_THREAD_VIDSOFT_VDP1_BAND_2,
+   YAB_THREAD_VDP2_ROTATION_BAND_0,
+   YAB_THREAD_VDP2_ROTATION_BAND_1,
+   YAB_THREAD_VDP2_ROTATION_BAND_2,
+   YAB_THREAD_BUPSYNC,
+   YAB_THREAD_AVCAPTURE,
    YAB_NUM_THREADS      // Total number of subthreads
 };
 
@@ -21,6 +21,7 @@
 #include "../vidshared.h"
 #include "../vidsoft.h"
 #include "../threads.h"
+#include "../trace.h"
 
 #include <stdlib.h>
 
@@ -51,6 +52,7 @@ static struct TitanContext {
    TitanTransFunc trans;
    struct PixelData * backscreen;
    int layer_priority[6];
+   Vdp2 * regs;
 } tt_context = {
    0,
    { NULL, NULL, NULL, NULL, NULL, NULL },
@@ -209,12 +211,15 @@ void TitanRenderSimplifiedCheck(pixel_t * buf, int start, int end, int can_use_s
 #define DECLARE_PRIORITY_THREAD(FUNC_NAME, THREAD_NUMBER) \
 void FUNC_NAME(void* data) \
 { \
+   TraceThreadName(#FUNC_NAME); \
    for (;;) \
    { \
       if (priority_thread_context.need_draw[THREAD_NUMBER]) \
       { \
          priority_thread_context.need_draw[THREAD_NUMBER] = 0; \
+         TRACE_BEGIN(TRACE_VIDSOFT_PRIORITY); \
          TitanRenderSimplifiedCheck(priority_thread_context.dispbuffer, priority_thread_context.lines[THREAD_NUMBER].start, priority_thread_context.lines[THREAD_NUMBER].end, priority_thread_context.use_simplified); \
+         TRACE_END(TRACE_VIDSOFT_PRIORITY); \
          priority_thread_context.draw_finished[THREAD_NUMBER] = 1; \
       } \
       YabThreadSleep(); \
@@ -347,7 +352,7 @@ finished:
       }
 
       //sprite self-shadowing, only if sprite window is not enabled
-      if (!(Vdp2Regs->SPCTL & 0x10))
+      if (!(tt_context.regs->SPCTL & 0x10))
          pixel_stack[0].pixel = TitanBlendPixelsTop(0x20000000, pixel_stack[0].pixel);
    }
    else if (pixel_stack[0].shadow_type == TITAN_NORMAL_SHADOW)
@@ -624,6 +629,11 @@ void TitanRenderThreads(pixel_t * dispbuffer, int can_use_simplified)
 }
 
 void TitanRender(pixel_t * dispbuffer)
+{
+   TitanRenderRegs(dispbuffer, Vdp2Regs);
+}
+
+void TitanRenderRegs(pixel_t * dispbuffer, Vdp2 * regs)
 {
    int can_use_simplified_rendering = 1;
 
@@ -632,27 +642,29 @@ void TitanRender(pixel_t * dispbuffer)
       return;
    }
 
+   tt_context.regs = regs;
+
    //using color calculation
-   if ((Vdp2Regs->CCCTL & 0x807f) != 0)
+   if ((regs->CCCTL & 0x807f) != 0)
       can_use_simplified_rendering = 0;
 
    //using special priority
-   if ((Vdp2Regs->SFPRMD & 0x3ff) != 0)
+   if ((regs->SFPRMD & 0x3ff) != 0)
       can_use_simplified_rendering = 0;
 
    //using line screen
-   if ((Vdp2Regs->LNCLEN & 0x1f) != 0)
+   if ((regs->LNCLEN & 0x1f) != 0)
       can_use_simplified_rendering = 0;
 
    //using shadow
-   if ((Vdp2Regs->SDCTL & 0x13F) != 0)
+   if ((regs->SDCTL & 0x13F) != 0)
       can_use_simplified_rendering = 0;
 
-   tt_context.layer_priority[TITAN_NBG0] = Vdp2Regs->PRINA & 0x7;
-   tt_context.layer_priority[TITAN_NBG1] = ((Vdp2Regs->PRINA >> 8) & 0x7);
-   tt_context.layer_priority[TITAN_NBG2] = (Vdp2Regs->PRINB & 0x7);
-   tt_context.layer_priority[TITAN_NBG3] = ((Vdp2Regs->PRINB >> 8) & 0x7);
-   tt_context.layer_priority[TITAN_RBG0] = (Vdp2Regs->PRIR & 0x7);
+   tt_context.layer_priority[TITAN_NBG0] = regs->PRINA & 0x7;
+   tt_context.layer_priority[TITAN_NBG1] = ((regs->PRINA >> 8) & 0x7);
+   tt_context.layer_priority[TITAN_NBG2] = (regs->PRINB & 0x7);
+   tt_context.layer_priority[TITAN_NBG3] = ((regs->PRINB >> 8) & 0x7);
+   tt_context.layer_priority[TITAN_RBG0] = (regs->PRIR & 0x7);
 
    if (vidsoft_num_priority_threads > 0)
    {
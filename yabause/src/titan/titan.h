@@ -55,6 +55,7 @@ void TitanPutPixel(int priority, s32 x, s32 y, u32 color, int linescreen, vdp2dr
 void TitanPutHLine(int priority, s32 x, s32 y, s32 width, u32 color);
 
 void TitanRender(pixel_t * dispbuffer);
+void TitanRenderRegs(pixel_t * dispbuffer, Vdp2 * regs);
 
 void TitanWriteColor(pixel_t * dispbuffer, s32 bufwidth, s32 x, s32 y, u32 color);
 
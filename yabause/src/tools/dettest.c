@@ -0,0 +1,130 @@
+/*******************************************************************************
+  DETTEST - Yabause determinism self-check tester
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+
+*******************************************************************************/
+
+// Runs a small counting loop on the master SH2 in lock-step mode while SCU
+// DMA copies the counter area to VDP1 and VDP2 RAM every frame, which goes
+// through the bulk DMA path. The first run records the per-frame hashes of
+// the determinism self-check, the second one must match them, and a third
+// one that changes a byte of VDP2 RAM behind the emulator's back must be
+// reported at that frame.
+
+// Usage: dettest [frames]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../core.h"
+#include "../cs0.h"
+#include "../memory.h"
+#include "../vdp2.h"
+#include "../yabause.h"
+#include "testboot.h"
+
+#define PROG_NAME "DETTEST"
+#define VER_NAME "1.00"
+
+#define SCU_REGS 0x25FE0000
+#define DMA_SIZE 0x1000
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Level 0 DMA started by the enable bit: 4 byte reads, 2 byte writes
+static void StartDma(u32 dst)
+{
+   MappedMemoryWriteLong(SCU_REGS + 0x14, 0x7, NULL);
+   MappedMemoryWriteLong(SCU_REGS + 0x00, TESTBOOT_COUNTER_ADDRESS, NULL);
+   MappedMemoryWriteLong(SCU_REGS + 0x04, dst, NULL);
+   MappedMemoryWriteLong(SCU_REGS + 0x08, DMA_SIZE, NULL);
+   MappedMemoryWriteLong(SCU_REGS + 0x0C, 0x101, NULL);
+   MappedMemoryWriteLong(SCU_REGS + 0x10, 0x101, NULL);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Returns the frame the self-check reported, 0 if it stayed quiet
+static int Run(const char *log, int frames, int poke_frame)
+{
+   int i;
+
+   if (TestBoot(CART_NONE, log) != 0)
+   {
+      printf("FAIL: unable to initialize\n");
+      exit(1);
+   }
+
+   for (i = 1; i <= frames && TestBootError[0] == '\0'; i++)
+   {
+      StartDma((i & 1) ? 0x25C00000 + (i & 0x3F) * DMA_SIZE : 0x25E00000 + (i & 0x3F) * DMA_SIZE);
+      if (i == poke_frame)
+         Vdp2Ram[0x7FFFF] ^= 0xFF;
+      YabauseExec();
+   }
+
+   YabauseDeInit();
+
+   if (TestBootError[0] == '\0')
+      return 0;
+
+   return i - 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+   const char *log = "dettest.log";
+   int frames = 20;
+   int poke_frame;
+   int frame;
+
+   if (argc > 2)
+      ProgramUsage(PROG_NAME, VER_NAME);
+
+   if (argc > 1)
+      frames = atoi(argv[1]);
+   if (frames < 2)
+      ProgramUsage(PROG_NAME, VER_NAME);
+
+   remove(log);
+
+   if ((frame = Run(log, frames, 0)) != 0)
+   {
+      printf("FAIL: recording run reported frame %d\n", frame);
+      return 1;
+   }
+
+   if ((frame = Run(log, frames, 0)) != 0)
+   {
+      printf("FAIL: identical run diverged at frame %d\n", frame);
+      return 1;
+   }
+
+   poke_frame = frames / 2;
+   if ((frame = Run(log, frames, poke_frame)) != poke_frame)
+   {
+      printf("FAIL: change at frame %d was reported at frame %d\n", poke_frame, frame);
+      return 1;
+   }
+
+   remove(log);
+   printf("PASS: %d frames identical, change at frame %d caught\n", frames, poke_frame);
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
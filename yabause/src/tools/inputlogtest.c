@@ -0,0 +1,257 @@
+/*******************************************************************************
+  INPUTLOGTEST - Yabause input log round trip tester
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+
+*******************************************************************************/
+
+// Runs a small counting loop on the master SH2 and records an input log
+// while the port data changes every few frames. The log is then played back
+// from several keyframes and frames in between, in no particular order: the
+// counter must be where it was when the frame was recorded and every frame
+// must get the port data it was recorded with. The same is done once more
+// with the index cleared from the header, like a recording that was never
+// stopped, so the keyframes have to be found by walking the file.
+
+// Usage: inputlogtest [frames]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../core.h"
+#include "../cs0.h"
+#include "../inputlog.h"
+#include "../peripheral.h"
+#include "../yabause.h"
+#include "testboot.h"
+
+#define PROG_NAME "INPUTLOGTEST"
+#define VER_NAME "1.00"
+
+#define KEYFRAME_INTERVAL 8
+
+//////////////////////////////////////////////////////////////////////////////
+
+// A pad that changes every 7 frames, with the size changing too
+static void SetPort(int frame)
+{
+   memset(PORTDATA1.data, 0, sizeof(PORTDATA1.data));
+   PORTDATA1.data[0] = 0xF1;
+   PORTDATA1.data[1] = 0x02;
+   PORTDATA1.data[2] = (u8)~(frame / 7);
+   PORTDATA1.data[3] = (u8)(frame / 7 * 3);
+   PORTDATA1.size = (frame / 7) & 1 ? 4 : 2;
+}
+
+static int PortMatches(int frame)
+{
+   PortData_struct expected;
+
+   memcpy(&expected, &PORTDATA1, sizeof(expected));
+   SetPort(frame);
+   if (PORTDATA1.size != expected.size ||
+       memcmp(PORTDATA1.data, expected.data, expected.size) != 0)
+      return 0;
+   return 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int Record(const char *log, u32 *counters, int frames)
+{
+   int i;
+
+   if (TestBoot(CART_NONE, NULL) != 0)
+   {
+      printf("FAIL: unable to initialize\n");
+      return 1;
+   }
+
+   if (InputLogRecord(log, KEYFRAME_INTERVAL) != 0)
+   {
+      printf("FAIL: unable to record %s\n", log);
+      YabauseDeInit();
+      return 1;
+   }
+
+   for (i = 0; i < frames; i++)
+   {
+      counters[i] = TestBootCounter();
+      SetPort(i);
+      YabauseExec();
+   }
+
+   InputLogStop();
+   YabauseDeInit();
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Seeks to the frame and plays a few frames from there
+static int CheckFrom(const u32 *counters, int frames, int frame)
+{
+   int i, end = frame + KEYFRAME_INTERVAL + 3;
+
+   if (InputLogSeek(frame) != 0)
+   {
+      printf("FAIL: unable to seek to frame %d\n", frame);
+      return 1;
+   }
+
+   if (end > frames)
+      end = frames;
+
+   for (i = frame; i < end; i++)
+   {
+      if (InputLogGetFrame() != (u32)i || TestBootCounter() != counters[i])
+      {
+         printf("FAIL: seek to %d, frame %d: counter %08X, recorded %08X\n",
+                frame, i, TestBootCounter(), counters[i]);
+         return 1;
+      }
+
+      // something for the log to overwrite
+      memset(&PORTDATA1, 0xA5, sizeof(PORTDATA1));
+      YabauseExec();
+
+      if (!PortMatches(i))
+      {
+         printf("FAIL: seek to %d, frame %d: port data differs\n", frame, i);
+         return 1;
+      }
+   }
+
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int Play(const char *name, const char *log, const u32 *counters, int frames, int indexed)
+{
+   const u32 *keyframes;
+   u32 num, i;
+   int ret = 1;
+
+   if (TestBoot(CART_NONE, NULL) != 0)
+   {
+      printf("FAIL: %s: unable to initialize\n", name);
+      return 1;
+   }
+
+   if (InputLogPlay(log) != 0)
+   {
+      printf("FAIL: %s: unable to play back %s\n", name, log);
+      goto done;
+   }
+
+   // without the index the frames after the last change of the port data
+   // are lost, they left nothing in the file
+   if (InputLogGetNumFrames() != (u32)frames &&
+       (indexed || InputLogGetNumFrames() > (u32)frames || InputLogGetNumFrames() + 7 < (u32)frames))
+   {
+      printf("FAIL: %s: %u frames, recorded %d\n", name, InputLogGetNumFrames(), frames);
+      goto done;
+   }
+   frames = InputLogGetNumFrames();
+
+   num = InputLogGetKeyframes(&keyframes);
+   if (num != (u32)(frames + KEYFRAME_INTERVAL - 1) / KEYFRAME_INTERVAL)
+   {
+      printf("FAIL: %s: %u keyframes\n", name, num);
+      goto done;
+   }
+
+   for (i = 0; i < num; i++)
+   {
+      if (keyframes[i] != i * KEYFRAME_INTERVAL)
+      {
+         printf("FAIL: %s: keyframe %u is at frame %u\n", name, i, keyframes[i]);
+         goto done;
+      }
+   }
+
+   {
+      const int targets[] = { 0, KEYFRAME_INTERVAL * 2, 5, KEYFRAME_INTERVAL + 3,
+                              frames - 1, KEYFRAME_INTERVAL, frames / 2 };
+
+      for (i = 0; i < sizeof(targets) / sizeof(targets[0]); i++)
+      {
+         if (CheckFrom(counters, frames, targets[i]) != 0)
+            goto done;
+      }
+   }
+
+   printf("PASS: %s, %d frames, %u keyframes, seeks matched the recording\n", name, frames, num);
+   ret = 0;
+
+done:
+   InputLogStop();
+   YabauseDeInit();
+   return ret;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Zeroes the index offset in the header
+static int DropIndex(const char *log)
+{
+   static const u8 zero[8] = { 0 };
+   FILE *fp = fopen(log, "r+b");
+   int ret;
+
+   if (fp == NULL)
+      return -1;
+
+   ret = fseek(fp, 16, SEEK_SET) == 0 && fwrite(zero, 1, 8, fp) == 8 ? 0 : -1;
+   fclose(fp);
+   return ret;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+   const char *log = "inputlogtest.yil";
+   int frames = 48;
+   u32 *counters;
+   int ret = 1;
+
+   if (argc > 2)
+      ProgramUsage(PROG_NAME, VER_NAME);
+
+   if (argc > 1)
+      frames = atoi(argv[1]);
+   if (frames < KEYFRAME_INTERVAL * 2 + 1)
+      ProgramUsage(PROG_NAME, VER_NAME);
+
+   if ((counters = (u32 *)malloc(frames * sizeof(u32))) == NULL)
+      return 1;
+
+   if (Record(log, counters, frames) == 0 &&
+       Play("indexed log", log, counters, frames, 1) == 0)
+   {
+      if (DropIndex(log) != 0)
+         printf("FAIL: unable to clear the index of %s\n", log);
+      else if (Play("log without index", log, counters, frames, 0) == 0)
+         ret = 0;
+   }
+
+   remove(log);
+   free(counters);
+   return ret;
+}
+
+//////////////////////////////////////////////////////////////////////////////
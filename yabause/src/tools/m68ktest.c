@@ -0,0 +1,405 @@
+/*******************************************************************************
+  M68KTEST - Yabause 68K core conformance tester
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+
+*******************************************************************************/
+
+// Without arguments, runs a small checksum program in sound RAM on every
+// compiled-in 68K core and checks the result against the same computation
+// done in C. The program is then patched through the SH2 side of sound RAM
+// and run again, which catches cores (like the q68 translator) that keep
+// executing stale code after WriteNotify.
+
+// With an SSF, plays it through Musashi and through q68, one frame (735
+// samples) at a time, and reports the first frame where the sound RAM or
+// the generated audio differ between the two cores.
+
+// Usage: m68ktest [file.ssf [frames]]
+
+// SPECIAL NOTE: for the SSF comparison q68 must be built with
+// Q68_EXACT_TIMING for the two runs to line up; its loose JIT timing shifts
+// interrupt delivery by a few cycles. The built-in program does not depend
+// on timing.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../core.h"
+#include "../cdbase.h"
+#include "../m68kcore.h"
+#include "../osdcore.h"
+#include "../peripheral.h"
+#include "../sh2core.h"
+#include "../scsp.h"
+#include "../vdp1.h"
+#ifdef YAB_WANT_SSF
+#include "../aosdk/ao.h"
+#include "../aosdk/ssf.h"
+#endif
+
+#define PROG_NAME "M68KTEST"
+#define VER_NAME "1.00"
+
+#define FRAME_SAMPLES 735
+
+#define PROGRAM_ADDRESS 0x1000
+#define PATCH_ADDRESS   0x100E
+#define DATA_ADDRESS    0x2000
+#define RESULT_ADDRESS  0x3000
+#define DATA_WORDS      256
+
+// reset vectors: SSP = 0x7000, PC = PROGRAM_ADDRESS
+static const u16 vectors[] = {
+   0x0000, 0x7000, 0x0000, PROGRAM_ADDRESS
+};
+
+//        moveq   #0,d0
+//        lea     DATA_ADDRESS.w,a0
+//        move.w  #DATA_WORDS-1,d1
+// loop:  add.w   (a0)+,d0
+//        rol.l   #3,d0
+//        eor.w   d1,d0            <- PATCH_ADDRESS
+//        dbra    d1,loop
+//        move.l  d0,RESULT_ADDRESS.w
+//        bra.s   *
+static const u16 program[] = {
+   0x7000, 0x41F8, DATA_ADDRESS, 0x323C, DATA_WORDS - 1,
+   0xD058, 0xE798, 0xB340, 0x51C9, 0xFFF8,
+   0x21C0, RESULT_ADDRESS, 0x60FE
+};
+
+#define OP_EOR_D1_D0 0xB340
+#define OP_ADD_D1_D0 0xD041
+
+typedef struct
+{
+   u32 dreg[8];
+   u32 areg[8];
+   u32 pc;
+   u32 sr;
+   u64 ramhash;
+   u64 audiohash;
+} frameinfo_struct;
+
+// Unused functions and variables
+SH2Interface_struct *SH2CoreList[] = {
+	NULL
+};
+
+VideoInterface_struct *VIDCoreList[] = {
+	NULL
+};
+
+SoundInterface_struct *SNDCoreList[] = {
+	&SNDDummy,
+	NULL
+};
+
+M68K_struct * M68KCoreList[] = {
+	&M68KDummy,
+#ifdef HAVE_MUSASHI
+	&M68KMusashi,
+#endif
+#ifdef HAVE_Q68
+	&M68KQ68,
+#endif
+	NULL
+};
+
+CDInterface *CDCoreList[] = {
+	NULL
+};
+
+PerInterface_struct *PERCoreList[] = {
+	NULL
+};
+
+OSD_struct *OSDCoreList[] = {
+	NULL
+};
+
+void YuiErrorMsg(const char *string) { }
+
+void YuiSwapBuffers() { }
+
+int YuiUseOGLOnThisThread() { return 0; }
+
+int YuiRevokeOGLOnThisThread() { return 0; }
+
+int YabauseThread_IsUseBios() { return 0; }
+
+void YabauseThread_coldBoot() { }
+
+const char * YabauseThread_getBackupPath() { return ""; }
+
+void YabauseThread_resetPlaymode() { }
+
+void YabauseThread_setBackupPath(const char * path) { }
+
+void YabauseThread_setUseBios(int use) { }
+
+//////////////////////////////////////////////////////////////////////////////
+
+void ProgramUsage()
+{
+   printf("%s v%s\n", PROG_NAME, VER_NAME);
+   printf("usage: %s [file.ssf [frames]]\n", PROG_NAME);
+   exit (1);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static u64 HashBytes(const void *data, size_t size)
+{
+   const u8 *p = (const u8 *)data;
+   u64 hash = 0xCBF29CE484222325ULL;
+   size_t i;
+
+   for (i = 0; i < size; i++)
+   {
+      hash ^= p[i];
+      hash *= 0x100000001B3ULL;
+   }
+
+   return hash;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static u16 DataWord(int i)
+{
+   return (u16)(i * 0x9E37 + 0x1234);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// What the program leaves at RESULT_ADDRESS, with op as the patched opcode
+static u32 ExpectedResult(u16 op)
+{
+   u32 d0 = 0;
+   int d1;
+
+   for (d1 = DATA_WORDS - 1; d1 >= 0; d1--)
+   {
+      d0 = (d0 & 0xFFFF0000) | ((d0 + DataWord(DATA_WORDS - 1 - d1)) & 0xFFFF);
+      d0 = (d0 << 3) | (d0 >> 29);
+      if (op == OP_EOR_D1_D0)
+         d0 ^= d1;
+      else
+         d0 = (d0 & 0xFFFF0000) | ((d0 + d1) & 0xFFFF);
+   }
+
+   return d0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Runs the program from the start in slices, like the sound thread does
+static u32 RunProgram(void)
+{
+   int i;
+
+   SoundRamWriteLong(RESULT_ADDRESS, 0);
+   M68K->SetPC(PROGRAM_ADDRESS);
+   for (i = 0; i < 100; i++)
+      M68K->Exec(1000);
+
+   return SoundRamReadLong(RESULT_ADDRESS);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int TestCore(M68K_struct *core)
+{
+   static const u16 ops[] = { OP_EOR_D1_D0, OP_ADD_D1_D0, OP_EOR_D1_D0 };
+   int ret = 0;
+   u32 result;
+   int i;
+
+   M68KInit(core->id);
+   if (ScspInit(SNDCORE_DUMMY, 1, 0) != 0)
+   {
+      printf("FAIL: %s: unable to initialize\n", core->Name);
+      return 1;
+   }
+
+   // Everything goes in through the SH2 side, as a game's sound driver would
+   for (i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++)
+      SoundRamWriteWord(i * 2, vectors[i]);
+   for (i = 0; i < sizeof(program) / sizeof(program[0]); i++)
+      SoundRamWriteWord(PROGRAM_ADDRESS + i * 2, program[i]);
+   for (i = 0; i < DATA_WORDS; i++)
+      SoundRamWriteWord(DATA_ADDRESS + i * 2, DataWord(i));
+
+   M68KStart();
+
+   for (i = 0; i < sizeof(ops) / sizeof(ops[0]); i++)
+   {
+      SoundRamWriteWord(PATCH_ADDRESS, ops[i]);
+
+      if ((result = RunProgram()) != ExpectedResult(ops[i]))
+      {
+         printf("FAIL: %s: run %d returned %08lX instead of %08lX\n", core->Name, i,
+                (unsigned long)result, (unsigned long)ExpectedResult(ops[i]));
+         ret = 1;
+         break;
+      }
+   }
+
+   if (ret == 0)
+      printf("PASS: %s, %d runs of the patched program correct\n", core->Name, i);
+
+   M68K->DeInit();
+   ScspDeInit();
+   return ret;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+#ifdef YAB_WANT_SSF
+static int RunCore(const char *filename, int coreid, frameinfo_struct *info, int frames)
+{
+   s16 buffer[FRAME_SAMPLES * 2];
+   int i, j;
+
+   if (!load_ssf((char *)filename, coreid, SNDCORE_DUMMY))
+   {
+      printf("unable to load %s\n", filename);
+      return -1;
+   }
+
+   if (M68K->id != coreid)
+   {
+      printf("68K core %d is not compiled in\n", coreid);
+      ScspDeInit();
+      return -1;
+   }
+
+   for (i = 0; i < frames; i++)
+   {
+      memset(buffer, 0, sizeof(buffer));
+      ssf_gen(buffer, FRAME_SAMPLES);
+
+      for (j = 0; j < 8; j++)
+      {
+         info[i].dreg[j] = M68K->GetDReg(j);
+         info[i].areg[j] = M68K->GetAReg(j);
+      }
+      info[i].pc = M68K->GetPC();
+      info[i].sr = M68K->GetSR();
+      info[i].ramhash = HashBytes(SoundRam, 0x80000);
+      info[i].audiohash = HashBytes(buffer, sizeof(buffer));
+   }
+
+   M68K->DeInit();
+   ScspDeInit();
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void PrintRegisters(const char *name, const frameinfo_struct *info)
+{
+   int i;
+
+   printf("%-8s PC=%06lX SR=%04lX", name, (unsigned long)info->pc, (unsigned long)info->sr);
+   for (i = 0; i < 8; i++)
+      printf(" D%d=%08lX", i, (unsigned long)info->dreg[i]);
+   printf("\n        ");
+   for (i = 0; i < 8; i++)
+      printf(" A%d=%08lX", i, (unsigned long)info->areg[i]);
+   printf("\n");
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int CompareSSF(int argc, char *argv[])
+{
+   frameinfo_struct *ref, *test;
+   int frames = 600;
+   int i;
+
+   if (argc > 2)
+      frames = atoi(argv[2]);
+   if (frames <= 0)
+      ProgramUsage();
+
+   ref = (frameinfo_struct *)calloc(frames, sizeof(frameinfo_struct));
+   test = (frameinfo_struct *)calloc(frames, sizeof(frameinfo_struct));
+   if (ref == NULL || test == NULL)
+      return 1;
+
+   if (RunCore(argv[1], M68KCORE_MUSASHI, ref, frames) != 0 ||
+       RunCore(argv[1], M68KCORE_Q68, test, frames) != 0)
+      return 1;
+
+   for (i = 0; i < frames; i++)
+   {
+      const char *what = NULL;
+
+      if (ref[i].ramhash != test[i].ramhash)
+         what = "sound RAM";
+      else if (ref[i].audiohash != test[i].audiohash)
+         what = "audio output";
+
+      if (what)
+      {
+         printf("FAIL: %s differs at frame %d\n", what, i);
+         PrintRegisters("musashi", &ref[i]);
+         PrintRegisters("q68", &test[i]);
+         free(ref);
+         free(test);
+         return 1;
+      }
+   }
+
+   printf("PASS: %d frames identical\n", frames);
+   free(ref);
+   free(test);
+   return 0;
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+   int ret = 0;
+   int i;
+
+   if (argc > 3)
+      ProgramUsage();
+
+   if (argc > 1)
+   {
+#ifdef YAB_WANT_SSF
+      return CompareSSF(argc, argv);
+#else
+      printf("SSF support is not compiled in\n");
+      return 1;
+#endif
+   }
+
+   for (i = 0; M68KCoreList[i] != NULL; i++)
+   {
+      if (M68KCoreList[i]->id != M68KCORE_DUMMY)
+         ret |= TestCore(M68KCoreList[i]);
+   }
+
+   return ret;
+}
+
+//////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,172 @@
+/*******************************************************************************
+  STATETEST - Yabause in-memory save state tester
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+
+*******************************************************************************/
+
+// Starts a small counting loop on the master SH2 through the emulated BIOS,
+// then checks that YabSaveStateMem gives the same bytes after a state is saved, the machine moves on, the
+// state is loaded back and saved again. Both the full and the fast load
+// path are checked, once without a cartridge and once with the 32 Mbit DRAM
+// cartridge, whose RAM is part of the state.
+
+// Usage: statetest [frames]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../core.h"
+#include "../cs0.h"
+#include "../yabause.h"
+#include "testboot.h"
+
+#define PROG_NAME "STATETEST"
+#define VER_NAME "1.00"
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void RunFrames(int frames)
+{
+   int i;
+
+   for (i = 0; i < frames; i++)
+      YabauseExec();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static size_t FirstDifference(const u8 *a, const u8 *b, size_t size)
+{
+   size_t i;
+
+   for (i = 0; i < size; i++)
+   {
+      if (a[i] != b[i])
+         break;
+   }
+
+   return i;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int TestCart(const char *name, int carttype, int frames)
+{
+   u8 *first, *second;
+   size_t size, used;
+   int fast, ret = 1;
+
+   if (TestBoot(carttype, NULL) != 0)
+   {
+      printf("FAIL: %s: unable to initialize\n", name);
+      return 1;
+   }
+
+   RunFrames(frames);
+
+   size = YabSaveStateMemSize();
+   first = (u8 *)malloc(size);
+   second = (u8 *)malloc(size);
+   if (size == 0 || first == NULL || second == NULL)
+   {
+      printf("FAIL: %s: no state size\n", name);
+      goto done;
+   }
+
+   for (fast = 0; fast < 2; fast++)
+   {
+      const char *mode = fast ? "fast load" : "full load";
+      size_t diff;
+
+      if (YabSaveStateMem(first, size, &used) != 0)
+      {
+         printf("FAIL: %s: unable to save a state of %lu bytes\n", name, (unsigned long)size);
+         goto done;
+      }
+
+      // Move the machine on so that the load has something to undo
+      RunFrames(frames / 2 + 1);
+
+      if (YabLoadStateMem(first, size, fast) != 0)
+      {
+         printf("FAIL: %s, %s: unable to load the state\n", name, mode);
+         goto done;
+      }
+
+      if (YabSaveStateMem(second, size, NULL) != 0)
+      {
+         printf("FAIL: %s, %s: unable to save the loaded state\n", name, mode);
+         goto done;
+      }
+
+      if ((diff = FirstDifference(first, second, size)) != size)
+      {
+         printf("FAIL: %s, %s: states differ at offset %08lX\n", name, mode, (unsigned long)diff);
+         goto done;
+      }
+
+      // The size is fixed by the cartridge, it must not grow as the game runs
+      if (YabSaveStateMemSize() != size)
+      {
+         printf("FAIL: %s, %s: state size changed from %lu to %lu bytes\n", name, mode,
+                (unsigned long)size, (unsigned long)YabSaveStateMemSize());
+         goto done;
+      }
+
+      RunFrames(frames / 2 + 1);
+   }
+
+   // A state for another cartridge would change the size, it is refused
+   memcpy(second, first, size);
+   ((s32 *)(second + 0x20))[0] = carttype == CART_NONE ? CART_DRAM32MBIT : CART_NONE;
+   if (YabLoadStateMem(second, size, 0) != -3)
+   {
+      printf("FAIL: %s: state for another cartridge was accepted\n", name);
+      goto done;
+   }
+
+   printf("PASS: %s, %lu byte states identical after load\n", name, (unsigned long)used);
+   ret = 0;
+
+done:
+   free(first);
+   free(second);
+   YabauseDeInit();
+   return ret;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+   int frames = 30;
+
+   if (argc > 2)
+      ProgramUsage(PROG_NAME, VER_NAME);
+
+   if (argc > 1)
+      frames = atoi(argv[1]);
+   if (frames <= 0)
+      ProgramUsage(PROG_NAME, VER_NAME);
+
+   if (TestCart("no cartridge", CART_NONE, frames) != 0 ||
+       TestCart("32 Mbit DRAM cartridge", CART_DRAM32MBIT, frames) != 0)
+      return 1;
+
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,161 @@
+/*******************************************************************************
+  TESTBOOT - shared setup of the headless Yabause testers
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../core.h"
+#include "../cdbase.h"
+#include "../cs0.h"
+#include "../m68kcore.h"
+#include "../memory.h"
+#include "../osdcore.h"
+#include "../peripheral.h"
+#include "../sh2core.h"
+#include "../sh2int.h"
+#include "../scsp.h"
+#include "../vdp1.h"
+#include "../yabause.h"
+#include "testboot.h"
+
+// loop: mov.l @r1,r0; add #1,r0; mov.l r0,@r1; bra loop; nop
+// with r1 loaded with TESTBOOT_COUNTER_ADDRESS first
+static const u16 program[] = {
+   0xD102, 0x6012, 0x7001, 0x2102, 0xAFFB, 0x0009, 0x0601, 0x0000
+};
+
+char TestBootError[256];
+
+SH2Interface_struct *SH2CoreList[] = {
+	&SH2Interpreter,
+	NULL
+};
+
+PerInterface_struct *PERCoreList[] = {
+	&PERDummy,
+	NULL
+};
+
+CDInterface *CDCoreList[] = {
+	&DummyCD,
+	NULL
+};
+
+SoundInterface_struct *SNDCoreList[] = {
+	&SNDDummy,
+	NULL
+};
+
+VideoInterface_struct *VIDCoreList[] = {
+	&VIDDummy,
+	NULL
+};
+
+M68K_struct * M68KCoreList[] = {
+	&M68KDummy,
+	NULL
+};
+
+// Unused functions and variables
+OSD_struct *OSDCoreList[] = {
+	NULL
+};
+
+void YuiErrorMsg(const char *string)
+{
+   snprintf(TestBootError, sizeof(TestBootError), "%s", string);
+   printf("%s\n", string);
+}
+
+void YuiSwapBuffers() { }
+
+int YuiUseOGLOnThisThread() { return 0; }
+
+int YuiRevokeOGLOnThisThread() { return 0; }
+
+int YabauseThread_IsUseBios() { return 0; }
+
+void YabauseThread_coldBoot() { }
+
+const char * YabauseThread_getBackupPath() { return ""; }
+
+void YabauseThread_resetPlaymode() { }
+
+void YabauseThread_setBackupPath(const char * path) { }
+
+void YabauseThread_setUseBios(int use) { }
+
+//////////////////////////////////////////////////////////////////////////////
+
+void ProgramUsage(const char *name, const char *version)
+{
+   printf("%s v%s\n", name, version);
+   printf("usage: %s [frames]\n", name);
+   exit (1);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int TestBoot(int carttype, const char *determinism_log)
+{
+   yabauseinit_struct yinit;
+   u32 i;
+
+   TestBootError[0] = '\0';
+
+   memset(&yinit, 0, sizeof(yinit));
+   yinit.percoretype = PERCORE_DUMMY;
+   yinit.sh2coretype = SH2CORE_INTERPRETER;
+   yinit.vidcoretype = VIDCORE_DUMMY;
+   yinit.m68kcoretype = M68KCORE_DUMMY;
+   yinit.sndcoretype = SNDCORE_DUMMY;
+   yinit.cdcoretype = CDCORE_DUMMY;
+   yinit.carttype = carttype;
+   yinit.regionid = REGION_AUTODETECT;
+   yinit.biospath = NULL;
+   yinit.videoformattype = VIDEOFORMATTYPE_NTSC;
+   yinit.clocksync = 1;
+   yinit.basetime = 0;
+   yinit.skip_load = 1;
+   yinit.deterministic = 1;
+   yinit.determinism_log = determinism_log;
+
+   if (YabauseInit(&yinit) != 0)
+      return -1;
+
+   YabauseResetNoLoad();
+   YabauseSpeedySetup();
+
+   for (i = 0; i < sizeof(program) / sizeof(program[0]); i++)
+      MappedMemoryWriteWord(TESTBOOT_PROGRAM_ADDRESS + i * 2, program[i], NULL);
+
+   SH2GetRegisters(MSH2, &MSH2->regs);
+   MSH2->regs.PC = TESTBOOT_PROGRAM_ADDRESS;
+   SH2SetRegisters(MSH2, &MSH2->regs);
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+u32 TestBootCounter(void)
+{
+   return T2ReadLong(HighWram, TESTBOOT_COUNTER_ADDRESS & 0xFFFFF);
+}
+
+//////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,45 @@
+/*******************************************************************************
+  TESTBOOT - shared setup of the headless Yabause testers
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+
+*******************************************************************************/
+
+// The core lists and front-end stubs the testers link against, and a boot
+// that starts a small counting loop on the master SH2 with dummy cores, no
+// BIOS and the lock-step deterministic mode.
+
+#ifndef TESTBOOT_H
+#define TESTBOOT_H
+
+#include "../core.h"
+
+#define TESTBOOT_PROGRAM_ADDRESS 0x06004000
+#define TESTBOOT_COUNTER_ADDRESS 0x06010000
+
+// Last message passed to YuiErrorMsg, empty if none since the last boot
+extern char TestBootError[256];
+
+void ProgramUsage(const char *name, const char *version);
+
+// Initializes the emulator with the given cartridge and writes the counting
+// loop to TESTBOOT_PROGRAM_ADDRESS. determinism_log may be NULL.
+// Returns 0 on success, -1 if YabauseInit failed.
+int TestBoot(int carttype, const char *determinism_log);
+
+// The long the loop increments at TESTBOOT_COUNTER_ADDRESS
+u32 TestBootCounter(void);
+
+#endif
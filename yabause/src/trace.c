@@ -0,0 +1,254 @@
+/*  This file is part of Yabause.
+
+    Yabause is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Yabause is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Yabause; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+/*! \file trace.c
+    \brief Runtime toggleable event tracer.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trace.h"
+#include "yabause.h"
+
+#ifdef _MSC_VER
+#include <windows.h>
+#define TRACE_TLS __declspec(thread)
+#define TRACE_ATOMIC_CLAIM(var) (InterlockedCompareExchange(&(var), 1, 0) == 0)
+#define TRACE_ATOMIC_RELEASE(var) InterlockedExchange(&(var), 0)
+#else
+#define TRACE_TLS __thread
+#define TRACE_ATOMIC_CLAIM(var) __sync_bool_compare_and_swap(&(var), 0, 1)
+#define TRACE_ATOMIC_RELEASE(var) __sync_lock_release(&(var))
+#endif
+
+#define TRACE_MAX_THREADS 32
+#define TRACE_RING_SIZE   (1 << 18) // events kept per thread, power of two
+
+typedef struct
+{
+   u64 time;
+   u16 probe;
+   char phase;
+} traceevent_struct;
+
+typedef struct
+{
+   char name[32];
+   volatile long owned;       // nonzero while a thread writes to it
+   u32 generation;            // session the events belong to
+   u32 count;                 // events written this session, only the owner writes
+   traceevent_struct * events;
+} tracebuffer_struct;
+
+volatile int TraceEnabled = 0;
+
+static tracebuffer_struct trace_buffers[TRACE_MAX_THREADS];
+static tracebuffer_struct trace_dropped;   // threads that didn't get a buffer
+static volatile u32 trace_generation = 0;
+static u64 trace_start_time = 0;
+
+static TRACE_TLS tracebuffer_struct * trace_local = NULL;
+static TRACE_TLS const char * trace_local_name = NULL;
+
+static const char * const trace_probe_names[TRACE_NUM_PROBES] = {
+   "Frame",
+   "SH2Exec",
+   "ScuExec",
+   "SmpcExec",
+   "Cs2Exec",
+   "M68KExec",
+   "ScspExec",
+   "SyncCPUtoSCSP",
+   "SCSP wait for frame start",
+   "HBlank",
+   "VBlankIN",
+   "VBlankOUT",
+   "VDP1 draw",
+   "VDP1 band",
+   "VDP1 wait",
+   "VDP2 layer",
+   "Priority render",
+   "Rotation band",
+   "VDP1 direct draw",
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Called once per thread, on its first event. Every thread gets a slot of
+// its own, even threads with the same name, since only the owner may write
+// to a buffer. Slots given back by TraceThreadExit are reused, so restarting
+// the video or sound threads doesn't use them up.
+static tracebuffer_struct * TraceClaimBuffer(void)
+{
+   tracebuffer_struct * buf;
+   long i;
+
+   for (i = 0; i < TRACE_MAX_THREADS; i++)
+   {
+      if (TRACE_ATOMIC_CLAIM(trace_buffers[i].owned))
+         break;
+   }
+
+   if (i >= TRACE_MAX_THREADS)
+      return &trace_dropped;
+
+   buf = &trace_buffers[i];
+   if (buf->events == NULL)
+      buf->events = (traceevent_struct *)malloc(TRACE_RING_SIZE * sizeof(traceevent_struct));
+   if (buf->events == NULL)
+   {
+      TRACE_ATOMIC_RELEASE(buf->owned);
+      return &trace_dropped;
+   }
+
+   if (trace_local_name != NULL)
+      snprintf(buf->name, sizeof(buf->name), "%s", trace_local_name);
+   else
+      snprintf(buf->name, sizeof(buf->name), "thread %ld", i);
+
+   // Whatever a previous owner left belongs to a thread that is gone
+   buf->generation = trace_generation;
+   buf->count = 0;
+
+   return buf;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void TraceEvent(int probe, char phase)
+{
+   tracebuffer_struct * buf = trace_local;
+   traceevent_struct * event;
+
+   if (buf == NULL)
+      buf = trace_local = TraceClaimBuffer();
+
+   if (buf->events == NULL)
+      return;
+
+   if (buf->generation != trace_generation)
+   {
+      buf->generation = trace_generation;
+      buf->count = 0;
+   }
+
+   event = &buf->events[buf->count & (TRACE_RING_SIZE - 1)];
+   event->time = YabauseGetTicks();
+   event->probe = (u16)probe;
+   event->phase = phase;
+   buf->count++;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Names the calling thread in the trace. Call it at the start of the thread
+// function, the name must stay valid while the thread runs.
+void TraceThreadName(const char * name)
+{
+   if (trace_local_name == name)
+      return;
+
+   trace_local_name = name;
+
+   if (trace_local != NULL && trace_local != &trace_dropped)
+      snprintf(trace_local->name, sizeof(trace_local->name), "%s", name);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Gives the calling thread's buffer back for the next thread to claim. Call
+// it before a thread function returns. The events stay in the buffer until
+// then, so a trace written afterwards still shows them.
+void TraceThreadExit(void)
+{
+   tracebuffer_struct * buf = trace_local;
+
+   trace_local = NULL;
+   trace_local_name = NULL;
+
+   if (buf != NULL && buf != &trace_dropped)
+      TRACE_ATOMIC_RELEASE(buf->owned);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int TraceStart(void)
+{
+   trace_start_time = YabauseGetTicks();
+   trace_generation++;
+   TraceEnabled = 1;
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void TraceStop(void)
+{
+   TraceEnabled = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Writes the newest events of every thread in the Chrome trace event format.
+// Call it after TraceStop, events being written meanwhile may come out torn.
+int TraceWrite(const char * filename)
+{
+   FILE * fp;
+   long i;
+   int first = 1;
+   double scale = 1000000.0 / (yabsys.tickfreq ? yabsys.tickfreq : 1000000);
+
+   if ((fp = fopen(filename, "w")) == NULL)
+      return -1;
+
+   fprintf(fp, "{\"traceEvents\":[\n");
+
+   for (i = 0; i < TRACE_MAX_THREADS; i++)
+   {
+      tracebuffer_struct * buf = &trace_buffers[i];
+      u32 j, start;
+
+      if (buf->events == NULL || buf->generation != trace_generation)
+         continue;
+
+      fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%ld,\"args\":{\"name\":\"%s\"}}",
+         first ? "" : ",\n", i, buf->name);
+      first = 0;
+
+      start = buf->count > TRACE_RING_SIZE ? buf->count - TRACE_RING_SIZE : 0;
+
+      for (j = start; j < buf->count; j++)
+      {
+         traceevent_struct * event = &buf->events[j & (TRACE_RING_SIZE - 1)];
+
+         if (event->probe >= TRACE_NUM_PROBES || event->time < trace_start_time)
+            continue;
+
+         fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"yabause\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%ld}",
+            trace_probe_names[event->probe], event->phase,
+            (double)(event->time - trace_start_time) * scale, i);
+      }
+   }
+
+   fprintf(fp, "\n],\"displayTimeUnit\":\"ms\"}\n");
+   fclose(fp);
+
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,78 @@
+/*  This file is part of Yabause.
+
+    Yabause is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Yabause is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Yabause; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+/*! \file trace.h
+    \brief Runtime toggleable event tracer.
+
+    Probes are always compiled in. While tracing is off a probe is a single
+    test of TraceEnabled. While it is on, each thread appends begin/end
+    events to a ring buffer of its own, so probes never take a lock. The
+    newest events of every thread can be written out in the Chrome trace
+    event format, which chrome://tracing and Perfetto can open.
+*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum
+{
+   TRACE_FRAME = 0,
+   TRACE_SH2_EXEC,
+   TRACE_SCU_EXEC,
+   TRACE_SMPC_EXEC,
+   TRACE_CS2_EXEC,
+   TRACE_M68K_EXEC,
+   TRACE_SCSP_EXEC,
+   TRACE_SCSP_SYNC_WAIT,
+   TRACE_SCSP_FRAME_WAIT,
+   TRACE_VDP2_HBLANK,
+   TRACE_VDP2_VBLANKIN,
+   TRACE_VDP2_VBLANKOUT,
+   TRACE_VIDSOFT_VDP1,
+   TRACE_VIDSOFT_VDP1_BAND,
+   TRACE_VIDSOFT_VDP1_WAIT,
+   TRACE_VIDSOFT_LAYER,
+   TRACE_VIDSOFT_PRIORITY,
+   TRACE_VDP2_ROTATION_BAND,
+   TRACE_VDP1_DIRECT_DRAW,
+   TRACE_NUM_PROBES
+};
+
+extern volatile int TraceEnabled;
+
+#define TRACE_BEGIN(probe) do { if (TraceEnabled) TraceEvent((probe), 'B'); } while (0)
+#define TRACE_END(probe) do { if (TraceEnabled) TraceEvent((probe), 'E'); } while (0)
+
+void TraceEvent(int probe, char phase);
+void TraceThreadName(const char * name);
+void TraceThreadExit(void);
+
+int TraceStart(void);
+void TraceStop(void);
+int TraceWrite(const char * filename);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
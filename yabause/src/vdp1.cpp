@@ -69,6 +69,7 @@ extern VideoInterface_struct *VIDCoreList[];
 extern YabEventQueue * rcv_evqueue;
 Vdp1 * Vdp1Regs;
 Vdp1External_struct Vdp1External = { 0 };
+u32 Vdp1RamPageGen[VDP1_RAM_PAGE_COUNT] = { 0 };
 }
 
 atomic<int> vdp1_clock{ 0 };
@@ -98,6 +99,7 @@ void Vdp1_onHblank() {
 //////////////////////////////////////////////////////////////////////////////
 
 extern "C" u8 FASTCALL Vdp1RamReadByte(u32 addr) {
+   Vdp2LockStepSync();
    addr &= 0x7FFFF;
    return T1ReadByte(Vdp1Ram, addr);
 }
@@ -105,6 +107,7 @@ extern "C" u8 FASTCALL Vdp1RamReadByte(u32 addr) {
 //////////////////////////////////////////////////////////////////////////////
 
 extern "C" u16 FASTCALL Vdp1RamReadWord(u32 addr) {
+    Vdp2LockStepSync();
     addr &= 0x07FFFF;
     return T1ReadWord(Vdp1Ram, addr);
 }
@@ -112,6 +115,7 @@ extern "C" u16 FASTCALL Vdp1RamReadWord(u32 addr) {
 //////////////////////////////////////////////////////////////////////////////
 
 extern "C" u32 FASTCALL Vdp1RamReadLong(u32 addr) {
+   Vdp2LockStepSync();
    addr &= 0x7FFFF;
    return T1ReadLong(Vdp1Ram, addr);
 }
@@ -119,30 +123,87 @@ extern "C" u32 FASTCALL Vdp1RamReadLong(u32 addr) {
 //////////////////////////////////////////////////////////////////////////////
 
 extern "C" void FASTCALL Vdp1RamWriteByte(u32 addr, u8 val) {
+   Vdp2LockStepSync();
    addr &= 0x7FFFF;
    T1WriteByte(Vdp1Ram, addr, val);
+   Vdp1RamPageGen[addr >> VDP1_RAM_PAGE_SHIFT]++;
    vdp1_clock = 0;
 }
 
 //////////////////////////////////////////////////////////////////////////////
 extern "C" void FASTCALL Vdp1RamWriteWord(u32 addr, u16 val) {
+   Vdp2LockStepSync();
    addr &= 0x7FFFF;
    T1WriteWord(Vdp1Ram, addr, val);
+   Vdp1RamPageGen[addr >> VDP1_RAM_PAGE_SHIFT]++;
    vdp1_clock = 0;
 }
 
 //////////////////////////////////////////////////////////////////////////////
 extern "C" void FASTCALL Vdp1RamWriteLong(u32 addr, u32 val) {
+   Vdp2LockStepSync();
    addr &= 0x7FFFF;
    //if(addr == 0x00000)
    //LOG("Vdp1RamWriteLong @ %08X", CurrentSH2->regs.PC);
    T1WriteLong(Vdp1Ram, addr, val);
+   Vdp1RamPageGen[addr >> VDP1_RAM_PAGE_SHIFT]++;
    vdp1_clock = 0;
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
+// For block writes that bypass Vdp1RamWrite*: same side effects, once per range
+extern "C" void Vdp1RamWriteNotify(u32 addr, u32 size) {
+   Vdp1RamMarkDirty(addr, size);
+   vdp1_clock = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+extern "C" void Vdp1RamMarkDirty(u32 addr, u32 size) {
+   u32 page;
+   u32 count;
+   if (size == 0)
+      return;
+   if (size > 0x80000)
+      size = 0x80000;
+   page = (addr & 0x7FFFF) >> VDP1_RAM_PAGE_SHIFT;
+   count = ((((addr & 0x7FFFF) + size - 1) >> VDP1_RAM_PAGE_SHIFT) - page) + 1;
+   if (count > VDP1_RAM_PAGE_COUNT)
+      count = VDP1_RAM_PAGE_COUNT;
+   while (count--) {
+      Vdp1RamPageGen[page]++;
+      page = (page + 1) & (VDP1_RAM_PAGE_COUNT - 1);
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Generation counters only ever increase, so the sum over a range changes
+// whenever any page in the range has been written.
+extern "C" u32 Vdp1RamPageGenSum(const u32 * pagegen, u32 addr, u32 size) {
+   u32 page;
+   u32 count;
+   u32 sum = 0;
+   if (size == 0)
+      return 0;
+   if (size > 0x80000)
+      size = 0x80000;
+   page = (addr & 0x7FFFF) >> VDP1_RAM_PAGE_SHIFT;
+   count = ((((addr & 0x7FFFF) + size - 1) >> VDP1_RAM_PAGE_SHIFT) - page) + 1;
+   if (count > VDP1_RAM_PAGE_COUNT)
+      count = VDP1_RAM_PAGE_COUNT;
+   while (count--) {
+      sum += pagegen[page];
+      page = (page + 1) & (VDP1_RAM_PAGE_COUNT - 1);
+   }
+   return sum;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 extern "C" u8 FASTCALL Vdp1FrameBufferReadByte(u32 addr) {
+   Vdp2LockStepSync();
    addr &= 0x3FFFF;
    //if (VIDCore->Vdp1ReadFrameBuffer && addr < 0x30000 ){
    //  u8 val;
@@ -157,6 +218,7 @@ extern "C" u8 FASTCALL Vdp1FrameBufferReadByte(u32 addr) {
 //////////////////////////////////////////////////////////////////////////////
 
 extern "C" u16 FASTCALL Vdp1FrameBufferReadWord(u32 addr) {
+   Vdp2LockStepSync();
    addr &= 0x3FFFF;
    if (VIDCore->Vdp1ReadFrameBuffer ){
      u16 val;
@@ -171,6 +233,7 @@ extern "C" u16 FASTCALL Vdp1FrameBufferReadWord(u32 addr) {
 //////////////////////////////////////////////////////////////////////////////
 
 extern "C" u32 FASTCALL Vdp1FrameBufferReadLong(u32 addr) {
+   Vdp2LockStepSync();
    addr &= 0x3FFFF;
    if (VIDCore->Vdp1ReadFrameBuffer ){
      u32 val;
@@ -185,6 +248,7 @@ extern "C" u32 FASTCALL Vdp1FrameBufferReadLong(u32 addr) {
 //////////////////////////////////////////////////////////////////////////////
 
 extern "C" void FASTCALL Vdp1FrameBufferWriteByte(u32 addr, u8 val) {
+   Vdp2LockStepSync();
    addr &= 0x3FFFF;
 
    if (VIDCore->Vdp1WriteFrameBuffer)
@@ -200,6 +264,7 @@ extern "C" void FASTCALL Vdp1FrameBufferWriteByte(u32 addr, u8 val) {
 //////////////////////////////////////////////////////////////////////////////
 
 extern "C" void FASTCALL Vdp1FrameBufferWriteWord(u32 addr, u16 val) {
+   Vdp2LockStepSync();
    addr &= 0x3FFFF;
 
    if (VIDCore->Vdp1WriteFrameBuffer)
@@ -215,6 +280,7 @@ extern "C" void FASTCALL Vdp1FrameBufferWriteWord(u32 addr, u16 val) {
 //////////////////////////////////////////////////////////////////////////////
 
 extern "C" void FASTCALL Vdp1FrameBufferWriteLong(u32 addr, u32 val) {
+   Vdp2LockStepSync();
    addr &= 0x3FFFF;
 
    if (VIDCore->Vdp1WriteFrameBuffer)
@@ -352,6 +418,7 @@ extern "C" void Vdp1Reset(void) {
 
    // Safe tarminator for Radient silvergun with no bios
    T1WriteWord(Vdp1Ram, 0x40000, 0x8000);
+   Vdp1RamMarkDirty(0, 0x80000);
 
    vdp1_clock = 0;
 
@@ -375,6 +442,7 @@ extern "C" u8 FASTCALL Vdp1ReadByte(u32 addr) {
 //////////////////////////////////////////////////////////////////////////////
 
 extern "C" u16 FASTCALL Vdp1ReadWord(u32 addr) {
+   Vdp2LockStepSync();
    addr &= 0xFF;
    switch(addr) {
       case 0x10:
@@ -417,6 +485,7 @@ extern YabEventQueue * vdp1_rcv_evqueue;
 //////////////////////////////////////////////////////////////////////////////
 
 extern "C" void FASTCALL Vdp1WriteWord(u32 addr, u16 val) {
+  Vdp2LockStepSync();
   addr &= 0xFF;
   switch(addr) {
     case 0x0:
@@ -459,6 +528,7 @@ extern "C" void FASTCALL Vdp1WriteWord(u32 addr, u16 val) {
         if (yabsys.wait_line_count == 5) { yabsys.wait_line_count = 4; }
         FRAMELOG("SET DIRECT WAIT %d", yabsys.wait_line_count);
         YabAddEventQueue(evqueue,VDPEV_DIRECT_DRAW); 
+        Vdp2LockStepMark();
         YabThreadYield();
       }
 #else
@@ -722,6 +792,199 @@ extern "C" void Vdp1FakeDrawCommands(u8 * ram, Vdp1 * regs)
 }
 
 
+//////////////////////////////////////////////////////////////////////////////
+
+static void Vdp1EntryBounds(vdp1cmdentry_struct * e, const s32 * x, const s32 * y, int n)
+{
+   int i;
+   e->minx = e->maxx = x[0];
+   e->miny = e->maxy = y[0];
+   for (i = 1; i < n; i++) {
+      if (x[i] < e->minx) e->minx = x[i];
+      if (x[i] > e->maxx) e->maxx = x[i];
+      if (y[i] < e->miny) e->miny = y[i];
+      if (y[i] > e->maxy) e->maxy = y[i];
+   }
+
+   // the renderers do their vertex math in 16 bits, a box this far out
+   // may have wrapped around, so let it cover everything
+   if (e->minx < -0x4000 || e->miny < -0x4000 || e->maxx > 0x3FFF || e->maxy > 0x3FFF) {
+      e->minx = e->miny = -0x7FFFFFFF;
+      e->maxx = e->maxy = 0x7FFFFFFF;
+   }
+}
+
+static void Vdp1EntryComputeBounds(vdp1cmdentry_struct * e)
+{
+   const vdp1cmd_struct * cmd = &e->cmd;
+   s32 lx = e->localX;
+   s32 ly = e->localY;
+   s32 x[4], y[4];
+
+   switch (cmd->CMDCTRL & 0x000F) {
+   case 0: // normal sprite draw
+   {
+      s32 w = ((cmd->CMDSIZE >> 8) & 0x3F) * 8;
+      s32 h = cmd->CMDSIZE & 0xFF;
+      x[0] = cmd->CMDXA + lx;
+      y[0] = cmd->CMDYA + ly;
+      x[1] = x[0] + (w > 0 ? w - 1 : 0);
+      y[1] = y[0] + (h > 0 ? h - 1 : 0);
+      Vdp1EntryBounds(e, x, y, 2);
+      break;
+   }
+   case 1: // scaled sprite draw
+      x[0] = cmd->CMDXA + lx;
+      y[0] = cmd->CMDYA + ly;
+      switch ((cmd->CMDCTRL >> 8) & 0xF) {
+      case 0x5: case 0x6: case 0x7:
+      case 0x9: case 0xA: case 0xB:
+      case 0xD: case 0xE: case 0xF:
+         // zoom point, the sprite extends by at most CMDXB/CMDYB around it
+         x[1] = x[0] - (s32)cmd->CMDXB - 1;
+         y[1] = y[0] - (s32)cmd->CMDYB - 1;
+         x[2] = x[0] + (s32)cmd->CMDXB + 1;
+         y[2] = y[0] + (s32)cmd->CMDYB + 1;
+         Vdp1EntryBounds(e, x, y, 3);
+         break;
+      default: // two coordinates
+         x[1] = cmd->CMDXC + lx;
+         y[1] = cmd->CMDYC + ly;
+         Vdp1EntryBounds(e, x, y, 2);
+         break;
+      }
+      break;
+   case 6: // line draw
+      x[0] = cmd->CMDXA + lx; y[0] = cmd->CMDYA + ly;
+      x[1] = cmd->CMDXB + lx; y[1] = cmd->CMDYB + ly;
+      Vdp1EntryBounds(e, x, y, 2);
+      break;
+   default: // distorted sprite, polygon, polyline
+      x[0] = cmd->CMDXA + lx; y[0] = cmd->CMDYA + ly;
+      x[1] = cmd->CMDXB + lx; y[1] = cmd->CMDYB + ly;
+      x[2] = cmd->CMDXC + lx; y[2] = cmd->CMDYC + ly;
+      x[3] = cmd->CMDXD + lx; y[3] = cmd->CMDYD + ly;
+      Vdp1EntryBounds(e, x, y, 4);
+      break;
+   }
+}
+
+// Walks the command list the same way Vdp1DrawCommands does, but instead of
+// drawing it records every drawing command together with the clipping and
+// local coordinate state it runs with. Clipping and local coordinate
+// commands are applied to regs, so regs ends in the same state as after a
+// real draw. Returns the number of drawing commands in the list.
+extern "C" int Vdp1ParseCommands(u8 * ram, Vdp1 * regs, vdp1cmdlist_struct * list)
+{
+   u16 command;
+   int command_count = 0;
+   u32 returnAddr = 0xffffffff;
+
+   list->count = 0;
+   list->finished = 1;
+
+   regs->COPR = regs->addr >> 3;
+   if (regs->addr > 0x7FFFF)
+      return 0; // address error
+
+   command = T1ReadWord(ram, regs->addr);
+   if (command & 0x8000)
+      return 0;
+
+   while (!(command & 0x8000) && command_count < VDP1_MAX_COMMANDS) {
+      regs->COPR = regs->addr >> 3;
+
+      if (!(command & 0x4000)) { // if (!skip)
+         switch (command & 0x000F) {
+         case 0: // normal sprite draw
+         case 1: // scaled sprite draw
+         case 2: // distorted sprite draw
+         case 3: // invalid, used as distorted sprite
+         case 4: // polygon draw
+         case 5: // polyline draw
+         case 6: // line draw
+         case 7: // undocumented polyline draw mirror
+         {
+            vdp1cmdentry_struct * e = &list->entries[list->count++];
+            e->addr = regs->addr;
+            Vdp1ReadCommand(&e->cmd, regs->addr, ram);
+            e->localX = regs->localX;
+            e->localY = regs->localY;
+            e->systemclipX2 = regs->systemclipX2;
+            e->systemclipY2 = regs->systemclipY2;
+            e->userclipX1 = regs->userclipX1;
+            e->userclipY1 = regs->userclipY1;
+            e->userclipX2 = regs->userclipX2;
+            e->userclipY2 = regs->userclipY2;
+            Vdp1EntryComputeBounds(e);
+            break;
+         }
+         case 8: // user clipping coordinates
+         case 11: // undocumented mirror
+            regs->userclipX1 = T1ReadWord(ram, regs->addr + 0xC);
+            regs->userclipY1 = T1ReadWord(ram, regs->addr + 0xE);
+            regs->userclipX2 = T1ReadWord(ram, regs->addr + 0x14);
+            regs->userclipY2 = T1ReadWord(ram, regs->addr + 0x16);
+            break;
+         case 9: // system clipping coordinates
+            regs->systemclipX1 = 0;
+            regs->systemclipY1 = 0;
+            regs->systemclipX2 = T1ReadWord(ram, regs->addr + 0x14);
+            regs->systemclipY2 = T1ReadWord(ram, regs->addr + 0x16);
+            break;
+         case 10: // local coordinate
+            regs->localX = T1ReadWord(ram, regs->addr + 0xC);
+            regs->localY = T1ReadWord(ram, regs->addr + 0xE);
+            break;
+         default: // Abort
+            regs->EDSR |= 2;
+            regs->LOPR = regs->addr >> 3;
+            regs->COPR = regs->addr >> 3;
+            return list->count;
+         }
+      }
+
+      // Next, determine where to go next
+      switch ((command & 0x3000) >> 12) {
+      case 0: // NEXT, jump to following table
+         regs->addr += 0x20;
+         break;
+      case 1: // ASSIGN, jump to CMDLINK
+         regs->addr = T1ReadWord(ram, regs->addr + 2) * 8;
+         break;
+      case 2: // CALL, call a subroutine
+         if (returnAddr == 0xFFFFFFFF)
+            returnAddr = regs->addr + 0x20;
+         regs->addr = T1ReadWord(ram, regs->addr + 2) * 8;
+         break;
+      case 3: // RETURN, return from subroutine
+         if (returnAddr != 0xFFFFFFFF) {
+            regs->addr = returnAddr;
+            returnAddr = 0xFFFFFFFF;
+         }
+         else
+            regs->addr += 0x20;
+         break;
+      }
+
+      // Bad address, it would loop forever
+      if (regs->addr == 0)
+         return list->count;
+
+      command = T1ReadWord(ram, regs->addr & 0x7FFFF);
+      command_count++;
+      if (command & 0x8000) {
+         regs->LOPR = regs->addr >> 3;
+         regs->COPR = regs->addr >> 3;
+      }
+   }
+
+   if (!(command & 0x8000))
+      list->finished = 0; // ran into the command limit
+
+   return list->count;
+}
+
 int Vdp1GenerateCCode() {
 
   FILE * regfp = fopen("v1reg.c", "w");
@@ -890,7 +1153,7 @@ extern "C" int Vdp1LoadState(FILE *fp, UNUSED int version, int size)
    yread(&check, (void *)Vdp1Regs, sizeof(Vdp1), 1, fp);
 
    // Read VDP1 ram
-   yread(&check, (void *)Vdp1Ram, 0x80000, 1, fp);
+   StateReadPages(&check, fp, Vdp1Ram, 0x80000, VDP1_RAM_PAGE_SHIFT, Vdp1RamMarkDirty);
 
 #ifdef IMPROVED_SAVESTATES
 
@@ -125,6 +125,17 @@ extern VideoInterface_struct VIDDummy;
 
 extern u8 * Vdp1Ram;
 
+// VDP1 RAM write tracking. Every write bumps the generation counter of the
+// page it lands in, so renderers can tell whether decoded data is stale.
+#define VDP1_RAM_PAGE_SHIFT 10
+#define VDP1_RAM_PAGE_COUNT (0x80000 >> VDP1_RAM_PAGE_SHIFT)
+
+extern u32 Vdp1RamPageGen[VDP1_RAM_PAGE_COUNT];
+
+void Vdp1RamMarkDirty(u32 addr, u32 size);
+void Vdp1RamWriteNotify(u32 addr, u32 size);
+u32 Vdp1RamPageGenSum(const u32 * pagegen, u32 addr, u32 size);
+
 u8 FASTCALL	Vdp1RamReadByte(u32);
 u16 FASTCALL	Vdp1RamReadWord(u32);
 u32 FASTCALL	Vdp1RamReadLong(u32);
@@ -158,6 +169,7 @@ typedef struct {
    int swap_frame_buffer;
    int current_frame;
    int status;
+   int vblank_swap;  // frame buffer swap latched at VBLANK-IN (software core)
 } Vdp1External_struct;
 
 extern Vdp1External_struct Vdp1External;
@@ -196,9 +208,41 @@ void FASTCALL	Vdp1WriteByte(u32, u8);
 void FASTCALL	Vdp1WriteWord(u32, u16);
 void FASTCALL	Vdp1WriteLong(u32, u32);
 
+#define VDP1_MAX_COMMANDS 4096
+
+// One drawing command of a parsed command list. The clipping and local
+// coordinate values are the ones in effect when the command runs, and the
+// bounding box is in framebuffer coordinates with the local offset applied.
+// Commands whose box can't be trusted get a box covering everything.
+typedef struct
+{
+   u32 addr;
+   vdp1cmd_struct cmd;
+   s16 localX;
+   s16 localY;
+   u16 systemclipX2;
+   u16 systemclipY2;
+   u16 userclipX1;
+   u16 userclipY1;
+   u16 userclipX2;
+   u16 userclipY2;
+   s32 minx;
+   s32 miny;
+   s32 maxx;
+   s32 maxy;
+} vdp1cmdentry_struct;
+
+typedef struct
+{
+   int count;
+   int finished;  // list reached an end/abort, the VDP1 goes idle
+   vdp1cmdentry_struct entries[VDP1_MAX_COMMANDS];
+} vdp1cmdlist_struct;
+
 void Vdp1Draw(void);
 void Vdp1NoDraw(void);
 void FASTCALL Vdp1ReadCommand(vdp1cmd_struct *cmd, u32 addr, u8* ram);
+int Vdp1ParseCommands(u8 * ram, Vdp1 * regs, vdp1cmdlist_struct * list);
 
 int Vdp1SaveState(FILE *fp);
 int Vdp1LoadState(FILE *fp, int version, int size);
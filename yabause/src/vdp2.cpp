@@ -56,12 +56,14 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
 #include "threads.h"
 #include "yui.h"
 #include "frameprofile.h"
+#include "trace.h"
 #include "vidogl.h"
 #include "vidsoft.h"
 #include <atomic>
 #include "vulkan/VIDVulkanCInterface.h"
 
 u8 * Vdp2Ram;
+u8 * Vdp2RenderRam;
 u8 * Vdp2ColorRam;
 Vdp2 * Vdp2Regs;
 Vdp2Internal_struct Vdp2Internal;
@@ -72,6 +74,8 @@ u8 A0_Updated = 0;
 u8 A1_Updated = 0;
 u8 B0_Updated = 0;
 u8 B1_Updated = 0;
+u32 Vdp2RamPageGen[VDP2_RAM_PAGE_COUNT] = { 0 };
+u32 Vdp2ColorRamPageGen[VDP2_CRAM_PAGE_COUNT] = { 0 };
 
 struct CellScrollData cell_scroll_data[270];
 Vdp2 Vdp2Lines[270];
@@ -113,6 +117,7 @@ YabEventQueue * command_ = NULL;
 
 extern "C" void * VdpProc(void *arg);      // rendering thread.
 static void vdp2VBlankIN(void); // VBLANK-IN handler
+static void Vdp2WaitFrameInFlight(void);
 static void vdp2VBlankOUT(void);// VBLANK-OUT handler
 void VDP2genVRamCyclePattern();
 int Vdp2GenerateCCode();
@@ -180,6 +185,7 @@ void FASTCALL Vdp2RamWriteByte(u32 addr, u8 val) {
    }
 
    T1WriteByte(Vdp2Ram, addr, val);
+   Vdp2RamPageGen[addr >> VDP2_RAM_PAGE_SHIFT]++;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -209,6 +215,7 @@ void FASTCALL Vdp2RamWriteWord(u32 addr, u16 val) {
    }
 
    T1WriteWord(Vdp2Ram, addr, val);
+   Vdp2RamPageGen[addr >> VDP2_RAM_PAGE_SHIFT]++;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -238,6 +245,7 @@ void FASTCALL Vdp2RamWriteLong(u32 addr, u32 val) {
    }
 
    T1WriteLong(Vdp2Ram, addr, val);
+   Vdp2RamPageGen[addr >> VDP2_RAM_PAGE_SHIFT]++;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -267,6 +275,7 @@ void FASTCALL Vdp2ColorRamWriteByte(u32 addr, u8 val) {
    addr &= 0xFFF;
    //LOG("[VDP2] Update Coloram Byte %08X:%02X", addr, val);
    T2WriteByte(Vdp2ColorRam, addr, val);
+   Vdp2ColorRamPageGen[addr >> VDP2_CRAM_PAGE_SHIFT]++;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -277,12 +286,14 @@ void FASTCALL Vdp2ColorRamWriteWord(u32 addr, u16 val) {
    if (Vdp2Internal.ColorMode == 0 ) {
      if (val != T2ReadWord(Vdp2ColorRam, addr)) {
        T2WriteWord(Vdp2ColorRam, addr, val);
+       Vdp2ColorRamPageGen[addr >> VDP2_CRAM_PAGE_SHIFT]++;
        VIDCore->OnUpdateColorRamWord(addr);
      }
 
      if (addr < 0x800) {
        if (val != T2ReadWord(Vdp2ColorRam, addr + 0x800)) {
          T2WriteWord(Vdp2ColorRam, addr + 0x800, val);
+         Vdp2ColorRamPageGen[(addr + 0x800) >> VDP2_CRAM_PAGE_SHIFT]++;
          VIDCore->OnUpdateColorRamWord(addr + 0x800);
        }
      }
@@ -290,6 +301,7 @@ void FASTCALL Vdp2ColorRamWriteWord(u32 addr, u16 val) {
    else {
      if (val != T2ReadWord(Vdp2ColorRam, addr)) {
        T2WriteWord(Vdp2ColorRam, addr, val);
+       Vdp2ColorRamPageGen[addr >> VDP2_CRAM_PAGE_SHIFT]++;
        VIDCore->OnUpdateColorRamWord(addr);
      }
    }
@@ -305,18 +317,21 @@ void FASTCALL Vdp2ColorRamWriteLong(u32 addr, u32 val) {
 
      const u32 base_addr = addr;
      T2WriteLong(Vdp2ColorRam, base_addr, val);
+     Vdp2ColorRamPageGen[base_addr >> VDP2_CRAM_PAGE_SHIFT]++;
      VIDCore->OnUpdateColorRamWord(base_addr + 2);
      VIDCore->OnUpdateColorRamWord(base_addr);
 
      if (addr < 0x800) {
        const u32 mirror_addr = base_addr + 0x800;
        T2WriteLong(Vdp2ColorRam, mirror_addr, val);
+       Vdp2ColorRamPageGen[mirror_addr >> VDP2_CRAM_PAGE_SHIFT]++;
        VIDCore->OnUpdateColorRamWord(mirror_addr + 2);
        VIDCore->OnUpdateColorRamWord(mirror_addr);
      }
    }
    else {
      T2WriteLong(Vdp2ColorRam, addr, val);
+     Vdp2ColorRamPageGen[addr >> VDP2_CRAM_PAGE_SHIFT]++;
      if (Vdp2Internal.ColorMode == 2) {
        VIDCore->OnUpdateColorRamWord(addr);
      }
@@ -330,6 +345,118 @@ void FASTCALL Vdp2ColorRamWriteLong(u32 addr, u32 val) {
 
 //////////////////////////////////////////////////////////////////////////////
 
+static void Vdp2MarkPages(u32 * gen, u32 count, u32 shift, u32 addr, u32 size) {
+   u32 first;
+   u32 last;
+   if (size == 0)
+      return;
+   first = addr >> shift;
+   last = (addr + size - 1) >> shift;
+   if (last >= count)
+      last = count - 1;
+   for (; first <= last; first++)
+      gen[first]++;
+}
+
+void Vdp2RamMarkDirty(u32 addr, u32 size) {
+   addr &= 0x7FFFF;
+   Vdp2MarkPages(Vdp2RamPageGen, VDP2_RAM_PAGE_COUNT, VDP2_RAM_PAGE_SHIFT, addr, size);
+}
+
+void Vdp2ColorRamMarkDirty(u32 addr, u32 size) {
+   addr &= 0xFFF;
+   Vdp2MarkPages(Vdp2ColorRamPageGen, VDP2_CRAM_PAGE_COUNT, VDP2_CRAM_PAGE_SHIFT, addr, size);
+}
+
+// For block writes that bypass Vdp2RamWrite*: same side effects, once per range
+void Vdp2RamWriteNotify(u32 addr, u32 size) {
+   u32 end;
+   if (size == 0)
+      return;
+   addr &= 0x7FFFF;
+   end = addr + size - 1;
+   if (addr < 0x20000) A0_Updated = 1;
+   if (addr < 0x40000 && end >= 0x20000) A1_Updated = 1;
+   if (addr < 0x60000 && end >= 0x40000) B0_Updated = 1;
+   if (end >= 0x60000) B1_Updated = 1;
+   Vdp2RamMarkDirty(addr, size);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Generation counters only ever increase, so the sum over a range changes
+// whenever any page in the range has been written.
+static u32 Vdp2PageGenSum(const u32 * gen, u32 addr, u32 size) {
+   u32 first;
+   u32 last;
+   u32 sum = 0;
+   if (size == 0)
+      return 0;
+   addr &= 0x7FFFF;
+   first = addr >> VDP2_RAM_PAGE_SHIFT;
+   last = (addr + size - 1) >> VDP2_RAM_PAGE_SHIFT;
+   if (last >= VDP2_RAM_PAGE_COUNT)
+      last = VDP2_RAM_PAGE_COUNT - 1;
+   for (; first <= last; first++)
+      sum += gen[first];
+   return sum;
+}
+
+u32 Vdp2RamPageGenSum(u32 addr, u32 size) {
+   return Vdp2PageGenSum(Vdp2RamPageGen, addr, size);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Bring a shadow copy up to date, copying contiguous runs of changed pages.
+// The generation is latched before the copy, so a write racing with it
+// leaves the page dirty for the next call. Returns the number of pages copied.
+static int Vdp2SyncPages(u8 * dst, u32 * dst_gen, const u8 * src, const u32 * gen, u32 count, u32 shift) {
+   u32 i = 0;
+   int copied = 0;
+   while (i < count) {
+      u32 start;
+      if (dst_gen[i] == gen[i]) {
+         i++;
+         continue;
+      }
+      start = i;
+      while (i < count && dst_gen[i] != gen[i]) {
+         dst_gen[i] = gen[i];
+         i++;
+      }
+      memcpy(dst + (start << shift), src + (start << shift), (i - start) << shift);
+      copied += i - start;
+   }
+   return copied;
+}
+
+int Vdp2RamSyncPages(u8 * dst, u32 * dst_gen) {
+   return Vdp2SyncPages(dst, dst_gen, Vdp2Ram, Vdp2RamPageGen, VDP2_RAM_PAGE_COUNT, VDP2_RAM_PAGE_SHIFT);
+}
+
+int Vdp2ColorRamSyncPages(u8 * dst, u32 * dst_gen) {
+   return Vdp2SyncPages(dst, dst_gen, Vdp2ColorRam, Vdp2ColorRamPageGen, VDP2_CRAM_PAGE_COUNT, VDP2_CRAM_PAGE_SHIFT);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static u32 Vdp2RenderRamPageGen[VDP2_RAM_PAGE_COUNT];
+
+void Vdp2RenderRamUpdate(void) {
+   Vdp2RamSyncPages(Vdp2RenderRam, Vdp2RenderRamPageGen);
+}
+
+int Vdp2RenderRamSyncPages(u8 * dst, u32 * dst_gen) {
+   return Vdp2SyncPages(dst, dst_gen, Vdp2RenderRam, Vdp2RenderRamPageGen, VDP2_RAM_PAGE_COUNT, VDP2_RAM_PAGE_SHIFT);
+}
+
+u32 Vdp2RenderRamPageGenSum(u32 addr, u32 size) {
+   return Vdp2PageGenSum(Vdp2RenderRamPageGen, addr, size);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 int Vdp2Init(void) {
    if ((Vdp2Regs = (Vdp2 *) calloc(1, sizeof(Vdp2))) == NULL)
       return -1;
@@ -337,6 +464,10 @@ int Vdp2Init(void) {
    if ((Vdp2Ram = T1MemoryInit(0x80000)) == NULL)
       return -1;
 
+   if ((Vdp2RenderRam = T1MemoryInit(0x80000)) == NULL)
+      return -1;
+   memset(Vdp2RenderRamPageGen, 0, sizeof(Vdp2RenderRamPageGen));
+
    if ((Vdp2ColorRam = T2MemoryInit(0x1000)) == NULL)
       return -1;
 
@@ -352,11 +483,18 @@ int Vdp2Init(void) {
 #endif
 
    vrammutex = YabThreadCreateMutex();
+   Vdp2VBlankRegs = Vdp2Regs;
 
    command_ = YabThreadCreateQueue(1);
 
 
    memset(Vdp2ColorRam, 0xFF, 0x1000);
+
+   // Start from generation 1 so zero-initialized shadow copies are stale
+   Vdp2RamMarkDirty(0, 0x80000);
+   Vdp2ColorRamMarkDirty(0, 0x1000);
+   Vdp2RenderRamUpdate();
+
    for (int i = 0; i < 0x1000; i += 2) {
      VIDCore->OnUpdateColorRamWord(i);
    }
@@ -375,6 +513,7 @@ int Vdp2Init(void) {
 
 void Vdp2DeInit(void) {
 #if defined(YAB_ASYNC_RENDERING)
+   Vdp2WaitFrameInFlight();
    if (vdp_proc_running == 1) {
    	YabAddEventQueue(evqueue,VDPEV_FINSH);
    	//vdp_proc_running = 0;
@@ -389,6 +528,10 @@ void Vdp2DeInit(void) {
       T1MemoryDeInit(Vdp2Ram);
    Vdp2Ram = NULL;
 
+   if (Vdp2RenderRam)
+      T1MemoryDeInit(Vdp2RenderRam);
+   Vdp2RenderRam = NULL;
+
    if (Vdp2ColorRam)
       T2MemoryDeInit(Vdp2ColorRam);
    Vdp2ColorRam = NULL;
@@ -517,28 +660,35 @@ extern "C" void * VdpProc( void *arg ){
     YabThreadSetCurrentThreadAffinityMask(YabThreadGetFastestCpuIndex());
   }
 
+  TraceThreadName("vdp");
   while( vdp_proc_running ){
     evcode = YabWaitEventQueue(evqueue);
     switch(evcode){
     case VDPEV_VBLANK_IN:
       FrameProfileAdd("VIN start");
+      TRACE_BEGIN(TRACE_VDP2_VBLANKIN);
       vdp2VBlankIN();
+      TRACE_END(TRACE_VDP2_VBLANKIN);
       FrameProfileAdd("VIN end");
       break;
     case VDPEV_VBLANK_OUT:
       FrameProfileAdd("VOUT start");
+      TRACE_BEGIN(TRACE_VDP2_VBLANKOUT);
       vdp2VBlankOUT();
+      TRACE_END(TRACE_VDP2_VBLANKOUT);
       FrameProfileAdd("VOUT end");
       //YabAddEventQueue(vout_rcv_evqueue, 0);
       break;
     case VDPEV_DIRECT_DRAW:
       FrameProfileAdd("DirectDraw start");
       FRAMELOG("VDP1: VDPEV_DIRECT_DRAW(T)");
+      TRACE_BEGIN(TRACE_VDP1_DIRECT_DRAW);
       if (Vdp1External.manualerase == 0) {
         VIDCore->Vdp1EraseWrite(1);
       }
       Vdp1Draw();
       VIDCore->Vdp1DrawEnd();
+      TRACE_END(TRACE_VDP1_DIRECT_DRAW);
       Vdp1External.frame_change_plot = 0;
       FrameProfileAdd("DirectDraw end");
       YabAddEventQueue(vdp1_rcv_evqueue, 0);
@@ -551,11 +701,15 @@ extern "C" void * VdpProc( void *arg ){
       YuiRevokeOGLOnThisThread();
       YabAddEventQueue(command_,0);
       break;
+    case VDPEV_SYNC:
+      YabAddEventQueue(rcv_evqueue, 0);
+      break;
     case VDPEV_FINSH:
       vdp_proc_running = 0;
       break;
     }
   }
+  TraceThreadExit();
   return NULL;
 }
 
@@ -800,6 +954,60 @@ void frameSkipAndLimit() {
 }
 
 
+//////////////////////////////////////////////////////////////////////////////
+// Pipelined mode: at VBLANK-IN the emulation thread hands the frame to the
+// render thread and continues. Only the software core is supported because
+// its end-of-frame pass reads nothing but the latched state below.
+Vdp2 * Vdp2VBlankRegs = NULL;
+static int vdp2_frame_pipelined = 0;
+static int vdp2_frame_in_flight = 0;
+
+#if defined(YAB_ASYNC_RENDERING)
+static Vdp2 Vdp2PipelineRegs;
+
+static int Vdp2UseFramePipeline(void) {
+  return yabsys.frame_pipeline && VIDCore != NULL && VIDCore->id == VIDCORE_SOFT;
+}
+#endif
+
+static void Vdp2WaitFrameInFlight(void) {
+  if (vdp2_frame_in_flight) {
+    YabWaitEventQueue(rcv_evqueue);
+    vdp2_frame_in_flight = 0;
+    FrameProfileAdd("VIN sync");
+  }
+}
+
+// Returns once the render thread has drained every queued event, so that the
+// emulation thread can save or load state without racing it.
+extern "C" void Vdp2Quiesce(void) {
+  Vdp2WaitFrameInFlight();
+  if (vdp_proc_running && evqueue != NULL) {
+    YabAddEventQueue(evqueue, VDPEV_SYNC);
+    YabWaitEventQueue(rcv_evqueue);
+  }
+}
+
+// In lock-step mode (yabsys.deterministic) the render thread's VDP1 work is
+// joined at the next line boundary, or earlier if the SH2s touch VDP1 first.
+int Vdp2LockStepPending = 0;
+
+extern "C" void Vdp2LockStepMark(void) {
+  if (yabsys.deterministic) Vdp2LockStepPending = 1;
+}
+
+extern "C" void Vdp2LockStepJoin(void) {
+  Vdp2LockStepPending = 0;
+  Vdp2Quiesce();
+}
+
+static void Vdp2LatchVBlankState(void) {
+  if (VIDCore != NULL && VIDCore->id == VIDCORE_SOFT) {
+    Vdp1External.vblank_swap = ((Vdp1Regs->FBCR & 2) == 0) || Vdp1External.manualchange;
+    if (Vdp1External.vblank_swap) Vdp1External.manualchange = 0;
+  }
+}
+
 //////////////////////////////////////////////////////////////////////////////
 void vdp2VBlankIN(void) {
    /* this should be done after a frame change or a plot trigger */
@@ -813,9 +1021,13 @@ void vdp2VBlankIN(void) {
    VIDCore->Vdp2DrawEnd();
    frameSkipAndLimit();
    VIDCore->Sync();
-   Vdp2Regs->TVSTAT |= 0x0008;
 
-   ScuSendVBlankIN();
+   // In pipelined mode the emulation thread already raised VBLANK-IN
+   if (!vdp2_frame_pipelined) {
+     Vdp2Regs->TVSTAT |= 0x0008;
+
+     ScuSendVBlankIN();
+   }
 
    //if (yabsys.IsSSH2Running)
    //   SH2SendInterrupt(SSH2, 0x43, 0x6);
@@ -841,6 +1053,29 @@ void Vdp2VBlankIN(void) {
   }
 */
 
+  Vdp2WaitFrameInFlight();
+  Vdp2LatchVBlankState();
+
+  if (Vdp2UseFramePipeline()) {
+    // Hand the finished frame over and keep emulating. The render thread
+    // composites it while the next frame runs, the wait happens at the
+    // next hand over.
+    memcpy(&Vdp2PipelineRegs, Vdp2Regs, sizeof(Vdp2));
+    Vdp2VBlankRegs = &Vdp2PipelineRegs;
+    vdp2_frame_pipelined = 1;
+    vdp2_frame_in_flight = 1;
+
+    Vdp2Regs->TVSTAT |= 0x0008;
+    ScuSendVBlankIN();
+
+    FrameProfileAdd("VIN event");
+    YabAddEventQueue(evqueue,VDPEV_VBLANK_IN);
+    return;
+  }
+
+  Vdp2VBlankRegs = Vdp2Regs;
+  vdp2_frame_pipelined = 0;
+
   FrameProfileAdd("VIN event");
   YabAddEventQueue(evqueue,VDPEV_VBLANK_IN);
 
@@ -852,6 +1087,7 @@ void Vdp2VBlankIN(void) {
 
 #else
 	FrameProfileAdd("VIN start");
+   Vdp2LatchVBlankState();
    /* this should be done after a frame change or a plot trigger */
    //Vdp1Regs->COPR = 0;
    //printf("COPR = 0 at %d\n", __LINE__);
@@ -895,6 +1131,7 @@ extern atomic<int> vdp1_clock;
 
 void Vdp2HBlankOUT(void) {
   int i;
+  Vdp2LockStepSync();
   if (yabsys.LineCount < yabsys.VBlankLineCount)
   {
     ScuRemoveHBlankIN();
@@ -986,6 +1223,7 @@ void Vdp2HBlankOUT(void) {
   if (Vdp2External.frame_render_flg == 0 && vdp1_clock>0 ){ // Delay if vdp1 ram was written
     FrameProfileAdd("VOUT event");
     Vdp2External.frame_render_flg = 1;
+    Vdp2WaitFrameInFlight();
     // Manual Change
     if (Vdp1External.manualchange == 1) {
       Vdp1External.swap_frame_buffer = 1;
@@ -1036,8 +1274,11 @@ void Vdp2HBlankOUT(void) {
       FRAMELOG("YaGetQueueSizeYaGetQueueSize !=0  %d", YaGetQueueSize(vdp1_rcv_evqueue));
     }
 
+    // The render thread is idle until this event, refresh its VRAM image now
+    Vdp2RenderRamUpdate();
     FRAMELOG("YabAddEventQueue(evqueue, VDPEV_VBLANK_OUT)");
     YabAddEventQueue(evqueue, VDPEV_VBLANK_OUT);
+    Vdp2LockStepMark();
     YabThreadYield();
     //YabThreadUSleep(10000);
 
@@ -1056,6 +1297,8 @@ void Vdp2HBlankOUT(void) {
     }  
   }
 #else
+    // Drawn on this thread, refresh the VRAM image right before it is read
+    Vdp2RenderRamUpdate();
     vdp2VBlankOUT();
   }
   
@@ -1181,9 +1424,12 @@ void restorevram() {
   fread(Vdp2Regs, sizeof(Vdp2), 1, fp);
   fread(Vdp2Ram, 0x80000, 1, fp);
   fread(Vdp2ColorRam, 0x1000, 1, fp);
+  Vdp2RamMarkDirty(0, 0x80000);
+  Vdp2ColorRamMarkDirty(0, 0x1000);
   fread(&Vdp2Internal, sizeof(Vdp2Internal_struct), 1, fp);
   fread((void *)Vdp1Regs, sizeof(Vdp1), 1, fp);
   fread((void *)Vdp1Ram, 0x80000, 1, fp);
+  Vdp1RamMarkDirty(0, 0x80000);
   fread(&Vdp1External, sizeof(Vdp1External_struct), 1, fp);
   fclose(fp);
 
@@ -2475,6 +2721,14 @@ int Vdp2SaveState(FILE *fp)
 
 //////////////////////////////////////////////////////////////////////////////
 
+static void Vdp2StateColorRamChanged(u32 addr, u32 size)
+{
+   Vdp2ColorRamMarkDirty(addr, size);
+   for (u32 i = addr; i < addr + size; i += 2) {
+     VIDCore->OnUpdateColorRamWord(i);
+   }
+}
+
 int Vdp2LoadState(FILE *fp, UNUSED int version, int size)
 {
    IOCheck_struct check = { 0, 0 };
@@ -2483,20 +2737,16 @@ int Vdp2LoadState(FILE *fp, UNUSED int version, int size)
    yread(&check, (void *)Vdp2Regs, sizeof(Vdp2), 1, fp);
 
    // Read VDP2 ram
-   yread(&check, (void *)Vdp2Ram, 0x80000, 1, fp);
+   StateReadPages(&check, fp, Vdp2Ram, 0x80000, VDP2_RAM_PAGE_SHIFT, Vdp2RamMarkDirty);
 
    // Read CRAM
-   yread(&check, (void *)Vdp2ColorRam, 0x1000, 1, fp);
+   StateReadPages(&check, fp, Vdp2ColorRam, 0x1000, VDP2_CRAM_PAGE_SHIFT, Vdp2StateColorRamChanged);
 
    // Read internal variables
    yread(&check, (void *)&Vdp2Internal, sizeof(Vdp2Internal_struct), 1, fp);
 
    //if(VIDCore) VIDCore->Resize(0,0,-1,-1,0,0);
 
-   for (int i = 0; i < 0x1000; i += 2) {
-     VIDCore->OnUpdateColorRamWord(i);
-   }
-
    return size;
 }
 
@@ -50,6 +50,7 @@ extern "C" {
 #endif
 
 extern u8 * Vdp2Ram;
+extern u8 * Vdp2RenderRam;
 extern u8 * Vdp2ColorRam;
 extern u8 Vdp2ColorRamUpdated;
 extern u8 A0_Updated;
@@ -71,6 +72,31 @@ void FASTCALL   Vdp2ColorRamWriteByte(u32, u8);
 void FASTCALL   Vdp2ColorRamWriteWord(u32, u16);
 void FASTCALL   Vdp2ColorRamWriteLong(u32, u32);
 
+// VRAM/CRAM write tracking. Every write bumps the generation counter of the
+// page it lands in. Renderers keep their own copy of the generations they
+// last consumed and only refresh pages whose generation moved.
+#define VDP2_RAM_PAGE_SHIFT 10
+#define VDP2_RAM_PAGE_COUNT (0x80000 >> VDP2_RAM_PAGE_SHIFT)
+#define VDP2_CRAM_PAGE_SHIFT 8
+#define VDP2_CRAM_PAGE_COUNT (0x1000 >> VDP2_CRAM_PAGE_SHIFT)
+
+extern u32 Vdp2RamPageGen[VDP2_RAM_PAGE_COUNT];
+extern u32 Vdp2ColorRamPageGen[VDP2_CRAM_PAGE_COUNT];
+
+void Vdp2RamMarkDirty(u32 addr, u32 size);
+void Vdp2ColorRamMarkDirty(u32 addr, u32 size);
+void Vdp2RamWriteNotify(u32 addr, u32 size);
+u32 Vdp2RamPageGenSum(u32 addr, u32 size);
+int Vdp2RamSyncPages(u8 * dst, u32 * dst_gen);
+int Vdp2ColorRamSyncPages(u8 * dst, u32 * dst_gen);
+
+// Frame snapshot of VRAM for the render thread. Pages written since the last
+// frame are copied in when the frame is handed over at VBlank-out, so the
+// renderer reads an immutable image while the CPUs run the next frame.
+void Vdp2RenderRamUpdate(void);
+int Vdp2RenderRamSyncPages(u8 * dst, u32 * dst_gen);
+u32 Vdp2RenderRamPageGenSum(u32 addr, u32 size);
+
 typedef struct {
    u16 TVMD;   // 0x25F80000
    u16 EXTEN;  // 0x25F80002
@@ -393,6 +419,10 @@ extern u64 lastticks;
 extern int vdp2_is_odd_frame;
 extern Vdp2 Vdp2Lines[270];
 
+// Registers the end-of-frame pass should use. Points at Vdp2Regs unless the
+// frame was handed over to the render thread by the pipelined mode.
+extern Vdp2 * Vdp2VBlankRegs;
+
 struct CellScrollData
 {
    u32 data[88];//(352/8) * 2 screens
@@ -460,6 +490,7 @@ void * VdpProc( void *arg );
 #define VDPEV_DIRECT_DRAW 0x200
 #define VDPEV_MAKECURRENT 0x300
 #define VDPEV_REVOKE 0x400
+#define VDPEV_SYNC 0x500
 #define VDPEV_FINSH 0xFF00
 
 extern YabEventQueue * evqueue;
@@ -468,6 +499,16 @@ int VideoSetFilterType( int video_filter_type );
 void vdp2ReqDump();
 void vdp2ReqRestore();
 
+void Vdp2Quiesce(void);
+
+// Lock-step mode: work handed to the render thread is joined before the
+// emulated machine can observe it, see Vdp2LockStepMark
+extern int Vdp2LockStepPending;
+void Vdp2LockStepMark(void);
+void Vdp2LockStepJoin(void);
+static INLINE void Vdp2LockStepSync(void) {
+  if (Vdp2LockStepPending) Vdp2LockStepJoin();
+}
 void VdpLockVram();
 void VdpUnLockVram();
 
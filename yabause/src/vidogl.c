@@ -1870,7 +1870,7 @@ void Vdp2GenLineinfo(vdp2draw_struct *info)
     index = 0;
     if (VDPLINE_SX(info->islinescroll))
     {
-      info->lineinfo[lineindex].LineScrollValH = T1ReadWord(Vdp2Ram, info->linescrolltbl + (i / info->lineinc)*bound);
+      info->lineinfo[lineindex].LineScrollValH = T1ReadWord(Vdp2RenderRam, info->linescrolltbl + (i / info->lineinc)*bound);
       if ((info->lineinfo[lineindex].LineScrollValH & 0x400)) info->lineinfo[lineindex].LineScrollValH |= 0xF800; else info->lineinfo[lineindex].LineScrollValH &= 0x07FF;
       index += 4;
     }
@@ -1880,7 +1880,7 @@ void Vdp2GenLineinfo(vdp2draw_struct *info)
 
     if (VDPLINE_SY(info->islinescroll))
     {
-      info->lineinfo[lineindex].LineScrollValV = T1ReadWord(Vdp2Ram, info->linescrolltbl + (i / info->lineinc)*bound + index);
+      info->lineinfo[lineindex].LineScrollValV = T1ReadWord(Vdp2RenderRam, info->linescrolltbl + (i / info->lineinc)*bound + index);
       if ((info->lineinfo[lineindex].LineScrollValV & 0x400)) info->lineinfo[lineindex].LineScrollValV |= 0xF800; else info->lineinfo[lineindex].LineScrollValV &= 0x07FF;
       index += 4;
     }
@@ -1890,8 +1890,8 @@ void Vdp2GenLineinfo(vdp2draw_struct *info)
 
     if (VDPLINE_SZ(info->islinescroll))
     {
-      val1 = T1ReadWord(Vdp2Ram, info->linescrolltbl + (i / info->lineinc)*bound + index);
-      val2 = T1ReadWord(Vdp2Ram, info->linescrolltbl + (i / info->lineinc)*bound + index + 2);
+      val1 = T1ReadWord(Vdp2RenderRam, info->linescrolltbl + (i / info->lineinc)*bound + index);
+      val2 = T1ReadWord(Vdp2RenderRam, info->linescrolltbl + (i / info->lineinc)*bound + index + 2);
       info->lineinfo[lineindex].CoordinateIncH = (((int)((val1) & 0x07) << 8) | (int)((val2) >> 8));
       index += 4;
     }
@@ -1956,7 +1956,7 @@ INLINE u32 Vdp2GetAlpha(vdp2draw_struct *info, u8 dot, u32 cramindex) {
 static INLINE u32 Vdp2GetPixel4bpp(vdp2draw_struct *info, u32 addr, YglTexture *texture) {
 
   u32 cramindex;
-  u16 dotw = T1ReadWord(Vdp2Ram, addr & 0x7FFFF);
+  u16 dotw = T1ReadWord(Vdp2RenderRam, addr & 0x7FFFF);
   u8 dot;
   u32 alpha = 0xFF;
 
@@ -2012,7 +2012,7 @@ static INLINE u32 Vdp2GetPixel4bpp(vdp2draw_struct *info, u32 addr, YglTexture *
 static INLINE u32 Vdp2GetPixel8bpp(vdp2draw_struct *info, u32 addr, YglTexture *texture) {
 
   u32 cramindex;
-  u16 dotw = T1ReadWord(Vdp2Ram, addr & 0x7FFFF);
+  u16 dotw = T1ReadWord(Vdp2RenderRam, addr & 0x7FFFF);
   u8 dot;
   u32 alpha = info->alpha;
 
@@ -2041,7 +2041,7 @@ static INLINE u32 Vdp2GetPixel8bpp(vdp2draw_struct *info, u32 addr, YglTexture *
 static INLINE u32 Vdp2GetPixel16bpp(vdp2draw_struct *info, u32 addr) {
   u32 cramindex;
   u8 alpha = info->alpha;
-  u16 dot = T1ReadWord(Vdp2Ram, addr & 0x7FFFF);
+  u16 dot = T1ReadWord(Vdp2RenderRam, addr & 0x7FFFF);
   if ((dot == 0) && info->transparencyenable) return 0x00000000;
   else {
     cramindex = info->coloroffset + dot;
@@ -2053,7 +2053,7 @@ static INLINE u32 Vdp2GetPixel16bpp(vdp2draw_struct *info, u32 addr) {
 
 static INLINE u32 Vdp2GetPixel16bppbmp(vdp2draw_struct *info, u32 addr) {
   u32 color;
-  u16 dot = T1ReadWord(Vdp2Ram, addr & 0x7FFFF);
+  u16 dot = T1ReadWord(Vdp2RenderRam, addr & 0x7FFFF);
   if (!(dot & 0x8000) && info->transparencyenable) color = 0x00000000;
   else color = SAT2YAB1(info->alpha, dot);
   return color;
@@ -2062,8 +2062,8 @@ static INLINE u32 Vdp2GetPixel16bppbmp(vdp2draw_struct *info, u32 addr) {
 static INLINE u32 Vdp2GetPixel32bppbmp(vdp2draw_struct *info, u32 addr) {
   u32 color;
   u16 dot1, dot2;
-  dot1 = T1ReadWord(Vdp2Ram, addr & 0x7FFFF);
-  dot2 = T1ReadWord(Vdp2Ram, addr + 2 & 0x7FFFF);
+  dot1 = T1ReadWord(Vdp2RenderRam, addr & 0x7FFFF);
+  dot2 = T1ReadWord(Vdp2RenderRam, addr + 2 & 0x7FFFF);
   if (!(dot1 & 0x8000) && info->transparencyenable) color = 0x00000000;
   else color = SAT2YAB2(info->alpha, dot1, dot2);
   return color;
@@ -2393,7 +2393,7 @@ static void FASTCALL Vdp2DrawBitmapLineScroll(vdp2draw_struct *info, YglTexture
         for (j = 0; j < vdp2width; j++)
         {
           //if (info->isverticalscroll){
-          //	sv += T1ReadLong(Vdp2Ram, info->verticalscrolltbl+(j>>3) ) >> 16;
+          //	sv += T1ReadLong(Vdp2RenderRam, info->verticalscrolltbl+(j>>3) ) >> 16;
           //}
           *texture->textdata++ = Vdp2GetPixel32bppbmp(info, baseaddr);
           baseaddr += 4;
@@ -2464,7 +2464,7 @@ static void FASTCALL Vdp2DrawBitmapCoordinateInc(vdp2draw_struct *info, YglTextu
           *texture->textdata++ = 0x0000;
         }
         else {
-          u8 dot = T1ReadByte(Vdp2Ram, baseaddr + addr);
+          u8 dot = T1ReadByte(Vdp2RenderRam, baseaddr + addr);
           u32 alpha = info->alpha;
           if (!(h & 0x01)) dot >> 4;
           if (!(dot & 0xF) && info->transparencyenable) *texture->textdata++ = 0x00000000;
@@ -2495,7 +2495,7 @@ static void FASTCALL Vdp2DrawBitmapCoordinateInc(vdp2draw_struct *info, YglTextu
         int h = ((j*inch) >> 8);
         u32 alpha = info->alpha;
         u32 addr = ((sh + h)&(info->cellw-1))  + sv * info->cellw;
-        u8 dot = T1ReadByte(Vdp2Ram, baseaddr + addr);
+        u8 dot = T1ReadByte(Vdp2RenderRam, baseaddr + addr);
         if (!dot && info->transparencyenable) {
           *texture->textdata++ = 0; continue;
         }
@@ -2550,6 +2550,78 @@ static void FASTCALL Vdp2DrawBitmapCoordinateInc(vdp2draw_struct *info, YglTextu
   }
 }
 
+// Hashes of character data from earlier frames. An entry stays good while
+// the generations of the snapshot pages under it have not moved, so tiles
+// in unchanged VRAM pages are neither hashed nor decoded again.
+#define VDP2_PATTERN_HASH_SIZE 0x1000
+
+static struct {
+  u32 addr;
+  u32 size;   // 0 = unused
+  u32 gen;    // Vdp2RenderRamPageGenSum over the data when hashed
+  u64 hash;
+} vdp2_pattern_hash[VDP2_PATTERN_HASH_SIZE];
+
+static u64 Vdp2GetPatternHash(u32 addr, u32 size)
+{
+  const u32 gen = Vdp2RenderRamPageGenSum(addr, size);
+  const u32 index = (addr >> 5) & (VDP2_PATTERN_HASH_SIZE - 1);
+  const u32 * src;
+  u32 i;
+  u64 h = 0xCBF29CE484222325ULL;
+
+  if (vdp2_pattern_hash[index].addr == addr && vdp2_pattern_hash[index].size == size &&
+      vdp2_pattern_hash[index].gen == gen)
+    return vdp2_pattern_hash[index].hash;
+
+  src = (const u32 *)(Vdp2RenderRam + addr);
+  for (i = 0; i < (size >> 2); i++) {
+    h = (h ^ src[i]) * 0x100000001B3ULL;
+  }
+
+  vdp2_pattern_hash[index].addr = addr;
+  vdp2_pattern_hash[index].size = size;
+  vdp2_pattern_hash[index].gen = gen;
+  vdp2_pattern_hash[index].hash = h;
+  return h;
+}
+
+// Builds the cross-frame cache key of a pattern: the decode parameters and a
+// hash of the character data. Returns 0 when the texels depend on something
+// the key can not describe, in which case only the per-frame cache is used.
+static int Vdp2GetPatternPersistentKey(vdp2draw_struct *info, u64 * key, u64 * content)
+{
+  static const int bpp[5] = { 4, 8, 16, 16, 32 };
+  const int CCMD = ((fixVdp2Regs->CCCTL >> 8) & 0x01);
+  u32 addr, size;
+
+  if (info->colornumber > 4) return 0;
+  // Color calculation by CRAM MSB reads the palette, not only VRAM
+  if (info->colornumber < 3 && info->specialcolormode == 3) return 0;
+
+  addr = info->charaddr & 0x7FFFF;
+  size = (info->patternpixelwh * info->patternpixelwh * bpp[info->colornumber]) >> 3;
+  if ((addr & 0x03) || addr + size > 0x80000) return 0;
+  if (info->char_bank[addr >> 17] == 0 || info->char_bank[(addr + size - 1) >> 17] == 0) return 0;
+
+  *content = Vdp2GetPatternHash(addr, size);
+
+  *key = (u64)info->colornumber
+    | ((u64)(info->transparencyenable & 0x01) << 3)
+    | ((u64)(info->patternpixelwh >> 4) << 4)
+    | ((u64)(info->paladdr & 0x7F) << 5)
+    | ((u64)(info->alpha & 0xFF) << 12)
+    | ((u64)(info->priority & 0x0F) << 20)
+    | ((u64)(info->coloroffset & 0xFFF) << 24)
+    | ((u64)(info->specialprimode & 0x03) << 36)
+    | ((u64)(info->specialfunction & 0x01) << 38)
+    | ((u64)(info->specialcode & 0xFF) << 39)
+    | ((u64)(info->specialcolormode & 0x03) << 47)
+    | ((u64)(info->specialcolorfunction & 0x01) << 49)
+    | ((u64)CCMD << 50);
+  return 1;
+}
+
 static void Vdp2DrawPatternPos(vdp2draw_struct *info, YglTexture *texture, int x, int y, int cx, int cy, int lines )
 {
   u64 cacheaddr = (((u64)(info->priority&0xF))<<35) | ((u32)(info->alpha >> 3) << 27) |
@@ -2559,6 +2631,8 @@ static void Vdp2DrawPatternPos(vdp2draw_struct *info, YglTexture *texture, int x
   YglCache c;
   vdp2draw_struct tile;
   int winmode = 0;
+  u64 pkey, pcontent;
+  int persistent = 0;
   tile.dst = 0;
   tile.uclipmode = 0;
   tile.colornumber = info->colornumber;
@@ -2618,9 +2692,24 @@ static void Vdp2DrawPatternPos(vdp2draw_struct *info, YglTexture *texture, int x
     return;
   }
 
+  if (Vdp2GetPatternPersistentKey(info, &pkey, &pcontent)) {
+    if (YglPersistentCacheLookup(_Ygl->texture_manager, info->patternpixelwh, pkey, pcontent, &c)) {
+      YglCachedQuadOffset(&tile, &c, cx, cy, info->coordincx, info->coordincy);
+      YglCacheAdd(_Ygl->texture_manager, cacheaddr, &c);
+      return;
+    }
+    if (YglPersistentCacheAdd(_Ygl->texture_manager, info->patternpixelwh, pkey, pcontent, texture, &c)) {
+      YglCachedQuadOffset(&tile, &c, cx, cy, info->coordincx, info->coordincy);
+      YglCacheAdd(_Ygl->texture_manager, cacheaddr, &c);
+      persistent = 1;
+    }
+  }
+
   //printf("x=%d,y=%d %lx not cached\n",x,y,cacheaddr);
-  YglQuadOffset(&tile, texture, &c, cx, cy, info->coordincx, info->coordincy);
-  YglCacheAdd(_Ygl->texture_manager, cacheaddr, &c);
+  if (!persistent) {
+    YglQuadOffset(&tile, texture, &c, cx, cy, info->coordincx, info->coordincy);
+    YglCacheAdd(_Ygl->texture_manager, cacheaddr, &c);
+  }
 
   switch (info->patternwh)
   {
@@ -2702,7 +2791,7 @@ static void Vdp2PatternAddr(vdp2draw_struct *info)
   {
   case 1:
   {
-    u16 tmp = T1ReadWord(Vdp2Ram, info->addr);
+    u16 tmp = T1ReadWord(Vdp2RenderRam, info->addr);
 
     info->addr += 2;
     info->specialfunction = (info->supplementdata >> 9) & 0x1;
@@ -2751,8 +2840,8 @@ static void Vdp2PatternAddr(vdp2draw_struct *info)
     break;
   }
   case 2: {
-    u16 tmp1 = T1ReadWord(Vdp2Ram, (info->addr&0x7FFFF));
-    u16 tmp2 = T1ReadWord(Vdp2Ram, (info->addr & 0x7FFFF)+ 2);
+    u16 tmp1 = T1ReadWord(Vdp2RenderRam, (info->addr&0x7FFFF));
+    u16 tmp2 = T1ReadWord(Vdp2RenderRam, (info->addr & 0x7FFFF)+ 2);
     info->addr += 4;
     info->charaddr = tmp2 & 0x7FFF;
     info->flipfunction = (tmp1 & 0xC000) >> 14;
@@ -2789,7 +2878,7 @@ static void Vdp2PatternAddrPos(vdp2draw_struct *info, int planex, int x, int pla
   {
   case 1:
   {
-    u16 tmp = T1ReadWord(Vdp2Ram, addr);
+    u16 tmp = T1ReadWord(Vdp2RenderRam, addr);
 
     info->specialfunction = (info->supplementdata >> 9) & 0x1;
     info->specialcolorfunction = (info->supplementdata >> 8) & 0x1;
@@ -2837,8 +2926,8 @@ static void Vdp2PatternAddrPos(vdp2draw_struct *info, int planex, int x, int pla
     break;
   }
   case 2: {
-    u16 tmp1 = T1ReadWord(Vdp2Ram, addr);
-    u16 tmp2 = T1ReadWord(Vdp2Ram, addr + 2);
+    u16 tmp1 = T1ReadWord(Vdp2RenderRam, addr);
+    u16 tmp2 = T1ReadWord(Vdp2RenderRam, addr + 2);
     info->charaddr = tmp2 &0x7FFF;
     info->flipfunction = (tmp1 & 0xC000) >> 14;
     switch (info->colornumber) {
@@ -2872,7 +2961,7 @@ static INLINE u32 Vdp2RotationFetchPixel(vdp2draw_struct *info, int x, int y, in
   switch (info->colornumber)
   {
   case 0: // 4 BPP
-    dot = T1ReadByte(Vdp2Ram, ((info->charaddr + (((y * cellw) + x) >> 1)) & 0x7FFFF));
+    dot = T1ReadByte(Vdp2RenderRam, ((info->charaddr + (((y * cellw) + x) >> 1)) & 0x7FFFF));
     if (!(x & 0x1)) dot >>= 4;
     if (!(dot & 0xF) && info->transparencyenable) return 0x00000000;
     else {
@@ -2892,7 +2981,7 @@ static INLINE u32 Vdp2RotationFetchPixel(vdp2draw_struct *info, int x, int y, in
       return   cramindex | alpha << 24;
     }
   case 1: // 8 BPP
-    dot = T1ReadByte(Vdp2Ram, ((info->charaddr + (y * cellw) + x) & 0x7FFFF));
+    dot = T1ReadByte(Vdp2RenderRam, ((info->charaddr + (y * cellw) + x) & 0x7FFFF));
     if (!(dot & 0xFF) && info->transparencyenable) return 0x00000000;
     else {
       cramindex = info->coloroffset + ((info->paladdr << 4) | (dot & 0xFF));
@@ -2911,7 +3000,7 @@ static INLINE u32 Vdp2RotationFetchPixel(vdp2draw_struct *info, int x, int y, in
       return   cramindex | alpha << 24;
     }
   case 2: // 16 BPP(palette)
-    dot = T1ReadWord(Vdp2Ram, ((info->charaddr + ((y * cellw) + x) * 2) & 0x7FFFF));
+    dot = T1ReadWord(Vdp2RenderRam, ((info->charaddr + ((y * cellw) + x) * 2) & 0x7FFFF));
     if ((dot == 0) && info->transparencyenable) return 0x00000000;
     else {
       cramindex = (info->coloroffset + dot);
@@ -2930,11 +3019,11 @@ static INLINE u32 Vdp2RotationFetchPixel(vdp2draw_struct *info, int x, int y, in
       return   cramindex | alpha << 24;
     }
   case 3: // 16 BPP(RGB)
-    dot = T1ReadWord(Vdp2Ram, ((info->charaddr + ((y * cellw) + x) * 2) & 0x7FFFF));
+    dot = T1ReadWord(Vdp2RenderRam, ((info->charaddr + ((y * cellw) + x) * 2) & 0x7FFFF));
     if (!(dot & 0x8000) && info->transparencyenable) return 0x00000000;
     else return SAT2YAB1(alpha, dot);
   case 4: // 32 BPP
-    dot = T1ReadLong(Vdp2Ram, ((info->charaddr + ((y * cellw) + x) * 4) & 0x7FFFF));
+    dot = T1ReadLong(Vdp2RenderRam, ((info->charaddr + ((y * cellw) + x) * 4) & 0x7FFFF));
     if (!(dot & 0x80000000) && info->transparencyenable) return 0x00000000;
     else return SAT2YAB2(alpha, (dot >> 16), dot);
   default:
@@ -3026,7 +3115,7 @@ static void Vdp2DrawMapPerLine(vdp2draw_struct *info, YglTexture *texture) {
       // info->verticalscrolltbl should be incremented by info->verticalscrollinc
       // each time there's a cell change and reseted at the end of the line...
       // or something like that :)
-      targetv += T1ReadLong(Vdp2Ram, info->verticalscrolltbl) >> 16;
+      targetv += T1ReadLong(Vdp2RenderRam, info->verticalscrolltbl) >> 16;
     }
 
     if (VDPLINE_SZ(info->islinescroll)) {
@@ -3391,7 +3480,7 @@ static void Vdp2DrawMapTest(vdp2draw_struct *info, YglTexture *texture) {
     for (h = -info->patternpixelwh; h < info->draww + info->patternpixelwh; h += info->patternpixelwh) {
 
       if (info->isverticalscroll) {
-        targetv = info->y + v + (T1ReadLong(Vdp2Ram, info->verticalscrolltbl + cell_count) >> 16);
+        targetv = info->y + v + (T1ReadLong(Vdp2RenderRam, info->verticalscrolltbl + cell_count) >> 16);
         cell_count += info->verticalscrollinc;
         // determine which chara shoud be used.
         //mapy   = (v+sy) / (512 * info->planeh);
@@ -3563,6 +3652,10 @@ void Vdp2DrawRotationThread(void * p) {
     curret_rbg->vdp2_sync_flg = RBG_FINIESED;
     YGL_THREAD_DEBUG("Vdp2DrawRotationThread end %d,%08X\n", curret_rbg->vdp2_sync_flg, curret_rbg->texture.textdata);
     YabThreadUnLock(g_rotate_mtx);
+    // Not moved to the rotation band pool: this thread is the one that hands
+    // bands to the pool in Vdp2DrawRotation_in, and the emulator thread takes
+    // g_rotate_mtx from it in Vdp2RgbTextureSync, which YabThreadSleep can't
+    // wait for. The yield only lasts until that sync, later in the same frame.
     while (curret_rbg->vdp2_sync_flg == RBG_FINIESED && Vdp2DrawRotationThread_running) YabThreadYield();
     YGL_THREAD_DEBUG("Vdp2DrawRotationThread out %d\n", curret_rbg->vdp2_sync_flg);
 
@@ -3696,7 +3789,7 @@ static void FASTCALL Vdp2DrawRotation(RBGDrawInfo * rbg)
    if (info->LineColorBase != 0)
    {
      rbg->line_info.blendmode = 0;
-     rbg->LineColorRamAdress = (T1ReadWord(Vdp2Ram, info->LineColorBase) & 0x7FF);// +info->coloroffset;
+     rbg->LineColorRamAdress = (T1ReadWord(Vdp2RenderRam, info->LineColorBase) & 0x7FF);// +info->coloroffset;
 
      u64 cacheaddr = 0xA0000000DAD;
      YglTMAllocate(_Ygl->texture_manager, &rbg->line_texture, rbg->vres, 1,  &x, &y);
@@ -3744,7 +3837,7 @@ static void FASTCALL Vdp2DrawRotation(RBGDrawInfo * rbg)
 	if (info->LineColorBase != 0)
 	{
 		rbg->line_info.blendmode = 0;
-		rbg->LineColorRamAdress = (T1ReadWord(Vdp2Ram, info->LineColorBase) & 0x7FF);// +info->coloroffset;
+		rbg->LineColorRamAdress = (T1ReadWord(Vdp2RenderRam, info->LineColorBase) & 0x7FF);// +info->coloroffset;
 
 		u64 cacheaddr = 0xA0000000DAD;
 		YglTMAllocate(_Ygl->texture_manager, &rbg->line_texture, rbg->vres, 1, &x, &y);
@@ -3836,7 +3929,7 @@ static INLINE int vdp2rGetKValue(vdp2rotationparameter_struct * parameter, float
   int h = ceilf(parameter->KtablV + (parameter->deltaKAx * i));
   if (parameter->coefdatasize == 2) {
     if (parameter->k_mem_type == 0) { // vram
-      kdata = T1ReadWord(Vdp2Ram, (parameter->coeftbladdr + (int)(h << 1)) & 0x7FFFF);
+      kdata = T1ReadWord(Vdp2RenderRam, (parameter->coeftbladdr + (int)(h << 1)) & 0x7FFFF);
     } else { // cram
       kdata = Vdp2ColorRamReadWord(((parameter->coeftbladdr + (int)(h << 1)) & 0x7FF) + 0x800);
     }
@@ -3851,7 +3944,7 @@ static INLINE int vdp2rGetKValue(vdp2rotationparameter_struct * parameter, float
   }
   else {
     if (parameter->k_mem_type == 0) { // vram
-      kdata = T1ReadLong(Vdp2Ram, (parameter->coeftbladdr + (int)(h << 2)) & 0x7FFFF);
+      kdata = T1ReadLong(Vdp2RenderRam, (parameter->coeftbladdr + (int)(h << 2)) & 0x7FFFF);
     } else { // cram
       kdata = Vdp2ColorRamReadLong( ((parameter->coeftbladdr + (int)(h << 2)) & 0x7FF) + 0x800 );
     }
@@ -3868,232 +3961,105 @@ static INLINE int vdp2rGetKValue(vdp2rotationparameter_struct * parameter, float
   return 1;
 }
 
-static void Vdp2DrawRotation_in(RBGDrawInfo * rbg) {
+// Per-line values of the rotation parameters, worked out once before the
+// lines are split into bands
+typedef struct {
+  float j;
+  float XspA, YspA;
+  float XspB, YspB;
+  int KtablVA, KtablVB;
+} rbgline_struct;
+
+typedef struct {
+  RBGDrawInfo * rbg;
+  vdp2draw_struct info;
+  vdp2rotationparameter_struct paraA;
+  vdp2rotationparameter_struct paraB;
+  rbgline_struct * lines;
+  u32 * textdata;
+  int pitch;
+} rbgbands_struct;
 
-  if (rbg == NULL) return;
+static void Vdp2DrawRotationLines(RBGDrawInfo * rbg, vdp2draw_struct * info, vdp2rotationparameter_struct * pA, vdp2rotationparameter_struct * pB,
+  const rbgline_struct * lines, int start, int end, u32 * texturedata, int pitch) {
 
-  vdp2draw_struct *info = &rbg->info;
+  const float hstep = 1.0 / rbg->rotate_mval_h;
   int rgb_type = rbg->rgb_type;
-  YglTexture *texture = &rbg->texture;
-  YglTexture *line_texture = &rbg->line_texture;
-
-  float i, j;
-  int x, y;
-  int cellw, cellh;
+  float i;
+  int x = 0, y = 0;
+  int cellw = info->cellw;
+  int cellh = info->cellh;
   int oldcellx = -1, oldcelly = -1;
   u32 color;
-  int vres, hres;
-  int h,h2;
-  int v,v2;
-  int lineInc = fixVdp2Regs->LCTA.part.U & 0x8000 ? 2 : 0;
-  int linecl = 0xFF;
+  int h, v;
   vdp2rotationparameter_struct *parameter;
-  Vdp2 * regs;
-  if ((fixVdp2Regs->CCCTL >> 5) & 0x01) {
-    linecl = ((~fixVdp2Regs->CCRLB & 0x1F) << 3) + 0x7;
-  }
-
-  if (vdp2height >= 448) {
-    lineInc <<= 1;
-    info->drawh = (vdp2height >> 1);
-    info->hres_shift = 1;
-  }
-  else {
-    info->hres_shift = 0;
-    info->drawh = vdp2height;
-  }
-
-  vres = rbg->vres/ rbg->rotate_mval_v;
-  hres = rbg->hres/ rbg->rotate_mval_h;
-  cellw = rbg->info.cellw;
-  cellh = rbg->info.cellh;
-  regs = Vdp2RestoreRegs(3, Vdp2Lines);
-
-  x = 0;
-  y = 0;
-  u32 lineaddr = 0;
-  if (rgb_type == 0)
-  {
-    paraA.dx = paraA.A * paraA.deltaX + paraA.B * paraA.deltaY;
-    paraA.dy = paraA.D * paraA.deltaX + paraA.E * paraA.deltaY;
-    paraA.Xp = paraA.A * (paraA.Px - paraA.Cx) +
-    paraA.B * (paraA.Py - paraA.Cy) +
-    paraA.C * (paraA.Pz - paraA.Cz) + paraA.Cx + paraA.Mx;
-    paraA.Yp = paraA.D * (paraA.Px - paraA.Cx) +
-    paraA.E * (paraA.Py - paraA.Cy) +
-    paraA.F * (paraA.Pz - paraA.Cz) + paraA.Cy + paraA.My;
-  }
-
-  if (rbg->useb)
-  {
-    paraB.dx = paraB.A * paraB.deltaX + paraB.B * paraB.deltaY;
-    paraB.dy = paraB.D * paraB.deltaX + paraB.E * paraB.deltaY;
-    paraB.Xp = paraB.A * (paraB.Px - paraB.Cx) + paraB.B * (paraB.Py - paraB.Cy)
-      + paraB.C * (paraB.Pz - paraB.Cz) + paraB.Cx + paraB.Mx;
-    paraB.Yp = paraB.D * (paraB.Px - paraB.Cx) + paraB.E * (paraB.Py - paraB.Cy)
-      + paraB.F * (paraB.Pz - paraB.Cz) + paraB.Cy + paraB.My;
-  }
 
-  paraA.over_pattern_name = fixVdp2Regs->OVPNRA;
-  paraB.over_pattern_name = fixVdp2Regs->OVPNRB;
-
-  if (_Ygl->rbg_use_compute_shader) {
-	  RBGGenerator_update(rbg);
-	  
-	  if (info->LineColorBase != 0) {
-		  const float vstep = 1.0 / rbg->rotate_mval_v;
-		  j = 0.0f;
-      int lvres = rbg->vres;
-      if (vres >= 480) {
-        lvres >>= 1;
-      }
-		  for (int jj = 0; jj < lvres; jj++) {
-			  if ((fixVdp2Regs->LCTA.part.U & 0x8000) != 0) {
-				  rbg->LineColorRamAdress = T1ReadWord(Vdp2Ram, info->LineColorBase + lineInc*(int)(j));
-				  *line_texture->textdata = rbg->LineColorRamAdress | (linecl << 24);
-				  line_texture->textdata++;
-          if (vres >= 480) {
-            *line_texture->textdata = rbg->LineColorRamAdress | (linecl << 24);
-            line_texture->textdata++;
-          }
-			  }
-			  else {
-				  *line_texture->textdata = rbg->LineColorRamAdress;
-				  line_texture->textdata++;
-			  }
-			  j += vstep;
-		  }
-	  }
-	
-	  return;
-  }
-
-  const float vstep = 1.0 / rbg->rotate_mval_v;
-  const float hstep = 1.0 / rbg->rotate_mval_h;
-  //for (j = 0; j < vres; j += vstep)
-  j = 0.0f;
-  for (int jj = 0; jj< rbg->vres; jj++)
+  for (int jj = start; jj < end; jj++)
   {
-#if 0 // PERLINE
-    Vdp2 * regs = Vdp2RestoreRegs(j, Vdp2Lines);
-#endif
+    const rbgline_struct * line = &lines[jj];
+    u32 * textdata = texturedata + jj * pitch;
 
     if (rgb_type == 0) {
-#if 0 // PERLINE
-      paraA.charaddr = (regs->MPOFR & 0x7) * 0x20000;
-      ReadPlaneSizeR(&paraA, regs->PLSZ >> 8);
-      for (i = 0; i < 16; i++) {
-        paraA.PlaneAddr(info, i, regs);
-        paraA.PlaneAddrv[i] = info->addr;
-      }
-#endif
-      paraA.Xsp = paraA.A * ((paraA.Xst + paraA.deltaXst * j) - paraA.Px) +
-      paraA.B * ((paraA.Yst + paraA.deltaYst * j) - paraA.Py) +
-      paraA.C * (paraA.Zst - paraA.Pz);
-
-      paraA.Ysp = paraA.D * ((paraA.Xst + paraA.deltaXst *j) - paraA.Px) +
-      paraA.E * ((paraA.Yst + paraA.deltaYst * j) - paraA.Py) +
-      paraA.F * (paraA.Zst - paraA.Pz);
-
-      paraA.KtablV = paraA.deltaKAst* j;
+      pA->Xsp = line->XspA;
+      pA->Ysp = line->YspA;
+      pA->KtablV = line->KtablVA;
     }
-    if (rbg->useb)
-    {
-#if 0 // PERLINE
-      Vdp2ReadRotationTable(1, &paraB, regs, Vdp2Ram);
-      paraB.dx = paraB.A * paraB.deltaX + paraB.B * paraB.deltaY;
-      paraB.dy = paraB.D * paraB.deltaX + paraB.E * paraB.deltaY;
-      paraB.Xp = paraB.A * (paraB.Px - paraB.Cx) + paraB.B * (paraB.Py - paraB.Cy)
-        + paraB.C * (paraB.Pz - paraB.Cz) + paraB.Cx + paraB.Mx;
-      paraB.Yp = paraB.D * (paraB.Px - paraB.Cx) + paraB.E * (paraB.Py - paraB.Cy)
-        + paraB.F * (paraB.Pz - paraB.Cz) + paraB.Cy + paraB.My;
-
-      ReadPlaneSize(info, regs->PLSZ >> 12);
-      ReadPatternData(info, regs->PNCN0, regs->CHCTLA & 0x1);
-
-      paraB.charaddr = (regs->MPOFR & 0x70) * 0x2000;
-      ReadPlaneSizeR(&paraB, regs->PLSZ >> 12);
-      for (i = 0; i < 16; i++) {
-        paraB.PlaneAddr(info, i, regs);
-        paraB.PlaneAddrv[i] = info->addr;
-      }
-#endif
-      paraB.Xsp = paraB.A * ((paraB.Xst + paraB.deltaXst * j) - paraB.Px) +
-        paraB.B * ((paraB.Yst + paraB.deltaYst * j) - paraB.Py) +
-        paraB.C * (paraB.Zst - paraB.Pz);
-
-      paraB.Ysp = paraB.D * ((paraB.Xst + paraB.deltaXst * j) - paraB.Px) +
-        paraB.E * ((paraB.Yst + paraB.deltaYst * j) - paraB.Py) +
-        paraB.F * (paraB.Zst - paraB.Pz);
-
-      paraB.KtablV = paraB.deltaKAst * j;
-  }
-
-    if (info->LineColorBase != 0)
-    {
-      if ((fixVdp2Regs->LCTA.part.U & 0x8000) != 0) {
-        rbg->LineColorRamAdress = T1ReadWord(Vdp2Ram, info->LineColorBase  + lineInc*(int)(j) );
-        *line_texture->textdata = rbg->LineColorRamAdress | (linecl << 24);
-        line_texture->textdata++;
-      }
-      else {
-      *line_texture->textdata = rbg->LineColorRamAdress;
-        line_texture->textdata++;
-      }
+    if (rbg->useb) {
+      pB->Xsp = line->XspB;
+      pB->Ysp = line->YspB;
+      pB->KtablV = line->KtablVB;
     }
 
-    //	  if (regs) ReadVdp2ColorOffset(regs, info, info->linecheck_mask);
-    //for (i = 0; i < hres; i += hstep)
     i = 0.0;
     for( int ii=0; ii< rbg->hres; ii++ )
     {
 /*
       if (Vdp2CheckWindowDot( info, (int)i, (int)j) == 0) {
-        *(texture->textdata++) = 0x00000000;
+        *(textdata++) = 0x00000000;
         continue; // may be faster than GPU
       }
 */
       switch (fixVdp2Regs->RPMD | rgb_type ) {
       case 0:
-        parameter = &paraA;
+        parameter = pA;
         if (parameter->coefenab) {
           if (vdp2rGetKValue(parameter, i) == 0) {
-            *(texture->textdata++) = 0x00000000;
+            *(textdata++) = 0x00000000;
             i += hstep;
             continue;
           }
         }
         break;
       case 1:
-        parameter = &paraB;
+        parameter = pB;
         if (parameter->coefenab) {
           if (vdp2rGetKValue(parameter, i) == 0) {
-            *(texture->textdata++) = 0x00000000;
+            *(textdata++) = 0x00000000;
             i += hstep;
             continue;
           }
         }
         break;
       case 2:
-        if (!(paraA.coefenab)) {
-          parameter = &paraA;
+        if (!(pA->coefenab)) {
+          parameter = pA;
         } else {
-          if (paraB.coefenab) {
-            parameter = &paraA;
+          if (pB->coefenab) {
+            parameter = pA;
             if (vdp2rGetKValue(parameter, i) == 0) {
-              parameter = &paraB;
+              parameter = pB;
               if( vdp2rGetKValue(parameter, i) == 0) {
-                *(texture->textdata++) = 0x00000000;
+                *(textdata++) = 0x00000000;
                 i += hstep;
                 continue;
               }
             }
           }
           else {
-            parameter = &paraA;
+            parameter = pA;
             if (vdp2rGetKValue(parameter, i) == 0) {
-              paraB.lineaddr = paraA.lineaddr;
-              parameter = &paraB;
+              pB->lineaddr = pA->lineaddr;
+              parameter = pB;
 			}
 			else {
 				int a = 0;
@@ -4102,12 +4068,12 @@ static void Vdp2DrawRotation_in(RBGDrawInfo * rbg) {
         }
         break;
       default:
-        parameter = info->GetRParam(info, (int)i, (int)j);
+        parameter = info->GetRParam(info, (int)i, (int)line->j);
         break;
       }
       if (parameter == NULL)
       {
-        *(texture->textdata++) = 0x00000000;
+        *(textdata++) = 0x00000000;
         i += hstep;
         continue;
       }
@@ -4135,14 +4101,14 @@ static void Vdp2DrawRotation_in(RBGDrawInfo * rbg) {
           break;
         case OVERMODE_TRANSE:
           if ((h < 0) || (h >= cellw) || (v < 0) || (v >= cellh)) {
-            *(texture->textdata++) = 0x0;
+            *(textdata++) = 0x0;
             i += hstep;
             continue;
           }
           break;
         case OVERMODE_512:
           if ((h < 0) || (h > 512) || (v < 0) || (v > 512)) {
-            *(texture->textdata++) = 0x00;
+            *(textdata++) = 0x00;
             i += hstep;
             continue;
           }
@@ -4158,7 +4124,7 @@ static void Vdp2DrawRotation_in(RBGDrawInfo * rbg) {
         switch (parameter->screenover) {
         case OVERMODE_TRANSE:
           if ((h < 0) || (h >= parameter->MaxH) || (v < 0) || (v >= parameter->MaxV)) {
-            *(texture->textdata++) = 0x00;
+            *(textdata++) = 0x00;
             i += hstep;
             continue;
           }
@@ -4185,7 +4151,7 @@ static void Vdp2DrawRotation_in(RBGDrawInfo * rbg) {
           break;
         case OVERMODE_512:
           if ((h < 0) || (h > 512) || (v < 0) || (v > 512)) {
-            *(texture->textdata++) = 0x00;
+            *(textdata++) = 0x00;
             i += hstep;
             continue;
           }
@@ -4333,12 +4299,181 @@ static void Vdp2DrawRotation_in(RBGDrawInfo * rbg) {
         }
       }
 
-      *(texture->textdata++) = color;
+      *(textdata++) = color;
       i += hstep;
     }
-    texture->textdata += texture->w;
+  }
+}
+
+static void Vdp2DrawRotationBand(void * data, int start, int end) {
+  rbgbands_struct * bands = (rbgbands_struct *)data;
+  vdp2draw_struct info = bands->info;
+  vdp2rotationparameter_struct pA = bands->paraA;
+  vdp2rotationparameter_struct pB = bands->paraB;
+
+  Vdp2DrawRotationLines(bands->rbg, &info, &pA, &pB, bands->lines, start, end, bands->textdata, bands->pitch);
+}
+
+static void Vdp2DrawRotation_in(RBGDrawInfo * rbg) {
+
+  if (rbg == NULL) return;
+
+  vdp2draw_struct *info = &rbg->info;
+  int rgb_type = rbg->rgb_type;
+  YglTexture *texture = &rbg->texture;
+  YglTexture *line_texture = &rbg->line_texture;
+
+  float j;
+  int vres, hres;
+  int lineInc = fixVdp2Regs->LCTA.part.U & 0x8000 ? 2 : 0;
+  int linecl = 0xFF;
+  Vdp2 * regs;
+  if ((fixVdp2Regs->CCCTL >> 5) & 0x01) {
+    linecl = ((~fixVdp2Regs->CCRLB & 0x1F) << 3) + 0x7;
+  }
+
+  if (vdp2height >= 448) {
+    lineInc <<= 1;
+    info->drawh = (vdp2height >> 1);
+    info->hres_shift = 1;
+  }
+  else {
+    info->hres_shift = 0;
+    info->drawh = vdp2height;
+  }
+
+  vres = rbg->vres/ rbg->rotate_mval_v;
+  hres = rbg->hres/ rbg->rotate_mval_h;
+  regs = Vdp2RestoreRegs(3, Vdp2Lines);
+
+  u32 lineaddr = 0;
+  if (rgb_type == 0)
+  {
+    paraA.dx = paraA.A * paraA.deltaX + paraA.B * paraA.deltaY;
+    paraA.dy = paraA.D * paraA.deltaX + paraA.E * paraA.deltaY;
+    paraA.Xp = paraA.A * (paraA.Px - paraA.Cx) +
+    paraA.B * (paraA.Py - paraA.Cy) +
+    paraA.C * (paraA.Pz - paraA.Cz) + paraA.Cx + paraA.Mx;
+    paraA.Yp = paraA.D * (paraA.Px - paraA.Cx) +
+    paraA.E * (paraA.Py - paraA.Cy) +
+    paraA.F * (paraA.Pz - paraA.Cz) + paraA.Cy + paraA.My;
+  }
+
+  if (rbg->useb)
+  {
+    paraB.dx = paraB.A * paraB.deltaX + paraB.B * paraB.deltaY;
+    paraB.dy = paraB.D * paraB.deltaX + paraB.E * paraB.deltaY;
+    paraB.Xp = paraB.A * (paraB.Px - paraB.Cx) + paraB.B * (paraB.Py - paraB.Cy)
+      + paraB.C * (paraB.Pz - paraB.Cz) + paraB.Cx + paraB.Mx;
+    paraB.Yp = paraB.D * (paraB.Px - paraB.Cx) + paraB.E * (paraB.Py - paraB.Cy)
+      + paraB.F * (paraB.Pz - paraB.Cz) + paraB.Cy + paraB.My;
+  }
+
+  paraA.over_pattern_name = fixVdp2Regs->OVPNRA;
+  paraB.over_pattern_name = fixVdp2Regs->OVPNRB;
+
+  if (_Ygl->rbg_use_compute_shader) {
+	  RBGGenerator_update(rbg);
+	  
+	  if (info->LineColorBase != 0) {
+		  const float vstep = 1.0 / rbg->rotate_mval_v;
+		  j = 0.0f;
+      int lvres = rbg->vres;
+      if (vres >= 480) {
+        lvres >>= 1;
+      }
+		  for (int jj = 0; jj < lvres; jj++) {
+			  if ((fixVdp2Regs->LCTA.part.U & 0x8000) != 0) {
+				  rbg->LineColorRamAdress = T1ReadWord(Vdp2RenderRam, info->LineColorBase + lineInc*(int)(j));
+				  *line_texture->textdata = rbg->LineColorRamAdress | (linecl << 24);
+				  line_texture->textdata++;
+          if (vres >= 480) {
+            *line_texture->textdata = rbg->LineColorRamAdress | (linecl << 24);
+            line_texture->textdata++;
+          }
+			  }
+			  else {
+				  *line_texture->textdata = rbg->LineColorRamAdress;
+				  line_texture->textdata++;
+			  }
+			  j += vstep;
+		  }
+	  }
+	
+	  return;
+  }
+
+  const float vstep = 1.0 / rbg->rotate_mval_v;
+  rbgline_struct * lines = (rbgline_struct *)malloc(rbg->vres * sizeof(rbgline_struct));
+  if (lines == NULL) return;
+
+  //for (j = 0; j < vres; j += vstep)
+  j = 0.0f;
+  for (int jj = 0; jj< rbg->vres; jj++)
+  {
+    rbgline_struct * line = &lines[jj];
+
+    line->j = j;
+    if (rgb_type == 0) {
+      line->XspA = paraA.A * ((paraA.Xst + paraA.deltaXst * j) - paraA.Px) +
+      paraA.B * ((paraA.Yst + paraA.deltaYst * j) - paraA.Py) +
+      paraA.C * (paraA.Zst - paraA.Pz);
+
+      line->YspA = paraA.D * ((paraA.Xst + paraA.deltaXst *j) - paraA.Px) +
+      paraA.E * ((paraA.Yst + paraA.deltaYst * j) - paraA.Py) +
+      paraA.F * (paraA.Zst - paraA.Pz);
+
+      line->KtablVA = paraA.deltaKAst* j;
+    }
+    if (rbg->useb)
+    {
+      line->XspB = paraB.A * ((paraB.Xst + paraB.deltaXst * j) - paraB.Px) +
+        paraB.B * ((paraB.Yst + paraB.deltaYst * j) - paraB.Py) +
+        paraB.C * (paraB.Zst - paraB.Pz);
+
+      line->YspB = paraB.D * ((paraB.Xst + paraB.deltaXst * j) - paraB.Px) +
+        paraB.E * ((paraB.Yst + paraB.deltaYst * j) - paraB.Py) +
+        paraB.F * (paraB.Zst - paraB.Pz);
+
+      line->KtablVB = paraB.deltaKAst * j;
+    }
+
+    if (info->LineColorBase != 0)
+    {
+      if ((fixVdp2Regs->LCTA.part.U & 0x8000) != 0) {
+        rbg->LineColorRamAdress = T1ReadWord(Vdp2RenderRam, info->LineColorBase  + lineInc*(int)(j) );
+        *line_texture->textdata = rbg->LineColorRamAdress | (linecl << 24);
+        line_texture->textdata++;
+      }
+      else {
+      *line_texture->textdata = rbg->LineColorRamAdress;
+        line_texture->textdata++;
+      }
+    }
+
     j += vstep;
   }
+
+  // Parameter A/B selection only reads paraA/paraB, so each band can draw
+  // from a copy of them. The rotation parameter window modes and RBG1 go
+  // through GetRParam, which uses the globals, and are drawn in one piece.
+  if ((fixVdp2Regs->RPMD | rgb_type) <= 2) {
+    rbgbands_struct bands;
+    bands.rbg = rbg;
+    bands.info = *info;
+    bands.paraA = paraA;
+    bands.paraB = paraB;
+    bands.lines = lines;
+    bands.textdata = texture->textdata;
+    bands.pitch = rbg->hres + texture->w;
+    Vdp2RotationDrawBands(Vdp2DrawRotationBand, &bands, rbg->vres);
+  }
+  else {
+    Vdp2DrawRotationLines(rbg, info, &paraA, &paraB, lines, 0, rbg->vres, texture->textdata, rbg->hres + texture->w);
+  }
+
+  texture->textdata += rbg->vres * (rbg->hres + texture->w);
+  free(lines);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -4426,6 +4561,8 @@ int VIDOGLInit(void)
   if (YglInit(2048, 1024, 8) != 0)
     return -1;
 
+  memset(vdp2_pattern_hash, 0, sizeof(vdp2_pattern_hash));
+
   SetSaturnResolution(320, 224);
 
   g_rgb0.async = 1;
@@ -6150,7 +6287,7 @@ static void Vdp2DrawBackScreen(void)
   ReadVdp2ColorOffset(fixVdp2Regs, &info, 0x20);
 
 #if defined(__ANDROID__) || defined(_OGLES3_) || defined(_OGL3_) || defined(NX)
-  dot = T1ReadWord(Vdp2Ram, scrAddr);
+  dot = T1ReadWord(Vdp2RenderRam, scrAddr);
 
   if ((fixVdp2Regs->BKTAU & 0x8000) != 0 ) {
     // per line background color
@@ -6158,7 +6295,7 @@ static void Vdp2DrawBackScreen(void)
     if (back_pixel_data != NULL) {
       for (int i = 0; i < vdp2height; i++) {
         u8 r, g, b, a;
-        dot = T1ReadWord(Vdp2Ram, (scrAddr + 2 * i));
+        dot = T1ReadWord(Vdp2RenderRam, (scrAddr + 2 * i));
         r = Y_MAX( ((dot & 0x1F) << 3) + info.cor, 0 );
         g = Y_MAX( (((dot & 0x3E0) >> 5) << 3) + info.cog , 0);
         b = Y_MAX( (((dot & 0x7C00) >> 10) << 3) + info.cob, 0 );
@@ -6187,7 +6324,7 @@ static void Vdp2DrawBackScreen(void)
 
     for (y = 0; y < vdp2height; y++)
     {
-      dot = T1ReadWord(Vdp2Ram, scrAddr);
+      dot = T1ReadWord(Vdp2RenderRam, scrAddr);
       scrAddr += 2;
 
       lineColors[3 * y + 0] = (dot & 0x1F) << 3;
@@ -6209,7 +6346,7 @@ static void Vdp2DrawBackScreen(void)
   }
   else
   {
-    dot = T1ReadWord(Vdp2Ram, scrAddr);
+    dot = T1ReadWord(Vdp2RenderRam, scrAddr);
 
     glColor3ub((dot & 0x1F) << 3, (dot & 0x3E0) >> 2, (dot & 0x7C00) >> 7);
 
@@ -6268,7 +6405,7 @@ int Vdp2DrawLineColorScreen(void)
 
   addr = (fixVdp2Regs->LCTA.all & 0x7FFFF) * 0x2;
   for (i = 0; i < line_cnt; i++) {
-    u16 LineColorRamAdress = T1ReadWord(Vdp2Ram, addr);
+    u16 LineColorRamAdress = T1ReadWord(Vdp2RenderRam, addr);
     *(line_pixel_data) = Vdp2ColorRamGetColor(LineColorRamAdress, alpha);
     line_pixel_data++;
     addr += inc;
@@ -6508,7 +6645,7 @@ static void Vdp2DrawNBG0(void)
     if (!info.enable) return;
 
     // Read in Parameter B
-    Vdp2ReadRotationTable(1, &paraB, fixVdp2Regs, Vdp2Ram);
+    Vdp2ReadRotationTable(1, &paraB, fixVdp2Regs, Vdp2RenderRam);
 
     if ((info.isbitmap = fixVdp2Regs->CHCTLA & 0x2) != 0)
     {
@@ -7522,7 +7659,7 @@ static void Vdp2DrawRBG0(void)
   if (!(info->enable & Vdp2External.disptoggle) || (info->priority == 0)) {
 
     if (Vdp1Regs->TVMR & 0x02) {
-      Vdp2ReadRotationTable(0, &paraA, fixVdp2Regs, Vdp2Ram);
+      Vdp2ReadRotationTable(0, &paraA, fixVdp2Regs, Vdp2RenderRam);
     }
     return;
   }
@@ -7553,8 +7690,8 @@ static void Vdp2DrawRBG0(void)
   info->linescrolltbl = 0;
   info->lineinc = 0;
 
-  Vdp2ReadRotationTable(0, &paraA, fixVdp2Regs, Vdp2Ram);
-  Vdp2ReadRotationTable(1, &paraB, fixVdp2Regs, Vdp2Ram);
+  Vdp2ReadRotationTable(0, &paraA, fixVdp2Regs, Vdp2RenderRam);
+  Vdp2ReadRotationTable(1, &paraB, fixVdp2Regs, Vdp2RenderRam);
   A0_Updated = 0;
   A1_Updated = 0;
   B0_Updated = 0;
@@ -7994,7 +8131,7 @@ vdp2rotationparameter_struct * FASTCALL vdp2rGetKValue2W(vdp2rotationparameter_s
   //kdata = param->prefecth_k2w[index];
 
   if (param->k_mem_type == 0) { // vram
-    kdata = T1ReadLong(Vdp2Ram, (param->coeftbladdr + (index << 2)) & 0x7FFFF);
+    kdata = T1ReadLong(Vdp2RenderRam, (param->coeftbladdr + (index << 2)) & 0x7FFFF);
   }
   else { // cram
     kdata = T2ReadLong((Vdp2ColorRam + 0x800), (param->coeftbladdr + (index << 2)) & 0xFFF);
@@ -8027,7 +8164,7 @@ vdp2rotationparameter_struct * FASTCALL vdp2rGetKValue1W(vdp2rotationparameter_s
   u16   kdata;
 
   if (param->k_mem_type == 0) { // vram
-    kdata = T1ReadWord(Vdp2Ram, (param->coeftbladdr + (index << 1)) & 0x7FFFF);
+    kdata = T1ReadWord(Vdp2RenderRam, (param->coeftbladdr + (index << 1)) & 0x7FFFF);
   }
   else { // cram
     kdata = T2ReadWord((Vdp2ColorRam + 0x800), (param->coeftbladdr + (index << 1)) & 0xFFF);
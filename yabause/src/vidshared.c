@@ -47,6 +47,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
 #include "vdp1.h"
 #include "debug.h"
 #include "cs2.h"
+#include "threads.h"
+#include "trace.h"
 
 //////////////////////////////////////////////////////////////////////////////
 
@@ -785,3 +787,115 @@ fixed32 Vdp2ReadCoefficientMode0_2FP(vdp2rotationparameterfp_struct *parameter,
 
 //////////////////////////////////////////////////////////////////////////////
 
+static struct
+{
+   volatile int need_draw[VDP2_ROTATION_BAND_THREADS];
+   volatile int draw_finished[VDP2_ROTATION_BAND_THREADS];
+   int started[VDP2_ROTATION_BAND_THREADS];
+   int start[VDP2_ROTATION_BAND_THREADS];
+   int end[VDP2_ROTATION_BAND_THREADS];
+   Vdp2RotationBandFunc func;
+   void * data;
+} vdp2_rotation_bands;
+
+static const char * const vdp2_rotation_band_names[VDP2_ROTATION_BAND_THREADS] = {
+   "vdp2 rotation band 0", "vdp2 rotation band 1", "vdp2 rotation band 2"
+};
+
+static int vdp2_rotation_num_band_threads = 0;
+static YabMutex * vdp2_rotation_band_mutex = NULL;
+
+static void * Vdp2RotationBandThread(void * arg)
+{
+   int num = (int)(size_t)arg;
+
+   TraceThreadName(vdp2_rotation_band_names[num]);
+   for (;;)
+   {
+      if (vdp2_rotation_bands.need_draw[num])
+      {
+         vdp2_rotation_bands.need_draw[num] = 0;
+         TRACE_BEGIN(TRACE_VDP2_ROTATION_BAND);
+         vdp2_rotation_bands.func(vdp2_rotation_bands.data, vdp2_rotation_bands.start[num], vdp2_rotation_bands.end[num]);
+         TRACE_END(TRACE_VDP2_ROTATION_BAND);
+         vdp2_rotation_bands.draw_finished[num] = 1;
+      }
+      YabThreadSleep();
+   }
+
+   return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// num is the total number of threads drawing, the calling one included.
+// Call it from the emulation thread while nothing is being drawn.
+void Vdp2RotationSetNumBandThreads(int num)
+{
+   num -= 1;
+   if (num < 0)
+      num = 0;
+   if (num > VDP2_ROTATION_BAND_THREADS)
+      num = VDP2_ROTATION_BAND_THREADS;
+
+   if (num > 0 && vdp2_rotation_band_mutex == NULL)
+      vdp2_rotation_band_mutex = YabThreadCreateMutex();
+
+   vdp2_rotation_num_band_threads = num;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Both rotation layers can be drawn at the same time from different threads,
+// they take turns using the workers.
+void Vdp2RotationDrawBands(Vdp2RotationBandFunc func, void *data, int height)
+{
+   int num_threads = vdp2_rotation_num_band_threads;
+   int num_bands, i;
+
+   if (num_threads == 0 || vdp2_rotation_band_mutex == NULL || height < 2 * (num_threads + 1))
+   {
+      func(data, 0, height);
+      return;
+   }
+
+   YabThreadLock(vdp2_rotation_band_mutex);
+
+   for (i = 0; i < num_threads; i++)
+   {
+      if (vdp2_rotation_bands.started[i])
+         continue;
+
+      vdp2_rotation_bands.need_draw[i] = 0;
+      vdp2_rotation_bands.draw_finished[i] = 1;
+      if (YabThreadStart(YAB_THREAD_VDP2_ROTATION_BAND_0 + i, vdp2_rotation_band_names[i], Vdp2RotationBandThread, (void *)(size_t)i) != 0)
+         break;
+      vdp2_rotation_bands.started[i] = 1;
+   }
+   num_threads = i;
+   num_bands = num_threads + 1;
+
+   vdp2_rotation_bands.func = func;
+   vdp2_rotation_bands.data = data;
+
+   // the calling thread draws the top band
+   for (i = 0; i < num_threads; i++)
+   {
+      vdp2_rotation_bands.start[i] = (height * (i + 1)) / num_bands;
+      vdp2_rotation_bands.end[i] = (height * (i + 2)) / num_bands;
+      vdp2_rotation_bands.draw_finished[i] = 0;
+      vdp2_rotation_bands.need_draw[i] = 1;
+      YabThreadWake(YAB_THREAD_VDP2_ROTATION_BAND_0 + i);
+   }
+
+   func(data, 0, height / num_bands);
+
+   for (i = 0; i < num_threads; i++)
+   {
+      while (!vdp2_rotation_bands.draw_finished[i]){}
+   }
+
+   YabThreadUnLock(vdp2_rotation_band_mutex);
+}
+
+//////////////////////////////////////////////////////////////////////////////
@@ -306,6 +306,15 @@ void FASTCALL Vdp2ParameterBPlaneAddr(vdp2draw_struct *info, int i, Vdp2* regs);
 float Vdp2ReadCoefficientMode0_2(vdp2rotationparameter_struct *parameter, u32 addr, u8* ram);
 fixed32 Vdp2ReadCoefficientMode0_2FP(vdp2rotationparameterfp_struct *parameter, u32 addr, u8* ram);
 
+// Rotation layers are drawn in horizontal bands, one per worker plus one on
+// the calling thread. func draws lines start to end-1.
+#define VDP2_ROTATION_BAND_THREADS 3
+
+typedef void (*Vdp2RotationBandFunc)(void *data, int start, int end);
+
+void Vdp2RotationSetNumBandThreads(int num);
+void Vdp2RotationDrawBands(Vdp2RotationBandFunc func, void *data, int height);
+
 //////////////////////////////////////////////////////////////////////////////
 
 static INLINE int GenerateRotatedXPos(vdp2rotationparameter_struct *p, int x, int y)
@@ -358,6 +367,30 @@ static INLINE int GenerateRotatedYPosFP(vdp2rotationparameterfp_struct *p, int x
 
 //////////////////////////////////////////////////////////////////////////////
 
+// Same coordinates as GenerateRotatedXPosFP/GenerateRotatedYPosFP for dots
+// 0 to count-1 of a line, for when kx, ky and Xp don't change along it.
+// Xsp/Ysp are worked out once and stepped by dX/dY, which leaves one multiply
+// per coordinate in a loop the compiler can vectorize.
+static INLINE void GenerateRotatedLineFP(vdp2rotationparameterfp_struct *p, fixed32 xmul, fixed32 ymul, fixed32 C, fixed32 F, int count, int *xs, int *ys)
+{
+   const fixed32 kx = p->kx, ky = p->ky;
+   const fixed32 Xp = p->Xp, Yp = p->Yp;
+   const u32 dX = (u32)p->dX, dY = (u32)p->dY;
+   u32 Xsp = (u32)(mulfixed(p->A, xmul) + mulfixed(p->B, ymul) + C);
+   u32 Ysp = (u32)(mulfixed(p->D, xmul) + mulfixed(p->E, ymul) + F);
+   int i;
+
+   for (i = 0; i < count; i++)
+   {
+      xs[i] = touint(mulfixed(kx, (fixed32)Xsp) + Xp);
+      ys[i] = touint(mulfixed(ky, (fixed32)Ysp) + Yp);
+      Xsp += dX;
+      Ysp += dY;
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 static INLINE void CalculateRotationValues(vdp2rotationparameter_struct *p)
 {
    p->Xp=p->A * (p->Px - p->Cx) +
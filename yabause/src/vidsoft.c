@@ -25,6 +25,7 @@
 */
 
 #include "vidsoft.h"
+#include "avcapture.h"
 #include "ygl.h"
 #include "vidshared.h"
 #include "debug.h"
@@ -41,10 +42,19 @@
 
 #include "yui.h"
 #include "threads.h"
+#include "trace.h"
 
 #include <stdlib.h>
 #include <limits.h>
 
+// Rasterizer scratch state is per thread, so the VDP1 band threads can each
+// draw their part of the command list at the same time
+#ifdef _MSC_VER
+#define VIDSOFT_TLS __declspec(thread)
+#else
+#define VIDSOFT_TLS __thread
+#endif
+
 #if defined WORDS_BIGENDIAN
 static INLINE u32 COLSAT2YAB16(int priority,u32 temp)            { return (priority | (temp & 0x7C00) << 1 | (temp & 0x3E0) << 14 | (temp & 0x1F) << 27); }
 static INLINE u32 COLSAT2YAB32(int priority,u32 temp)            { return (((temp & 0xFF) << 24) | ((temp & 0xFF00) << 8) | ((temp & 0xFF0000) >> 8) | priority); }
@@ -108,6 +118,11 @@ void VIDSoftGetNativeResolution(int *width, int *height, int*interlace);
 void VIDSoftVdp2DispOff(void);void VIDSoftVdp2DispOff(void);
 void VIDSoftOnUpdateColorRamWord(u32 addr) {}
 void VIDSoftVulkanGetScreenshot(void ** outbuf, int * width, int * height) { return; }
+static void VidsoftVdp1TextureCacheFree(void);
+static void VidsoftVdp1DrawBands(void);
+void * VidsoftVdp1BandThread0(void * data);
+void * VidsoftVdp1BandThread1(void * data);
+void * VidsoftVdp1BandThread2(void * data);
 VideoInterface_struct VIDSoft = {
 VIDCORE_SOFT,
 "Software Video Interface",
@@ -184,12 +199,34 @@ struct VidsoftVdp1ThreadContext
    volatile int draw_finished;
    volatile int need_draw;
    Vdp1 regs;
+   u32 page_gen[VDP1_RAM_PAGE_COUNT];
    u8 ram[0x80000];
    u8 back_framebuffer[0x40000];
 }vidsoft_vdp1_thread_context;
 
 int vidsoft_vdp1_thread_enabled = 0;
 
+#define VIDSOFT_VDP1_BAND_THREADS 3
+
+//the vdp1 thread parses the command list, sorts the commands into
+//horizontal bands of the framebuffer and draws one band itself while the
+//band threads draw the others
+struct
+{
+   volatile int need_draw[VIDSOFT_VDP1_BAND_THREADS];
+   volatile int draw_finished[VIDSOFT_VDP1_BAND_THREADS];
+   struct
+   {
+      int start;
+      int end;
+      int count;
+      u16 cmds[VDP1_MAX_COMMANDS];
+   }bands[VIDSOFT_VDP1_BAND_THREADS + 1];
+}vidsoft_vdp1_band_context;
+
+static vdp1cmdlist_struct vidsoft_vdp1_cmdlist;
+int vidsoft_num_vdp1_band_threads = 0;
+
 typedef struct { s16 x; s16 y; } vdp1vertex;
 
 typedef struct
@@ -1139,18 +1176,333 @@ int Rbg0CheckRam(Vdp2* regs)
    return 0;
 }
 
-static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparameterfp_struct *parameter, Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data)
+#define ROTATION_MAX_LINES 512
+#define ROTATION_MAX_WIDTH 704
+
+// Per-line state of the rotation accumulators, worked out once on the
+// calling thread so every band can start at any line
+typedef struct
 {
+   fixed32 xmul, ymul;
+   fixed32 xmul2, ymul2;
+   u32 coefy, rcoefy;
+   u32 coefy2, rcoefy2;
+   u32 linewnd0addr, linewnd1addr;
+   u32 rplinewnd0addr, rplinewnd1addr;
+} rotationline_struct;
+
+// Everything a band needs. The bands draw from private copies of what the
+// per-line and per-dot code modifies (info, the parameters, the screen and
+// window state) and only share what stays constant while drawing.
+typedef struct
+{
+   vdp2draw_struct *info;
+   vdp2rotationparameterfp_struct *p;
+   vdp2rotationparameterfp_struct *p2;
+   screeninfo_struct sinfo, sinfo2;
+   clipping_struct clip[2];
+   clipping_struct rpwindow[2];
+   int userpwindow;
+   int isrplinewindow;
+   u32 lineAddr, lineInc;
+   fixed32 C, F, C2, F2;
+   int width;
+   Vdp2* lines;
+   Vdp2* regs;
+   u8* ram;
+   u8* color_ram;
+   rotationline_struct line[ROTATION_MAX_LINES];
+} rotationdraw_struct;
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void Vdp2DrawRotationBandFP(void *data, int start, int end)
+{
+   rotationdraw_struct *d = (rotationdraw_struct *)data;
+   vdp2draw_struct info = *d->info;
+   vdp2rotationparameterfp_struct *p = d->p;
+   screeninfo_struct sinfo = d->sinfo;
+   clipping_struct clip[2];
+   int xs[ROTATION_MAX_WIDTH], ys[ROTATION_MAX_WIDTH];
    int i, j;
-   int x, y;
-   screeninfo_struct sinfo;
+
+   clip[0] = d->clip[0];
+   clip[1] = d->clip[1];
+
+   for (j = start; j < end; j++)
+   {
+      rotationline_struct *line = &d->line[j];
+      u32 linewnd0addr = line->linewnd0addr;
+      u32 linewnd1addr = line->linewnd1addr;
+
+      info.LoadLineParams(&info, &sinfo, j, d->lines);
+      ReadLineWindowClip(info.islinewindow, clip, &linewnd0addr, &linewnd1addr, d->ram, d->regs);
+
+      GenerateRotatedLineFP(p, line->xmul, line->ymul, d->C, d->F, d->width, xs, ys);
+
+      for (i = 0; i < d->width; i++)
+      {
+         u32 color, dot;
+         int x, y;
+
+         if (!TestBothWindow(info.wctl, clip, i, j))
+            continue;
+
+         x = xs[i] & sinfo.xmask;
+         y = ys[i] & sinfo.ymask;
+
+         // Convert coordinates into graphics
+         if (!info.isbitmap)
+         {
+            // Tile
+            Vdp2MapCalcXY(&info, &x, &y, &sinfo, d->regs, d->ram, 0);
+         }
+
+         // Fetch pixel
+         if (!Vdp2FetchPixel(&info, x, y, &color, &dot, d->ram, info.charaddr, info.paladdr, d->color_ram))
+         {
+            continue;
+         }
+
+         Rbg0PutPixel(&info, color, dot, i, j);
+      }
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void Vdp2DrawRotationCoefBandFP(void *data, int start, int end)
+{
+   rotationdraw_struct *d = (rotationdraw_struct *)data;
+   vdp2draw_struct info = *d->info;
+   vdp2rotationparameterfp_struct param = *d->p;
+   vdp2rotationparameterfp_struct param2;
+   vdp2rotationparameterfp_struct *p = &param;
+   vdp2rotationparameterfp_struct *p2 = NULL;
+   screeninfo_struct sinfo = d->sinfo;
+   screeninfo_struct sinfo2;
+   clipping_struct clip[2], rpwindow[2];
+   int xs[ROTATION_MAX_WIDTH], ys[ROTATION_MAX_WIDTH];
+   int xs2[ROTATION_MAX_WIDTH], ys2[ROTATION_MAX_WIDTH];
+   Vdp2* regs = d->regs;
+   u8* ram = d->ram;
+   int i, j;
+
+   if (d->p2 != NULL)
+   {
+      param2 = *d->p2;
+      p2 = &param2;
+      sinfo2 = d->sinfo2;
+   }
+
+   clip[0] = d->clip[0];
+   clip[1] = d->clip[1];
+   rpwindow[0] = d->rpwindow[0];
+   rpwindow[1] = d->rpwindow[1];
+
+   // The line color of a line uses the coefficient last read, which is the
+   // one of the last dot of the line above when they're read per dot
+   if (start > 0 && info.linescreen > 1 && p->deltaKAx != 0)
+   {
+      rotationline_struct *line = &d->line[start - 1];
+      u32 coefx = 0, rcoefx = 0;
+
+      for (i = 0; i < d->width - 1; i++)
+      {
+         coefx += toint(p->deltaKAx);
+         rcoefx += decipart(p->deltaKAx);
+      }
+
+      Vdp2ReadCoefficientFP(p,
+                            p->coeftbladdr +
+                            (line->coefy + coefx + toint(rcoefx + line->rcoefy)) *
+                            p->coefdatasize, ram);
+   }
+
+   for (j = start; j < end; j++)
+   {
+      rotationline_struct *line = &d->line[j];
+      u32 coefx = 0, rcoefx = 0;
+      u32 coefx2 = 0, rcoefx2 = 0;
+      u32 linewnd0addr = line->linewnd0addr;
+      u32 linewnd1addr = line->linewnd1addr;
+      u32 rplinewnd0addr = line->rplinewnd0addr;
+      u32 rplinewnd1addr = line->rplinewnd1addr;
+      int perdot2 = (p2 != NULL) && p2->coefenab && (p2->deltaKAx != 0);
+
+      if (p->deltaKAx == 0)
+      {
+         Vdp2ReadCoefficientFP(p,
+                               p->coeftbladdr +
+                               (line->coefy + touint(line->rcoefy)) *
+                               p->coefdatasize, ram);
+      }
+      if ((p2 != NULL) && p2->coefenab && (p2->deltaKAx == 0))
+      {
+         Vdp2ReadCoefficientFP(p2,
+                               p2->coeftbladdr +
+                               (line->coefy2 + touint(line->rcoefy2)) *
+                               p2->coefdatasize, ram);
+      }
+
+      if (info.linescreen > 1)
+      {
+         u16 lineColorAddr = (T1ReadWord(ram, d->lineAddr + d->lineInc * j) & 0x780) | p->linescreen;
+         u32 lineColor = Vdp2ColorRamGetColor(lineColorAddr, d->color_ram);
+         TitanPutLineHLine(info.linescreen, j, COLSAT2YAB32(0x3F, lineColor));
+      }
+
+      info.LoadLineParams(&info, &sinfo, j, d->lines);
+      ReadLineWindowClip(info.islinewindow, clip, &linewnd0addr, &linewnd1addr, ram, regs);
+
+      if (d->userpwindow)
+         ReadLineWindowClip(d->isrplinewindow, rpwindow, &rplinewnd0addr, &rplinewnd1addr, ram, regs);
+
+      // Coefficients read once per line leave the whole line with the same
+      // scaling, so the coordinates can be generated up front
+      if (p->deltaKAx == 0)
+         GenerateRotatedLineFP(p, line->xmul, line->ymul, d->C, d->F, d->width, xs, ys);
+      if ((p2 != NULL) && !perdot2)
+         GenerateRotatedLineFP(p2, line->xmul2, line->ymul2, d->C2, d->F2, d->width, xs2, ys2);
+
+      for (i = 0; i < d->width; i++)
+      {
+         u32 color, dot;
+         int x, y;
+
+         if (p->deltaKAx != 0)
+         {
+            Vdp2ReadCoefficientFP(p,
+                                  p->coeftbladdr +
+                                  (line->coefy + coefx + toint(rcoefx + line->rcoefy)) *
+                                  p->coefdatasize, ram);
+            coefx += toint(p->deltaKAx);
+            rcoefx += decipart(p->deltaKAx);
+         }
+         if (perdot2)
+         {
+            Vdp2ReadCoefficientFP(p2,
+                                  p2->coeftbladdr +
+                                  (line->coefy2 + coefx2 + toint(rcoefx2 + line->rcoefy2)) *
+                                  p2->coefdatasize, ram);
+            coefx2 += toint(p2->deltaKAx);
+            rcoefx2 += decipart(p2->deltaKAx);
+         }
+
+         if (!TestBothWindow(info.wctl, clip, i, j))
+            continue;
+
+         if (((! d->userpwindow) && p->msb) || (d->userpwindow && (! TestBothWindow(regs->WCTLD, rpwindow, i, j))))
+         {
+            if ((p2 == NULL) || (p2->coefenab && p2->msb)) continue;
+
+            if (perdot2)
+            {
+               x = GenerateRotatedXPosFP(p2, i, line->xmul2, line->ymul2, d->C2);
+               y = GenerateRotatedYPosFP(p2, i, line->xmul2, line->ymul2, d->F2);
+            }
+            else
+            {
+               x = xs2[i];
+               y = ys2[i];
+            }
+
+            switch(p2->screenover) {
+               case 0:
+                  x &= sinfo2.xmask;
+                  y &= sinfo2.ymask;
+                  break;
+               case 1:
+                  VDP2LOG("Screen-over mode 1 not implemented");
+                  x &= sinfo2.xmask;
+                  y &= sinfo2.ymask;
+                  break;
+               case 2:
+                  if ((x > sinfo2.xmask) || (y > sinfo2.ymask)) continue;
+                  break;
+               case 3:
+                  if ((x > 512) || (y > 512)) continue;
+            }
+
+            // Convert coordinates into graphics
+            if (!info.isbitmap)
+            {
+               // Tile
+               Vdp2MapCalcXY(&info, &x, &y, &sinfo2, regs, ram, 0);
+            }
+         }
+         else if (p->msb) continue;
+         else
+         {
+            if (p->deltaKAx != 0)
+            {
+               x = GenerateRotatedXPosFP(p, i, line->xmul, line->ymul, d->C);
+               y = GenerateRotatedYPosFP(p, i, line->xmul, line->ymul, d->F);
+            }
+            else
+            {
+               x = xs[i];
+               y = ys[i];
+            }
+
+            switch(p->screenover) {
+               case 0:
+                  x &= sinfo.xmask;
+                  y &= sinfo.ymask;
+                  break;
+               case 1:
+                  VDP2LOG("Screen-over mode 1 not implemented");
+                  x &= sinfo.xmask;
+                  y &= sinfo.ymask;
+                  break;
+               case 2:
+                  if ((x > sinfo.xmask) || (y > sinfo.ymask)) continue;
+                  break;
+               case 3:
+                  if ((x > 512) || (y > 512)) continue;
+            }
+
+            // Convert coordinates into graphics
+            if (!info.isbitmap)
+            {
+               // Tile
+               Vdp2MapCalcXY(&info, &x, &y, &sinfo, regs, ram, 0);
+            }
+         }
+
+         // Fetch pixel
+         if (!Vdp2FetchPixel(&info, x, y, &color, &dot, ram, info.charaddr, info.paladdr, d->color_ram))
+         {
+            continue;
+         }
+
+         Rbg0PutPixel(&info, color, dot, i, j);
+      }
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparameterfp_struct *parameter, Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data)
+{
+   int j;
    vdp2rotationparameterfp_struct *p=&parameter[info->rotatenum];
-   clipping_struct clip[2];
    u32 linewnd0addr, linewnd1addr;
-
-   clip[0].xstart = clip[0].ystart = clip[0].xend = clip[0].yend = 0;
-   clip[1].xstart = clip[1].ystart = clip[1].xend = clip[1].yend = 0;
-   ReadWindowData(info->wctl, clip, regs);
+   clipping_struct lineclip[2];
+   rotationdraw_struct d;
+
+   d.info = info;
+   d.p = p;
+   d.p2 = NULL;
+   d.lines = lines;
+   d.regs = regs;
+   d.ram = ram;
+   d.color_ram = color_ram;
+   d.width = rbg0width < ROTATION_MAX_WIDTH ? rbg0width : ROTATION_MAX_WIDTH;
+
+   d.clip[0].xstart = d.clip[0].ystart = d.clip[0].xend = d.clip[0].yend = 0;
+   d.clip[1].xstart = d.clip[1].ystart = d.clip[1].xend = d.clip[1].yend = 0;
+   ReadWindowData(info->wctl, d.clip, regs);
    linewnd0addr = linewnd1addr = 0;
    ReadLineWindowData(&info->islinewindow, info->wctl, &linewnd0addr, &linewnd1addr, regs);
 
@@ -1158,7 +1510,8 @@ static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparam
 
    if (!p->coefenab)
    {
-      fixed32 xmul, ymul, C, F;
+      fixed32 xmul, ymul;
+      int height = vdp2height < ROTATION_MAX_LINES ? vdp2height : ROTATION_MAX_LINES;
 
       // Since coefficients aren't being used, we can simplify the drawing process
       if (IsScreenRotatedFP(p))
@@ -1171,98 +1524,74 @@ static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparam
       }
       else
       {
-         GenerateRotatedVarFP(p, &xmul, &ymul, &C, &F);
+         GenerateRotatedVarFP(p, &xmul, &ymul, &d.C, &d.F);
 
          // Do simple rotation
          CalculateRotationValuesFP(p);
 
-         SetupScreenVars(info, &sinfo, info->PlaneAddr, regs);
+         SetupScreenVars(info, &d.sinfo, info->PlaneAddr, regs);
 
-         for (j = 0; j < vdp2height; j++)
+         for (j = 0; j < height; j++)
          {
-            info->LoadLineParams(info, &sinfo, j, lines);
-            ReadLineWindowClip(info->islinewindow, clip, &linewnd0addr, &linewnd1addr, ram, regs);
-
-            for (i = 0; i < rbg0width; i++)
-            {
-               u32 color, dot;
-
-               if (!TestBothWindow(info->wctl, clip, i, j))
-                  continue;
-
-               x = GenerateRotatedXPosFP(p, i, xmul, ymul, C) & sinfo.xmask;
-               y = GenerateRotatedYPosFP(p, i, xmul, ymul, F) & sinfo.ymask;
-
-               // Convert coordinates into graphics
-               if (!info->isbitmap)
-               {
-                  // Tile
-                  Vdp2MapCalcXY(info, &x, &y, &sinfo, regs, ram,0);
-               }
- 
-               // Fetch pixel
-               if (!Vdp2FetchPixel(info, x, y, &color, &dot, ram, info->charaddr,info->paladdr, color_ram))
-               {
-                  continue;
-               }
-
-               Rbg0PutPixel(info, color, dot, i, j);
-            }
+            d.line[j].xmul = xmul;
+            d.line[j].ymul = ymul;
+            d.line[j].linewnd0addr = linewnd0addr;
+            d.line[j].linewnd1addr = linewnd1addr;
+            ReadLineWindowClip(info->islinewindow, lineclip, &linewnd0addr, &linewnd1addr, ram, regs);
             xmul += p->deltaXst;
             ymul += p->deltaYst;
          }
 
+         Vdp2RotationDrawBands(Vdp2DrawRotationBandFP, &d, height);
          return;
       }
    }
    else
    {
-      fixed32 xmul, ymul, C, F;
-      u32 coefx, coefy;
-      u32 rcoefx, rcoefy;
-      u32 lineAddr, lineColor, lineInc;
-      u16 lineColorAddr;
-
-      fixed32 xmul2, ymul2, C2, F2;
-      u32 coefx2, coefy2;
-      u32 rcoefx2, rcoefy2;
-      screeninfo_struct sinfo2;
+      fixed32 xmul, ymul;
+      u32 coefy, rcoefy;
+
+      fixed32 xmul2, ymul2;
+      u32 coefy2, rcoefy2;
       vdp2rotationparameterfp_struct *p2 = NULL;
 
-      clipping_struct rpwindow[2];
-      int userpwindow = 0;
-      int isrplinewindow = 0;
       u32 rplinewnd0addr, rplinewnd1addr;
+      int height = rbg0height < ROTATION_MAX_LINES ? rbg0height : ROTATION_MAX_LINES;
+
+      d.userpwindow = 0;
+      d.isrplinewindow = 0;
+      memset(d.rpwindow, 0, sizeof(d.rpwindow));
+      rplinewnd0addr = rplinewnd1addr = 0;
 
       if ((regs->RPMD & 3) == 2)
          p2 = &parameter[1 - info->rotatenum];
       else if ((regs->RPMD & 3) == 3)
       {
-         ReadWindowData(regs->WCTLD, rpwindow, regs);
-         rplinewnd0addr = rplinewnd1addr = 0;
-         ReadLineWindowData(&isrplinewindow, regs->WCTLD, &rplinewnd0addr, &rplinewnd1addr, regs);
-         userpwindow = 1;
+         ReadWindowData(regs->WCTLD, d.rpwindow, regs);
+         ReadLineWindowData(&d.isrplinewindow, regs->WCTLD, &rplinewnd0addr, &rplinewnd1addr, regs);
+         d.userpwindow = 1;
          p2 = &parameter[1 - info->rotatenum];
       }
 
-      GenerateRotatedVarFP(p, &xmul, &ymul, &C, &F);
+      GenerateRotatedVarFP(p, &xmul, &ymul, &d.C, &d.F);
 
       // Rotation using Coefficient Tables(now this stuff just gets wacky. It
       // has to be done in software, no exceptions)
       CalculateRotationValuesFP(p);
 
-      SetupScreenVars(info, &sinfo, p->PlaneAddr, regs);
-      coefx = coefy = 0;
-      rcoefx = rcoefy = 0;
+      SetupScreenVars(info, &d.sinfo, p->PlaneAddr, regs);
+      coefy = 0;
+      rcoefy = 0;
+      xmul2 = ymul2 = 0;
+      coefy2 = rcoefy2 = 0;
+      d.C2 = d.F2 = 0;
 
       if (p2 != NULL)
       {
          Vdp2ReadRotationTableFP(1 - info->rotatenum, p2, regs, ram);
-         GenerateRotatedVarFP(p2, &xmul2, &ymul2, &C2, &F2);
+         GenerateRotatedVarFP(p2, &xmul2, &ymul2, &d.C2, &d.F2);
          CalculateRotationValuesFP(p2);
-         SetupScreenVars(info, &sinfo2, p2->PlaneAddr, regs);
-         coefx2 = coefy2 = 0;
-         rcoefx2 = rcoefy2 = 0;
+         SetupScreenVars(info, &d.sinfo2, p2->PlaneAddr, regs);
       }
 
       if (Rbg0CheckRam(regs))//sonic r / all star baseball 97
@@ -1278,6 +1607,7 @@ static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparam
          }
       }
 
+      d.lineAddr = d.lineInc = 0;
       if (info->linescreen)
       {
          if ((info->rotatenum == 0) && (regs->KTCTL & 0x10))
@@ -1285,144 +1615,36 @@ static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparam
          else if (regs->KTCTL & 0x1000)
             info->linescreen = 3;
          if (regs->VRSIZE & 0x8000)
-            lineAddr = (regs->LCTA.all & 0x7FFFF) << 1;
+            d.lineAddr = (regs->LCTA.all & 0x7FFFF) << 1;
          else
-            lineAddr = (regs->LCTA.all & 0x3FFFF) << 1;
+            d.lineAddr = (regs->LCTA.all & 0x3FFFF) << 1;
 
-         lineInc = regs->LCTA.part.U & 0x8000 ? 2 : 0;
+         d.lineInc = regs->LCTA.part.U & 0x8000 ? 2 : 0;
       }
 
-      for (j = 0; j < rbg0height; j++)
+      for (j = 0; j < height; j++)
       {
-         if (p->deltaKAx == 0)
-         {
-            Vdp2ReadCoefficientFP(p,
-                                  p->coeftbladdr +
-                                  (coefy + touint(rcoefy)) *
-                                  p->coefdatasize, ram);
-         }
-         if ((p2 != NULL) && p2->coefenab && (p2->deltaKAx == 0))
-         {
-            Vdp2ReadCoefficientFP(p2,
-                                  p2->coeftbladdr +
-                                  (coefy2 + touint(rcoefy2)) *
-                                  p2->coefdatasize, ram);
-         }
-
-         if (info->linescreen > 1)
-         {
-            lineColorAddr = (T1ReadWord(ram, lineAddr) & 0x780) | p->linescreen;
-            lineColor = Vdp2ColorRamGetColor(lineColorAddr, color_ram);
-            lineAddr += lineInc;
-            TitanPutLineHLine(info->linescreen, j, COLSAT2YAB32(0x3F, lineColor));
-         }
-
-         info->LoadLineParams(info, &sinfo, j, lines);
-         ReadLineWindowClip(info->islinewindow, clip, &linewnd0addr, &linewnd1addr, ram, regs);
-
-         if (userpwindow)
-            ReadLineWindowClip(isrplinewindow, rpwindow, &rplinewnd0addr, &rplinewnd1addr, ram, regs);
-
-         for (i = 0; i < rbg0width; i++)
-         {
-            u32 color, dot;
-
-            if (p->deltaKAx != 0)
-            {
-               Vdp2ReadCoefficientFP(p,
-                                     p->coeftbladdr +
-                                     (coefy + coefx + toint(rcoefx + rcoefy)) *
-                                     p->coefdatasize, ram);
-               coefx += toint(p->deltaKAx);
-               rcoefx += decipart(p->deltaKAx);
-            }
-            if ((p2 != NULL) && p2->coefenab && (p2->deltaKAx != 0))
-            {
-               Vdp2ReadCoefficientFP(p2,
-                                     p2->coeftbladdr +
-                                     (coefy2 + coefx2 + toint(rcoefx2 + rcoefy2)) *
-                                     p2->coefdatasize, ram);
-               coefx2 += toint(p2->deltaKAx);
-               rcoefx2 += decipart(p2->deltaKAx);
-            }
-
-            if (!TestBothWindow(info->wctl, clip, i, j))
-               continue;
-
-            if (((! userpwindow) && p->msb) || (userpwindow && (! TestBothWindow(regs->WCTLD, rpwindow, i, j))))
-            {
-               if ((p2 == NULL) || (p2->coefenab && p2->msb)) continue;
-
-               x = GenerateRotatedXPosFP(p2, i, xmul2, ymul2, C2);
-               y = GenerateRotatedYPosFP(p2, i, xmul2, ymul2, F2);
-
-               switch(p2->screenover) {
-                  case 0:
-                     x &= sinfo2.xmask;
-                     y &= sinfo2.ymask;
-                     break;
-                  case 1:
-                     VDP2LOG("Screen-over mode 1 not implemented");
-                     x &= sinfo2.xmask;
-                     y &= sinfo2.ymask;
-                     break;
-                  case 2:
-                     if ((x > sinfo2.xmask) || (y > sinfo2.ymask)) continue;
-                     break;
-                  case 3:
-                     if ((x > 512) || (y > 512)) continue;
-               }
-
-               // Convert coordinates into graphics
-               if (!info->isbitmap)
-               {
-                  // Tile
-                  Vdp2MapCalcXY(info, &x, &y, &sinfo2, regs, ram, 0);
-               }
-            }
-            else if (p->msb) continue;
-            else
-            {
-               x = GenerateRotatedXPosFP(p, i, xmul, ymul, C);
-               y = GenerateRotatedYPosFP(p, i, xmul, ymul, F);
-
-               switch(p->screenover) {
-                  case 0:
-                     x &= sinfo.xmask;
-                     y &= sinfo.ymask;
-                     break;
-                  case 1:
-                     VDP2LOG("Screen-over mode 1 not implemented");
-                     x &= sinfo.xmask;
-                     y &= sinfo.ymask;
-                     break;
-                  case 2:
-                     if ((x > sinfo.xmask) || (y > sinfo.ymask)) continue;
-                     break;
-                  case 3:
-                     if ((x > 512) || (y > 512)) continue;
-               }
+         rotationline_struct *line = &d.line[j];
+
+         line->xmul = xmul;
+         line->ymul = ymul;
+         line->coefy = coefy;
+         line->rcoefy = rcoefy;
+         line->xmul2 = xmul2;
+         line->ymul2 = ymul2;
+         line->coefy2 = coefy2;
+         line->rcoefy2 = rcoefy2;
+         line->linewnd0addr = linewnd0addr;
+         line->linewnd1addr = linewnd1addr;
+         line->rplinewnd0addr = rplinewnd0addr;
+         line->rplinewnd1addr = rplinewnd1addr;
+
+         ReadLineWindowClip(info->islinewindow, lineclip, &linewnd0addr, &linewnd1addr, ram, regs);
+         if (d.userpwindow)
+            ReadLineWindowClip(d.isrplinewindow, lineclip, &rplinewnd0addr, &rplinewnd1addr, ram, regs);
 
-               // Convert coordinates into graphics
-               if (!info->isbitmap)
-               {
-                  // Tile
-                  Vdp2MapCalcXY(info, &x, &y, &sinfo, regs, ram, 0);
-               }
-            }
-
-            // Fetch pixel
-            if (!Vdp2FetchPixel(info, x, y, &color, &dot, ram, info->charaddr, info->paladdr, color_ram))
-            {
-               continue;
-            }
-
-            Rbg0PutPixel(info, color, dot, i, j);
-         }
          xmul += p->deltaXst;
          ymul += p->deltaYst;
-         coefx = 0;
-         rcoefx = 0;
          coefy += toint(p->deltaKAst);
          rcoefy += decipart(p->deltaKAst);
 
@@ -1432,13 +1654,14 @@ static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparam
             ymul2 += p2->deltaYst;
             if (p2->coefenab)
             {
-               coefx2 = 0;
-               rcoefx2 = 0;
                coefy2 += toint(p2->deltaKAst);
                rcoefy2 += decipart(p2->deltaKAst);
             }
          }
       }
+
+      d.p2 = p2;
+      Vdp2RotationDrawBands(Vdp2DrawRotationCoefBandFP, &d, height);
       return;
    }
 
@@ -1477,7 +1700,7 @@ static void Vdp2DrawBackScreen(void)
          // Per Line
          for (i = 0; i < vdp2height; i++)
          {
-            dot = T1ReadWord(Vdp2Ram, scrAddr);
+            dot = T1ReadWord(Vdp2RenderRam, scrAddr);
             scrAddr += 2;
 
             TitanPutBackHLine(i, info.PostPixelFetchCalc(&info, COLSAT2YAB16(0x3f, dot)));
@@ -1486,7 +1709,7 @@ static void Vdp2DrawBackScreen(void)
       else
       {
          // Single Color
-         dot = T1ReadWord(Vdp2Ram, scrAddr);
+         dot = T1ReadWord(Vdp2RenderRam, scrAddr);
 
          for (j = 0; j < vdp2height; j++)
             TitanPutBackHLine(j, info.PostPixelFetchCalc(&info, COLSAT2YAB16(0x3f, dot)));
@@ -1520,7 +1743,7 @@ static void Vdp2DrawLineScreen(void)
       /* per line */
       for (i = 0; i < vdp2height; i++)
       {
-         color = T1ReadWord(Vdp2Ram, scrAddr) & 0x7FF;
+         color = T1ReadWord(Vdp2RenderRam, scrAddr) & 0x7FF;
          dot = Vdp2ColorRamGetColor(color, Vdp2ColorRam);
          scrAddr += 2;
 
@@ -1530,7 +1753,7 @@ static void Vdp2DrawLineScreen(void)
    else
    {
       /* single color, implemented but not tested... */
-      color = T1ReadWord(Vdp2Ram, scrAddr) & 0x7FF;
+      color = T1ReadWord(Vdp2RenderRam, scrAddr) & 0x7FF;
       dot = Vdp2ColorRamGetColor(color, Vdp2ColorRam);
       for (i = 0; i < vdp2height; i++)
          TitanPutLineHLine(1, i, COLSAT2YAB32(alpha, dot));
@@ -2083,18 +2306,23 @@ struct {
    Vdp2 regs;
    u8 ram[0x80000];
    u8 color_ram[0x1000];
+   u32 ram_gen[VDP2_RAM_PAGE_COUNT];
+   u32 color_ram_gen[VDP2_CRAM_PAGE_COUNT];
    struct CellScrollData cell_scroll_data[270];
 }vidsoft_thread_context;
 
 #define DECLARE_THREAD(NAME, LAYER, FUNC) \
 void NAME(void * data) \
 { \
+   TraceThreadName(#NAME); \
    for (;;) \
    { \
       if (vidsoft_thread_context.need_draw[LAYER]) \
       { \
          vidsoft_thread_context.need_draw[LAYER] = 0; \
+         TRACE_BEGIN(TRACE_VIDSOFT_LAYER); \
          FUNC(vidsoft_thread_context.lines, &vidsoft_thread_context.regs, vidsoft_thread_context.ram, vidsoft_thread_context.color_ram, vidsoft_thread_context.cell_scroll_data); \
+         TRACE_END(TRACE_VIDSOFT_LAYER); \
          vidsoft_thread_context.draw_finished[LAYER] = 1; \
       } \
       YabThreadSleep(); \
@@ -2118,13 +2346,19 @@ void VIDSoftSetNumLayerThreads(int num)
 
 void VidsoftVdp1Thread(void* data)
 {
+   TraceThreadName("VidsoftVdp1Thread");
    for (;;)
    {
       if (vidsoft_vdp1_thread_context.need_draw)
       {
          vidsoft_vdp1_thread_context.need_draw = 0;
-         Vdp1DrawCommands(vidsoft_vdp1_thread_context.ram, &vidsoft_vdp1_thread_context.regs, vidsoft_vdp1_thread_context.back_framebuffer);
+         TRACE_BEGIN(TRACE_VIDSOFT_VDP1);
+         if (vidsoft_num_vdp1_band_threads > 0)
+            VidsoftVdp1DrawBands();
+         else
+            Vdp1DrawCommands(vidsoft_vdp1_thread_context.ram, &vidsoft_vdp1_thread_context.regs, vidsoft_vdp1_thread_context.back_framebuffer);
          memcpy(vdp1backframebuffer, vidsoft_vdp1_thread_context.back_framebuffer, 0x40000);
+         TRACE_END(TRACE_VIDSOFT_VDP1);
          vidsoft_vdp1_thread_context.draw_finished = 1;
       }
 
@@ -2138,7 +2372,9 @@ void VidsoftWaitForVdp1Thread()
 {
    if (vidsoft_vdp1_thread_enabled)
    {
+      TRACE_BEGIN(TRACE_VIDSOFT_VDP1_WAIT);
       while (!vidsoft_vdp1_thread_context.draw_finished){}
+      TRACE_END(TRACE_VIDSOFT_VDP1_WAIT);
    }
 }
 
@@ -2150,6 +2386,20 @@ void VIDSoftSetVdp1ThreadEnable(int b)
 
 }
 
+//////////////////////////////////////////////////////////////////////////////
+
+//num is the total number of threads, the vdp1 thread draws a band as well
+void VIDSoftSetNumVdp1BandThreads(int num)
+{
+   num -= 1;
+   if (num < 0)
+      num = 0;
+   if (num > VIDSOFT_VDP1_BAND_THREADS)
+      num = VIDSOFT_VDP1_BAND_THREADS;
+
+   vidsoft_num_vdp1_band_threads = num;
+}
+
 void VidsoftSpriteThread(void * data)
 {
    for (;;)
@@ -2203,6 +2453,16 @@ int VIDSoftInit(void)
    vidsoft_vdp1_thread_context.draw_finished = 1;
    YabThreadStart(YAB_THREAD_VIDSOFT_VDP1, "vdp soft", VidsoftVdp1Thread, 0);
 
+   for (i = 0; i < VIDSOFT_VDP1_BAND_THREADS; i++)
+   {
+      vidsoft_vdp1_band_context.draw_finished[i] = 1;
+      vidsoft_vdp1_band_context.need_draw[i] = 0;
+   }
+
+   YabThreadStart(YAB_THREAD_VIDSOFT_VDP1_BAND_0, "vdp1 band 0", VidsoftVdp1BandThread0, 0);
+   YabThreadStart(YAB_THREAD_VIDSOFT_VDP1_BAND_1, "vdp1 band 1", VidsoftVdp1BandThread1, 0);
+   YabThreadStart(YAB_THREAD_VIDSOFT_VDP1_BAND_2, "vdp1 band 2", VidsoftVdp1BandThread2, 0);
+
    YabThreadStart(YAB_THREAD_VIDSOFT_LAYER_RBG0, "vdp rbg0", VidsoftRbg0Thread, 0);
    YabThreadStart(YAB_THREAD_VIDSOFT_LAYER_NBG0, "vdp nbg0",VidsoftNbg0Thread, 0);
    YabThreadStart(YAB_THREAD_VIDSOFT_LAYER_NBG1, "vdp nbg1",VidsoftNbg1Thread, 0);
@@ -2338,6 +2598,8 @@ void VIDSoftDeInit(void)
 
    if (vdp1framebuffer[1])
       free(vdp1framebuffer[1]);
+
+   VidsoftVdp1TextureCacheFree();
   
 #if !defined(ANDROID)  
 #ifdef USE_OPENGL
@@ -2432,6 +2694,8 @@ void VIDSoftVdp1DrawStart()
       VidsoftWaitForVdp1Thread();
 
       //take a snapshot of the vdp1 state, to be used by the thread
+      //page generations first, so a racing write can only make them older than the data
+      memcpy(vidsoft_vdp1_thread_context.page_gen, Vdp1RamPageGen, sizeof(Vdp1RamPageGen));
       memcpy(vidsoft_vdp1_thread_context.ram, Vdp1Ram, 0x80000);
       memcpy(&vidsoft_vdp1_thread_context.regs, Vdp1Regs, sizeof(Vdp1));
       memcpy(vidsoft_vdp1_thread_context.back_framebuffer, vdp1backframebuffer, 0x40000);
@@ -2509,16 +2773,23 @@ typedef struct _COLOR_PARAMS
 	double r,g,b;
 } COLOR_PARAMS;
 
-COLOR_PARAMS leftColumnColor;
+VIDSOFT_TLS COLOR_PARAMS leftColumnColor;
 
 
 
-int currentPixel;
-int currentPixelIsVisible;
-int characterWidth;
-int characterHeight;
+VIDSOFT_TLS int currentPixel;
+VIDSOFT_TLS int currentPixelIsVisible;
+VIDSOFT_TLS int characterWidth;
+VIDSOFT_TLS int characterHeight;
 
-static int getpixel(int linenumber, int currentlineindex, vdp1cmd_struct *cmd, u8 * ram) {
+//framebuffer lines (in command coordinates) the current thread may draw to
+static VIDSOFT_TLS int vdp1band_active = 0;
+static VIDSOFT_TLS int vdp1band_y1 = INT_MIN;
+static VIDSOFT_TLS int vdp1band_y2 = INT_MAX;
+
+//decodes one texel of the current character pattern into currentPixel
+//returns 1 when the texel is an end code
+static INLINE int Vdp1DecodeTexel(int linenumber, int currentlineindex, vdp1cmd_struct *cmd, u8 * ram, int isTextured) {
 
 	u32 characterAddress;
 	u32 colorlut;
@@ -2526,40 +2797,12 @@ static int getpixel(int linenumber, int currentlineindex, vdp1cmd_struct *cmd, u
 	u8 SPD;
 	int endcode;
 	int endcodesEnabled;
-	int untexturedColor = 0;
-	int isTextured = 1;
-	int currentShape = cmd->CMDCTRL & 0x7;
-	int flip;
 
    characterAddress = cmd->CMDSRCA << 3;
    colorbank = cmd->CMDCOLR;
 	colorlut = (u32)colorbank << 3;
    SPD = ((cmd->CMDPMOD & 0x40) != 0);//show the actual color of transparent pixels if 1 (they won't be drawn transparent)
    endcodesEnabled = ((cmd->CMDPMOD & 0x80) == 0) ? 1 : 0;
-   flip = (cmd->CMDCTRL & 0x30) >> 4;
-
-	//4 polygon, 5 polyline or 6 line
-	if(currentShape == 4 || currentShape == 5 || currentShape == 6) {
-		isTextured = 0;
-      untexturedColor = cmd->CMDCOLR;
-	}
-
-	switch( flip ) {
-		case 1:
-			// Horizontal flipping
-			currentlineindex = characterWidth - currentlineindex-1;
-			break;
-		case 2:
-			// Vertical flipping
-			linenumber = characterHeight - linenumber-1;
-
-			break;
-		case 3:
-			// Horizontal/Vertical flipping
-			linenumber = characterHeight - linenumber-1;
-			currentlineindex = characterWidth - currentlineindex-1;
-			break;
-	}
 
    switch ((cmd->CMDPMOD >> 3) & 0x7)
 	{
@@ -2633,6 +2876,199 @@ static int getpixel(int linenumber, int currentlineindex, vdp1cmd_struct *cmd, u
 			break;
 	}
 
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Decoded sprite texture cache. Each entry holds the character pattern of a
+// textured command decoded to final pixel values, and is keyed by CMDSRCA,
+// CMDSIZE, color mode and color bank. The entry stays valid as long as the
+// VDP1 RAM pages it was decoded from keep the same write generation.
+
+#define VIDSOFT_TEXCACHE_SIZE 256
+#define VIDSOFT_TEXCACHE_BUDGET (16 * 1024 * 1024)
+#define VIDSOFT_TEXEL_ENDCODE 0x10000
+
+typedef struct
+{
+   int used;
+   u32 srca;
+   u16 size;
+   u16 pmod;
+   u16 colr;
+   u32 gensum;
+   int visible;
+   u32 capacity;
+   u32 * data;
+} vidsoft_vdp1_texture_struct;
+
+static vidsoft_vdp1_texture_struct vidsoft_vdp1_texture_cache[VIDSOFT_TEXCACHE_SIZE];
+static u32 vidsoft_vdp1_texture_cache_bytes = 0;
+static VIDSOFT_TLS vidsoft_vdp1_texture_struct * currentTexture = NULL;
+
+static void VidsoftVdp1TextureCacheFree(void)
+{
+   int i;
+   for (i = 0; i < VIDSOFT_TEXCACHE_SIZE; i++)
+   {
+      if (vidsoft_vdp1_texture_cache[i].data)
+         free(vidsoft_vdp1_texture_cache[i].data);
+   }
+   memset(vidsoft_vdp1_texture_cache, 0, sizeof(vidsoft_vdp1_texture_cache));
+   vidsoft_vdp1_texture_cache_bytes = 0;
+   currentTexture = NULL;
+}
+
+static INLINE const u32 * VidsoftVdp1PageGen(u8 * ram)
+{
+   if (ram == vidsoft_vdp1_thread_context.ram)
+      return vidsoft_vdp1_thread_context.page_gen;
+   return Vdp1RamPageGen;
+}
+
+static u32 VidsoftVdp1TextureGenSum(vdp1cmd_struct *cmd, const u32 * pagegen, int width, int height)
+{
+   u32 texels = width * height;
+   u32 bytes;
+   u32 sum;
+
+   switch ((cmd->CMDPMOD >> 3) & 0x7)
+   {
+   case 0x0:
+   case 0x1:
+      bytes = (texels + 1) >> 1;
+      break;
+   case 0x5:
+      bytes = texels * 2;
+      break;
+   default:
+      bytes = texels;
+      break;
+   }
+
+   sum = Vdp1RamPageGenSum(pagegen, cmd->CMDSRCA << 3, bytes);
+   if (((cmd->CMDPMOD >> 3) & 0x7) == 0x1)
+      sum += Vdp1RamPageGenSum(pagegen, (u32)cmd->CMDCOLR << 3, 0x20);
+   return sum;
+}
+
+static vidsoft_vdp1_texture_struct * VidsoftVdp1TextureLookup(vdp1cmd_struct *cmd, u8 * ram)
+{
+   vidsoft_vdp1_texture_struct * tex;
+   u32 srca = cmd->CMDSRCA;
+   u16 pmod = cmd->CMDPMOD & 0xF8;
+   u16 colr = cmd->CMDCOLR;
+   u16 size = cmd->CMDSIZE;
+   u32 texels = characterWidth * characterHeight;
+   u32 gensum;
+   u32 hash;
+   int x, y;
+
+   if (((pmod >> 3) & 0x7) > 0x5 || texels == 0)
+      return NULL;
+
+   gensum = VidsoftVdp1TextureGenSum(cmd, VidsoftVdp1PageGen(ram), characterWidth, characterHeight);
+
+   hash = (srca ^ (srca >> 8) ^ (colr * 31) ^ (size * 7) ^ pmod) & (VIDSOFT_TEXCACHE_SIZE - 1);
+   tex = &vidsoft_vdp1_texture_cache[hash];
+
+   if (tex->used && tex->srca == srca && tex->size == size && tex->pmod == pmod && tex->colr == colr && tex->gensum == gensum)
+      return tex;
+
+   //band threads share the cache, it was filled before they started and
+   //must not change under them, so a miss is decoded texel by texel
+   if (vdp1band_active)
+      return NULL;
+
+   if (tex->capacity < texels)
+   {
+      if (vidsoft_vdp1_texture_cache_bytes + (texels - tex->capacity) * sizeof(u32) > VIDSOFT_TEXCACHE_BUDGET)
+      {
+         VidsoftVdp1TextureCacheFree();
+         tex = &vidsoft_vdp1_texture_cache[hash];
+      }
+      vidsoft_vdp1_texture_cache_bytes -= tex->capacity * sizeof(u32);
+      free(tex->data);
+      if ((tex->data = (u32 *)malloc(texels * sizeof(u32))) == NULL)
+      {
+         tex->capacity = 0;
+         tex->used = 0;
+         return NULL;
+      }
+      tex->capacity = texels;
+      vidsoft_vdp1_texture_cache_bytes += texels * sizeof(u32);
+   }
+
+   for (y = 0; y < characterHeight; y++)
+   {
+      u32 * line = tex->data + y * characterWidth;
+      for (x = 0; x < characterWidth; x++)
+      {
+         if (Vdp1DecodeTexel(y, x, cmd, ram, 1))
+            line[x] = VIDSOFT_TEXEL_ENDCODE;
+         else
+            line[x] = (u16)currentPixel;
+      }
+   }
+
+   tex->used = 1;
+   tex->srca = srca;
+   tex->size = size;
+   tex->pmod = pmod;
+   tex->colr = colr;
+   tex->gensum = gensum;
+   tex->visible = currentPixelIsVisible;
+   return tex;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int getpixel(int linenumber, int currentlineindex, vdp1cmd_struct *cmd, u8 * ram) {
+
+	int untexturedColor = 0;
+	int isTextured = 1;
+	int currentShape = cmd->CMDCTRL & 0x7;
+	int flip;
+
+   flip = (cmd->CMDCTRL & 0x30) >> 4;
+
+	//4 polygon, 5 polyline or 6 line
+	if(currentShape == 4 || currentShape == 5 || currentShape == 6) {
+		isTextured = 0;
+      untexturedColor = cmd->CMDCOLR;
+	}
+
+	switch( flip ) {
+		case 1:
+			// Horizontal flipping
+			currentlineindex = characterWidth - currentlineindex-1;
+			break;
+		case 2:
+			// Vertical flipping
+			linenumber = characterHeight - linenumber-1;
+
+			break;
+		case 3:
+			// Horizontal/Vertical flipping
+			linenumber = characterHeight - linenumber-1;
+			currentlineindex = characterWidth - currentlineindex-1;
+			break;
+	}
+
+   if (isTextured && currentTexture && (unsigned)linenumber < (unsigned)characterHeight && (unsigned)currentlineindex < (unsigned)characterWidth)
+   {
+      u32 texel = currentTexture->data[linenumber * characterWidth + currentlineindex];
+      currentPixelIsVisible = currentTexture->visible;
+      if (texel & VIDSOFT_TEXEL_ENDCODE)
+         return 1;
+      currentPixel = texel;
+      return 0;
+   }
+
+   if (Vdp1DecodeTexel(linenumber, currentlineindex, cmd, ram, isTextured))
+      return 1;
+
 	if(!isTextured)
 		currentPixel = untexturedColor;
 
@@ -2717,6 +3153,9 @@ static void putpixel8(int x, int y, Vdp1 * regs, vdp1cmd_struct *cmd, u8 * back_
     if (iPix >= (back_framebuffer + 0x40000))
         return;
 
+    if (y < vdp1band_y1 || y > vdp1band_y2)
+        return;
+
     if (CheckDil(y, regs))
        return;
 
@@ -2749,6 +3188,9 @@ static void putpixel(int x, int y, Vdp1* regs, vdp1cmd_struct * cmd, u8 * back_f
 	int SPD = ((cmd->CMDPMOD & 0x40) != 0);//show the actual color of transparent pixels if 1 (they won't be drawn transparent)
    int original_y = y;
 
+   if (y < vdp1band_y1 || y > vdp1band_y2)
+      return;
+
    if (CheckDil(y, regs))
       return;
 
@@ -2993,10 +3435,10 @@ typedef union _COLOR { // xbgr x555
 	u16 value;
 } COLOR;
 
-COLOR gouraudA;
-COLOR gouraudB;
-COLOR gouraudC;
-COLOR gouraudD;
+VIDSOFT_TLS COLOR gouraudA;
+VIDSOFT_TLS COLOR gouraudB;
+VIDSOFT_TLS COLOR gouraudC;
+VIDSOFT_TLS COLOR gouraudD;
 
 static void gouraudTable(u8* ram, Vdp1* regs, vdp1cmd_struct * cmd)
 {
@@ -3012,10 +3454,10 @@ static void gouraudTable(u8* ram, Vdp1* regs, vdp1cmd_struct * cmd)
    gouraudD.value = T1ReadWord(ram, gouraudTableAddress + 6);
 }
 
-int xleft[1000];
-int yleft[1000];
-int xright[1000];
-int yright[1000];
+VIDSOFT_TLS int xleft[1000];
+VIDSOFT_TLS int yleft[1000];
+VIDSOFT_TLS int xright[1000];
+VIDSOFT_TLS int yright[1000];
 
 static int
 storeLineCoords(int x, int y, int i, void *arrays, Vdp1* regs, vdp1cmd_struct * cmd, u8* ram, u8* back_framebuffer) {
@@ -3093,6 +3535,12 @@ static void drawQuad(s16 tl_x, s16 tl_y, s16 bl_x, s16 bl_y, s16 tr_x, s16 tr_y,
 	characterWidth = ((cmd->CMDSIZE >> 8) & 0x3F) * 8;
    characterHeight = cmd->CMDSIZE & 0xFF;
 
+   //polygons, polylines and lines are untextured
+   if ((cmd->CMDCTRL & 0x7) < 4)
+      currentTexture = VidsoftVdp1TextureLookup(cmd, ram);
+   else
+      currentTexture = NULL;
+
 	intarrays[0] = xleft; intarrays[1] = yleft;
    totalleft = iterateOverLine(tl_x, tl_y, bl_x, bl_y, 0, intarrays, storeLineCoords, regs, cmd, ram, back_framebuffer);
 	intarrays[0] = xright; intarrays[1] = yright;
@@ -3144,6 +3592,15 @@ static void drawQuad(s16 tl_x, s16 tl_y, s16 bl_x, s16 bl_y, s16 tr_x, s16 tr_y,
 
 		COLOR_PARAMS leftToRightStep = {0,0,0};
 
+		//lines that are entirely outside of this thread's band draw nothing
+		if (vdp1band_active)
+		{
+			int ly = yleft[(int)(i*leftLineStep)];
+			int ry = yright[(int)(i*rightLineStep)];
+			if ((ly < vdp1band_y1 && ry < vdp1band_y1) || (ly > vdp1band_y2 && ry > vdp1band_y2))
+				continue;
+		}
+
 		//get the length of the line we are about to draw
 		xlinelength = iterateOverLine(
 			xleft[(int)(i*leftLineStep)],
@@ -3362,6 +3819,7 @@ void VIDSoftVdp1PolylineDraw(u8* ram, Vdp1*regs, u8 * back_framebuffer)
    vdp1cmd_struct cmd;
 
    Vdp1ReadCommand(&cmd, regs->addr, ram);
+   currentTexture = NULL;
 
 	X[0] = (int)regs->localX + (int)((s16)T1ReadWord(ram, regs->addr + 0x0C));
 	Y[0] = (int)regs->localY + (int)((s16)T1ReadWord(ram, regs->addr + 0x0E));
@@ -3397,6 +3855,7 @@ void VIDSoftVdp1LineDraw(u8* ram, Vdp1*regs, u8* back_framebuffer)
    vdp1cmd_struct cmd;
 
    Vdp1ReadCommand(&cmd, regs->addr, ram);
+   currentTexture = NULL;
 
 	x1 = (int)regs->localX + (int)((s16)T1ReadWord(ram, regs->addr + 0x0C));
 	y1 = (int)regs->localY + (int)((s16)T1ReadWord(ram, regs->addr + 0x0E));
@@ -3438,6 +3897,150 @@ void VIDSoftVdp1LocalCoordinate(u8* ram, Vdp1*regs)
 
 //////////////////////////////////////////////////////////////////////////////
 
+//runs the commands binned to one band, clipped to the lines of that band.
+//every pixel belongs to exactly one band and each band keeps the list
+//order, so the result is the same as drawing the list in one go
+static void VidsoftVdp1DrawBand(int which)
+{
+   Vdp1 regs = vidsoft_vdp1_thread_context.regs;
+   u8 * ram = vidsoft_vdp1_thread_context.ram;
+   u8 * back_framebuffer = vidsoft_vdp1_thread_context.back_framebuffer;
+   int i;
+
+   vdp1band_active = 1;
+   vdp1band_y1 = vidsoft_vdp1_band_context.bands[which].start;
+   vdp1band_y2 = vidsoft_vdp1_band_context.bands[which].end;
+
+   for (i = 0; i < vidsoft_vdp1_band_context.bands[which].count; i++)
+   {
+      const vdp1cmdentry_struct * e = &vidsoft_vdp1_cmdlist.entries[vidsoft_vdp1_band_context.bands[which].cmds[i]];
+
+      regs.addr = e->addr;
+      regs.localX = e->localX;
+      regs.localY = e->localY;
+      regs.systemclipX1 = 0;
+      regs.systemclipY1 = 0;
+      regs.systemclipX2 = e->systemclipX2;
+      regs.systemclipY2 = e->systemclipY2;
+      regs.userclipX1 = e->userclipX1;
+      regs.userclipY1 = e->userclipY1;
+      regs.userclipX2 = e->userclipX2;
+      regs.userclipY2 = e->userclipY2;
+
+      switch (e->cmd.CMDCTRL & 0x000F)
+      {
+      case 0:
+         VIDSoftVdp1NormalSpriteDraw(ram, &regs, back_framebuffer);
+         break;
+      case 1:
+         VIDSoftVdp1ScaledSpriteDraw(ram, &regs, back_framebuffer);
+         break;
+      case 2:
+      case 3:
+      case 4:
+         // Polygons are drawn as distorted sprites, see VIDSoft
+         VIDSoftVdp1DistortedSpriteDraw(ram, &regs, back_framebuffer);
+         break;
+      case 5:
+      case 7:
+         VIDSoftVdp1PolylineDraw(ram, &regs, back_framebuffer);
+         break;
+      case 6:
+         VIDSoftVdp1LineDraw(ram, &regs, back_framebuffer);
+         break;
+      }
+   }
+
+   vdp1band_active = 0;
+   vdp1band_y1 = INT_MIN;
+   vdp1band_y2 = INT_MAX;
+}
+
+#define DECLARE_VDP1_BAND_THREAD(FUNC_NAME, THREAD_NUMBER) \
+void * FUNC_NAME(void* data) \
+{ \
+   TraceThreadName(#FUNC_NAME); \
+   for (;;) \
+   { \
+      if (vidsoft_vdp1_band_context.need_draw[THREAD_NUMBER]) \
+      { \
+         vidsoft_vdp1_band_context.need_draw[THREAD_NUMBER] = 0; \
+         TRACE_BEGIN(TRACE_VIDSOFT_VDP1_BAND); \
+         VidsoftVdp1DrawBand(THREAD_NUMBER + 1); \
+         TRACE_END(TRACE_VIDSOFT_VDP1_BAND); \
+         vidsoft_vdp1_band_context.draw_finished[THREAD_NUMBER] = 1; \
+      } \
+      YabThreadSleep(); \
+   } \
+   return NULL; \
+}
+
+DECLARE_VDP1_BAND_THREAD(VidsoftVdp1BandThread0, 0);
+DECLARE_VDP1_BAND_THREAD(VidsoftVdp1BandThread1, 1);
+DECLARE_VDP1_BAND_THREAD(VidsoftVdp1BandThread2, 2);
+
+static void VidsoftVdp1DrawBands(void)
+{
+   vdp1cmdlist_struct * list = &vidsoft_vdp1_cmdlist;
+   u8 * ram = vidsoft_vdp1_thread_context.ram;
+   int num_bands = vidsoft_num_vdp1_band_threads + 1;
+   int height = vdp1height * vdp1interlace;
+   int i, j;
+
+   Vdp1ParseCommands(ram, &vidsoft_vdp1_thread_context.regs, list);
+
+   for (j = 0; j < num_bands; j++)
+   {
+      vidsoft_vdp1_band_context.bands[j].start = j == 0 ? INT_MIN : (height * j) / num_bands;
+      vidsoft_vdp1_band_context.bands[j].end = j == num_bands - 1 ? INT_MAX : (height * (j + 1)) / num_bands - 1;
+      vidsoft_vdp1_band_context.bands[j].count = 0;
+   }
+
+   for (i = 0; i < list->count; i++)
+   {
+      const vdp1cmdentry_struct * e = &list->entries[i];
+
+      //completely outside of system clipping, drawQuad would skip it too
+      if (e->maxx < 0 || e->minx > e->systemclipX2 ||
+          e->maxy < 0 || e->miny > e->systemclipY2 * 2)
+         continue;
+
+      //decode the textures up front, the band threads only read the cache
+      if ((e->cmd.CMDCTRL & 0x7) < 4)
+      {
+         vdp1cmd_struct cmd = e->cmd;
+         characterWidth = ((cmd.CMDSIZE >> 8) & 0x3F) * 8;
+         characterHeight = cmd.CMDSIZE & 0xFF;
+         VidsoftVdp1TextureLookup(&cmd, ram);
+      }
+
+      for (j = 0; j < num_bands; j++)
+      {
+         if (e->maxy >= vidsoft_vdp1_band_context.bands[j].start && e->miny <= vidsoft_vdp1_band_context.bands[j].end)
+            vidsoft_vdp1_band_context.bands[j].cmds[vidsoft_vdp1_band_context.bands[j].count++] = i;
+      }
+   }
+
+   for (j = 0; j < vidsoft_num_vdp1_band_threads; j++)
+   {
+      vidsoft_vdp1_band_context.draw_finished[j] = 0;
+      vidsoft_vdp1_band_context.need_draw[j] = 1;
+      YabThreadWake(YAB_THREAD_VIDSOFT_VDP1_BAND_0 + j);
+   }
+
+   VidsoftVdp1DrawBand(0);
+
+   for (j = 0; j < vidsoft_num_vdp1_band_threads; j++)
+   {
+      while (!vidsoft_vdp1_band_context.draw_finished[j]){}
+   }
+
+   if (list->finished)
+      Vdp1External.status = VDP1_STATUS_IDLE;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 void VIDSoftVdp1ReadFrameBuffer(u32 type, u32 addr, void * out)
 {
    u32 val;
@@ -3872,7 +4475,10 @@ void VIDSoftVdp2DrawEnd(void)
       while (!vidsoft_thread_context.draw_finished[TITAN_SPRITE]){}
    }
 
-   TitanRender(dispbuffer);
+   TitanRenderRegs(dispbuffer, Vdp2VBlankRegs);
+
+   if (AVCaptureVideoActive)
+      AVCaptureVideo(dispbuffer, vdp2width, vdp2height);
 
    VIDSoftVdp1SwapFrameBuffer();
 
@@ -3908,7 +4514,7 @@ void VidsoftStartLayerThread(int * layer_priority, int * draw_priority_0, int *
       }
       else
       {
-        (*layer_func) (Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
+        (*layer_func) (Vdp2Lines, Vdp2Regs, Vdp2RenderRam, Vdp2ColorRam, cell_scroll_data);
       }
    }
 }
@@ -3971,8 +4577,9 @@ void VIDSoftVdp2DrawScreens(void)
    {
       memcpy(vidsoft_thread_context.lines, Vdp2Lines, sizeof(Vdp2) * 270);
       memcpy(&vidsoft_thread_context.regs, Vdp2Regs, sizeof(Vdp2));
-      memcpy(vidsoft_thread_context.ram, Vdp2Ram, 0x80000);
-      memcpy(vidsoft_thread_context.color_ram, Vdp2ColorRam, 0x1000);
+      //only pages written since the last frame need to be copied
+      Vdp2RenderRamSyncPages(vidsoft_thread_context.ram, vidsoft_thread_context.ram_gen);
+      Vdp2ColorRamSyncPages(vidsoft_thread_context.color_ram, vidsoft_thread_context.color_ram_gen);
       memcpy(vidsoft_thread_context.cell_scroll_data, cell_scroll_data, sizeof(struct CellScrollData) * 270);
    }
 
@@ -3986,7 +4593,7 @@ void VIDSoftVdp2DrawScreens(void)
    }
    else
    {
-      VidsoftDrawSprite(Vdp2Regs, sprite_window_mask, vdp1frontframebuffer, Vdp2Ram, Vdp1Regs, Vdp2Lines, Vdp2ColorRam);
+      VidsoftDrawSprite(Vdp2Regs, sprite_window_mask, vdp1frontframebuffer, Vdp2RenderRam, Vdp1Regs, Vdp2Lines, Vdp2ColorRam);
    }
 
    if (vidsoft_num_layer_threads > 0)
@@ -3999,11 +4606,11 @@ void VIDSoftVdp2DrawScreens(void)
    }
    else
    {
-      Vdp2DrawNBG0(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
-      Vdp2DrawNBG1(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
-      Vdp2DrawNBG2(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
-      Vdp2DrawNBG3(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
-      Vdp2DrawRBG0(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
+      Vdp2DrawNBG0(Vdp2Lines, Vdp2Regs, Vdp2RenderRam, Vdp2ColorRam, cell_scroll_data);
+      Vdp2DrawNBG1(Vdp2Lines, Vdp2Regs, Vdp2RenderRam, Vdp2ColorRam, cell_scroll_data);
+      Vdp2DrawNBG2(Vdp2Lines, Vdp2Regs, Vdp2RenderRam, Vdp2ColorRam, cell_scroll_data);
+      Vdp2DrawNBG3(Vdp2Lines, Vdp2Regs, Vdp2RenderRam, Vdp2ColorRam, cell_scroll_data);
+      Vdp2DrawRBG0(Vdp2Lines, Vdp2Regs, Vdp2RenderRam, Vdp2ColorRam, cell_scroll_data);
    }
 }
 
@@ -4016,19 +4623,19 @@ void VIDSoftVdp2DrawScreen(int screen)
    switch(screen)
    {
       case 0:
-         Vdp2DrawNBG0(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
+         Vdp2DrawNBG0(Vdp2Lines, Vdp2Regs, Vdp2RenderRam, Vdp2ColorRam, cell_scroll_data);
          break;
       case 1:
-         Vdp2DrawNBG1(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
+         Vdp2DrawNBG1(Vdp2Lines, Vdp2Regs, Vdp2RenderRam, Vdp2ColorRam, cell_scroll_data);
          break;
       case 2:
-         Vdp2DrawNBG2(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
+         Vdp2DrawNBG2(Vdp2Lines, Vdp2Regs, Vdp2RenderRam, Vdp2ColorRam, cell_scroll_data);
          break;
       case 3:
-         Vdp2DrawNBG3(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
+         Vdp2DrawNBG3(Vdp2Lines, Vdp2Regs, Vdp2RenderRam, Vdp2ColorRam, cell_scroll_data);
          break;
       case 4:
-         Vdp2DrawRBG0(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
+         Vdp2DrawRBG0(Vdp2Lines, Vdp2Regs, Vdp2RenderRam, Vdp2ColorRam, cell_scroll_data);
          break;
    }
 }
@@ -4113,7 +4720,7 @@ void VIDSoftVdp2SetResolution(u16 TVMD)
 
 void VIDSoftVdp1SwapFrameBuffer(void)
 {
-   if (((Vdp1Regs->FBCR & 2) == 0) || Vdp1External.manualchange)
+   if (Vdp1External.vblank_swap)
    {
 		u8 *temp;
       if (vidsoft_vdp1_thread_enabled)
@@ -4124,7 +4731,6 @@ void VIDSoftVdp1SwapFrameBuffer(void)
       temp = vdp1frontframebuffer;
       vdp1frontframebuffer = vdp1backframebuffer;
       vdp1backframebuffer = temp;
-      Vdp1External.manualchange = 0;
    }
 }
 
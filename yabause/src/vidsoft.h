@@ -45,6 +45,8 @@ void VIDSoftSetNumLayerThreads(int num);
 
 void VIDSoftSetVdp1ThreadEnable(int b);
 
+void VIDSoftSetNumVdp1BandThreads(int num);
+
 void VidsoftWaitForVdp1Thread();
 
 void VIDSoftVdp2DrawStart(void);
@@ -81,6 +81,8 @@ protected:
 
   Buffer ssbo_vram_;
   Buffer ssbo_cram_;
+  u32 vram_gen_[VDP2_RAM_PAGE_COUNT] = {};
+  u32 cram_gen_[VDP2_CRAM_PAGE_COUNT] = {};
   Buffer ssbo_window_;
   Buffer ssbo_paraA_;
   Buffer rbgUniform;
@@ -1055,7 +1055,7 @@ void VIDVulkan::updateBackColor() {
     scrAddr = (((fixVdp2Regs->BKTAU & 0x3) << 16) | fixVdp2Regs->BKTAL) * 2;
 
   readVdp2ColorOffset(fixVdp2Regs, &info, 0x20);
-  dot = T1ReadWord(Vdp2Ram, scrAddr);
+  dot = T1ReadWord(Vdp2RenderRam, scrAddr);
   u32* back_pixel_data = backColor.dynamicBuf;
   int lineCount = 1;
   if ((fixVdp2Regs->BKTAU & 0x8000) != 0) {
@@ -1064,7 +1064,7 @@ void VIDVulkan::updateBackColor() {
 
   for (int i = 0; i < lineCount; i++) {
     u8 r, g, b, a;
-    dot = T1ReadWord(Vdp2Ram, (scrAddr + 2 * i));
+    dot = T1ReadWord(Vdp2RenderRam, (scrAddr + 2 * i));
     r = Y_MAX(((dot & 0x1F) << 3) + info.cor, 0);
     g = Y_MAX((((dot & 0x3E0) >> 5) << 3) + info.cog, 0);
     b = Y_MAX((((dot & 0x7C00) >> 10) << 3) + info.cob, 0);
@@ -1111,7 +1111,7 @@ void VIDVulkan::updateLineColor(void) {
 
   addr = (fixVdp2Regs->LCTA.all & 0x7FFFF) * 0x2;
   for (i = 0; i < line_cnt; i++) {
-    u16 LineColorRamAdress = T1ReadWord(Vdp2Ram, addr);
+    u16 LineColorRamAdress = T1ReadWord(Vdp2RenderRam, addr);
     *(line_pixel_data) = Vdp2ColorRamGetColor(LineColorRamAdress, alpha);
     line_pixel_data++;
     addr += inc;
@@ -1134,7 +1134,7 @@ void VIDVulkan::Vdp2DrawScreens(void)
   else
     scrAddr = (((fixVdp2Regs->BKTAU & 0x3) << 16) | fixVdp2Regs->BKTAL) * 2;
 
-  dot = T1ReadWord(Vdp2Ram, scrAddr);
+  dot = T1ReadWord(Vdp2RenderRam, scrAddr);
   setClearColor(
     (float)(((dot & 0x1F) << 3) + info.cor) / (float)(0xFF),
     (float)((((dot & 0x3E0) >> 5) << 3) + info.cog) / (float)(0xFF),
@@ -2012,7 +2012,7 @@ void VIDVulkan::drawNBG0() {
     if (!info.enable) return;
 
     // Read in Parameter B
-    Vdp2ReadRotationTable(1, &paraB, fixVdp2Regs, Vdp2Ram);
+    Vdp2ReadRotationTable(1, &paraB, fixVdp2Regs, Vdp2RenderRam);
 
     if ((info.isbitmap = fixVdp2Regs->CHCTLA & 0x2) != 0)
     {
@@ -3179,7 +3179,7 @@ void VIDVulkan::drawRBG0() {
   if (!(info->enable & Vdp2External.disptoggle) || (info->priority == 0)) {
 
     if (Vdp1Regs->TVMR & 0x02) {
-      Vdp2ReadRotationTable(0, &paraA, fixVdp2Regs, Vdp2Ram);
+      Vdp2ReadRotationTable(0, &paraA, fixVdp2Regs, Vdp2RenderRam);
     }
     return;
   }
@@ -3210,8 +3210,8 @@ void VIDVulkan::drawRBG0() {
   info->linescrolltbl = 0;
   info->lineinc = 0;
 
-  Vdp2ReadRotationTable(0, &paraA, fixVdp2Regs, Vdp2Ram);
-  Vdp2ReadRotationTable(1, &paraB, fixVdp2Regs, Vdp2Ram);
+  Vdp2ReadRotationTable(0, &paraA, fixVdp2Regs, Vdp2RenderRam);
+  Vdp2ReadRotationTable(1, &paraB, fixVdp2Regs, Vdp2RenderRam);
   A0_Updated = 0;
   A1_Updated = 0;
   B0_Updated = 0;
@@ -3649,7 +3649,7 @@ void VIDVulkan::drawRotation(RBGDrawInfo * rbg, VdpPipeline ** pipleLine)
     if (info->LineColorBase != 0)
     {
       rbg->line_info.blendmode = 0;
-      rbg->LineColorRamAdress = (T1ReadWord(Vdp2Ram, info->LineColorBase) & 0x7FF);// +info->coloroffset;
+      rbg->LineColorRamAdress = (T1ReadWord(Vdp2RenderRam, info->LineColorBase) & 0x7FF);// +info->coloroffset;
 
       u64 cacheaddr = 0xA0000000DAD;
       YglTMAllocate(_Ygl->texture_manager, &rbg->line_texture, rbg->vres, 1, &x, &y);
@@ -3698,7 +3698,7 @@ void VIDVulkan::drawRotation(RBGDrawInfo * rbg, VdpPipeline ** pipleLine)
     if (info->LineColorBase != 0)
     {
       rbg->line_info.blendmode = 0;
-      rbg->LineColorRamAdress = (T1ReadWord(Vdp2Ram, info->LineColorBase) & 0x7FF);// +info->coloroffset;
+      rbg->LineColorRamAdress = (T1ReadWord(Vdp2RenderRam, info->LineColorBase) & 0x7FF);// +info->coloroffset;
 
       u64 cacheaddr = 0xA0000000DAD;
       tm->allocate(&rbg->line_texture, rbg->vres, 1, &x, &y);
@@ -3739,7 +3739,7 @@ static inline int vdp2rGetKValue(vdp2rotationparameter_struct * parameter, float
   int h = ceilf(parameter->KtablV + (parameter->deltaKAx * i));
   if (parameter->coefdatasize == 2) {
     if (parameter->k_mem_type == 0) { // vram
-      kdata = T1ReadWord(Vdp2Ram, (parameter->coeftbladdr + (int)(h << 1)) & 0x7FFFF);
+      kdata = T1ReadWord(Vdp2RenderRam, (parameter->coeftbladdr + (int)(h << 1)) & 0x7FFFF);
     }
     else { // cram
       kdata = Vdp2ColorRamReadWord(((parameter->coeftbladdr + (int)(h << 1)) & 0x7FF) + 0x800);
@@ -3755,7 +3755,7 @@ static inline int vdp2rGetKValue(vdp2rotationparameter_struct * parameter, float
   }
   else {
     if (parameter->k_mem_type == 0) { // vram
-      kdata = T1ReadLong(Vdp2Ram, (parameter->coeftbladdr + (int)(h << 2)) & 0x7FFFF);
+      kdata = T1ReadLong(Vdp2RenderRam, (parameter->coeftbladdr + (int)(h << 2)) & 0x7FFFF);
     }
     else { // cram
       kdata = Vdp2ColorRamReadLong(((parameter->coeftbladdr + (int)(h << 2)) & 0x7FF) + 0x800);
@@ -3818,7 +3818,7 @@ static inline u32 Vdp2RotationFetchPixel(vdp2draw_struct *info, int x, int y, in
   switch (info->colornumber)
   {
   case 0: // 4 BPP
-    dot = T1ReadByte(Vdp2Ram, ((info->charaddr + (((y * cellw) + x) >> 1)) & 0x7FFFF));
+    dot = T1ReadByte(Vdp2RenderRam, ((info->charaddr + (((y * cellw) + x) >> 1)) & 0x7FFFF));
     if (!(x & 0x1)) dot >>= 4;
     if (!(dot & 0xF) && info->transparencyenable) return 0x00000000;
     else {
@@ -3838,7 +3838,7 @@ static inline u32 Vdp2RotationFetchPixel(vdp2draw_struct *info, int x, int y, in
       return   cramindex | alpha << 24;
     }
   case 1: // 8 BPP
-    dot = T1ReadByte(Vdp2Ram, ((info->charaddr + (y * cellw) + x) & 0x7FFFF));
+    dot = T1ReadByte(Vdp2RenderRam, ((info->charaddr + (y * cellw) + x) & 0x7FFFF));
     if (!(dot & 0xFF) && info->transparencyenable) return 0x00000000;
     else {
       cramindex = info->coloroffset + ((info->paladdr << 4) | (dot & 0xFF));
@@ -3857,7 +3857,7 @@ static inline u32 Vdp2RotationFetchPixel(vdp2draw_struct *info, int x, int y, in
       return   cramindex | alpha << 24;
     }
   case 2: // 16 BPP(palette)
-    dot = T1ReadWord(Vdp2Ram, ((info->charaddr + ((y * cellw) + x) * 2) & 0x7FFFF));
+    dot = T1ReadWord(Vdp2RenderRam, ((info->charaddr + ((y * cellw) + x) * 2) & 0x7FFFF));
     if ((dot == 0) && info->transparencyenable) return 0x00000000;
     else {
       cramindex = (info->coloroffset + dot);
@@ -3876,11 +3876,11 @@ static inline u32 Vdp2RotationFetchPixel(vdp2draw_struct *info, int x, int y, in
       return   cramindex | alpha << 24;
     }
   case 3: // 16 BPP(RGB)
-    dot = T1ReadWord(Vdp2Ram, ((info->charaddr + ((y * cellw) + x) * 2) & 0x7FFFF));
+    dot = T1ReadWord(Vdp2RenderRam, ((info->charaddr + ((y * cellw) + x) * 2) & 0x7FFFF));
     if (!(dot & 0x8000) && info->transparencyenable) return 0x00000000;
     else return SAT2YAB1(alpha, dot);
   case 4: // 32 BPP
-    dot = T1ReadLong(Vdp2Ram, ((info->charaddr + ((y * cellw) + x) * 4) & 0x7FFFF));
+    dot = T1ReadLong(Vdp2RenderRam, ((info->charaddr + ((y * cellw) + x) * 4) & 0x7FFFF));
     if (!(dot & 0x80000000) && info->transparencyenable) return 0x00000000;
     else return SAT2YAB2(alpha, (dot >> 16), dot);
   default:
@@ -3970,7 +3970,7 @@ void VIDVulkan::drawRotation_in(RBGDrawInfo * rbg) {
       }
       for (int jj = 0; jj < lvres; jj++) {
         if ((fixVdp2Regs->LCTA.part.U & 0x8000) != 0) {
-          rbg->LineColorRamAdress = T1ReadWord(Vdp2Ram, info->LineColorBase + lineInc * (int)(j));
+          rbg->LineColorRamAdress = T1ReadWord(Vdp2RenderRam, info->LineColorBase + lineInc * (int)(j));
           *line_texture->textdata = rbg->LineColorRamAdress | (linecl << 24);
           line_texture->textdata++;
           if (vres >= 480) {
@@ -4021,7 +4021,7 @@ void VIDVulkan::drawRotation_in(RBGDrawInfo * rbg) {
     if (rbg->useb)
     {
 #if 0 // PERLINE
-      Vdp2ReadRotationTable(1, &paraB, regs, Vdp2Ram);
+      Vdp2ReadRotationTable(1, &paraB, regs, Vdp2RenderRam);
       paraB.dx = paraB.A * paraB.deltaX + paraB.B * paraB.deltaY;
       paraB.dy = paraB.D * paraB.deltaX + paraB.E * paraB.deltaY;
       paraB.Xp = paraB.A * (paraB.Px - paraB.Cx) + paraB.B * (paraB.Py - paraB.Cy)
@@ -4053,7 +4053,7 @@ void VIDVulkan::drawRotation_in(RBGDrawInfo * rbg) {
     if (info->LineColorBase != 0)
     {
       if ((fixVdp2Regs->LCTA.part.U & 0x8000) != 0) {
-        rbg->LineColorRamAdress = T1ReadWord(Vdp2Ram, info->LineColorBase + lineInc * (int)(j));
+        rbg->LineColorRamAdress = T1ReadWord(Vdp2RenderRam, info->LineColorBase + lineInc * (int)(j));
         *line_texture->textdata = rbg->LineColorRamAdress | (linecl << 24);
         line_texture->textdata++;
       }
@@ -4383,7 +4383,7 @@ void VIDVulkan::genLineinfo(vdp2draw_struct *info)
     index = 0;
     if (VDPLINE_SX(info->islinescroll))
     {
-      info->lineinfo[lineindex].LineScrollValH = T1ReadWord(Vdp2Ram, info->linescrolltbl + (i / info->lineinc)*bound);
+      info->lineinfo[lineindex].LineScrollValH = T1ReadWord(Vdp2RenderRam, info->linescrolltbl + (i / info->lineinc)*bound);
       if ((info->lineinfo[lineindex].LineScrollValH & 0x400)) info->lineinfo[lineindex].LineScrollValH |= 0xF800; else info->lineinfo[lineindex].LineScrollValH &= 0x07FF;
       index += 4;
     }
@@ -4393,7 +4393,7 @@ void VIDVulkan::genLineinfo(vdp2draw_struct *info)
 
     if (VDPLINE_SY(info->islinescroll))
     {
-      info->lineinfo[lineindex].LineScrollValV = T1ReadWord(Vdp2Ram, info->linescrolltbl + (i / info->lineinc)*bound + index);
+      info->lineinfo[lineindex].LineScrollValV = T1ReadWord(Vdp2RenderRam, info->linescrolltbl + (i / info->lineinc)*bound + index);
       if ((info->lineinfo[lineindex].LineScrollValV & 0x400)) info->lineinfo[lineindex].LineScrollValV |= 0xF800; else info->lineinfo[lineindex].LineScrollValV &= 0x07FF;
       index += 4;
     }
@@ -4403,8 +4403,8 @@ void VIDVulkan::genLineinfo(vdp2draw_struct *info)
 
     if (VDPLINE_SZ(info->islinescroll))
     {
-      val1 = T1ReadWord(Vdp2Ram, info->linescrolltbl + (i / info->lineinc)*bound + index);
-      val2 = T1ReadWord(Vdp2Ram, info->linescrolltbl + (i / info->lineinc)*bound + index + 2);
+      val1 = T1ReadWord(Vdp2RenderRam, info->linescrolltbl + (i / info->lineinc)*bound + index);
+      val2 = T1ReadWord(Vdp2RenderRam, info->linescrolltbl + (i / info->lineinc)*bound + index + 2);
       info->lineinfo[lineindex].CoordinateIncH = (((int)((val1) & 0x07) << 8) | (int)((val2) >> 8));
       index += 4;
     }
@@ -4742,7 +4742,7 @@ void VIDVulkan::drawBitmapLineScroll(vdp2draw_struct *info, CharTexture *texture
         for (j = 0; j < vdp2width; j++)
         {
           //if (info->isverticalscroll){
-          //	sv += T1ReadLong(Vdp2Ram, info->verticalscrolltbl+(j>>3) ) >> 16;
+          //	sv += T1ReadLong(Vdp2RenderRam, info->verticalscrolltbl+(j>>3) ) >> 16;
           //}
           *texture->textdata++ = getPixel32bppbmp(info, baseaddr);
           baseaddr += 4;
@@ -4812,7 +4812,7 @@ void VIDVulkan::drawBitmapCoordinateInc(vdp2draw_struct *info, CharTexture *text
           *texture->textdata++ = 0x0000;
         }
         else {
-          u8 dot = T1ReadByte(Vdp2Ram, baseaddr + addr);
+          u8 dot = T1ReadByte(Vdp2RenderRam, baseaddr + addr);
           u32 alpha = info->alpha;
           if (!(h & 0x01)) dot >>= 4;
           if (!(dot & 0xF) && info->transparencyenable) *texture->textdata++ = 0x00000000;
@@ -4843,7 +4843,7 @@ void VIDVulkan::drawBitmapCoordinateInc(vdp2draw_struct *info, CharTexture *text
         int h = ((j*inch) >> 8);
         u32 alpha = info->alpha;
         u32 addr = ((sh + h)&(info->cellw - 1)) + sv * info->cellw;
-        u8 dot = T1ReadByte(Vdp2Ram, baseaddr + addr);
+        u8 dot = T1ReadByte(Vdp2RenderRam, baseaddr + addr);
         if (!dot && info->transparencyenable) {
           *texture->textdata++ = 0; continue;
         }
@@ -5129,7 +5129,7 @@ void VIDVulkan::drawMap(vdp2draw_struct *info, CharTexture *texture) {
     for (h = -info->patternpixelwh; h < info->draww + info->patternpixelwh; h += info->patternpixelwh) {
 
       if (info->isverticalscroll) {
-        targetv = info->y + v + (T1ReadLong(Vdp2Ram, info->verticalscrolltbl + cell_count) >> 16);
+        targetv = info->y + v + (T1ReadLong(Vdp2RenderRam, info->verticalscrolltbl + cell_count) >> 16);
         cell_count += info->verticalscrollinc;
         // determine which chara shoud be used.
         //mapy   = (v+sy) / (512 * info->planeh);
@@ -5256,7 +5256,7 @@ void VIDVulkan::drawMapPerLine(vdp2draw_struct *info, CharTexture *texture) {
       // info->verticalscrolltbl should be incremented by info->verticalscrollinc
       // each time there's a cell change and reseted at the end of the line...
       // or something like that :)
-      targetv += T1ReadLong(Vdp2Ram, info->verticalscrolltbl) >> 16;
+      targetv += T1ReadLong(Vdp2RenderRam, info->verticalscrolltbl) >> 16;
     }
 
     if (VDPLINE_SZ(info->islinescroll)) {
@@ -5454,7 +5454,7 @@ void VIDVulkan::getPatternAddr(vdp2draw_struct *info)
   {
   case 1:
   {
-    u16 tmp = T1ReadWord(Vdp2Ram, info->addr);
+    u16 tmp = T1ReadWord(Vdp2RenderRam, info->addr);
 
     info->addr += 2;
     info->specialfunction = (info->supplementdata >> 9) & 0x1;
@@ -5503,8 +5503,8 @@ void VIDVulkan::getPatternAddr(vdp2draw_struct *info)
     break;
   }
   case 2: {
-    u16 tmp1 = T1ReadWord(Vdp2Ram, (info->addr & 0x7FFFF));
-    u16 tmp2 = T1ReadWord(Vdp2Ram, (info->addr & 0x7FFFF) + 2);
+    u16 tmp1 = T1ReadWord(Vdp2RenderRam, (info->addr & 0x7FFFF));
+    u16 tmp2 = T1ReadWord(Vdp2RenderRam, (info->addr & 0x7FFFF) + 2);
     info->addr += 4;
     info->charaddr = tmp2 & 0x7FFF;
     info->flipfunction = (tmp1 & 0xC000) >> 14;
@@ -5542,7 +5542,7 @@ void VIDVulkan::getPalAndCharAddr(vdp2draw_struct *info, int planex, int x, int
   {
   case 1:
   {
-    u16 tmp = T1ReadWord(Vdp2Ram, addr);
+    u16 tmp = T1ReadWord(Vdp2RenderRam, addr);
 
     info->specialfunction = (info->supplementdata >> 9) & 0x1;
     info->specialcolorfunction = (info->supplementdata >> 8) & 0x1;
@@ -5590,8 +5590,8 @@ void VIDVulkan::getPalAndCharAddr(vdp2draw_struct *info, int planex, int x, int
     break;
   }
   case 2: {
-    u16 tmp1 = T1ReadWord(Vdp2Ram, addr);
-    u16 tmp2 = T1ReadWord(Vdp2Ram, addr + 2);
+    u16 tmp1 = T1ReadWord(Vdp2RenderRam, addr);
+    u16 tmp2 = T1ReadWord(Vdp2RenderRam, addr + 2);
     info->charaddr = tmp2 & 0x7FFF;
     info->flipfunction = (tmp1 & 0xC000) >> 14;
     switch (info->colornumber) {
@@ -5820,7 +5820,7 @@ void VIDVulkan::drawCell(vdp2draw_struct *info, CharTexture *texture)
 u32 VIDVulkan::getPixel4bpp(vdp2draw_struct *info, u32 addr, CharTexture *texture) {
 
   u32 cramindex;
-  u16 dotw = T1ReadWord(Vdp2Ram, addr & 0x7FFFF);
+  u16 dotw = T1ReadWord(Vdp2RenderRam, addr & 0x7FFFF);
   u8 dot;
   u32 alpha = 0xFF;
 
@@ -5877,7 +5877,7 @@ u32 VIDVulkan::getPixel4bpp(vdp2draw_struct *info, u32 addr, CharTexture *textur
 u32 VIDVulkan::getPixel8bpp(vdp2draw_struct *info, u32 addr, CharTexture *texture) {
 
   u32 cramindex;
-  u16 dotw = T1ReadWord(Vdp2Ram, addr & 0x7FFFF);
+  u16 dotw = T1ReadWord(Vdp2RenderRam, addr & 0x7FFFF);
   u8 dot;
   u32 alpha = info->alpha;
 
@@ -5906,7 +5906,7 @@ u32 VIDVulkan::getPixel8bpp(vdp2draw_struct *info, u32 addr, CharTexture *textur
 u32 VIDVulkan::getPixel16bpp(vdp2draw_struct *info, u32 addr) {
   u32 cramindex;
   u8 alpha = info->alpha;
-  u16 dot = T1ReadWord(Vdp2Ram, addr & 0x7FFFF);
+  u16 dot = T1ReadWord(Vdp2RenderRam, addr & 0x7FFFF);
   if ((dot == 0) && info->transparencyenable) return 0x00000000;
   else {
     cramindex = info->coloroffset + dot;
@@ -5918,7 +5918,7 @@ u32 VIDVulkan::getPixel16bpp(vdp2draw_struct *info, u32 addr) {
 
 u32 VIDVulkan::getPixel16bppbmp(vdp2draw_struct *info, u32 addr) {
   u32 color;
-  u16 dot = T1ReadWord(Vdp2Ram, addr & 0x7FFFF);
+  u16 dot = T1ReadWord(Vdp2RenderRam, addr & 0x7FFFF);
   if (!(dot & 0x8000) && info->transparencyenable) color = 0x00000000;
   else color = SAT2YAB1(info->alpha, dot);
   return color;
@@ -5927,8 +5927,8 @@ u32 VIDVulkan::getPixel16bppbmp(vdp2draw_struct *info, u32 addr) {
 u32 VIDVulkan::getPixel32bppbmp(vdp2draw_struct *info, u32 addr) {
   u32 color;
   u16 dot1, dot2;
-  dot1 = T1ReadWord(Vdp2Ram, addr & 0x7FFFF);
-  dot2 = T1ReadWord(Vdp2Ram, addr + 2 & 0x7FFFF);
+  dot1 = T1ReadWord(Vdp2RenderRam, addr & 0x7FFFF);
+  dot2 = T1ReadWord(Vdp2RenderRam, addr + 2 & 0x7FFFF);
   if (!(dot1 & 0x8000) && info->transparencyenable) color = 0x00000000;
   else color = SAT2YAB2(info->alpha, dot1, dot2);
   return color;
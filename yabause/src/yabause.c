@@ -54,6 +54,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
 #include "cs2.h"
 #include "debug.h"
 #include "error.h"
+#include "inputlog.h"
 #include "memory.h"
 #include "m68kcore.h"
 #include "peripheral.h"
@@ -64,11 +65,15 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
 #include "smpc.h"
 #include "ygl.h"
 #include "vidsoft.h"
+#include "vidshared.h"
 #include "vdp2.h"
 #include "yui.h"
 #include "bios.h"
+#include "avcapture.h"
+#include "bupsync.h"
 //#include "movie.h"
 #include "osdcore.h"
+#include "trace.h"
 #ifdef HAVE_LIBSDL
 #if defined(__APPLE__) || defined(GEKKO)
  #ifdef HAVE_LIBSDL2
@@ -131,6 +136,99 @@ u32 saved_scsp_cycles = 0;//fixed point
 volatile u64 saved_m68k_cycles = 0;//fixed point
 static u32 g_scsp_main_mode = 1;
 
+//////////////////////////////////////////////////////////////////////////////
+// Determinism self-check: one line of state hashes per frame. The first run
+// records them, later runs with the same inputs compare against the file and
+// report the first frame and region that differ.
+
+static FILE * determinism_log = NULL;
+static int determinism_verify = 0;
+
+static const char * const determinism_regions[] = {
+   "MSH2", "SSH2", "HighWram", "LowWram", "SoundRam", "Vdp1Ram", "Vdp2Ram", "Vdp2ColorRam"
+};
+#define DETERMINISM_REGION_NUM (sizeof(determinism_regions) / sizeof(determinism_regions[0]))
+
+u64 YabauseHashBytes(const void * data, size_t size) {
+   const u8 * p = (const u8 *)data;
+   u64 hash = 0xCBF29CE484222325ULL;
+   size_t i;
+   for (i = 0; i + 8 <= size; i += 8) {
+      u64 word;
+      memcpy(&word, p + i, 8);
+      hash = (hash ^ word) * 0x100000001B3ULL;
+   }
+   for (; i < size; i++)
+      hash = (hash ^ p[i]) * 0x100000001B3ULL;
+   return hash;
+}
+
+static char * trace_path = NULL;
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void YabauseDeterminismOpen(const char * path) {
+   determinism_log = NULL;
+   determinism_verify = 0;
+   if (path == NULL || path[0] == '\0')
+      return;
+
+   if ((determinism_log = fopen(path, "r")) != NULL) {
+      determinism_verify = 1;
+      return;
+   }
+   determinism_log = fopen(path, "w");
+}
+
+static void YabauseDeterminismClose(void) {
+   if (determinism_log)
+      fclose(determinism_log);
+   determinism_log = NULL;
+}
+
+static void YabauseDeterminismCheck(void) {
+   u64 hash[DETERMINISM_REGION_NUM];
+   sh2regs_struct regs;
+   u32 i;
+
+   SH2GetRegisters(MSH2, &regs);
+   hash[0] = YabauseHashBytes(&regs, sizeof(regs));
+   SH2GetRegisters(SSH2, &regs);
+   hash[1] = YabauseHashBytes(&regs, sizeof(regs));
+   hash[2] = YabauseHashBytes(HighWram, 0x100000);
+   hash[3] = YabauseHashBytes(LowWram, 0x100000);
+   hash[4] = YabauseHashBytes(SoundRam, 0x80000);
+   hash[5] = YabauseHashBytes(Vdp1Ram, 0x80000);
+   hash[6] = YabauseHashBytes(Vdp2Ram, 0x80000);
+   hash[7] = YabauseHashBytes(Vdp2ColorRam, 0x1000);
+
+   if (!determinism_verify) {
+      fprintf(determinism_log, "%u", yabsys.frame_count);
+      for (i = 0; i < DETERMINISM_REGION_NUM; i++)
+         fprintf(determinism_log, " %016" PRIx64, hash[i]);
+      fprintf(determinism_log, "\n");
+      return;
+   }
+
+   for (i = 0; i < DETERMINISM_REGION_NUM; i++) {
+      u64 expected;
+      u32 frame;
+      if ((i == 0 && fscanf(determinism_log, "%u", &frame) != 1) ||
+          fscanf(determinism_log, " %" SCNx64, &expected) != 1) {
+         // Ran past the end of the recording
+         YabauseDeterminismClose();
+         return;
+      }
+      if (expected != hash[i]) {
+         static char msg[128];
+         sprintf(msg, "Determinism check: %s diverged at frame %u", determinism_regions[i], yabsys.frame_count);
+         YabSetError(YAB_ERR_OTHER, (void *)msg);
+         YabauseDeterminismClose();
+         return;
+      }
+   }
+}
+
 extern char * getLastShaderError();
 
 //////////////////////////////////////////////////////////////////////////////
@@ -195,6 +293,16 @@ int YabauseInit(yabauseinit_struct *init)
 
   yabsys.use_sh2_cache = init->use_sh2_cache;
 
+  yabsys.deterministic = init->deterministic;
+
+  // The pipelined frame swaps VDP1 buffers a frame late, keep it out of
+  // lock-step runs. It needs the render thread of YAB_ASYNC_RENDERING.
+#ifdef YAB_ASYNC_RENDERING
+  yabsys.frame_pipeline = init->frame_pipeline && !init->deterministic;
+#else
+  yabsys.frame_pipeline = 0;
+#endif
+
   q_scsp_frame_start = YabThreadCreateQueue(1);
   q_scsp_finish = YabThreadCreateQueue(1);
   setM68kCounter(0);
@@ -204,6 +312,21 @@ int YabauseInit(yabauseinit_struct *init)
   }
 
    yabsys.frame_count = 0;
+
+   if (init->deterministic)
+      YabauseDeterminismOpen(init->determinism_log);
+
+   if (init->trace_path && init->trace_path[0] != '\0' && trace_path == NULL) {
+      trace_path = strdup(init->trace_path);
+      TraceStart();
+   }
+
+   if ((init->capture_audio_path || init->capture_video_path) && !AVCaptureIsRunning()) {
+      if (AVCaptureStart(init->capture_audio_path, init->capture_audio_format, init->capture_video_path) != 0) {
+         YabSetError(YAB_ERR_CANNOTINIT, _("Capture"));
+         return -1;
+      }
+   }
    yabsys.sync_shift = init->sync_shift;
 
    // Need to set this first, so init routines see it
@@ -217,6 +340,8 @@ int YabauseInit(yabauseinit_struct *init)
       return -1;
    }
 
+   YabRomSetCacheDir(init->rom_cache_dir);
+
    if ((BiosRom = T2MemoryInit(0x80000)) == NULL)
       return -1;
 
@@ -230,6 +355,7 @@ int YabauseInit(yabauseinit_struct *init)
    if (yabsys.extend_backup) {
      FILE * pbackup;
      bupfilename = init->buppath;
+     BupSyncRecover(bupfilename);
      pbackup = fopen(bupfilename, "a+b");
      if (pbackup == NULL) {
        YabSetError(YAB_ERR_CANNOTINIT, _("InternalBackup"));
@@ -254,16 +380,23 @@ int YabauseInit(yabauseinit_struct *init)
 
        BupRamWritten = 0;
        yabsys.extend_backup = 0;
+       if (BupSyncAdd(BUPSYNC_INTERNAL, BupRam, 0x10000, init->buppath) != 0)
+         return -1;
      }
+     else if (BupSyncAdd(BUPSYNC_INTERNAL, BupRam, tweak_backup_file_size, bupfilename) != 0)
+       return -1;
 
    }
    else {
      if ((BupRam = T1MemoryInit(0x10000)) == NULL)
        return -1;
 
+     BupSyncRecover(init->buppath);
      if (LoadBackupRam(init->buppath) != 0)
        FormatBackupRam(BupRam, 0x10000);
      BupRamWritten = 0;
+     if (BupSyncAdd(BUPSYNC_INTERNAL, BupRam, 0x10000, init->buppath) != 0)
+       return -1;
    }
    
    // check if format is needed?
@@ -274,6 +407,8 @@ int YabauseInit(yabauseinit_struct *init)
       return -1;
    }
 
+   BupSyncStart(BUPSYNC_DEFAULT_INTERVAL, yabsys.UseThreads);
+
    MappedMemoryInit();
 
    VideoSetSetting(VDP_SETTING_RBG_USE_COMPUTESHADER, init->rbg_use_compute_shader);
@@ -310,6 +445,7 @@ int YabauseInit(yabauseinit_struct *init)
       YabSetError(YAB_ERR_CANNOTINIT, _("CS2"));
       return -1;
    }
+   Cs2SetTimingMode(init->cd_timing, init->cd_timing_profile, init->cd_event_log);
 
    if (ScuInit() != 0)
    {
@@ -323,12 +459,14 @@ int YabauseInit(yabauseinit_struct *init)
       return -1;
    }
 
-   g_scsp_main_mode = init->scsp_main_mode;
-   if (ScspInit(init->sndcoretype, init->scsp_sync_count_per_frame, init->scsp_main_mode ) != 0)
+   // Lock-step needs the sound thread that follows the SH2 cycle counter
+   g_scsp_main_mode = init->deterministic ? 0 : init->scsp_main_mode;
+   if (ScspInit(init->sndcoretype, init->scsp_sync_count_per_frame, g_scsp_main_mode ) != 0)
    {
       YabSetError(YAB_ERR_CANNOTINIT, _("SCSP/M68K"));
       return -1;
    }
+   ScspSetIdleSkip(init->sound_idle_skip);
 
    if (Vdp1Init() != 0)
    {
@@ -449,14 +587,18 @@ int YabauseInit(yabauseinit_struct *init)
    {
       int num = yabsys.NumThreads < 1 ? 1 : yabsys.NumThreads;
       VIDSoftSetVdp1ThreadEnable(num == 1 ? 0 : 1);
+      VIDSoftSetNumVdp1BandThreads(num);
       VIDSoftSetNumLayerThreads(num);
       VIDSoftSetNumPriorityThreads(num);
+      Vdp2RotationSetNumBandThreads(num);
    }
    else
    {
       VIDSoftSetVdp1ThreadEnable(0);
+      VIDSoftSetNumVdp1BandThreads(0);
       VIDSoftSetNumLayerThreads(0);
       VIDSoftSetNumPriorityThreads(0);
+      Vdp2RotationSetNumBandThreads(0);
    }
 
    scsp_set_use_new(init->use_new_scsp);
@@ -470,17 +612,7 @@ int YabauseInit(yabauseinit_struct *init)
 
 void YabFlushBackups(void)
 {
-  if (BupRam)
-  {
-    if (yabsys.extend_backup) {
-    //  YabFreeMap(BupRam);
-    }
-    else {
-      if (T123Save(BupRam, 0x10000, 1, bupfilename) != 0)
-        YabSetError(YAB_ERR_FILEWRITE, (void *)bupfilename);
-      T1MemoryDeInit(BupRam);
-    }
-  }
+  BupSyncFlush();
   CartFlush();
 }
 
@@ -488,13 +620,23 @@ void YabFlushBackups(void)
 
 void YabauseDeInit(void) {
    
+  YabauseDeterminismClose();
+  InputLogStop();
+  if (trace_path) {
+     TraceStop();
+     TraceWrite(trace_path);
+     free(trace_path);
+     trace_path = NULL;
+  }
+  // The emulation thread may be gone before the next YabauseInit
+  TraceThreadExit();
   OSDDeInit();
    Vdp2DeInit();
    Vdp1DeInit();
    
    SH2DeInit();
 
-   if (BiosRom)
+   if (BiosRom && YabRomUnmap(BiosRom) != 0)
       T2MemoryDeInit(BiosRom);
    BiosRom = NULL;
 
@@ -506,14 +648,15 @@ void YabauseDeInit(void) {
       T2MemoryDeInit(LowWram);
    LowWram = NULL;
 
+   // writes out both backup images, the cartridge one is freed below
+   BupSyncStop();
+
    if (BupRam)
    {
      if (yabsys.extend_backup) {
        YabFreeMap(BupRam);
      }
      else {
-       if (T123Save(BupRam, 0x10000, 1, bupfilename) != 0)
-         YabSetError(YAB_ERR_FILEWRITE, (void *)bupfilename);
        T1MemoryDeInit(BupRam);
      }
    }
@@ -527,6 +670,9 @@ void YabauseDeInit(void) {
    PerDeInit();
    VideoDeInit();
    CheatDeInit();
+
+   // after the sound and video threads are gone
+   AVCaptureStop();
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -659,10 +805,12 @@ u64 getM68KCounter();
 u64 g_m68K_dec_cycle = 0;
 
 
+
 int YabauseEmulate(void) {
    int oneframeexec = 0;
    yabsys.frame_count++;
    PlayRecorder_proc(yabsys.frame_count);
+   InputLogFrame();
 
    const u32 cyclesinc =
       yabsys.DecilineMode ? yabsys.DecilineStop : yabsys.DecilineStop * 10;
@@ -734,6 +882,8 @@ int YabauseEmulate(void) {
    SH2OnFrame(SSH2);
    u64 cpu_emutime = 0;
    Vdp2UpdateHv(0,0);
+   TraceThreadName("emulation");
+   TRACE_BEGIN(TRACE_FRAME);
    while (!oneframeexec)
    {
       PROFILE_START("Total Emulation");
@@ -749,6 +899,7 @@ int YabauseEmulate(void) {
 #ifdef YAB_STATICS
       u64 current_cpu_clock = YabauseGetTicks();
 #endif
+      TRACE_BEGIN(TRACE_SH2_EXEC);
       if( sync_shift != 0 ){
         u32 i;
         const u32 div = sync_shift;
@@ -770,6 +921,7 @@ int YabauseEmulate(void) {
         if (yabsys.IsSSH2Running)
           SH2Exec(SSH2, sh2cycles);
       }
+      TRACE_END(TRACE_SH2_EXEC);
 
 #ifdef YAB_STATICS
       cpu_emutime += (YabauseGetTicks() - current_cpu_clock) * 1000000 / yabsys.tickfreq;
@@ -780,16 +932,22 @@ int YabauseEmulate(void) {
        if(yabsys.DecilineCount == 9) {
          // HBlankIN
          PROFILE_START("hblankin");
+         TRACE_BEGIN(TRACE_VDP2_HBLANK);
          Vdp2HBlankIN();
+         TRACE_END(TRACE_VDP2_HBLANK);
          PROFILE_STOP("hblankin");
        }
        else if (yabsys.DecilineCount == 10) {
          // HBlankOUT
          PROFILE_START("hblankout");
+         TRACE_BEGIN(TRACE_VDP2_HBLANK);
          Vdp2HBlankOUT();
+         TRACE_END(TRACE_VDP2_HBLANK);
          PROFILE_STOP("hblankout");
          PROFILE_START("SCSP");
+         TRACE_BEGIN(TRACE_SCSP_EXEC);
          ScspExec();
+         TRACE_END(TRACE_SCSP_EXEC);
          PROFILE_STOP("SCSP");
          yabsys.DecilineCount = 0;
          yabsys.LineCount++;
@@ -801,10 +959,14 @@ int YabauseEmulate(void) {
 #endif
             PROFILE_START("vblankin");
             // VBlankIN
+            TRACE_BEGIN(TRACE_VDP2_VBLANKIN);
             SmpcINTBACKEnd();
             Vdp2VBlankIN();
+            TRACE_END(TRACE_VDP2_VBLANKIN);
 #if defined(ASYNC_SCSP)
+            TRACE_BEGIN(TRACE_SCSP_SYNC_WAIT);
             SyncCPUtoSCSP();
+            TRACE_END(TRACE_SCSP_SYNC_WAIT);
 #endif
             PROFILE_STOP("vblankin");
             CheatDoPatches();
@@ -813,7 +975,9 @@ int YabauseEmulate(void) {
          {
             // VBlankOUT
             PROFILE_START("VDP1/VDP2");
+            TRACE_BEGIN(TRACE_VDP2_VBLANKOUT);
             Vdp2VBlankOUT();
+            TRACE_END(TRACE_VDP2_VBLANKOUT);
             yabsys.LineCount = 0;
             oneframeexec = 1;
             PROFILE_STOP("VDP1/VDP2");
@@ -822,7 +986,9 @@ int YabauseEmulate(void) {
       }
 
       PROFILE_START("SCU");
+      TRACE_BEGIN(TRACE_SCU_EXEC);
       ScuExec(sh2cycles >> 1);
+      TRACE_END(TRACE_SCU_EXEC);
       PROFILE_STOP("SCU");
       PROFILE_START("68K");
       M68KSync();  // Wait for the previous iteration to finish
@@ -830,10 +996,14 @@ int YabauseEmulate(void) {
 
       yabsys.UsecFrac += usecinc;
       PROFILE_START("SMPC");
+      TRACE_BEGIN(TRACE_SMPC_EXEC);
       SmpcExec(yabsys.UsecFrac >> YABSYS_TIMING_BITS);
+      TRACE_END(TRACE_SMPC_EXEC);
       PROFILE_STOP("SMPC");
       PROFILE_START("CDB");
+      TRACE_BEGIN(TRACE_CS2_EXEC);
       Cs2Exec(yabsys.UsecFrac >> YABSYS_TIMING_BITS);
+      TRACE_END(TRACE_CS2_EXEC);
       PROFILE_STOP("CDB");
       yabsys.UsecFrac &= YABSYS_TIMING_MASK;
       
@@ -849,7 +1019,9 @@ int YabauseEmulate(void) {
             cycles++;
             saved_centicycles -= 100;
          }
+         TRACE_BEGIN(TRACE_M68K_EXEC);
          M68KExec(cycles);
+         TRACE_END(TRACE_M68K_EXEC);
          PROFILE_STOP("68K");
       }
       else
@@ -868,12 +1040,18 @@ int YabauseEmulate(void) {
 #else
       {
         saved_m68k_cycles  += m68k_cycles_per_deciline;
+        if (yabsys.deterministic)
+          ScspLockStepBoundary();
         setM68kCounter(saved_m68k_cycles);
 #endif
       }
       PROFILE_STOP("Total Emulation");
    }
    M68KSync();
+   TRACE_END(TRACE_FRAME);
+
+   if (determinism_log)
+      YabauseDeterminismCheck();
 
 #ifdef YAB_WANT_SSF
 
@@ -934,6 +1112,7 @@ void SyncCPUtoSCSP() {
     YabWaitEventQueue(q_scsp_finish);
     saved_m68k_cycles = 0;
     setM68kCounter(saved_m68k_cycles);
+    setM68kDoneCounter(0);
     YabAddEventQueue(q_scsp_frame_start, 0);
   }
   //LOG("[SH2] START SCSP");
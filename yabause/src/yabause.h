@@ -89,6 +89,18 @@ typedef struct
    const char *playRecordPath;
    int use_cpu_affinity;
    int use_sh2_cache;
+   int frame_pipeline; // 1 = software renderer draws frame N while frame N+1 is emulated, YAB_ASYNC_RENDERING only
+   int deterministic;  // 1 = lock-step SCSP and VDP threads, identical inputs give identical states
+   const char *determinism_log; // per-frame state hashes, recorded if missing, verified otherwise
+   int cd_timing;      // 0 = real drive seek/read speed, 1 = accelerated
+   const char *cd_timing_profile; // per-game overrides of cd_timing
+   const char *cd_event_log; // CD block interrupt/status order, recorded if missing, verified otherwise
+   int sound_idle_skip; // 1 = fast-forward the 68K through polling loops until the next event
+   const char *trace_path; // Chrome trace of the whole run, written on YabauseDeInit
+   const char *capture_audio_path; // sound output of the whole run, written by a background thread
+   int capture_audio_format; // AVCAPTURE_AUDIO_WAV or AVCAPTURE_AUDIO_RAW
+   const char *capture_video_path; // software renderer output as YUV4MPEG2
+   const char *rom_cache_dir; // byte swapped copies of mapped ROM images, NULL = load them instead
 } yabauseinit_struct;
 
 #define CLKTYPE_26MHZ           0
@@ -113,6 +125,7 @@ int YabauseExec(void);
 void YabauseStartSlave(void);
 void YabauseStopSlave(void);
 u64 YabauseGetTicks(void);
+u64 YabauseHashBytes(const void * data, size_t size);
 void YabauseSetVideoFormat(int type);
 void YabauseSpeedySetup(void);
 int YabauseQuickLoadGame(void);
@@ -147,6 +160,8 @@ typedef struct
    u32 sync_shift;
    int use_cpu_affinity;
    int use_sh2_cache;
+   int frame_pipeline;
+   int deterministic;
    int Hcount;
 } yabsys_struct;
 
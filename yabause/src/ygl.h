@@ -262,6 +262,41 @@ typedef struct _YglCacheHash {
 	struct _YglCacheHash * next;
 } YglCacheHash;
 
+// Cross-frame tile cache. Decoded patterns are kept in fixed-size slots at the
+// top of the atlas and keyed by VRAM content, so unchanged tiles are not
+// decoded or uploaded again on the next frame.
+#define YGL_PCACHE_HASHSIZE (0x1000)
+#define YGL_PCACHE_POOL_NUM (2)
+
+typedef struct {
+	u64 key;        // decode parameters
+	u64 content;    // hash of the VRAM bytes
+	u32 frame;      // last frame this slot was drawn
+	int prev;       // LRU links, -1 terminated
+	int next;
+	int hnext;      // hash chain
+	int valid;
+} YglPersistentSlot;
+
+typedef struct {
+	unsigned int size;     // slot edge in texels
+	unsigned int top;      // first atlas row of this pool
+	unsigned int columns;
+	unsigned int rows;
+	YglPersistentSlot * slots;
+	int head;              // most recently used
+	int tail;              // least recently used
+	int hash[YGL_PCACHE_HASHSIZE];
+	u32 dirty;             // slot rows waiting for upload, one bit per row
+} YglPersistentPool;
+
+typedef struct {
+	u64 hits;
+	u64 misses;
+	u64 evictions;
+	u64 uploaded;          // texels sent to the GPU from the pools
+} YglPersistentCacheStats;
+
 typedef struct {
 	unsigned int currentX;
 	unsigned int currentY;
@@ -281,6 +316,15 @@ typedef struct {
   GLuint pixelBufferID_in[2];
   unsigned int * texture_in[2];
 
+  unsigned int pcache_height;     // atlas rows reserved for the persistent pools
+  unsigned int * pcache_texture;  // CPU copy of the reserved rows
+  YglPersistentPool pcache[YGL_PCACHE_POOL_NUM];
+  u32 pcache_frame;
+  u64 pcache_hits;
+  u64 pcache_misses;
+  u64 pcache_evictions;
+  u64 pcache_uploaded;            // texels sent to the GPU from the pools
+
 } YglTextureManager;
 
 extern YglTextureManager * YglTM;
@@ -302,6 +346,15 @@ int YglIsCached(YglTextureManager * tm, u64, YglCache *);
 void YglCacheAdd(YglTextureManager * tm, u64, YglCache *);
 void YglCacheReset(YglTextureManager * tm);
 
+void YglPersistentCacheInit(YglTextureManager * tm);
+void YglPersistentCacheDeInit(YglTextureManager * tm);
+void YglPersistentCacheFlush(YglTextureManager * tm);
+void YglPersistentCacheResize(YglTextureManager * tm, unsigned int width);
+void YglPersistentCacheUpload(YglTextureManager * tm);
+int YglPersistentCacheLookup(YglTextureManager * tm, unsigned int size, u64 key, u64 content, YglCache * c);
+int YglPersistentCacheAdd(YglTextureManager * tm, unsigned int size, u64 key, u64 content, YglTexture * output, YglCache * c);
+void YglPersistentCacheGetStats(YglTextureManager * tm, YglPersistentCacheStats * stats);
+
 #define VDP1_COLOR_CL_REPLACE 0x00
 #define VDP1_COLOR_CL_SHADOW 0x10
 #define VDP1_COLOR_CL_HALF_LUMINANCE 0x20
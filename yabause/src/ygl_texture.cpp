@@ -1050,6 +1050,8 @@ class RBGGenerator {
   int struct_size_;
 
   void * mapped_vram = nullptr;
+  u32 vram_gen_[VDP2_RAM_PAGE_COUNT] = {};
+  u32 cram_gen_[VDP2_CRAM_PAGE_COUNT] = {};
 
   int local_size_x = 10;
   int local_size_y = 10;
@@ -1186,7 +1188,7 @@ public:
 
     glGenBuffers(1, &ssbo_vram_);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo_vram_);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, 0x80000, (void*)Vdp2Ram, GL_DYNAMIC_DRAW);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, 0x80000, (void*)Vdp2RenderRam, GL_DYNAMIC_DRAW);
 
     glGenBuffers(1, &ssbo_paraA_);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo_paraA_);
@@ -2528,7 +2530,8 @@ public:
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo_vram_);
     //glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, 0x80000, (void*)Vdp2Ram);
     if (mapped_vram == nullptr) mapped_vram = glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, 0x80000, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
-    memcpy(mapped_vram, Vdp2Ram, 0x80000);
+    // The mapping is not invalidated, so only pages written since the last upload need copying
+    Vdp2RenderRamSyncPages((u8*)mapped_vram, vram_gen_);
     glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
     mapped_vram = nullptr;
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, ssbo_vram_);
@@ -2541,7 +2544,12 @@ public:
         glBufferData(GL_SHADER_STORAGE_BUFFER, 0x1000, NULL, GL_DYNAMIC_DRAW);
       }
       glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo_cram_);
-      glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, 0x1000, (void*)Vdp2ColorRam);
+      for (int i = 0; i < VDP2_CRAM_PAGE_COUNT; i++) {
+        if (cram_gen_[i] != Vdp2ColorRamPageGen[i]) {
+          cram_gen_[i] = Vdp2ColorRamPageGen[i];
+          glBufferSubData(GL_SHADER_STORAGE_BUFFER, i << VDP2_CRAM_PAGE_SHIFT, 1 << VDP2_CRAM_PAGE_SHIFT, (void*)(Vdp2ColorRam + (i << VDP2_CRAM_PAGE_SHIFT)));
+        }
+      }
       glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, ssbo_cram_);
     }
 
@@ -4193,13 +4201,14 @@ void RBGGeneratorVulkan::update(VIDVulkan::RBGDrawInfo * rbg, const vdp2rotation
     d.unmapMemory(ssbo_window_.mem);
   }
 
+  // Host visible memory keeps its contents, so only pages written since the last upload need copying
   data = d.mapMemory(ssbo_vram_.mem, 0, 0x80000);
-  memcpy(data, Vdp2Ram, 0x80000);
+  Vdp2RenderRamSyncPages((u8*)data, vram_gen_);
   d.unmapMemory(ssbo_vram_.mem);
 
   if (rbg->info.specialcolormode == 3 || paraa.k_mem_type != 0 || parab.k_mem_type != 0) {
     data = d.mapMemory(ssbo_cram_.mem, 0, 0x1000);
-    memcpy(data, Vdp2ColorRam, 0x1000);
+    Vdp2ColorRamSyncPages((u8*)data, cram_gen_);
     d.unmapMemory(ssbo_cram_.mem);
   }
 
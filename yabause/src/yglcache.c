@@ -97,6 +97,7 @@ void YglCacheAdd(YglTextureManager * tm, u64 addr, YglCache * c) {
 
   if (tm->HashTable[hashkey] == NULL){
 	add = YglgetNewCash(tm);
+    if (add == NULL) return;
     add->addr = addr;
     add->x = c->x;
     add->y = c->y;
@@ -116,6 +117,7 @@ void YglCacheAdd(YglTextureManager * tm, u64 addr, YglCache * c) {
     }
 
 	add = YglgetNewCash(tm);
+    if (add == NULL) return;
     add->addr = addr;
     add->x = c->x;
     add->y = c->y;
@@ -130,6 +132,214 @@ void YglCacheAdd(YglTextureManager * tm, u64 addr, YglCache * c) {
 void YglCacheReset(YglTextureManager * tm) {
 	memset(tm->HashTable, 0, sizeof(tm->HashTable));
 	tm->CashLink_index = 0;
+	tm->pcache_frame++;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static const struct {
+  unsigned int size;
+  unsigned int rows;
+} YglPersistentPoolLayout[YGL_PCACHE_POOL_NUM] = {  // at most 32 rows, see dirty
+  { 8, 24 },   // 8x8 patterns
+  { 16, 8 },   // 16x16 patterns
+};
+
+static YglPersistentPool * YglPersistentGetPool(YglTextureManager * tm, unsigned int size) {
+  int i;
+  for (i = 0; i < YGL_PCACHE_POOL_NUM; i++) {
+    if (tm->pcache[i].size == size && tm->pcache[i].slots != NULL)
+      return &tm->pcache[i];
+  }
+  return NULL;
+}
+
+static u32 YglPersistentGetHash(u64 key, u64 content) {
+  u64 h = (key ^ content) * 0x9E3779B97F4A7C15ULL;
+  return (u32)(h >> 52) & (YGL_PCACHE_HASHSIZE - 1);
+}
+
+static void YglPersistentUnlink(YglPersistentPool * pool, int index) {
+  YglPersistentSlot * slot = &pool->slots[index];
+  if (slot->prev != -1) pool->slots[slot->prev].next = slot->next;
+  else pool->head = slot->next;
+  if (slot->next != -1) pool->slots[slot->next].prev = slot->prev;
+  else pool->tail = slot->prev;
+}
+
+static void YglPersistentPushHead(YglPersistentPool * pool, int index) {
+  YglPersistentSlot * slot = &pool->slots[index];
+  slot->prev = -1;
+  slot->next = pool->head;
+  if (pool->head != -1) pool->slots[pool->head].prev = index;
+  pool->head = index;
+  if (pool->tail == -1) pool->tail = index;
+}
+
+static void YglPersistentSlotPos(YglPersistentPool * pool, int index, YglCache * c) {
+  c->x = (float)((index % pool->columns) * pool->size);
+  c->y = (float)(pool->top + (index / pool->columns) * pool->size);
+}
+
+static void YglPersistentMarkDirty(YglPersistentPool * pool, int row) {
+  pool->dirty |= 1u << row;
+}
+
+void YglPersistentCacheInit(YglTextureManager * tm) {
+  int i;
+  unsigned int top = 0;
+
+  for (i = 0; i < YGL_PCACHE_POOL_NUM; i++) {
+    YglPersistentPool * pool = &tm->pcache[i];
+    pool->size = YglPersistentPoolLayout[i].size;
+    pool->rows = YglPersistentPoolLayout[i].rows;
+    pool->columns = tm->width / pool->size;
+    pool->top = top;
+    pool->slots = (YglPersistentSlot *)malloc(sizeof(YglPersistentSlot) * pool->columns * pool->rows);
+    top += pool->size * pool->rows;
+  }
+  tm->pcache_height = top;
+  tm->pcache_texture = (unsigned int *)calloc(tm->width * tm->pcache_height, sizeof(unsigned int));
+  YglPersistentCacheFlush(tm);
+}
+
+void YglPersistentCacheDeInit(YglTextureManager * tm) {
+  int i;
+  for (i = 0; i < YGL_PCACHE_POOL_NUM; i++) {
+    free(tm->pcache[i].slots);
+    tm->pcache[i].slots = NULL;
+  }
+  free(tm->pcache_texture);
+  tm->pcache_texture = NULL;
+}
+
+void YglPersistentCacheFlush(YglTextureManager * tm) {
+  int i, j;
+  for (i = 0; i < YGL_PCACHE_POOL_NUM; i++) {
+    YglPersistentPool * pool = &tm->pcache[i];
+    int count = pool->columns * pool->rows;
+    pool->head = -1;
+    pool->tail = -1;
+    for (j = 0; j < YGL_PCACHE_HASHSIZE; j++) pool->hash[j] = -1;
+    for (j = 0; j < count; j++) {
+      pool->slots[j].valid = 0;
+      pool->slots[j].frame = 0;
+      pool->slots[j].hnext = -1;
+      YglPersistentPushHead(pool, j);
+    }
+    pool->dirty = 0;
+  }
+}
+
+// Called when the atlas textures are recreated. Slot coordinates stay valid
+// because the atlas only ever grows, but the new texture has to be refilled.
+void YglPersistentCacheResize(YglTextureManager * tm, unsigned int width) {
+  int i;
+  if (width > tm->width) {
+    unsigned int y;
+    unsigned int * texture = (unsigned int *)calloc(width * tm->pcache_height, sizeof(unsigned int));
+    for (y = 0; y < tm->pcache_height; y++) {
+      memcpy(texture + y * width, tm->pcache_texture + y * tm->width, tm->width * sizeof(unsigned int));
+    }
+    free(tm->pcache_texture);
+    tm->pcache_texture = texture;
+  }
+  for (i = 0; i < YGL_PCACHE_POOL_NUM; i++) {
+    tm->pcache[i].dirty = (tm->pcache[i].rows < 32) ? (1u << tm->pcache[i].rows) - 1 : 0xFFFFFFFF;
+  }
+}
+
+// Sends the slot rows filled since the last push. The atlas texture must be
+// bound and no pixel unpack buffer may be bound.
+void YglPersistentCacheUpload(YglTextureManager * tm) {
+  int i;
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, tm->width);
+  for (i = 0; i < YGL_PCACHE_POOL_NUM; i++) {
+    YglPersistentPool * pool = &tm->pcache[i];
+    unsigned int row = 0;
+    // one upload per run of dirty rows, evictions land on scattered rows
+    while (row < pool->rows && (pool->dirty >> row) != 0) {
+      unsigned int y, h, end;
+      if (!((pool->dirty >> row) & 1)) { row++; continue; }
+      for (end = row; end < pool->rows && ((pool->dirty >> end) & 1); end++);
+      y = pool->top + row * pool->size;
+      h = (end - row) * pool->size;
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, pool->columns * pool->size, h, GL_RGBA, GL_UNSIGNED_BYTE, tm->pcache_texture + y * tm->width);
+      tm->pcache_uploaded += pool->columns * pool->size * h;
+      row = end;
+    }
+    pool->dirty = 0;
+  }
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
+
+int YglPersistentCacheLookup(YglTextureManager * tm, unsigned int size, u64 key, u64 content, YglCache * c) {
+  YglPersistentPool * pool = YglPersistentGetPool(tm, size);
+  int index;
+
+  if (pool == NULL) return 0;
+
+  index = pool->hash[YglPersistentGetHash(key, content)];
+  while (index != -1) {
+    YglPersistentSlot * slot = &pool->slots[index];
+    if (slot->key == key && slot->content == content) {
+      slot->frame = tm->pcache_frame;
+      YglPersistentUnlink(pool, index);
+      YglPersistentPushHead(pool, index);
+      YglPersistentSlotPos(pool, index, c);
+      tm->pcache_hits++;
+      return 1;
+    }
+    index = slot->hnext;
+  }
+  return 0;
+}
+
+// Takes the least recently used slot for a new pattern. Returns 0 when every
+// slot is already referenced by this frame so the caller falls back to the
+// per-frame area.
+int YglPersistentCacheAdd(YglTextureManager * tm, unsigned int size, u64 key, u64 content, YglTexture * output, YglCache * c) {
+  YglPersistentPool * pool = YglPersistentGetPool(tm, size);
+  YglPersistentSlot * slot;
+  u32 hashkey;
+  int index;
+
+  if (pool == NULL) return 0;
+
+  tm->pcache_misses++;
+  index = pool->tail;
+  slot = &pool->slots[index];
+  if (slot->valid && slot->frame == tm->pcache_frame) return 0;
+
+  if (slot->valid) {
+    int * link = &pool->hash[YglPersistentGetHash(slot->key, slot->content)];
+    while (*link != index) link = &pool->slots[*link].hnext;
+    *link = slot->hnext;
+    tm->pcache_evictions++;
+  }
+
+  hashkey = YglPersistentGetHash(key, content);
+  slot->key = key;
+  slot->content = content;
+  slot->frame = tm->pcache_frame;
+  slot->valid = 1;
+  slot->hnext = pool->hash[hashkey];
+  pool->hash[hashkey] = index;
+  YglPersistentUnlink(pool, index);
+  YglPersistentPushHead(pool, index);
+  YglPersistentMarkDirty(pool, index / pool->columns);
+
+  YglPersistentSlotPos(pool, index, c);
+  output->w = tm->width - size;
+  output->textdata = tm->pcache_texture + (unsigned int)c->y * tm->width + (unsigned int)c->x;
+  return 1;
+}
+
+void YglPersistentCacheGetStats(YglTextureManager * tm, YglPersistentCacheStats * stats) {
+  stats->hits = tm->pcache_hits;
+  stats->misses = tm->pcache_misses;
+  stats->evictions = tm->pcache_evictions;
+  stats->uploaded = tm->pcache_uploaded;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -25,6 +25,7 @@
 #include "vidshared.h"
 #include "debug.h"
 #include "frameprofile.h"
+#include "osdcore.h"
 
 #define NUM_TEXTURE_BUFFER 1
 
@@ -495,6 +496,7 @@ YglTextureManager * YglTMInit(unsigned int w, unsigned int h) {
   tm->height = h;
   tm->current = 0;
 
+  YglPersistentCacheInit(tm);
   YglTMReset(tm);
 
   for (int i = 0; i < NUM_TEXTURE_BUFFER; i++) {
@@ -551,6 +553,7 @@ void YglTMDeInit(YglTextureManager * tm) {
     tm->pixelBufferID_in[i] = 0;
   }
 
+  YglPersistentCacheDeInit(tm);
   free(tm);
 }
 
@@ -558,8 +561,8 @@ void YglTMDeInit(YglTextureManager * tm) {
 
 void YglTMReset(YglTextureManager * tm  ) {
   tm->currentX = 0;
-  tm->currentY = 0;
-  tm->yMax = 0;
+  tm->currentY = tm->pcache_height;
+  tm->yMax = tm->pcache_height;
 }
 
 #if 0
@@ -583,8 +586,12 @@ void YglTmPush(YglTextureManager * tm){
   if (tm->texture != NULL ) {
     glBindBuffer(GL_PIXEL_UNPACK_BUFFER, tm->pixelBufferID_in[tm->current] );
     glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, tm->width, tm->yMax, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    if (tm->yMax > tm->pcache_height) {
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, tm->pcache_height, tm->width, tm->yMax - tm->pcache_height, GL_RGBA, GL_UNSIGNED_BYTE,
+        (void*)(uintptr_t)(tm->pcache_height * tm->width * 4));
+    }
     glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    YglPersistentCacheUpload(tm);
     tm->texture = NULL;
   }
 }
@@ -698,6 +705,7 @@ void YglTMRealloc(YglTextureManager * tm, unsigned int width, unsigned int heigh
   }
 
   // user new texture
+  YglPersistentCacheResize(tm, width);
   tm->width = width;
   tm->height = height;
   tm->texture = tm->texture_in[tm->current];
@@ -3956,6 +3964,13 @@ render_finish:
   glDisable(GL_SCISSOR_TEST);
   glDisable(GL_STENCIL_TEST);
   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  if (_Ygl->texture_manager != NULL) {
+    YglPersistentCacheStats pstats;
+    YglPersistentCacheGetStats(_Ygl->texture_manager, &pstats);
+    OSDPushMessage(OSDMSG_DEBUG, 1, "PATTERN hit %llu miss %llu evict %llu upload %llu",
+      (unsigned long long)pstats.hits, (unsigned long long)pstats.misses,
+      (unsigned long long)pstats.evictions, (unsigned long long)pstats.uploaded);
+  }
   OSDDisplayMessages(NULL,0,0);
   YuiSwapBuffers();
   FrameProfileAdd("YglRender end");